@@ -0,0 +1,48 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+# Fails when an object of a level of a multi-level build defines a global
+# symbol without the prefix of the level, i.e., a non-static function or
+# variable that is missing from include/internal/bike_namespace.h. Such a
+# symbol would be defined once per level, and the levels would not link
+# together (or would silently share one of the definitions).
+#
+# Run with cmake -DNM=<nm> -DPREFIX=<prefix> -DOBJECTS=<obj1|obj2|...> -P <this
+# file>
+
+if(NOT NM OR NOT PREFIX OR NOT OBJECTS)
+  message(FATAL_ERROR "NM, PREFIX and OBJECTS must be set")
+endif()
+
+string(REPLACE "|" ";" OBJECTS "${OBJECTS}")
+
+# The POSIX output format of nm: <name> <type> [<value> <size>]
+execute_process(
+  COMMAND ${NM} -g -P ${OBJECTS}
+  OUTPUT_VARIABLE SYMBOLS
+  RESULT_VARIABLE NM_RESULT)
+
+if(NOT NM_RESULT EQUAL 0)
+  message(FATAL_ERROR "${NM} failed on the objects of ${PREFIX}")
+endif()
+
+string(REPLACE "\n" ";" SYMBOLS "${SYMBOLS}")
+
+set(MISSING "")
+foreach(line ${SYMBOLS})
+  # The defined (global) symbols, with the leading underscore of Mach-O
+  if(line MATCHES "^_?([A-Za-z0-9_.$]+) [A-TV-Z] ")
+    set(name ${CMAKE_MATCH_1})
+    if(NOT name MATCHES "^${PREFIX}")
+      list(APPEND MISSING ${name})
+    endif()
+  endif()
+endforeach()
+
+if(MISSING)
+  list(REMOVE_DUPLICATES MISSING)
+  string(REPLACE ";" "\n  " MISSING "${MISSING}")
+  message(FATAL_ERROR
+    "Global symbols without the prefix ${PREFIX} (add them to "
+    "include/internal/bike_namespace.h):\n  ${MISSING}")
+endif()
@@ -62,6 +62,14 @@ if(RDTSC)
   set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DRDTSC")
 endif()
 
+if(BIKE_PROFILE)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DBIKE_PROFILE")
+endif()
+
+if(DECODE_TRACE)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DDECODE_TRACE=1")
+endif()
+
 if(VERBOSE)
   set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DVERBOSE=${VERBOSE}")
 endif()
@@ -86,6 +94,42 @@ if(BIND_PK_AND_M)
   set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DBIND_PK_AND_M=1")
 endif()
 
+if(DECODE_VARTIME)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DDECODE_VARTIME=1")
+endif()
+
+if(BG_DECODER)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DBG_DECODER=1")
+endif()
+
+if(MAJ_DECODER)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DMAJ_DECODER=1")
+endif()
+
+if(INCREMENTAL_SYNDROME)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DINCREMENTAL_SYNDROME=1")
+endif()
+
+if(INTRA_OP_PARALLEL)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DINTRA_OP_PARALLEL=1")
+endif()
+
+if(SORTED_SET_BITS)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DSORTED_SET_BITS=1")
+endif()
+
+if(SPARSE_FO_CHECK)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DSPARSE_FO_CHECK=1")
+endif()
+
+if(DELTA_ROTATION)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DDELTA_ROTATION=1")
+endif()
+
+if(GF2X_INV_DIVSTEP)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DGF2X_INV_DIVSTEP=1")
+endif()
+
 # SHA3 is the default in Round-4 BIKE
 if(NOT USE_AES_AND_SHA2)
   set(USE_SHA3_AND_SHAKE ON)
@@ -140,4 +184,20 @@ set_source_files_properties(${AVX2_SRCS} PROPERTIES COMPILE_OPTIONS "-mavx2")
 set_source_files_properties(${AVX512_SRCS} PROPERTIES COMPILE_OPTIONS "${AVX512_FLAGS}")
 
 set_source_files_properties(${PROJECT_SOURCE_DIR}/src/gf2x/gf2x_mul_base_pclmul.c PROPERTIES COMPILE_OPTIONS "-mpclmul;")
+set_source_files_properties(${PROJECT_SOURCE_DIR}/src/gf2x/gf2x_divstep_pclmul.c PROPERTIES COMPILE_OPTIONS "-mpclmul;")
 set_source_files_properties(${PROJECT_SOURCE_DIR}/src/gf2x/gf2x_mul_base_vpclmul.c PROPERTIES COMPILE_OPTIONS "-mvpclmulqdq;${AVX512_FLAGS}")
+set_source_files_properties(${PROJECT_SOURCE_DIR}/src/gf2x/gf2x_divstep_vpclmul.c PROPERTIES COMPILE_OPTIONS "-mvpclmulqdq;${AVX512_FLAGS}")
+set_source_files_properties(${PROJECT_SOURCE_DIR}/src/decode/decode_vpopcnt.c PROPERTIES COMPILE_OPTIONS "-mavx512vpopcntdq;${AVX512_FLAGS}")
+set_source_files_properties(${PROJECT_SOURCE_DIR}/src/random/aes_vaes.c PROPERTIES COMPILE_OPTIONS "-mvaes;${AVX512_FLAGS}")
+
+# The SHA512 extensions (sha512_ni.c) are built only on request, and are then
+# used when the CPU has them. They require a compiler that supports -msha512.
+if(SHA512_NI AND X86_64 AND STANDALONE_IMPL AND (NOT USE_SHA3_AND_SHAKE))
+  include(CheckCCompilerFlag)
+  check_c_compiler_flag("-msha512" HAVE_SHA512_NI)
+  if(NOT HAVE_SHA512_NI)
+    message(FATAL_ERROR "SHA512_NI requires a compiler that supports -msha512")
+  endif()
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DSHA512_NI_SUPPORTED=1")
+  set_source_files_properties(${PROJECT_SOURCE_DIR}/src/random/sha512_ni.c PROPERTIES COMPILE_OPTIONS "-msha512;-mavx2")
+endif()
@@ -0,0 +1,63 @@
+# Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+# A multi-level build (e.g. -DMULTI_LEVEL="1;3;17").
+# The level dependent sources of the library are compiled once per level with
+# LEVEL=<level> and BIKE_NAMESPACE=bike_l<level>_ (see bike_namespace.h), while
+# the level independent sources are compiled once. The runtime dispatcher
+# (src/multi_level.c) gives access to the levels by their number.
+
+if(LEVEL)
+  message(FATAL_ERROR "Can't set both LEVEL and MULTI_LEVEL")
+endif()
+
+get_target_property(BIKE_SRCS ${PROJECT_NAME} SOURCES)
+
+set(SHARED_SRCS "")
+set(LEVEL_SRCS "")
+foreach(src ${BIKE_SRCS})
+  if(src MATCHES "/(arena|cpu_features|decode_trace|error|fips202|parallel|profile|aes|aes_vaes|rng|sha|sha3_x4|sha512_[a-z0-9_]+|keccak_x[48]_[a-z0-9]+)\\.c$" OR src MATCHES "\\.h$")
+    list(APPEND SHARED_SRCS ${src})
+  else()
+    list(APPEND LEVEL_SRCS ${src})
+  endif()
+endforeach()
+
+set(LEVEL_LIST "")
+foreach(lvl ${MULTI_LEVEL})
+  add_library(bike_l${lvl} OBJECT ${LEVEL_SRCS})
+  target_compile_definitions(bike_l${lvl}
+    PRIVATE
+      LEVEL=${lvl}
+      BIKE_NAMESPACE=bike_l${lvl}_)
+
+  list(APPEND SHARED_SRCS $<TARGET_OBJECTS:bike_l${lvl}>)
+  set(LEVEL_LIST "${LEVEL_LIST}X(${lvl})")
+
+  # Every global symbol of the level must have its prefix
+  add_custom_command(TARGET ${PROJECT_NAME} POST_BUILD
+    COMMAND ${CMAKE_COMMAND}
+      -DNM=${CMAKE_NM}
+      -DPREFIX=bike_l${lvl}_
+      "-DOBJECTS=$<JOIN:$<TARGET_OBJECTS:bike_l${lvl}>,|>"
+      -P ${PROJECT_SOURCE_DIR}/cmake/check-namespace.cmake
+    VERBATIM)
+endforeach()
+
+list(APPEND SHARED_SRCS ${SRC_DIR}/multi_level.c)
+set_target_properties(${PROJECT_NAME} PROPERTIES SOURCES "${SHARED_SRCS}")
+set_source_files_properties(${SRC_DIR}/multi_level.c
+  PROPERTIES COMPILE_DEFINITIONS "BIKE_LEVEL_LIST=${LEVEL_LIST}")
+
+# The tests, the DFR simulation, the benchmarks and the KAT verification use
+# the first level directly
+list(GET MULTI_LEVEL 0 FIRST_LEVEL)
+foreach(target bike-test bike-dfr bike-bench bike-katcheck)
+  if(TARGET ${target})
+    target_compile_definitions(${target}
+      PRIVATE
+        MULTI_LEVEL=1
+        LEVEL=${FIRST_LEVEL}
+        BIKE_NAMESPACE=bike_l${FIRST_LEVEL}_)
+  endif()
+endforeach()
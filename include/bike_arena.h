@@ -0,0 +1,59 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+// An arena of memory for the workspaces (see bike_workspace_t) and the
+// buffers of long runs, such as the threads of the bulk API and of the DFR
+// simulation. The memory of an arena is mapped once, and is placed on one
+// NUMA node. It is mapped on the huge pages that the system reserved (of
+// 1 GB for arenas of at least 1 GB, and of 2 MB otherwise) when there are
+// enough of them, and on transparent huge pages otherwise, to reduce the TLB
+// misses of the buffers.
+// The buffers are taken from the arena by a bump allocator, and are released
+// together by bike_arena_reset, which also wipes them. An arena is not
+// thread-safe, every thread should use its own arena.
+typedef struct bike_arena_s bike_arena_t;
+
+// The alignment of the buffers (it is also the alignment of a workspace)
+#define BIKE_ARENA_ALIGN (64)
+
+// The node of the CPU that the calling thread runs on
+#define BIKE_ARENA_LOCAL_NODE (-1)
+
+typedef enum
+{
+  BIKE_ARENA_PAGES_SMALL = 0, // Regular (possibly transparent huge) pages
+  BIKE_ARENA_PAGES_2M,
+  BIKE_ARENA_PAGES_1G
+} bike_arena_pages_t;
+
+// Create an arena of (at least) size bytes on the NUMA node node (or
+// BIKE_ARENA_LOCAL_NODE). The placement on the node is best effort: the
+// memory is not bound to a node when the system does not support it.
+int bike_arena_create(OUT bike_arena_t **arena,
+                      IN size_t          size,
+                      IN int             node);
+
+// Take a buffer of size bytes, aligned to BIKE_ARENA_ALIGN bytes, from the
+// arena. Returns NULL when there is not enough room left in the arena.
+void *bike_arena_alloc(IN OUT bike_arena_t *arena, IN size_t size);
+
+// Wipe all the buffers that were taken from the arena, and release them. The
+// wipe takes time that depends only on the sizes of the buffers.
+void bike_arena_reset(IN OUT bike_arena_t *arena);
+
+// The pages that the memory of the arena is mapped on.
+bike_arena_pages_t bike_arena_pages(IN const bike_arena_t *arena);
+
+// Wipe and unmap the memory of the arena, and release it.
+void bike_arena_destroy(IN OUT bike_arena_t *arena);
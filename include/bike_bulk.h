@@ -0,0 +1,52 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+// Bulk processing of many independent KEM operations (e.g., for re-keying
+// archives, or generating test corpora) by a pool of threads. Every thread
+// has its own workspace (see bike_workspace_t), allocated by the thread, and
+// takes the jobs from its own range of the jobs array. A thread that completed
+// its range steals half of the remaining jobs of another thread.
+typedef enum
+{
+  BIKE_BULK_KEYPAIR = 0, // (pk, sk) = crypto_kem_keypair()
+  BIKE_BULK_ENC,         // (ct, ss) = crypto_kem_enc(pk)
+  BIKE_BULK_DEC          // ss = crypto_kem_dec(ct, sk)
+} bike_bulk_op_t;
+
+// The buffers of a job are inputs or outputs according to op.
+typedef struct bike_bulk_job_s {
+  bike_bulk_op_t op;
+  unsigned char *pk;
+  unsigned char *sk;
+  unsigned char *ct;
+  unsigned char *ss;
+  int            res; // The return value of the operation
+} bike_bulk_job_t;
+
+#define BIKE_BULK_SEED_BYTES (32)
+
+// Run the n jobs with num_threads threads (the calling thread is one of them),
+// and set the res field of every job. Returns 0 when all the jobs succeeded.
+// When seed (of BIKE_BULK_SEED_BYTES bytes) is not NULL, the randomness of
+// the job i is generated by a DRBG that is seeded with H(seed || i), instead
+// of the source of bike_set_rng. Therefore, the results depend only on seed
+// and on the jobs array, and not on the number of threads or on the thread
+// that ran every job.
+// When the library is built with USE_NIST_RAND, the jobs are run in order by
+// the calling thread with the NIST DRBG (and seed is ignored), so that the
+// results are the same as the sequential calls, e.g., for generating KATs.
+int bike_bulk_run(IN OUT bike_bulk_job_t jobs[],
+                  IN size_t              n,
+                  IN size_t              num_threads,
+                  IN const uint8_t *     seed);
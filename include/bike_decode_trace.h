@@ -0,0 +1,53 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+// When the library is built with DECODE_TRACE, every iteration of the decoder
+// (decode, decode_with_stats and decode_vartime, but not the multi-instance
+// decoder) appends a record to a ring buffer of the calling thread. When the
+// buffer is full, the oldest record is overwritten. The records hold the
+// weights of secret values, therefore DECODE_TRACE is intended only for DFR
+// simulations and parameter tuning.
+#define BIKE_DECODE_TRACE_SIZE (512)
+
+// The decoder iteration runs up to 3 steps: find_err1 (the step 1), and
+// find_err2 on the black and on the gray sets (the steps 2 and 3). Index 0 of
+// the weights holds their value before the step 1, and index k their value
+// after the step k. When an iteration stops early (or runs only the step 1 in
+// the BGF decoder), the weights of the steps that did not run repeat the last
+// ones.
+#define BIKE_DECODE_TRACE_STEPS (3)
+
+typedef struct bike_decode_record_s {
+  uint32_t decode;    // The number of the decoding in the calling thread
+  uint32_t iter;      // The iteration of the decoding
+  uint32_t threshold; // The threshold of the step 1 (get_threshold)
+  uint32_t black_weight;
+  uint32_t gray_weight;
+  uint32_t syndrome_weight[BIKE_DECODE_TRACE_STEPS + 1];
+  uint32_t e_weight[BIKE_DECODE_TRACE_STEPS + 1];
+} bike_decode_record_t;
+
+// Move up to max_records records of the calling thread, from the oldest, to
+// records and set num_records to their number. Return 0 (or -1, with
+// num_records 0, when the library is built without DECODE_TRACE).
+int bike_decode_trace_read(OUT bike_decode_record_t *records,
+                           IN size_t                 max_records,
+                           OUT size_t *num_records);
+
+// The number of records of the calling thread that were overwritten before
+// they were read
+uint64_t bike_decode_trace_dropped(void);
+
+// Drop the records of the calling thread, and restart its decode numbers
+void bike_decode_trace_reset(void);
@@ -0,0 +1,39 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include "defs.h"
+
+// The library selects the implementation of every function (portable, AVX2,
+// AVX512, PCLMUL, VPCLMUL) according to the features of the CPU. The ISA below
+// caps the features that the library uses, in order to compare the different
+// implementations on one CPU. Every ISA includes the ones that precede it.
+// The initial ISA is set by the BIKE_ISA environment variable
+// (e.g., BIKE_ISA=avx2), and is BIKE_ISA_NATIVE when it is not set.
+typedef enum
+{
+  BIKE_ISA_PORTABLE = 0,
+  BIKE_ISA_PCLMUL   = 1,
+  BIKE_ISA_AVX2     = 2,
+  BIKE_ISA_AVX512   = 3,
+  BIKE_ISA_VPCLMUL  = 4, // Including VAES
+  BIKE_ISA_NATIVE   = 5  // All the features of the CPU
+} bike_isa_t;
+
+// Cap the features that the library uses by isa, and return 0 (or -1 for an
+// invalid isa). The new ISA takes effect on the next call to the library.
+// It must not be called while other threads use the library.
+int bike_force_isa(IN bike_isa_t isa);
+
+// The highest ISA that the library currently uses
+bike_isa_t bike_get_isa(void);
+
+// Returns 1 if the CPU supports all the features of isa, and 0 otherwise
+int bike_isa_available(IN bike_isa_t isa);
+
+const char *bike_isa_name(IN bike_isa_t isa);
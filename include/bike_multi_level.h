@@ -0,0 +1,60 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+// The workspace of the level (see kem.h)
+struct bike_workspace_s;
+
+// A library that is built with MULTI_LEVEL contains several BIKE levels.
+// The KEM functions of every level are specialized at compile time for its
+// parameters, and are available under a level prefix
+// (e.g., bike_l1_crypto_kem_enc, bike_l3_crypto_kem_enc) and through the
+// parameters struct of the level below.
+typedef struct bike_level_params_s {
+  uint32_t level;
+  size_t   sk_bytes;
+  size_t   pk_bytes;
+  size_t   ct_bytes;
+  size_t   ss_bytes;
+
+  int (*keypair)(OUT unsigned char *pk, OUT unsigned char *sk);
+  int (*enc)(OUT unsigned char *ct,
+             OUT unsigned char *ss,
+             IN const unsigned char *pk);
+  int (*dec)(OUT unsigned char *ss,
+             IN const unsigned char *ct,
+             IN const unsigned char *sk);
+
+  // The workspace APIs (see kem.h), with a workspace of workspace_bytes bytes
+  // of the level.
+  size_t workspace_bytes;
+  int (*keypair_ws)(OUT unsigned char *pk,
+                    OUT unsigned char *sk,
+                    IN OUT struct bike_workspace_s *ws);
+  int (*enc_ws)(OUT unsigned char *ct,
+                OUT unsigned char *ss,
+                IN const unsigned char *pk,
+                IN OUT struct bike_workspace_s *ws);
+  int (*dec_ws)(OUT unsigned char *ss,
+                IN const unsigned char *ct,
+                IN const unsigned char *sk,
+                IN OUT struct bike_workspace_s *ws);
+} bike_level_params_t;
+
+// Returns the parameters of the given level,
+// or NULL if the level is not part of the build.
+const bike_level_params_t *bike_get_level(IN uint32_t level);
+
+// The number of levels in the build, and the parameters of the i-th level.
+size_t                     bike_num_levels(void);
+const bike_level_params_t *bike_get_level_by_index(IN size_t i);
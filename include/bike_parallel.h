@@ -0,0 +1,30 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include "defs.h"
+
+// When the library is built with INTRA_OP_PARALLEL, a single KEM operation
+// can use a small team of persistent helper threads: the three top level
+// sub-multiplications of the Karatsuba multiplication (e.g., of gf2x_mod_inv
+// in the key generation) and the two columns of the first step of the
+// decoder run on different cores. This reduces the latency of one operation,
+// at the cost of the helpers spinning while they wait for work.
+// The team is used by one operation at a time; operations that are called
+// concurrently by other threads run without it.
+#define BIKE_PARALLEL_MAX_HELPERS (2)
+
+// Start a team of num_helpers (1 to BIKE_PARALLEL_MAX_HELPERS) threads, and
+// return 0 (or -1 when the team is already started, when the threads could
+// not be created, or when the library is built without INTRA_OP_PARALLEL).
+int bike_parallel_start(IN size_t num_helpers);
+
+// Stop the team (after the operation that uses it completes)
+void bike_parallel_stop(void);
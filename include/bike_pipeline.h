@@ -0,0 +1,75 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defs.h"
+#include "kem.h"
+
+// A decapsulation pipeline for servers that decapsulate many ciphertexts.
+// Every decapsulation (of crypto_kem_dec_with_key) is split into three stages,
+// and every stage runs on its own threads, so that the GF2X bound work of the
+// decoder and the hash bound work of the other stages overlap:
+//   BIKE_PIPELINE_DECODE: the decoder.
+//   BIKE_PIPELINE_CHECK:  the re-encryption check (the functions L and H).
+//   BIKE_PIPELINE_KDF:    the shared secret (the function K).
+// The stages are connected by bounded queues. When SHA_X4_WAYS decapsulations
+// are waiting in the queue of a hash bound stage, the stage computes their
+// hashes with one multi-buffer hash call.
+// The pipeline trades the latency of a single call for sustained throughput.
+typedef struct bike_pipeline_s bike_pipeline_t;
+
+enum
+{
+  BIKE_PIPELINE_DECODE = 0,
+  BIKE_PIPELINE_CHECK,
+  BIKE_PIPELINE_KDF,
+  BIKE_PIPELINE_NUM_STAGES
+};
+
+typedef struct bike_pipeline_params_s {
+  // The maximal number of decapsulations in the pipeline (submitted and not
+  // completed). bike_pipeline_submit blocks while the pipeline is full.
+  size_t max_in_flight;
+
+  // The number of threads of every stage (at least one)
+  size_t num_threads[BIKE_PIPELINE_NUM_STAGES];
+
+  // The thread i of the stage s is pinned to the core first_cpu[s] + i,
+  // or is not pinned when first_cpu[s] is negative (pinning is supported only
+  // on Linux).
+  int first_cpu[BIKE_PIPELINE_NUM_STAGES];
+} bike_pipeline_params_t;
+
+// Called by a thread of the pipeline when the decapsulation completed, where
+// res is its return value (as of crypto_kem_dec_with_key). The callback should
+// return quickly, as it delays the following decapsulations.
+typedef void (*bike_pipeline_done_cb_t)(IN OUT void *arg, IN int res);
+
+// Create a pipeline and start its threads.
+int bike_pipeline_create(OUT bike_pipeline_t **pipeline,
+                         IN const bike_pipeline_params_t *params);
+
+// Decapsulate ct with key into ss in the pipeline, and call done(arg, res)
+// when ss is ready. ct is copied before the call returns, while key and ss
+// must remain valid until done is called.
+int bike_pipeline_submit(IN OUT bike_pipeline_t *pipeline,
+                         OUT unsigned char *     ss,
+                         IN const unsigned char *ct,
+                         IN const bike_dec_key_t *key,
+                         IN bike_pipeline_done_cb_t done,
+                         IN OUT void *              arg);
+
+// Wait until all the submitted decapsulations completed.
+void bike_pipeline_flush(IN OUT bike_pipeline_t *pipeline);
+
+// Complete all the submitted decapsulations, stop the threads, securely clean
+// the state of the pipeline and release it.
+void bike_pipeline_destroy(IN OUT bike_pipeline_t *pipeline);
@@ -0,0 +1,43 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "defs.h"
+
+// When the library is built with BIKE_PROFILE, every thread accumulates the
+// number of cycles and the number of calls of the stages below. The stages
+// may be nested (e.g., gf2x_mod_mul is called by compute_syndrome and by
+// gf2x_mod_inv), therefore their cycles should not be summed.
+typedef enum
+{
+  BIKE_PROFILE_COMPUTE_SYNDROME = 0, // The initial syndrome of the decoder
+  BIKE_PROFILE_NEXT_SYNDROME    = 1, // The syndrome after every flip step
+  BIKE_PROFILE_GET_THRESHOLD    = 2,
+  BIKE_PROFILE_FIND_ERR1        = 3,
+  BIKE_PROFILE_FIND_ERR2        = 4,
+  BIKE_PROFILE_FUNCTION_H       = 5, // In encapsulation and decapsulation
+  BIKE_PROFILE_GF2X_MOD_MUL     = 6,
+  BIKE_PROFILE_GF2X_MOD_INV     = 7,
+  BIKE_PROFILE_NUM_STAGES       = 8
+} bike_profile_stage_t;
+
+typedef struct bike_profile_s {
+  uint64_t cycles[BIKE_PROFILE_NUM_STAGES];
+  uint64_t calls[BIKE_PROFILE_NUM_STAGES];
+} bike_profile_t;
+
+// Copy the counters of the calling thread to profile, and return 0
+// (or -1, with zero counters, when the library is built without BIKE_PROFILE).
+int bike_profile_get(OUT bike_profile_t *profile);
+
+// Reset the counters of the calling thread
+void bike_profile_reset(void);
+
+const char *bike_profile_stage_name(IN bike_profile_stage_t stage);
@@ -0,0 +1,36 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+// The source of the randomness of the key generation and the encapsulation
+// (unless the library is built with USE_NIST_RAND, which uses the NIST DRBG).
+// A source fills buf with len random bytes, and returns 0 on success.
+typedef int (*bike_rng_t)(OUT uint8_t *buf, IN size_t len);
+
+// Set the randomness source of the library. NULL sets the default source
+// (bike_rng_drbg). The source should be set before the other APIs of the
+// library are used, and not while they are running in other threads.
+void bike_set_rng(IN bike_rng_t rng);
+
+// The sources of the library:
+// The getrandom system call (or /dev/urandom on non-Linux systems).
+int bike_rng_getrandom(OUT uint8_t *buf, IN size_t len);
+
+// The RDRAND and RDSEED instructions (on x86_64 CPUs that support them).
+int bike_rng_rdrand(OUT uint8_t *buf, IN size_t len);
+int bike_rng_rdseed(OUT uint8_t *buf, IN size_t len);
+
+// A per-thread buffered DRBG. It is seeded (and periodically reseeded) with
+// bike_rng_getrandom. The DRBGs of different threads are independent,
+// therefore it does not require any locking.
+int bike_rng_drbg(OUT uint8_t *buf, IN size_t len);
@@ -20,6 +20,9 @@
 #define AES256_BLOCK_BYTES (16U)
 #define AES256_ROUNDS      (14U)
 
+// The number of blocks encrypted by aes256_enc_ctr_x8
+#define AES256_CTR_X8_BLOCKS (8U)
+
 typedef ALIGN(16) struct aes256_key_s {
   uint8_t raw[AES256_KEY_BYTES];
 } aes256_key_t;
@@ -36,6 +39,19 @@ ret_t aes256_key_expansion(OUT aes256_ks_t *ks, IN const aes256_key_t *key);
 
 ret_t aes256_enc(OUT uint8_t *ct, IN const uint8_t *pt, IN const aes256_ks_t *ks);
 
+// Encrypts the AES256_CTR_X8_BLOCKS counter blocks ctr, ctr + 1, ..., ctr + 7
+// (the counter is incremented in its lower quadword) into ct.
+// The blocks are processed in parallel, with VAES when available.
+ret_t aes256_enc_ctr_x8(OUT uint8_t *ct,
+                        IN const uint128_t *ctr,
+                        IN const aes256_ks_t *ks);
+
+#  if defined(X86_64)
+ret_t aes256_enc_ctr_x8_vaes(OUT uint8_t *ct,
+                             IN const uint128_t *ctr,
+                             IN const aes256_ks_t *ks);
+#  endif
+
 // Empty function
 _INLINE_ void aes256_free_ks(OUT BIKE_UNUSED_ATT aes256_ks_t *ks) {}
 
@@ -72,6 +88,28 @@ _INLINE_ ret_t aes256_enc(OUT uint8_t *ct,
   return SUCCESS;
 }
 
+// Encrypts the AES256_CTR_X8_BLOCKS counter blocks ctr, ctr + 1, ..., ctr + 7
+// (the counter is incremented in its lower quadword) into ct, with a single
+// OpenSSL call.
+_INLINE_ ret_t aes256_enc_ctr_x8(OUT uint8_t *ct,
+                                 IN const uint128_t *ctr,
+                                 IN const aes256_ks_t *ks)
+{
+  uint128_t ctrs[AES256_CTR_X8_BLOCKS];
+  int       outlen = 0;
+
+  for(size_t i = 0; i < AES256_CTR_X8_BLOCKS; i++) {
+    ctrs[i] = *ctr;
+    ctrs[i].u.qw[0] += i;
+  }
+
+  if(0 == EVP_EncryptUpdate(*ks, ct, &outlen, (const uint8_t *)ctrs,
+                            sizeof(ctrs))) {
+    BIKE_ERROR(EXTERNAL_LIB_ERROR_OPENSSL);
+  }
+  return SUCCESS;
+}
+
 _INLINE_ void aes256_free_ks(OUT aes256_ks_t *ks)
 {
   EVP_CIPHER_CTX_free(*ks);
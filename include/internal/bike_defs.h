@@ -27,8 +27,6 @@
 #  define THRESHOLD_COEFF1 0.0176796
 #  define THRESHOLD_MIN    12
 
-// The gf2m code is optimized to a block in this case:
-#  define BLOCK_BITS 4096
 # define MAX_RAND_INDICES_T 271 // taken from level 1
 
 #elif(LEVEL == 10)
@@ -40,8 +38,6 @@
 #  define THRESHOLD_COEFF1 0.0069722
 #  define THRESHOLD_MIN    21
 
-// The gf2m code is optimized to a block in this case:
-#  define BLOCK_BITS 8192
 # define MAX_RAND_INDICES_T 271  // taken from level 1
 
 #elif(LEVEL == 11)
@@ -53,8 +49,6 @@
 #  define  THRESHOLD_COEFF1 0.0171232876712329
 #  define  THRESHOLD_MIN    5
 
-// The gf2m code is optimized to a block in this case:
-#  define  BLOCK_BITS 1024
 # define MAX_RAND_INDICES_T 271  // taken from level 1
 
 #elif(LEVEL == 12)
@@ -66,8 +60,6 @@
 #  define  THRESHOLD_COEFF1 0.0148305084745763
 #  define  THRESHOLD_MIN    7
 
-// The gf2m code is optimized to a block in this case:
-#  define  BLOCK_BITS 1024
 # define MAX_RAND_INDICES_T 271  // taken from level 1
 
 #elif(LEVEL == 13)
@@ -79,8 +71,6 @@
 #  define  THRESHOLD_COEFF1 0.0133555926544240
 #  define  THRESHOLD_MIN    8
 
-// The gf2m code is optimized to a block in this case:
-#  define  BLOCK_BITS 2048
 # define MAX_RAND_INDICES_T 271  // taken from level 1
 
 #elif(LEVEL == 14)
@@ -93,9 +83,6 @@
 #  define  THRESHOLD_MIN    11
 # define MAX_RAND_INDICES_T 271  // taken from level 1
 
-// The gf2m code is optimized to a block in this case:
-#  define  BLOCK_BITS 2048
-
 #elif(LEVEL == 15)
 #  define  R_BITS 2053
 #  define  D      23
@@ -105,8 +92,6 @@
 #  define  THRESHOLD_COEFF1 0.0123456790123457
 #  define  THRESHOLD_MIN    12
 
-// The gf2m code is optimized to a block in this case:
-#  define  BLOCK_BITS 4096
 # define MAX_RAND_INDICES_T 271  // taken from level 1
 
 #elif(LEVEL == 16)
@@ -118,8 +103,6 @@
 #  define  THRESHOLD_COEFF1 0.0132042253521127
 #  define  THRESHOLD_MIN    12
 
-// The gf2m code is optimized to a block in this case:
-#  define  BLOCK_BITS 4096
 # define MAX_RAND_INDICES_T 271  // taken from level 1
 
 #elif(LEVEL == 17)
@@ -131,8 +114,6 @@
 #  define  THRESHOLD_COEFF1 0.0106746370623399
 #  define  THRESHOLD_MIN    18
 
-// The gf2m code is optimized to a block in this case:
-#  define  BLOCK_BITS 4096
 # define MAX_RAND_INDICES_T 271  // taken from level 1
 
 #elif(LEVEL == 18)
@@ -144,8 +125,6 @@
 #  define  THRESHOLD_COEFF1 0.0105174589819100
 #  define  THRESHOLD_MIN    18
 
-// The gf2m code is optimized to a block in this case:
-#  define  BLOCK_BITS 8192
 # define MAX_RAND_INDICES_T 271  // taken from level 1
 
 #elif(LEVEL == 3)
@@ -163,8 +142,6 @@
 // https://github.com/awslabs/bike-kem/blob/master/BIKE_Rejection_Sampling.pdf
 # define MAX_RAND_INDICES_T 373
 
-// The gf2m code is optimized to a block in this case:
-#  define BLOCK_BITS 32768
 #elif(LEVEL == 1)
 // 64-bits of post-quantum security parameters (BIKE paper):
 #  define R_BITS 12323
@@ -181,8 +158,6 @@
 // https://github.com/awslabs/bike-kem/blob/master/BIKE_Rejection_Sampling.pdf
 # define MAX_RAND_INDICES_T 271
 
-// The gf2x code is optimized to a block in this case:
-#  define BLOCK_BITS       (16384)
 #else
 #  error "Bad level, choose one of 0/10/1/3"
 #endif
@@ -198,8 +173,13 @@
 #define R_YMM    DIVIDE_AND_CEIL(R_BITS, 8 * BYTES_IN_YMM)
 #define R_ZMM    DIVIDE_AND_CEIL(R_BITS, 8 * BYTES_IN_ZMM)
 
-#define R_BLOCKS        DIVIDE_AND_CEIL(R_BITS, BLOCK_BITS)
-#define R_PADDED        (R_BLOCKS * BLOCK_BITS)
+// The dense polynomials (pad_r_t) are padded to a multiple of R_PAD_BITS
+// bits: the operands of the largest base multiplication of Karatsuba
+// (GF2X_VPCLMUL_BASE_QWORDS), which is a multiple of every vector width.
+// Karatsuba itself only reads the R_QWORDS rounded up to its base
+// multiplication, so the padding does not have to be a power of two.
+#define R_PAD_BITS      1024
+#define R_PADDED        (DIVIDE_AND_CEIL(R_BITS, R_PAD_BITS) * R_PAD_BITS)
 #define R_PADDED_BYTES  (R_PADDED / 8)
 #define R_PADDED_QWORDS (R_PADDED / 64)
 
@@ -225,9 +205,42 @@
 //////////////////////////////////
 // Parameters for the BGF decoder.
 //////////////////////////////////
-#define BGF_DECODER
+// The decoder is BGF unless another one is selected (see decode.h)
+#if !defined(BG_DECODER) && !defined(MAJ_DECODER)
+#  define BGF_DECODER
+#endif
 #define DELTA  3
 #define SLICES (LOG2_MSB(D) + 1)
 
+// The delta rotations of the decoder (see rotate_right_delta_add_port): every
+// step advances a window of the syndrome by up to DELTA_ROT_MAX_ADV blocks of
+// DELTA_ROT_BLOCK_BITS bits (in DELTA_ROT_ADV_LOG passes), and the windows of
+// the sorted indices of a column are reached in at most DELTA_ROT_STEPS steps:
+// one step for every index, and at most DELTA_ROT_MAX_BLOCK / DELTA_ROT_MAX_ADV
+// steps that only advance the window by DELTA_ROT_MAX_ADV blocks.
+#define DELTA_ROT_BLOCK_BITS   256
+#define DELTA_ROT_BLOCK_QWORDS (DELTA_ROT_BLOCK_BITS / 64)
+#define DELTA_ROT_ADV_LOG      3
+#define DELTA_ROT_MAX_ADV      ((1 << DELTA_ROT_ADV_LOG) - 1)
+#define DELTA_ROT_MAX_BLOCK    ((R_BITS - 1) / DELTA_ROT_BLOCK_BITS)
+#define DELTA_ROT_STEPS        (D + (DELTA_ROT_MAX_BLOCK / DELTA_ROT_MAX_ADV))
+
+// Every step advances the qwords of the window that the following steps use:
+// the R_ZMM + 1 registers that are rotated into the UPC (the most of all the
+// implementations), and the qwords of the blocks that the window can still
+// advance. The last pass reads DELTA_ROT_READ_QWORDS more qwords.
+#define DELTA_ROT_WIN_QWORDS                                       \
+  (8 * DIVIDE_AND_CEIL((8 * (R_ZMM + 1)) +                         \
+                         (DELTA_ROT_BLOCK_QWORDS * DELTA_ROT_MAX_BLOCK), \
+                       8))
+#define DELTA_ROT_READ_QWORDS \
+  (DELTA_ROT_WIN_QWORDS + (DELTA_ROT_BLOCK_QWORDS << (DELTA_ROT_ADV_LOG - 1)))
+
+// The syndrome is stored three times (see dup_port), and it also holds the
+// window of the delta rotations, which is longer for the small test levels.
+#define SYNDROME_QWORDS                                \
+  (((3 * R_QWORDS) > DELTA_ROT_READ_QWORDS) ? (3 * R_QWORDS) \
+                                            : DELTA_ROT_READ_QWORDS)
+
 // GF2X inversion can only handle R < 32768
 bike_static_assert((R_BITS < 32768), r_too_large_for_inversion);
@@ -0,0 +1,203 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+// In a multi-level build (MULTI_LEVEL) the level dependent code is compiled
+// once per level with BIKE_NAMESPACE set to bike_l<level>_, so every global
+// symbol below gets the prefix of its level (e.g., bike_l1_crypto_kem_enc).
+// The level independent code (CPU features, errors, randomness sources,
+// SHA3/SHAKE, SHA2, AES) is compiled only once and is not prefixed.
+// Every new non-static function of the level dependent code must be listed
+// here. A multi-level build fails when an object of a level defines a global
+// symbol without the prefix (see cmake/check-namespace.cmake).
+
+#define BIKE_NS_CONCAT_(a, b) a##b
+#define BIKE_NS_CONCAT(a, b)  BIKE_NS_CONCAT_(a, b)
+#define BIKE_NS(name)         BIKE_NS_CONCAT(BIKE_NAMESPACE, name)
+
+// kem.c
+#define crypto_kem_keypair       BIKE_NS(crypto_kem_keypair)
+#define crypto_kem_keypair_batch BIKE_NS(crypto_kem_keypair_batch)
+#define crypto_kem_enc           BIKE_NS(crypto_kem_enc)
+#define crypto_kem_dec           BIKE_NS(crypto_kem_dec)
+#define crypto_kem_enc_key_init  BIKE_NS(crypto_kem_enc_key_init)
+#define crypto_kem_enc_key_size  BIKE_NS(crypto_kem_enc_key_size)
+#define crypto_kem_enc_with_key  BIKE_NS(crypto_kem_enc_with_key)
+#define crypto_kem_dec_key_init  BIKE_NS(crypto_kem_dec_key_init)
+#define crypto_kem_dec_with_key  BIKE_NS(crypto_kem_dec_with_key)
+#define crypto_kem_enc_view      BIKE_NS(crypto_kem_enc_view)
+#define crypto_kem_dec_view      BIKE_NS(crypto_kem_dec_view)
+#define bike_pk_view_init        BIKE_NS(pk_view_init)
+#define bike_ct_view_init        BIKE_NS(ct_view_init)
+#define bike_ct_view_export      BIKE_NS(ct_view_export)
+#define crypto_kem_dec_key_clean BIKE_NS(crypto_kem_dec_key_clean)
+#define crypto_kem_dec_key_size  BIKE_NS(crypto_kem_dec_key_size)
+#define crypto_kem_sk_compact    BIKE_NS(crypto_kem_sk_compact)
+#define crypto_kem_dec_key_init_compact \
+  BIKE_NS(crypto_kem_dec_key_init_compact)
+#define crypto_kem_dec_batch     BIKE_NS(crypto_kem_dec_batch)
+#define crypto_kem_keypair_ws    BIKE_NS(crypto_kem_keypair_ws)
+#define crypto_kem_enc_ws        BIKE_NS(crypto_kem_enc_ws)
+#define crypto_kem_dec_ws        BIKE_NS(crypto_kem_dec_ws)
+#define crypto_kem_keypair_with_ctx BIKE_NS(crypto_kem_keypair_with_ctx)
+#define bike_keygen_ctx_size     BIKE_NS(keygen_ctx_size)
+#define bike_keygen_ctx_init     BIKE_NS(keygen_ctx_init)
+#define bike_workspace_size      BIKE_NS(workspace_size)
+#define bike_enc_pool_size       BIKE_NS(enc_pool_size)
+#define bike_enc_pool_init       BIKE_NS(enc_pool_init)
+#define bike_enc_precompute      BIKE_NS(enc_precompute)
+#define bike_enc_pool_count      BIKE_NS(enc_pool_count)
+#define crypto_kem_enc_online    BIKE_NS(crypto_kem_enc_online)
+#define bike_enc_pool_clean      BIKE_NS(enc_pool_clean)
+#define bike_level_params        BIKE_NS(level_params)
+#define dec_stage_decode         BIKE_NS(dec_stage_decode)
+#define dec_stage_check          BIKE_NS(dec_stage_check)
+#define dec_stage_kdf            BIKE_NS(dec_stage_kdf)
+
+// keypool.c
+#define bike_keypool_create    BIKE_NS(keypool_create)
+#define bike_keypool_pop       BIKE_NS(keypool_pop)
+#define bike_keypool_get_stats BIKE_NS(keypool_get_stats)
+#define bike_keypool_destroy   BIKE_NS(keypool_destroy)
+
+// keycache.c
+#define bike_key_cache_entry_size BIKE_NS(key_cache_entry_size)
+#define bike_key_cache_create     BIKE_NS(key_cache_create)
+#define bike_key_cache_dec        BIKE_NS(key_cache_dec)
+#define bike_key_cache_get_stats  BIKE_NS(key_cache_get_stats)
+#define bike_key_cache_destroy    BIKE_NS(key_cache_destroy)
+
+// bulk.c
+#define bike_bulk_run BIKE_NS(bulk_run)
+
+// pipeline.c
+#define bike_pipeline_create  BIKE_NS(pipeline_create)
+#define bike_pipeline_submit  BIKE_NS(pipeline_submit)
+#define bike_pipeline_flush   BIKE_NS(pipeline_flush)
+#define bike_pipeline_destroy BIKE_NS(pipeline_destroy)
+
+// common
+#define r_bits_vector_weight BIKE_NS(r_bits_vector_weight)
+#define print_LE             BIKE_NS(print_LE)
+#define print_BE             BIKE_NS(print_BE)
+#define get_dispatch_ctx     BIKE_NS(get_dispatch_ctx)
+
+// decode
+#define compute_syndrome               BIKE_NS(compute_syndrome)
+#define find_err1                      BIKE_NS(find_err1)
+#define decode                         BIKE_NS(decode)
+#define decode_key_init                BIKE_NS(decode_key_init)
+#define decode_with_key                BIKE_NS(decode_with_key)
+#define decode_with_key_ws             BIKE_NS(decode_with_key_ws)
+#define decode_padded_ws               BIKE_NS(decode_padded_ws)
+#define decode_with_stats              BIKE_NS(decode_with_stats)
+#define decode_vartime                 BIKE_NS(decode_vartime)
+#define decode_with_params             BIKE_NS(decode_with_params)
+#define decode_default_params          BIKE_NS(decode_default_params)
+#define decode_alg_params              BIKE_NS(decode_alg_params)
+#define decode_wide                    BIKE_NS(decode_wide)
+#define decode_wide_ws                 BIKE_NS(decode_wide_ws)
+#define decode_wide_with_stats         BIKE_NS(decode_wide_with_stats)
+#define rotate_right_port              BIKE_NS(rotate_right_port)
+#define rotate_right_avx2              BIKE_NS(rotate_right_avx2)
+#define rotate_right_avx512            BIKE_NS(rotate_right_avx512)
+#define dup_port                       BIKE_NS(dup_port)
+#define dup_avx2                       BIKE_NS(dup_avx2)
+#define dup_avx512                     BIKE_NS(dup_avx512)
+#define bit_sliced_adder_port          BIKE_NS(bit_sliced_adder_port)
+#define bit_sliced_adder_avx2          BIKE_NS(bit_sliced_adder_avx2)
+#define bit_sliced_adder_avx512        BIKE_NS(bit_sliced_adder_avx512)
+#define bit_slice_full_subtract_port   BIKE_NS(bit_slice_full_subtract_port)
+#define bit_slice_full_subtract_avx2   BIKE_NS(bit_slice_full_subtract_avx2)
+#define bit_slice_full_subtract_avx512 BIKE_NS(bit_slice_full_subtract_avx512)
+#define rotate_right_add_port          BIKE_NS(rotate_right_add_port)
+#define rotate_right_add_avx2          BIKE_NS(rotate_right_add_avx2)
+#define rotate_right_add_avx512        BIKE_NS(rotate_right_add_avx512)
+#define rotate_right_add_wide_port     BIKE_NS(rotate_right_add_wide_port)
+#define rotate_right_add_wide_avx512   BIKE_NS(rotate_right_add_wide_avx512)
+#define rotate_right_delta_add_port    BIKE_NS(rotate_right_delta_add_port)
+#define rotate_right_delta_add_avx2    BIKE_NS(rotate_right_delta_add_avx2)
+#define rotate_right_delta_add_avx512  BIKE_NS(rotate_right_delta_add_avx512)
+#define bit_slice_full_subtract_wide_port BIKE_NS(bit_slice_full_subtract_wide_port)
+#define bit_slice_full_subtract_wide_avx512 BIKE_NS(bit_slice_full_subtract_wide_avx512)
+#define syndrome_weight_port           BIKE_NS(syndrome_weight_port)
+#define syndrome_weight_avx2           BIKE_NS(syndrome_weight_avx2)
+#define syndrome_weight_avx512         BIKE_NS(syndrome_weight_avx512)
+#define syndrome_weight_vpopcnt        BIKE_NS(syndrome_weight_vpopcnt)
+
+// gf2x
+#define gf2x_mod_inv                 BIKE_NS(gf2x_mod_inv)
+#define gf2x_mod_inv_ws              BIKE_NS(gf2x_mod_inv_ws)
+#define gf2x_mod_inv_exp             BIKE_NS(gf2x_mod_inv_exp)
+#define gf2x_mod_inv_divstep         BIKE_NS(gf2x_mod_inv_divstep)
+#define gf2x_divstep_mul_port        BIKE_NS(gf2x_divstep_mul_port)
+#define gf2x_divstep_mul_pclmul      BIKE_NS(gf2x_divstep_mul_pclmul)
+#define gf2x_divstep_mul_vpclmul     BIKE_NS(gf2x_divstep_mul_vpclmul)
+#define gf2x_mod_mul                 BIKE_NS(gf2x_mod_mul)
+#define gf2x_mod_mul_ws              BIKE_NS(gf2x_mod_mul_ws)
+#define gf2x_mod_mul_with_ctx        BIKE_NS(gf2x_mod_mul_with_ctx)
+#define gf2x_mod_mul_sparse          BIKE_NS(gf2x_mod_mul_sparse)
+#define gf2x_mod_mul_sparse_ws       BIKE_NS(gf2x_mod_mul_sparse_ws)
+#define gf2x_mod_mul_sparse_with_ctx BIKE_NS(gf2x_mod_mul_sparse_with_ctx)
+#define gf2x_mod_mul_sparse_port     BIKE_NS(gf2x_mod_mul_sparse_port)
+#define gf2x_mod_mul_sparse_avx2     BIKE_NS(gf2x_mod_mul_sparse_avx2)
+#define gf2x_mod_mul_sparse_avx512   BIKE_NS(gf2x_mod_mul_sparse_avx512)
+#define gf2x_mul_base_port           BIKE_NS(gf2x_mul_base_port)
+#define gf2x_mul_base_pclmul         BIKE_NS(gf2x_mul_base_pclmul)
+#define gf2x_mul_base_vpclmul        BIKE_NS(gf2x_mul_base_vpclmul)
+#define gf2x_mod_sqr_port            BIKE_NS(gf2x_mod_sqr_port)
+#define gf2x_mod_sqr_pclmul          BIKE_NS(gf2x_mod_sqr_pclmul)
+#define gf2x_mod_sqr_vpclmul         BIKE_NS(gf2x_mod_sqr_vpclmul)
+#define gf2x_red_port                BIKE_NS(gf2x_red_port)
+#define gf2x_red_avx2                BIKE_NS(gf2x_red_avx2)
+#define gf2x_red_avx512              BIKE_NS(gf2x_red_avx512)
+#define k_sqr_port                   BIKE_NS(k_sqr_port)
+#define k_sqr_avx2                   BIKE_NS(k_sqr_avx2)
+#define k_sqr_avx512                 BIKE_NS(k_sqr_avx512)
+#define k_sqr_map_port               BIKE_NS(k_sqr_map_port)
+#define k_sqr_map_avx2               BIKE_NS(k_sqr_map_avx2)
+#define k_sqr_map_avx512             BIKE_NS(k_sqr_map_avx512)
+#define gf2x_ksqr_maps_size          BIKE_NS(gf2x_ksqr_maps_size)
+#define gf2x_ksqr_maps_init          BIKE_NS(gf2x_ksqr_maps_init)
+#define karatzuba_add1_port          BIKE_NS(karatzuba_add1_port)
+#define karatzuba_add1_avx2          BIKE_NS(karatzuba_add1_avx2)
+#define karatzuba_add1_avx512        BIKE_NS(karatzuba_add1_avx512)
+#define karatzuba_add2_port          BIKE_NS(karatzuba_add2_port)
+#define karatzuba_add2_avx2          BIKE_NS(karatzuba_add2_avx2)
+#define karatzuba_add2_avx512        BIKE_NS(karatzuba_add2_avx512)
+#define karatzuba_add3_port          BIKE_NS(karatzuba_add3_port)
+#define karatzuba_add3_avx2          BIKE_NS(karatzuba_add3_avx2)
+#define karatzuba_add3_avx512        BIKE_NS(karatzuba_add3_avx512)
+#define karatzuba_add23_port         BIKE_NS(karatzuba_add23_port)
+#define karatzuba_add23_avx2         BIKE_NS(karatzuba_add23_avx2)
+#define karatzuba_add23_avx512       BIKE_NS(karatzuba_add23_avx512)
+
+// random
+#define get_seeds                       BIKE_NS(get_seeds)
+#define generate_secret_key             BIKE_NS(generate_secret_key)
+#define generate_error_vector           BIKE_NS(generate_error_vector)
+#define cmp_error_vector                BIKE_NS(cmp_error_vector)
+#define secret_key_from_wlist           BIKE_NS(secret_key_from_wlist)
+#define generate_indices_mod_z          BIKE_NS(generate_indices_mod_z)
+#define sample_indices_fisher_yates     BIKE_NS(sample_indices_fisher_yates)
+#define sample_error_vec_indices_port   BIKE_NS(sample_error_vec_indices_port)
+#define sample_error_vec_indices_avx2   BIKE_NS(sample_error_vec_indices_avx2)
+#define sample_error_vec_indices_avx512 BIKE_NS(sample_error_vec_indices_avx512)
+#define secure_set_bits_port            BIKE_NS(secure_set_bits_port)
+#define secure_set_bits_avx2            BIKE_NS(secure_set_bits_avx2)
+#define secure_set_bits_avx512          BIKE_NS(secure_set_bits_avx512)
+#define secure_set_bits_sorted          BIKE_NS(secure_set_bits_sorted)
+#define secure_cmp_e_wlist              BIKE_NS(secure_cmp_e_wlist)
+#define is_idx_dup_port                 BIKE_NS(is_idx_dup_port)
+#define is_idx_dup_avx2                 BIKE_NS(is_idx_dup_avx2)
+#define is_idx_dup_avx512               BIKE_NS(is_idx_dup_avx512)
+#define init_prf_state                  BIKE_NS(init_prf_state)
+#define get_prf_output                  BIKE_NS(get_prf_output)
+#define clean_prf_state                 BIKE_NS(clean_prf_state)
+#define sample_uniform_r_bits_with_fixed_prf_context \
+  BIKE_NS(sample_uniform_r_bits_with_fixed_prf_context)
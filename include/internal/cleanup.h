@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #include "utilities.h"
 
 /* Runs _thecleanup function on _thealloc once _thealloc went out of scope */
@@ -45,10 +47,20 @@ _INLINE_ void secure_clean(OUT uint8_t *p, IN const uint32_t len)
     secure_clean((uint8_t *)o, sizeof(*o));    \
   }
 
+// Same as CLEANUP_FUNC, but cleans only the fields of type that precede
+// public_field. The fields from public_field to the end of type hold only
+// public data (e.g., a public key or a ciphertext), so they are not cleaned.
+#define CLEANUP_FUNC_SECRET_PREFIX(name, type, public_field)    \
+  _INLINE_ void name##_cleanup(IN OUT type *o)                  \
+  {                                                             \
+    secure_clean((uint8_t *)o, offsetof(type, public_field));   \
+  }
+
 CLEANUP_FUNC(r, r_t)
 CLEANUP_FUNC(m, m_t)
 CLEANUP_FUNC(e, e_t)
 CLEANUP_FUNC(sk, sk_t)
+CLEANUP_FUNC(compact_sk, compact_sk_t)
 CLEANUP_FUNC(ss, ss_t)
 CLEANUP_FUNC(ct, ct_t)
 CLEANUP_FUNC(pad_r, pad_r_t)
@@ -59,10 +71,6 @@ CLEANUP_FUNC(upc, upc_t)
 CLEANUP_FUNC(func_k, func_k_t)
 CLEANUP_FUNC(dbl_pad_r, dbl_pad_r_t)
 
-#if defined(BIND_PK_AND_M)
-  CLEANUP_FUNC(pk_m_bind, pk_m_bind_t)
-#endif
-
 // The functions below require special handling because we deal
 // with arrays and not structures.
 
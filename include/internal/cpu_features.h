@@ -9,9 +9,21 @@
 
 #include <stdint.h>
 
+#include "bike_isa.h"
+
 void cpu_features_init(void);
 
+// Incremented by every call to bike_force_isa. The users of the flags that
+// cache any state derived from them (e.g., the dispatch table) compare it
+// with the generation of the cache, and refresh it when it changes.
+uint32_t cpu_features_generation(void);
+
 uint32_t is_avx2_enabled(void);
 uint32_t is_avx512_enabled(void);
 uint32_t is_pclmul_enabled(void);
 uint32_t is_vpclmul_enabled(void);
+uint32_t is_vaes_enabled(void);
+uint32_t is_vpopcnt_enabled(void); // AVX512_VPOPCNTDQ
+uint32_t is_rdrand_enabled(void);
+uint32_t is_rdseed_enabled(void);
+uint32_t is_sha512_enabled(void); // SHA512 (x86 SHA512 extensions)
@@ -0,0 +1,48 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include "kem_internal.h"
+#include "sha.h"
+
+// The decapsulation of crypto_kem_dec_with_key, split into three stages that
+// can run on different threads (see bike_pipeline.h):
+//   1. Decode: e' = decode(ct).
+//   2. Check:  m' = c1 ^ L(e'), and m' = sigma when H(m') != e'.
+//   3. KDF:    ss = K(m', ct).
+// The stages are GF2X bound (decode) and hash bound (check and KDF).
+typedef struct dec_stage_s {
+  e_t      e;
+  pad_e_t  e_prime;
+  pad_e_t  e_tmp;
+  m_t      m_prime;
+  func_k_t k_in;
+  ss_t     l_ss;
+
+  // Public data (not cleaned)
+  const bike_dec_key_t *key;
+  ct_t                  l_ct;
+} dec_stage_t;
+
+CLEANUP_FUNC_SECRET_PREFIX(dec_stage, dec_stage_t, key)
+
+// Set l_ct and key of st before the first stage.
+ret_t dec_stage_decode(IN OUT dec_stage_t *st, IN OUT decode_ws_t *ws);
+
+// The check and the KDF stages of n decapsulations. When n = SHA_X4_WAYS, the
+// functions L and K of all of them are computed by one multi-buffer hash call
+// (and separately when that call fails). res[j] is set to the result of the
+// stage of st[j], and a failure of one decapsulation does not stop the
+// others.
+void dec_stage_check(IN OUT dec_stage_t *const st[],
+                     OUT int                   res[],
+                     IN size_t                 n);
+
+void dec_stage_kdf(IN OUT dec_stage_t *const st[],
+                   OUT int                   res[],
+                   IN size_t                 n);
@@ -7,6 +7,261 @@
 
 #pragma once
 
+#include <stddef.h>
+
+#include "cleanup.h"
+#include "decode_internal.h"
+#include "gf2x.h"
 #include "types.h"
 
+// The decoding algorithms, which all use the kernels of decode_ctx:
+// - DECODER_BGF: the Black-Gray-Flip decoder of BIKE's specification, which
+//   runs the black and gray steps only in the first iteration (the default).
+// - DECODER_BG: the Black-Gray decoder, which runs them in every iteration.
+// - DECODER_MAJ: the majority decoder, whose iterations are a single step
+//   with the threshold of BGF, but at least the (majority) threshold of the
+//   black and gray steps. Its iterations are the cheapest (no black and gray
+//   steps), and it needs more of them.
+typedef enum
+{
+  DECODER_BGF = 0,
+  DECODER_BG  = 1,
+  DECODER_MAJ = 2
+} decoder_alg_t;
+
+#define DECODER_ALGS 3
+
+// The threshold of the black and gray steps, and the minimal threshold of the
+// majority decoder
+#define MAJ_THRESHOLD (((D + 1) / 2) + 1)
+
+// The number of iterations of every decoding algorithm. The one of the majority
+// decoder leaves the same margin as BGF above the iterations that the
+// decodings needed in the DFR simulations (see tests/dfr.c).
+#if(LEVEL == 3)
+#  define MAX_IT_BGF 5
+#  define MAX_IT_BG  4
+#  define MAX_IT_MAJ 6
+#else
+// Level 1, and the experimental levels (taken from level 1)
+#  define MAX_IT_BGF 5
+#  define MAX_IT_BG  3
+#  define MAX_IT_MAJ 6
+#endif
+
+// The algorithm of the decoding functions, except decode_with_params, is
+// selected at build time (BGF_DECODER, BG_DECODER, or MAJ_DECODER).
+#if defined(BG_DECODER) && defined(MAJ_DECODER)
+#  error "Only one of BG_DECODER and MAJ_DECODER can be defined"
+#elif defined(BG_DECODER)
+#  define DECODER_ALG DECODER_BG
+#  define MAX_IT      MAX_IT_BG
+#elif defined(MAJ_DECODER)
+#  define DECODER_ALG DECODER_MAJ
+#  define MAX_IT      MAX_IT_MAJ
+#elif defined(BGF_DECODER)
+#  define DECODER_ALG DECODER_BGF
+#  define MAX_IT      MAX_IT_BGF
+#endif
+
+// The parameters of the decoder (see BIKE's specification, Section 5.2):
+// the threshold of the first step of every iteration is
+// max(threshold_coeff0 + threshold_coeff1 * |s|, threshold_min), the gray set
+// holds the bits whose UPC is at least that threshold minus delta, and the
+// black and gray steps use err2_threshold. The first gray_iters iterations
+// run the black and gray steps (1 in the BGF decoder, max_it in the BG
+// decoder, and 0 in the majority decoder).
+typedef struct decode_params_s {
+  double   threshold_coeff0;
+  double   threshold_coeff1;
+  uint32_t threshold_min;
+  uint32_t delta;
+  uint32_t err2_threshold;
+  uint32_t max_it;
+  uint32_t gray_iters;
+} decode_params_t;
+
+// The parameters of the level and of DECODER_ALG, which all the decoding
+// functions use, except decode_with_params.
+extern const decode_params_t decode_default_params;
+
+// Set params to the parameters of the level and of the algorithm alg, for
+// decode_with_params. Returns FAIL with E_DECODER_INVALID_PARAMS when alg is
+// not a decoder_alg_t.
+ret_t decode_alg_params(OUT decode_params_t *params, IN decoder_alg_t alg);
+
+// The part of the decoder state that depends only on the secret key.
+// It is set up once by decode_key_init and can then be used for decoding
+// any number of ciphertexts with decode_with_key.
+typedef struct decode_key_s {
+  pad_r_t h0;
+#if defined(INCREMENTAL_SYNDROME)
+  // Loaded with aligned vector loads, as h0 and pk
+  ALIGN(ALIGN_BYTES) pad_r_t h1;
+#endif
+  pad_r_t               pk;
+  compressed_idx_d_ar_t wlist;
+#if defined(DELTA_ROTATION)
+  // The wlist of every column is sorted, and its rotations are derived from
+  // each other in these steps (see rotate_right_delta_add_port)
+  rot_step_t steps[N0][DELTA_ROT_STEPS];
+#endif
+  const decode_ctx *    ctx; // Points to the global dispatch table
+} decode_key_t;
+
+CLEANUP_FUNC(decode_key, decode_key_t)
+
+#if defined(INCREMENTAL_SYNDROME)
+bike_static_assert((offsetof(decode_key_t, h1) % ALIGN_BYTES) == 0,
+                   decode_key_h1_misaligned);
+#endif
+bike_static_assert((offsetof(decode_key_t, pk) % ALIGN_BYTES) == 0,
+                   decode_key_pk_misaligned);
+
+// The scratch memory of the decoder. decode_with_key_ws keeps all the
+// temporary (secret) values of the decoding in it, and does not clean it.
+typedef struct decode_ws_s {
+  syndrome_t s;
+  syndrome_t rotated_syndrome;
+  upc_t      upc;
+#if defined(INTRA_OP_PARALLEL)
+  // The column 1 of find_err1 runs on a helper thread (see decode.c)
+  syndrome_t par_rotated_syndrome;
+  upc_t      par_upc;
+#endif
+  e_t        black_e;
+  e_t        gray_e;
+  e_t        prev_e; // The errors vector at the last syndrome computation
+  pad_r_t    c0;
+
+  // The temporary values of the syndrome (re)computations
+  pad_r_t       tmp[3];
+  gf2x_mul_ws_t mul;
+} decode_ws_t;
+
+CLEANUP_FUNC(decode_ws, decode_ws_t)
+
+void decode_key_init(OUT decode_key_t *key, IN const sk_t *sk);
+
+ret_t decode_with_key(OUT e_t *e, IN const ct_t *ct, IN const decode_key_t *key);
+
+// Same as decode_with_key, with the scratch memory in ws instead of the stack.
+ret_t decode_with_key_ws(OUT e_t *e,
+                         IN const ct_t *ct,
+                         IN const decode_key_t *key,
+                         IN OUT decode_ws_t *ws);
+
+// Same as decode_with_key_ws, with the padded c0 of the ciphertext (whose
+// padding is zero) instead of the ciphertext, so c0 is not copied.
+ret_t decode_padded_ws(OUT e_t *e,
+                       IN const pad_r_t *c0,
+                       IN const decode_key_t *key,
+                       IN OUT decode_ws_t *ws);
+
+// Same as decode_with_key, in addition it sets iters to the number of
+// iterations after which the syndrome became zero, or to (MAX_IT + 1) when the
+// decoder did not converge. Computing it leaks the syndrome weight after every
+// iteration, therefore it is intended only for DFR simulations.
+ret_t decode_with_stats(OUT e_t *e,
+                        OUT uint32_t *iters,
+                        IN const ct_t *ct,
+                        IN const decode_key_t *key);
+
+#if defined(DECODE_VARTIME)
+// NOT CONSTANT TIME - for DFR simulations only.
+// Same as decode_with_stats, but stops as soon as the syndrome is zero
+// instead of running all the MAX_IT iterations. The resulting errors vector
+// is the same as the one of decode_with_key.
+ret_t decode_vartime(OUT e_t *e,
+                     OUT uint32_t *iters,
+                     IN const ct_t *ct,
+                     IN const decode_key_t *key);
+#endif
+
+// Same as decode_with_stats, with the parameters params instead of the ones of
+// the level, where iters is set to (params->max_it + 1) when the decoder did
+// not converge. Returns FAIL with E_DECODER_INVALID_PARAMS when max_it is 0,
+// when a threshold or delta is larger than D, or when a coefficient of the
+// threshold is negative or not finite. Intended only for exploring
+// decoder variants in DFR simulations, without rebuilding the library.
+ret_t decode_with_params(OUT e_t *e,
+                         OUT uint32_t *iters,
+                         IN const ct_t *ct,
+                         IN const decode_key_t *key,
+                         IN const decode_params_t *params);
+
 ret_t decode(OUT e_t *e, IN const ct_t *ct, IN const sk_t *sk);
+
+// The number of decodings that decode_wide performs in lockstep
+#define DECODE_WIDE_LANES WIDE_LANES
+
+// The scratch memory of decode_wide_ws (see decode_ws_t), with the states of
+// DECODE_WIDE_LANES decodings. The UPCs of all the decodings are computed in
+// the transposed layout of wide_syndrome_t, and the syndromes of every
+// decoding are computed separately, with the scratch memory in single.
+typedef struct decode_wide_ws_s {
+  wide_syndrome_t s;
+  wide_syndrome_t rotated_syndrome;
+  wide_upc_t      upc;
+  upc_slice_t     msb;
+
+  syndrome_t lane_s[DECODE_WIDE_LANES];
+  e_t        e[DECODE_WIDE_LANES];
+  e_t        black_e[DECODE_WIDE_LANES];
+  e_t        gray_e[DECODE_WIDE_LANES];
+  e_t        prev_e[DECODE_WIDE_LANES];
+  pad_r_t    c0[DECODE_WIDE_LANES];
+
+  decode_ws_t single;
+} decode_wide_ws_t;
+
+CLEANUP_FUNC(decode_wide_ws, decode_wide_ws_t)
+
+// Decode the n ciphertexts ct[j] with the keys key[j] (which may all point to
+// the same key), in groups of DECODE_WIDE_LANES decodings that are computed in
+// lockstep. e[j] is set to the errors vector of decode_with_key(ct[j], key[j]),
+// and failed[j] is set to 1 when that call would return E_DECODING_FAILURE and
+// to 0 otherwise. The decodings are independent and constant-time, and the
+// last group is completed with copies of its last decoding.
+ret_t decode_wide(OUT e_t e[],
+                  OUT uint32_t failed[],
+                  IN const ct_t ct[],
+                  IN const decode_key_t *const key[],
+                  IN size_t                    n);
+
+// Same as decode_wide, with the scratch memory in ws instead of the stack.
+ret_t decode_wide_ws(OUT e_t e[],
+                     OUT uint32_t failed[],
+                     IN const ct_t ct[],
+                     IN const decode_key_t *const key[],
+                     IN size_t                    n,
+                     IN OUT decode_wide_ws_t *ws);
+
+// Same as decode_wide, where iters[j] is set as in decode_with_stats instead
+// of failed[j]. Intended only for DFR simulations (see decode_with_stats).
+ret_t decode_wide_with_stats(OUT e_t e[],
+                             OUT uint32_t iters[],
+                             IN const ct_t ct[],
+                             IN const decode_key_t *const key[],
+                             IN size_t                    n);
+
+// The steps of the decoder, exposed for benchmarking (see tests/bench.c).
+// s = c0 * h0, where h0_wlist holds the set bits of h0.
+ret_t compute_syndrome(OUT syndrome_t *syndrome,
+                       IN const pad_r_t *c0,
+                       IN const pad_r_t *h0,
+                       IN const compressed_idx_d_t *h0_wlist,
+                       IN OUT gf2x_mul_ws_t *ws,
+                       IN const decode_ctx *ctx);
+
+// The first iteration of the decoder, which also computes the black and gray
+// errors vectors. It uses the UPC and the rotated syndrome of ws.
+void find_err1(OUT e_t *e,
+               OUT e_t *black_e,
+               OUT e_t *gray_e,
+               IN const syndrome_t *          syndrome,
+               IN const decode_key_t *        key,
+               IN uint8_t                     threshold,
+               IN uint8_t                     delta,
+               IN OUT decode_ws_t *ws,
+               IN const decode_ctx *ctx);
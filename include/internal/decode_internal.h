@@ -25,6 +25,45 @@ void bit_sliced_adder_port(OUT upc_t *upc,
                            IN const size_t    num_of_slices);
 void bit_slice_full_subtract_port(OUT upc_t *upc, IN uint8_t val);
 
+// The weight of the first R_BITS of the syndrome
+uint64_t syndrome_weight_port(IN const syndrome_t *s);
+
+// upc += (in rotated right by bitscount), for the first num_of_slices slices
+// of upc. tmp is used for the intermediate rotation.
+void rotate_right_add_port(OUT upc_t *upc,
+                           OUT syndrome_t *tmp,
+                           IN const syndrome_t *in,
+                           IN uint32_t          bitscount,
+                           IN size_t            num_of_slices);
+
+// A step of the delta rotations (see DELTA_ROT_STEPS)
+typedef struct rot_step_s {
+  uint8_t adv;  // The number of blocks that the window advances
+  uint8_t bits; // The rotation of the window (less than DELTA_ROT_BLOCK_BITS)
+  uint8_t mask; // 0xff if the rotated window is added to the UPC, else 0
+} rot_step_t;
+
+// Advance the window win by step->adv blocks (in place), and add the window
+// rotated right by step->bits to upc if step->mask is set, for the first
+// num_of_slices slices of upc. The window of a column starts as the periodic
+// syndrome (see delta_rot_win_init in decode.c), and advances to the block of
+// every sorted index. This costs DELTA_ROT_ADV_LOG passes over the window,
+// instead of the log2(R) passes of rotating the syndrome for every index.
+void rotate_right_delta_add_port(OUT upc_t *upc,
+                                 IN OUT syndrome_t *win,
+                                 IN const rot_step_t *step,
+                                 IN size_t            num_of_slices);
+
+// The multi-instance versions of rotate_right_add and bit_slice_full_subtract
+// (see wide_syndrome_t), where bitscount[k] and val[k] belong to the lane k.
+void rotate_right_add_wide_port(OUT wide_upc_t *upc,
+                                OUT wide_syndrome_t *tmp,
+                                IN const wide_syndrome_t *in,
+                                IN const uint32_t bitscount[WIDE_LANES],
+                                IN size_t         num_of_slices);
+void bit_slice_full_subtract_wide_port(OUT wide_upc_t *upc,
+                                       IN const uint8_t val[WIDE_LANES]);
+
 #if defined(X86_64)
 void rotate_right_avx2(OUT syndrome_t *out,
                        IN const syndrome_t *in,
@@ -44,6 +83,38 @@ void bit_sliced_adder_avx512(OUT upc_t *upc,
 
 void bit_slice_full_subtract_avx2(OUT upc_t *upc, IN uint8_t val);
 void bit_slice_full_subtract_avx512(OUT upc_t *upc, IN uint8_t val);
+
+uint64_t syndrome_weight_avx2(IN const syndrome_t *s);
+uint64_t syndrome_weight_avx512(IN const syndrome_t *s);
+uint64_t syndrome_weight_vpopcnt(IN const syndrome_t *s);
+
+void rotate_right_add_avx2(OUT upc_t *upc,
+                           OUT syndrome_t *tmp,
+                           IN const syndrome_t *in,
+                           IN uint32_t          bitscount,
+                           IN size_t            num_of_slices);
+void rotate_right_add_avx512(OUT upc_t *upc,
+                             OUT syndrome_t *tmp,
+                             IN const syndrome_t *in,
+                             IN uint32_t          bitscount,
+                             IN size_t            num_of_slices);
+
+void rotate_right_delta_add_avx2(OUT upc_t *upc,
+                                 IN OUT syndrome_t *win,
+                                 IN const rot_step_t *step,
+                                 IN size_t            num_of_slices);
+void rotate_right_delta_add_avx512(OUT upc_t *upc,
+                                   IN OUT syndrome_t *win,
+                                   IN const rot_step_t *step,
+                                   IN size_t            num_of_slices);
+
+void rotate_right_add_wide_avx512(OUT wide_upc_t *upc,
+                                  OUT wide_syndrome_t *tmp,
+                                  IN const wide_syndrome_t *in,
+                                  IN const uint32_t bitscount[WIDE_LANES],
+                                  IN size_t         num_of_slices);
+void bit_slice_full_subtract_wide_avx512(OUT wide_upc_t *upc,
+                                         IN const uint8_t val[WIDE_LANES]);
 #endif
 
 // Decode methods struct
@@ -56,6 +127,23 @@ typedef struct decode_ctx_st {
                            IN OUT syndrome_t *rotated_syndrom,
                            IN const size_t    num_of_slices);
   void (*bit_slice_full_subtract)(OUT upc_t *upc, IN uint8_t val);
+  void (*rotate_right_add)(OUT upc_t *upc,
+                           OUT syndrome_t *tmp,
+                           IN const syndrome_t *in,
+                           IN uint32_t          bitscount,
+                           IN size_t            num_of_slices);
+  void (*rotate_right_delta_add)(OUT upc_t *upc,
+                                 IN OUT syndrome_t *win,
+                                 IN const rot_step_t *step,
+                                 IN size_t            num_of_slices);
+  uint64_t (*syndrome_weight)(IN const syndrome_t *s);
+  void (*rotate_right_add_wide)(OUT wide_upc_t *upc,
+                                OUT wide_syndrome_t *tmp,
+                                IN const wide_syndrome_t *in,
+                                IN const uint32_t bitscount[WIDE_LANES],
+                                IN size_t         num_of_slices);
+  void (*full_subtract_wide)(OUT wide_upc_t *upc,
+                             IN const uint8_t val[WIDE_LANES]);
 } decode_ctx;
 
 _INLINE_ void decode_ctx_init(decode_ctx *ctx)
@@ -66,11 +154,22 @@ _INLINE_ void decode_ctx_init(decode_ctx *ctx)
     ctx->dup                     = dup_avx512;
     ctx->bit_sliced_adder        = bit_sliced_adder_avx512;
     ctx->bit_slice_full_subtract = bit_slice_full_subtract_avx512;
+    ctx->rotate_right_add        = rotate_right_add_avx512;
+    ctx->rotate_right_delta_add  = rotate_right_delta_add_avx512;
+    ctx->syndrome_weight         = is_vpopcnt_enabled() ? syndrome_weight_vpopcnt
+                                                        : syndrome_weight_avx512;
+    ctx->rotate_right_add_wide   = rotate_right_add_wide_avx512;
+    ctx->full_subtract_wide      = bit_slice_full_subtract_wide_avx512;
   } else if(is_avx2_enabled()) {
     ctx->rotate_right            = rotate_right_avx2;
     ctx->dup                     = dup_avx2;
     ctx->bit_sliced_adder        = bit_sliced_adder_avx2;
     ctx->bit_slice_full_subtract = bit_slice_full_subtract_avx2;
+    ctx->rotate_right_add        = rotate_right_add_avx2;
+    ctx->rotate_right_delta_add  = rotate_right_delta_add_avx2;
+    ctx->syndrome_weight         = syndrome_weight_avx2;
+    ctx->rotate_right_add_wide   = rotate_right_add_wide_port;
+    ctx->full_subtract_wide      = bit_slice_full_subtract_wide_port;
   } else
 #endif
   {
@@ -78,5 +177,10 @@ _INLINE_ void decode_ctx_init(decode_ctx *ctx)
     ctx->dup                     = dup_port;
     ctx->bit_sliced_adder        = bit_sliced_adder_port;
     ctx->bit_slice_full_subtract = bit_slice_full_subtract_port;
+    ctx->rotate_right_add        = rotate_right_add_port;
+    ctx->rotate_right_delta_add  = rotate_right_delta_add_port;
+    ctx->syndrome_weight         = syndrome_weight_port;
+    ctx->rotate_right_add_wide   = rotate_right_add_wide_port;
+    ctx->full_subtract_wide      = bit_slice_full_subtract_wide_port;
   }
 }
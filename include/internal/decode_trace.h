@@ -0,0 +1,31 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include "bike_decode_trace.h"
+
+// The instrumentation of bike_decode_trace.h. Without DECODE_TRACE the macro
+// DECODE_TRACE_RUN is empty.
+#if defined(DECODE_TRACE)
+
+// Return the number of a new decoding of the calling thread
+uint32_t decode_trace_begin(void);
+
+// Append rec to the ring buffer of the calling thread
+void decode_trace_push(IN const bike_decode_record_t *rec);
+
+#  define DECODE_TRACE_RUN(x) \
+    do {                      \
+      x;                      \
+    } while(0)
+
+#else
+
+#  define DECODE_TRACE_RUN(x)
+
+#endif
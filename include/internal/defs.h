@@ -7,6 +7,11 @@
 
 #pragma once
 
+// Prefix the global symbols of the level dependent code (multi-level build)
+#if defined(BIKE_NAMESPACE)
+#  include "bike_namespace.h"
+#endif
+
 ////////////////////////////////////////////
 //             Basic defs
 ///////////////////////////////////////////
@@ -0,0 +1,24 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include "decode_internal.h"
+#include "gf2x_internal.h"
+#include "sampling_internal.h"
+
+// The methods of the gf2x, decode and sampling modules that are selected
+// for the current CPU. The table is filled once, on the first call to
+// get_dispatch_ctx (which also initializes the CPU features), and is
+// read-only afterwards, so it can be used by several threads concurrently.
+typedef struct dispatch_ctx_s {
+  gf2x_ctx     gf2x;
+  decode_ctx   decode;
+  sampling_ctx sampling;
+} dispatch_ctx;
+
+const dispatch_ctx *get_dispatch_ctx(void);
@@ -21,7 +21,19 @@ enum _bike_err
   E_AES_OVER_USED            = 3,
   EXTERNAL_LIB_ERROR_OPENSSL = 4,
   E_SHAKE_PRF_INIT_FAIL      = 5,
-  E_SHAKE_OVER_USED          = 6
+  E_SHAKE_OVER_USED          = 6,
+  E_KEYPOOL_INVALID_PARAMS   = 7,
+  E_KEYPOOL_INIT_FAIL        = 8,
+  E_RNG_FAIL                 = 9,
+  E_WORKSPACE_MISALIGNED     = 10,
+  E_PIPELINE_INVALID_PARAMS  = 11,
+  E_PIPELINE_INIT_FAIL       = 12,
+  E_COMPACT_SK_INVALID       = 13,
+  E_DECODER_INVALID_PARAMS   = 14,
+  E_ENC_POOL_INVALID_PARAMS  = 15,
+  E_KEY_CACHE_INVALID_PARAMS = 16,
+  E_KEY_CACHE_INIT_FAIL      = 17,
+  E_ARENA_INIT_FAIL          = 18
 };
 
 typedef enum _bike_err _bike_err_t;
@@ -7,8 +7,108 @@
 
 #pragma once
 
+#include "cleanup.h"
 #include "types.h"
 
+// The secure buffer size required for Karatsuba (see gf2x_mul.c) with a base
+// multiplication of b quadwords is computed by:
+//    size(n) = 3*half(n) + size(half(n)),  where half(n) <= n/2 + b,
+// and size(n) <= 20b for the flat schedules of n <= 4b.
+// It is less than 3n, plus 20b for the flat schedules (with b <= 16).
+#define SECURE_BUFFER_QWORDS ((3 * R_PADDED_QWORDS) + (20 * 16))
+
+// The scratch memory of the gf2x functions. The _ws variants of the functions
+// below keep all their temporary (secret) values in a workspace that is given
+// by the caller instead of on the stack. They do not clean the workspace,
+// this is left to its owner, once it is no longer needed.
+
+// Karatsuba multiplication (the product before the reduction, and the
+// temporary values of the recursion).
+typedef struct gf2x_dense_ws_s {
+  dbl_pad_r_t t;
+  uint64_t    secure_buffer[SECURE_BUFFER_QWORDS];
+#if defined(INTRA_OP_PARALLEL)
+  // The middle product and the secure buffers of the two top level
+  // sub-multiplications that run on the helper threads. The middle product
+  // is of 2 * half(n) <= n + 2b quadwords.
+  uint64_t par_mid[R_PADDED_QWORDS + (2 * 16)];
+  uint64_t par_buffer[2][SECURE_BUFFER_QWORDS];
+#endif
+} ALIGN(ALIGN_BYTES) gf2x_dense_ws_t;
+
+// Sparse multiplication by rotations (the triplicated input and its rotation)
+typedef struct gf2x_sparse_ws_s {
+  syndrome_t s;
+  syndrome_t rotated_s;
+} ALIGN(ALIGN_BYTES) gf2x_sparse_ws_t;
+
+// k-squaring by a permutation of the bits of the input
+typedef struct gf2x_ksqr_ws_s {
+  uint16_t map[R_PADDED];
+  uint8_t  a_bytes[R_PADDED];
+  uint8_t  c_bytes[R_PADDED];
+} ALIGN(ALIGN_BYTES) gf2x_ksqr_ws_t;
+
+// gf2x_mod_mul_ws and gf2x_mod_mul_sparse_ws
+typedef struct gf2x_mul_ws_s {
+  union {
+    gf2x_dense_ws_t  dense;
+    gf2x_sparse_ws_t sparse;
+  } u;
+} ALIGN(ALIGN_BYTES) gf2x_mul_ws_t;
+
+// Inversion by divsteps (see gf2x_inv.c). The polynomials are of R_BITS + 1
+// bits, rounded up to a multiple of 8 quadwords, and their products by the
+// transition matrices have an additional quadword.
+#define DIVSTEP_QWORDS (R_QWORDS + 10)
+
+typedef struct gf2x_divstep_ws_s {
+  uint64_t f[DIVSTEP_QWORDS];
+  uint64_t g[DIVSTEP_QWORDS];
+  uint64_t v[DIVSTEP_QWORDS];
+  uint64_t r[DIVSTEP_QWORDS];
+  uint64_t t[4][DIVSTEP_QWORDS];
+} ALIGN(ALIGN_BYTES) gf2x_divstep_ws_t;
+
+// gf2x_mod_inv_ws
+typedef struct gf2x_inv_ws_s {
+  pad_r_t f;
+  pad_r_t g;
+  pad_r_t t;
+  pad_r_t sqr_buf;
+  union {
+    gf2x_dense_ws_t   mul;
+    gf2x_ksqr_ws_t    k_sqr;
+    gf2x_divstep_ws_t divstep;
+  } u;
+} ALIGN(ALIGN_BYTES) gf2x_inv_ws_t;
+
+// The permutation maps of the k-squarings of the inversion by
+// exponentiation (see gf2x_ksqr_maps_init), for the exponents k that the
+// current ISA computes by a k-squaring. The header below is followed by
+// num_maps maps of R_PADDED indices each (gf2x_ksqr_maps_size() bytes in
+// total). Since R < 2^15 (see bike_defs.h), the inversion has at most 14
+// exponentiations of each kind.
+#define GF2X_KSQR_MAX_MAPS (2 * 14)
+
+typedef struct gf2x_ksqr_maps_s {
+  uint32_t num_maps;
+  uint32_t k[GF2X_KSQR_MAX_MAPS];
+} ALIGN(ALIGN_BYTES) gf2x_ksqr_maps_t;
+
+// The map j of maps
+_INLINE_ const uint16_t *gf2x_ksqr_map(IN const gf2x_ksqr_maps_t *maps,
+                                       IN const size_t            j)
+{
+  const uint16_t *first = (const uint16_t *)&maps[1];
+  return &first[j * R_PADDED];
+}
+
+CLEANUP_FUNC(gf2x_dense_ws, gf2x_dense_ws_t)
+CLEANUP_FUNC(gf2x_sparse_ws, gf2x_sparse_ws_t)
+CLEANUP_FUNC(gf2x_mul_ws, gf2x_mul_ws_t)
+CLEANUP_FUNC(gf2x_inv_ws, gf2x_inv_ws_t)
+
 // c = a+b mod (x^r - 1)
 _INLINE_ void
 gf2x_mod_add(OUT pad_r_t *c, IN const pad_r_t *a, IN const pad_r_t *b)
@@ -24,6 +124,38 @@ gf2x_mod_add(OUT pad_r_t *c, IN const pad_r_t *a, IN const pad_r_t *b)
 
 // c = a*b mod (x^r - 1)
 void gf2x_mod_mul(OUT pad_r_t *c, IN const pad_r_t *a, IN const pad_r_t *b);
+void gf2x_mod_mul_ws(OUT pad_r_t *c,
+                     IN const pad_r_t *a,
+                     IN const pad_r_t *b,
+                     IN OUT gf2x_mul_ws_t *ws);
 
-// c = a^-1 mod (x^r - 1)
+// c = a*b mod (x^r - 1), where b is sparse with w set bits at the positions
+// wlist. Depending on the CPU it is computed either by Karatsuba (using b) or
+// by constant-time rotations of a (using wlist).
+void gf2x_mod_mul_sparse(OUT pad_r_t *c,
+                         IN const pad_r_t *a,
+                         IN const pad_r_t *b,
+                         IN const idx_t *wlist,
+                         IN size_t w);
+void gf2x_mod_mul_sparse_ws(OUT pad_r_t *c,
+                            IN const pad_r_t *a,
+                            IN const pad_r_t *b,
+                            IN const idx_t *wlist,
+                            IN size_t w,
+                            IN OUT gf2x_mul_ws_t *ws);
+
+// c = a^-1 mod (x^r - 1), computed either by exponentiation or by divsteps
+// (see gf2x_ctx_init). The exponentiation uses the precomputed maps of its
+// k-squarings, if maps is not NULL.
 void gf2x_mod_inv(OUT pad_r_t *c, IN const pad_r_t *a);
+void gf2x_mod_inv_ws(OUT pad_r_t *c,
+                     IN const pad_r_t *a,
+                     IN const gf2x_ksqr_maps_t *maps,
+                     IN OUT gf2x_inv_ws_t *ws);
+
+// The size in bytes of the maps of the current ISA, and their computation.
+// The maps depend only on R and on the ISA (the exponents that it computes
+// by k-squarings); the inversion computes the exponents that have no map by
+// itself, e.g., after bike_force_isa.
+size_t gf2x_ksqr_maps_size(void);
+void   gf2x_ksqr_maps_init(OUT gf2x_ksqr_maps_t *maps);
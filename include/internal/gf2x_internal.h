@@ -11,7 +11,9 @@
 #include <stdlib.h>
 
 #include "cpu_features.h"
+#include "gf2x.h"
 #include "types.h"
+#include "utilities.h"
 
 // The size in quadwords of the operands in the gf2x_mul_base function
 // for different implementations.
@@ -19,6 +21,29 @@
 #define GF2X_PCLMUL_BASE_QWORDS  (8)
 #define GF2X_VPCLMUL_BASE_QWORDS (16)
 
+// Rough cost estimates (in cycles) of a single gf2x_mul_base call and of
+// a constant-time rotation of 8 quadwords (used by gf2x_mod_mul_sparse)
+// for the different implementations. gf2x_ctx_init uses them to decide up to
+// which sparse weight the rotations are faster than Karatsuba.
+#define GF2X_PORT_BASE_COST    (42)
+#define GF2X_PCLMUL_BASE_COST  (44)
+#define GF2X_VPCLMUL_BASE_COST (95)
+
+#define GF2X_PORT_ROT_COST   (106)
+#define GF2X_AVX2_ROT_COST   (30)
+#define GF2X_AVX512_ROT_COST (11)
+
+// Rough cost estimates of a modular squaring (mod_sqr) and of a k-squaring,
+// per 10 quadwords of R. gf2x_ctx_init uses them to find the largest k for
+// which k repeated squarings are faster than a single k-squaring.
+#define GF2X_PORT_SQR_COST    (680)
+#define GF2X_PCLMUL_SQR_COST  (22)
+#define GF2X_VPCLMUL_SQR_COST (8)
+
+#define GF2X_PORT_K_SQR_COST   (2100)
+#define GF2X_AVX2_K_SQR_COST   (900)
+#define GF2X_AVX512_K_SQR_COST (400)
+
 // ------------------ FUNCTIONS NEEDED FOR GF2X MULTIPLICATION ------------------
 // GF2X multiplication of a and b of size GF2X_BASE_QWORDS, c = a * b
 void gf2x_mul_base_port(OUT uint64_t *c,
@@ -28,24 +53,57 @@ void karatzuba_add1_port(OUT uint64_t *alah,
                          OUT uint64_t *blbh,
                          IN const uint64_t *a,
                          IN const uint64_t *b,
-                         IN const size_t    qwords_len);
+                         IN const size_t    qwords_len,
+                         IN const size_t    hi_qwords_len);
 void karatzuba_add2_port(OUT uint64_t *z,
                          IN const uint64_t *x,
                          IN const uint64_t *y,
                          IN const size_t    qwords_len);
 void karatzuba_add3_port(OUT uint64_t *c,
                          IN const uint64_t *mid,
-                         IN const size_t    qwords_len);
+                         IN const size_t    qwords_len,
+                         IN const size_t    hi_qwords_len);
+void karatzuba_add23_port(OUT uint64_t *c,
+                          IN const uint64_t *mid,
+                          IN const size_t    qwords_len);
+
+// c = a*b mod (x^r - 1), where b has w set bits at the positions wlist
+void gf2x_mod_mul_sparse_port(OUT pad_r_t *c,
+                              IN const pad_r_t *a,
+                              IN const idx_t *wlist,
+                              IN const size_t w,
+                              OUT gf2x_sparse_ws_t *ws);
 
 // -------------------- FUNCTIONS NEEDED FOR GF2X INVERSION --------------------
-// c = a^2
-void gf2x_sqr_port(OUT dbl_pad_r_t *c, IN const pad_r_t *a);
+// c = a^2 mod (x^r - 1), where c and a do not overlap
+void gf2x_mod_sqr_port(OUT pad_r_t *c, IN const pad_r_t *a);
 // The k-squaring function computes c = a^(2^k) % (x^r - 1),
 // It is required by inversion, where l_param is derived from k.
-void k_sqr_port(OUT pad_r_t *c, IN const pad_r_t *a, IN size_t l_param);
+void k_sqr_port(OUT pad_r_t *c,
+                IN const pad_r_t *a,
+                IN size_t l_param,
+                OUT gf2x_ksqr_ws_t *ws);
+// k-squaring by a precomputed permutation map (see gf2x_ksqr_maps_init)
+void k_sqr_map_port(OUT pad_r_t *c,
+                    IN const pad_r_t *a,
+                    IN const uint16_t *map,
+                    OUT gf2x_ksqr_ws_t *ws);
 // c = a mod (x^r - 1)
 void gf2x_red_port(OUT pad_r_t *c, IN const dbl_pad_r_t *a);
 
+// c0 = m[0]*x + m[1]*y and c1 = m[2]*x + m[3]*y, where m is the transition
+// matrix of a batch of divsteps (of 64-bit entries), x and y are of qwords
+// quadwords (a multiple of DIVSTEP_ALIGN_QWORDS), and c0 and c1 are of
+// qwords + 1 quadwords.
+#define DIVSTEP_ALIGN_QWORDS (8)
+
+void gf2x_divstep_mul_port(OUT uint64_t *c0,
+                           OUT uint64_t *c1,
+                           IN const uint64_t m[4],
+                           IN const uint64_t *x,
+                           IN const uint64_t *y,
+                           IN size_t          qwords);
+
 // AVX2 and AVX512 versions of the functions
 #if defined(X86_64)
 // ------------------ FUNCTIONS NEEDED FOR GF2X MULTIPLICATION ------------------
@@ -60,12 +118,14 @@ void karatzuba_add1_avx2(OUT uint64_t *alah,
                          OUT uint64_t *blbh,
                          IN const uint64_t *a,
                          IN const uint64_t *b,
-                         IN const size_t    qwords_len);
+                         IN const size_t    qwords_len,
+                         IN const size_t    hi_qwords_len);
 void karatzuba_add1_avx512(OUT uint64_t *alah,
                            OUT uint64_t *blbh,
                            IN const uint64_t *a,
                            IN const uint64_t *b,
-                           IN const size_t    qwords_len);
+                           IN const size_t    qwords_len,
+                           IN const size_t    hi_qwords_len);
 
 void karatzuba_add2_avx2(OUT uint64_t *z,
                          IN const uint64_t *x,
@@ -79,94 +139,331 @@ void karatzuba_add2_avx512(OUT uint64_t *z,
 
 void karatzuba_add3_avx2(OUT uint64_t *c,
                          IN const uint64_t *mid,
-                         IN const size_t    qwords_len);
+                         IN const size_t    qwords_len,
+                         IN const size_t    hi_qwords_len);
 void karatzuba_add3_avx512(OUT uint64_t *c,
                            IN const uint64_t *mid,
-                           IN const size_t    qwords_len);
+                           IN const size_t    qwords_len,
+                           IN const size_t    hi_qwords_len);
+
+void karatzuba_add23_avx2(OUT uint64_t *c,
+                          IN const uint64_t *mid,
+                          IN const size_t    qwords_len);
+void karatzuba_add23_avx512(OUT uint64_t *c,
+                            IN const uint64_t *mid,
+                            IN const size_t    qwords_len);
+
+void gf2x_mod_mul_sparse_avx2(OUT pad_r_t *c,
+                              IN const pad_r_t *a,
+                              IN const idx_t *wlist,
+                              IN const size_t w,
+                              OUT gf2x_sparse_ws_t *ws);
+void gf2x_mod_mul_sparse_avx512(OUT pad_r_t *c,
+                                IN const pad_r_t *a,
+                                IN const idx_t *wlist,
+                                IN const size_t w,
+                                OUT gf2x_sparse_ws_t *ws);
 
 // -------------------- FUNCTIONS NEEDED FOR GF2X INVERSION --------------------
-// c = a^2
-void gf2x_sqr_pclmul(OUT dbl_pad_r_t *c, IN const pad_r_t *a);
-void gf2x_sqr_vpclmul(OUT dbl_pad_r_t *c, IN const pad_r_t *a);
+// c = a^2 mod (x^r - 1)
+void gf2x_mod_sqr_pclmul(OUT pad_r_t *c, IN const pad_r_t *a);
+void gf2x_mod_sqr_vpclmul(OUT pad_r_t *c, IN const pad_r_t *a);
 
 // The k-squaring function computes c = a^(2^k) % (x^r - 1),
 // It is required by inversion, where l_param is derived from k.
-void k_sqr_avx2(OUT pad_r_t *c, IN const pad_r_t *a, IN size_t l_param);
-void k_sqr_avx512(OUT pad_r_t *c, IN const pad_r_t *a, IN size_t l_param);
+void k_sqr_avx2(OUT pad_r_t *c,
+                IN const pad_r_t *a,
+                IN size_t l_param,
+                OUT gf2x_ksqr_ws_t *ws);
+void k_sqr_avx512(OUT pad_r_t *c,
+                  IN const pad_r_t *a,
+                  IN size_t l_param,
+                  OUT gf2x_ksqr_ws_t *ws);
+void k_sqr_map_avx2(OUT pad_r_t *c,
+                    IN const pad_r_t *a,
+                    IN const uint16_t *map,
+                    OUT gf2x_ksqr_ws_t *ws);
+void k_sqr_map_avx512(OUT pad_r_t *c,
+                      IN const pad_r_t *a,
+                      IN const uint16_t *map,
+                      OUT gf2x_ksqr_ws_t *ws);
 
 // c = a mod (x^r - 1)
 void gf2x_red_avx2(OUT pad_r_t *c, IN const dbl_pad_r_t *a);
 void gf2x_red_avx512(OUT pad_r_t *c, IN const dbl_pad_r_t *a);
+
+void gf2x_divstep_mul_pclmul(OUT uint64_t *c0,
+                             OUT uint64_t *c1,
+                             IN const uint64_t m[4],
+                             IN const uint64_t *x,
+                             IN const uint64_t *y,
+                             IN size_t          qwords);
+void gf2x_divstep_mul_vpclmul(OUT uint64_t *c0,
+                              OUT uint64_t *c1,
+                              IN const uint64_t m[4],
+                              IN const uint64_t *x,
+                              IN const uint64_t *y,
+                              IN size_t          qwords);
 #endif
 
 // GF2X methods struct
 typedef struct gf2x_ctx_st {
+  // The operands of karatzuba are of mul_qwords quadwords: R_QWORDS rounded up
+  // to a multiple of mul_base_qwords (and not to R_PADDED_QWORDS).
+  size_t mul_qwords;
   size_t mul_base_qwords;
   void (*mul_base)(OUT uint64_t *c, IN const uint64_t *a, IN const uint64_t *b);
   void (*karatzuba_add1)(OUT uint64_t *alah,
                          OUT uint64_t *blbh,
                          IN const uint64_t *a,
                          IN const uint64_t *b,
-                         IN const size_t    qwords_len);
+                         IN const size_t    qwords_len,
+                         IN const size_t    hi_qwords_len);
   void (*karatzuba_add2)(OUT uint64_t *z,
                          IN const uint64_t *x,
                          IN const uint64_t *y,
                          IN const size_t    qwords_len);
   void (*karatzuba_add3)(OUT uint64_t *c,
                          IN const uint64_t *mid,
-                         IN const size_t    qwords_len);
+                         IN const size_t    qwords_len,
+                         IN const size_t    hi_qwords_len);
+  void (*karatzuba_add23)(OUT uint64_t *c,
+                          IN const uint64_t *mid,
+                          IN const size_t    qwords_len);
+
+  // The sparse multiplication is used only for weights up to mul_sparse_max_w
+  size_t mul_sparse_max_w;
+  void (*mul_sparse)(OUT pad_r_t *c,
+                     IN const pad_r_t *a,
+                     IN const idx_t *wlist,
+                     IN const size_t w,
+                     OUT gf2x_sparse_ws_t *ws);
 
-  void (*sqr)(OUT dbl_pad_r_t *c, IN const pad_r_t *a);
-  void (*k_sqr)(OUT pad_r_t *c, IN const pad_r_t *a, IN size_t l_param);
+  // f^(2^k) is computed by k squarings for k <= k_sqr_thr,
+  // and by a single k-squaring otherwise.
+  size_t k_sqr_thr;
+  void (*mod_sqr)(OUT pad_r_t *c, IN const pad_r_t *a);
+  void (*k_sqr)(OUT pad_r_t *c,
+                IN const pad_r_t *a,
+                IN size_t l_param,
+                OUT gf2x_ksqr_ws_t *ws);
+  void (*k_sqr_map)(OUT pad_r_t *c,
+                    IN const pad_r_t *a,
+                    IN const uint16_t *map,
+                    OUT gf2x_ksqr_ws_t *ws);
 
   void (*red)(OUT pad_r_t *c, IN const dbl_pad_r_t *a);
+
+  // The inversion method (gf2x_mod_inv_exp or gf2x_mod_inv_divstep), and the
+  // multiplication by the transition matrices of the divsteps.
+  void (*mod_inv)(OUT pad_r_t *c,
+                  IN const pad_r_t *a,
+                  IN const gf2x_ksqr_maps_t *maps,
+                  IN OUT gf2x_inv_ws_t *ws,
+                  IN const struct gf2x_ctx_st *ctx);
+  void (*divstep_mul)(OUT uint64_t *c0,
+                      OUT uint64_t *c1,
+                      IN const uint64_t m[4],
+                      IN const uint64_t *x,
+                      IN const uint64_t *y,
+                      IN size_t          qwords);
 } gf2x_ctx;
 
+// c = a^-1 mod (x^r - 1) by exponentiation, [1](Algorithm 2) in gf2x_inv.c
+void gf2x_mod_inv_exp(OUT pad_r_t *c,
+                      IN const pad_r_t *a,
+                      IN const gf2x_ksqr_maps_t *maps,
+                      IN OUT gf2x_inv_ws_t *ws,
+                      IN const gf2x_ctx *ctx);
+
+// c = a^-1 mod (x^r - 1) by constant-time divsteps (Bernstein-Yang)
+void gf2x_mod_inv_divstep(OUT pad_r_t *c,
+                          IN const pad_r_t *a,
+                          IN const gf2x_ksqr_maps_t *maps,
+                          IN OUT gf2x_inv_ws_t *ws,
+                          IN const gf2x_ctx *ctx);
+
 // Used in gf2x_inv.c to avoid initializing the context many times.
 void gf2x_mod_mul_with_ctx(OUT pad_r_t *c,
                            IN const pad_r_t *a,
                            IN const pad_r_t *b,
+                           OUT gf2x_dense_ws_t *ws,
                            IN const gf2x_ctx *ctx);
 
+void gf2x_mod_mul_sparse_with_ctx(OUT pad_r_t *c,
+                                  IN const pad_r_t *a,
+                                  IN const idx_t *wlist,
+                                  IN const size_t w,
+                                  OUT gf2x_sparse_ws_t *ws,
+                                  IN const gf2x_ctx *ctx);
+
+// The rotation amount that multiplies a polynomial by x^idx,
+// i.e., (R_BITS - idx) mod R_BITS, computed in constant time.
+_INLINE_ uint32_t sparse_rotation_bits(IN const idx_t idx)
+{
+  const uint32_t bits = R_BITS - idx;
+  return bits - (R_BITS & secure_l32_mask(bits, R_BITS));
+}
+
+// The size of the low part of the karatzuba operands of qwords_len quadwords:
+// half of them, rounded up to a multiple of base_qwords. The high part, of the
+// remaining quadwords, may therefore be smaller than the low part.
+_INLINE_ size_t karatzuba_half_qwords(IN const size_t qwords_len,
+                                      IN const size_t base_qwords)
+{
+  return DIVIDE_AND_CEIL(qwords_len, 2 * base_qwords) * base_qwords;
+}
+
+// Operands of up to KARATZUBA_FLAT_BLOCKS blocks (of the size of the base
+// multiplication) are multiplied by a flat schedule (see gf2x_mul.c).
+// The schedule of k blocks requires karatzuba_flat_mults(k) base
+// multiplications, and a secure buffer of karatzuba_flat_buffer(k) blocks.
+#define KARATZUBA_FLAT_BLOCKS (4)
+
+_INLINE_ size_t karatzuba_flat_mults(IN const size_t blocks)
+{
+  switch(blocks) {
+    case 1: return 1;
+    case 2: return 3;
+    case 3: return 6;
+    default: return 9;
+  }
+}
+
+_INLINE_ size_t karatzuba_flat_buffer(IN const size_t blocks)
+{
+  switch(blocks) {
+    case 1: return 0;
+    case 2: return 4;
+    case 3: return 14;
+    default: return 20;
+  }
+}
+
+// The size of the secure buffer of karatzuba of qwords_len quadwords
+// (see SECURE_BUFFER_QWORDS)
+_INLINE_ size_t karatzuba_buffer_qwords(IN const size_t qwords_len,
+                                        IN const size_t base_qwords)
+{
+  if(qwords_len <= (KARATZUBA_FLAT_BLOCKS * base_qwords)) {
+    return karatzuba_flat_buffer(qwords_len / base_qwords) * base_qwords;
+  }
+
+  const size_t half_qw_len = karatzuba_half_qwords(qwords_len, base_qwords);
+
+  return (3 * half_qw_len) + karatzuba_buffer_qwords(half_qw_len, base_qwords);
+}
+
+// Estimated cost of karatzuba of qwords_len quadwords (see gf2x_mul.c)
+// with a gf2x_mul_base of base_qwords quadwords
+_INLINE_ size_t karatzuba_cost(IN const size_t qwords_len,
+                               IN const size_t base_qwords,
+                               IN const size_t base_cost)
+{
+  if(qwords_len <= (KARATZUBA_FLAT_BLOCKS * base_qwords)) {
+    return karatzuba_flat_mults(qwords_len / base_qwords) * base_cost;
+  }
+
+  const size_t half_qw_len = karatzuba_half_qwords(qwords_len, base_qwords);
+
+  return (2 * karatzuba_cost(half_qw_len, base_qwords, base_cost)) +
+         karatzuba_cost(qwords_len - half_qw_len, base_qwords, base_cost);
+}
+
 _INLINE_ void gf2x_ctx_init(gf2x_ctx *ctx)
 {
+  size_t rot_cost;
+  size_t base_cost;
+  size_t k_sqr_cost;
+  size_t sqr_cost;
+
 #if defined(X86_64)
   if(is_avx512_enabled()) {
-    ctx->karatzuba_add1 = karatzuba_add1_avx512;
-    ctx->karatzuba_add2 = karatzuba_add2_avx512;
-    ctx->karatzuba_add3 = karatzuba_add3_avx512;
-    ctx->k_sqr          = k_sqr_avx512;
-    ctx->red            = gf2x_red_avx512;
+    ctx->karatzuba_add1  = karatzuba_add1_avx512;
+    ctx->karatzuba_add2  = karatzuba_add2_avx512;
+    ctx->karatzuba_add3  = karatzuba_add3_avx512;
+    ctx->karatzuba_add23 = karatzuba_add23_avx512;
+    ctx->k_sqr           = k_sqr_avx512;
+    ctx->k_sqr_map       = k_sqr_map_avx512;
+    ctx->red             = gf2x_red_avx512;
+    ctx->mul_sparse      = gf2x_mod_mul_sparse_avx512;
+    rot_cost             = GF2X_AVX512_ROT_COST;
+    k_sqr_cost           = GF2X_AVX512_K_SQR_COST;
   } else if(is_avx2_enabled()) {
-    ctx->karatzuba_add1 = karatzuba_add1_avx2;
-    ctx->karatzuba_add2 = karatzuba_add2_avx2;
-    ctx->karatzuba_add3 = karatzuba_add3_avx2;
-    ctx->k_sqr          = k_sqr_avx2;
-    ctx->red            = gf2x_red_avx2;
+    ctx->karatzuba_add1  = karatzuba_add1_avx2;
+    ctx->karatzuba_add2  = karatzuba_add2_avx2;
+    ctx->karatzuba_add3  = karatzuba_add3_avx2;
+    ctx->karatzuba_add23 = karatzuba_add23_avx2;
+    ctx->k_sqr           = k_sqr_avx2;
+    ctx->k_sqr_map       = k_sqr_map_avx2;
+    ctx->red             = gf2x_red_avx2;
+    ctx->mul_sparse      = gf2x_mod_mul_sparse_avx2;
+    rot_cost             = GF2X_AVX2_ROT_COST;
+    k_sqr_cost           = GF2X_AVX2_K_SQR_COST;
   } else
 #endif
   {
-    ctx->karatzuba_add1 = karatzuba_add1_port;
-    ctx->karatzuba_add2 = karatzuba_add2_port;
-    ctx->karatzuba_add3 = karatzuba_add3_port;
-    ctx->k_sqr          = k_sqr_port;
-    ctx->red            = gf2x_red_port;
+    ctx->karatzuba_add1  = karatzuba_add1_port;
+    ctx->karatzuba_add2  = karatzuba_add2_port;
+    ctx->karatzuba_add3  = karatzuba_add3_port;
+    ctx->karatzuba_add23 = karatzuba_add23_port;
+    ctx->k_sqr           = k_sqr_port;
+    ctx->k_sqr_map       = k_sqr_map_port;
+    ctx->red             = gf2x_red_port;
+    ctx->mul_sparse      = gf2x_mod_mul_sparse_port;
+    rot_cost             = GF2X_PORT_ROT_COST;
+    k_sqr_cost           = GF2X_PORT_K_SQR_COST;
   }
 
 #if defined(X86_64)
   if(is_vpclmul_enabled()) {
     ctx->mul_base_qwords = GF2X_VPCLMUL_BASE_QWORDS;
     ctx->mul_base        = gf2x_mul_base_vpclmul;
-    ctx->sqr             = gf2x_sqr_vpclmul;
+    ctx->mod_sqr         = gf2x_mod_sqr_vpclmul;
+    base_cost            = GF2X_VPCLMUL_BASE_COST;
+    sqr_cost             = GF2X_VPCLMUL_SQR_COST;
   } else if(is_pclmul_enabled()) {
     ctx->mul_base_qwords = GF2X_PCLMUL_BASE_QWORDS;
     ctx->mul_base        = gf2x_mul_base_pclmul;
-    ctx->sqr             = gf2x_sqr_pclmul;
+    ctx->mod_sqr         = gf2x_mod_sqr_pclmul;
+    base_cost            = GF2X_PCLMUL_BASE_COST;
+    sqr_cost             = GF2X_PCLMUL_SQR_COST;
   } else
 #endif
   {
     ctx->mul_base_qwords = GF2X_PORT_BASE_QWORDS;
     ctx->mul_base        = gf2x_mul_base_port;
-    ctx->sqr             = gf2x_sqr_port;
+    ctx->mod_sqr         = gf2x_mod_sqr_port;
+    base_cost            = GF2X_PORT_BASE_COST;
+    sqr_cost             = GF2X_PORT_SQR_COST;
+  }
+
+  ctx->mul_qwords =
+    DIVIDE_AND_CEIL(R_QWORDS, ctx->mul_base_qwords) * ctx->mul_base_qwords;
+
+  // A sparse multiplication costs w rotations of R_QWORDS quadwords
+  ctx->mul_sparse_max_w =
+    karatzuba_cost(ctx->mul_qwords, ctx->mul_base_qwords, base_cost) /
+    (DIVIDE_AND_CEIL(R_QWORDS, 8) * rot_cost);
+
+  ctx->k_sqr_thr = k_sqr_cost / sqr_cost;
+
+#if defined(X86_64)
+  if(is_vpclmul_enabled()) {
+    ctx->divstep_mul = gf2x_divstep_mul_vpclmul;
+  } else if(is_pclmul_enabled()) {
+    ctx->divstep_mul = gf2x_divstep_mul_pclmul;
+  } else
+#endif
+  {
+    ctx->divstep_mul = gf2x_divstep_mul_port;
   }
+
+  // The exponentiation is faster for R of the BIKE levels (the divsteps are
+  // quadratic in R), even with VPCLMUL.
+#if defined(GF2X_INV_DIVSTEP)
+  ctx->mod_inv = gf2x_mod_inv_divstep;
+#else
+  ctx->mod_inv = gf2x_mod_inv_exp;
+#endif
 }
@@ -0,0 +1,40 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include "cleanup.h"
+#include "decode.h"
+#include "kem.h"
+#include "sha.h"
+
+// With BIND_PK_AND_M, the function H hashes pk and m. The expanded keys save
+// the hash state after absorbing pk, so that H absorbs only m for every
+// operation. The OpenSSL hash context cannot be copied without an allocation,
+// so the state is not saved (and pk is hashed every time) with OpenSSL.
+#if defined(BIND_PK_AND_M) && defined(SHA_CTX_COPYABLE)
+#  define BIKE_PK_HASH_CACHED
+#endif
+
+// The expanded public key (see bike_enc_key_t in kem.h)
+struct bike_enc_key_s {
+  bike_pk_view_t view;
+#if defined(BIKE_PK_HASH_CACHED)
+  sha_ctx_t pk_hash;
+#endif
+};
+
+// The expanded private key (see bike_dec_key_t in kem.h)
+struct bike_dec_key_s {
+  aligned_sk_t sk;
+  decode_key_t dec;
+#if defined(BIKE_PK_HASH_CACHED)
+  sha_ctx_t pk_hash;
+#endif
+};
+
+CLEANUP_FUNC(bike_dec_key, bike_dec_key_t)
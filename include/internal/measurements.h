@@ -7,6 +7,33 @@
 
 #pragma once
 
+// get_cycles is used by MEASURE (RDTSC), by the benchmarks (BIKE_BENCH),
+// and by the instrumentation of the library (BIKE_PROFILE, see profile.h)
+#if defined(RDTSC) || defined(BIKE_BENCH) || defined(BIKE_PROFILE)
+#  include <stdint.h>
+
+#  define HALF_GPR_SIZE UINT8_C(32)
+
+#  if defined(X86_64)
+inline static uint64_t get_cycles(void)
+{
+  uint64_t hi;
+  uint64_t lo;
+  __asm__ __volatile__("rdtscp\n\t" : "=a"(lo), "=d"(hi)::"rcx");
+  return lo ^ (hi << HALF_GPR_SIZE);
+}
+#  elif defined(AARCH64)
+inline static uint64_t get_cycles(void)
+{
+  uint64_t value;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(value));
+  return value;
+}
+#  else
+#    error "Unsupported architecture."
+#  endif
+#endif
+
 #if !defined(RDTSC)
 #  define MEASURE(msg, x) \
     do {                  \
@@ -15,7 +42,6 @@
 #else
 
 #  include <float.h>
-#  include <stdint.h>
 
 // This part defines the functions and macros needed to measure using RDTSC
 #  if !defined(REPEAT)
@@ -36,27 +62,6 @@ double                 temp_clk;
 size_t                 rdtsc_itr;
 size_t                 rdtsc_outer_itr;
 
-#  define HALF_GPR_SIZE UINT8_C(32)
-
-#  if defined(X86_64)
-inline static uint64_t get_cycles(void)
-{
-  uint64_t hi;
-  uint64_t lo;
-  __asm__ __volatile__("rdtscp\n\t" : "=a"(lo), "=d"(hi)::"rcx");
-  return lo ^ (hi << HALF_GPR_SIZE);
-}
-#  elif defined(AARCH64)
-inline static uint64_t get_cycles(void)
-{
-  uint64_t value;
-  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(value));
-  return value;
-}
-#  else
-#    error "Unsupported architecture."
-#  endif
-
 /*
 This MACRO measures the number of cycles "x" runs. This is the flow:
    1) it repeats "x" WARMUP times, in order to warm the cache.
@@ -0,0 +1,18 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include "bike_parallel.h"
+
+typedef void (*par_task_t)(IN OUT void *arg, IN size_t task);
+
+// Run task(arg, 0), ..., task(arg, num_tasks - 1) and return when all of them
+// completed. The task 0 runs on the calling thread, and the others on the
+// helper threads (see bike_parallel_start). The tasks that have no free
+// helper run on the calling thread after its own task.
+void par_run(IN par_task_t task, IN OUT void *arg, IN size_t num_tasks);
@@ -15,10 +15,17 @@
 
 #  include "fips202.h"
 
+// The PRF squeezes SHAKE_PRF_BUFFER_BLOCKS blocks of SHAKE256_RATE bytes at a
+// time into its buffer. Requests longer than a block are squeezed directly
+// into the output.
+#  define SHAKE_PRF_BUFFER_BLOCKS (4)
+#  define SHAKE_PRF_BUFFER_BYTES  (SHAKE_PRF_BUFFER_BLOCKS * SHAKE256_RATE)
+
 typedef struct shake256_prf_state_s {
   uint64_t s[25];
-  uint8_t  buffer[SHAKE256_RATE];
+  uint8_t  buffer[SHAKE_PRF_BUFFER_BYTES];
   size_t   curr_pos_in_buffer;
+  size_t   buffer_len;
   size_t   rem_invocations;
 } shake256_prf_state_t;
 
@@ -28,11 +35,17 @@ typedef shake256_prf_state_t prf_state_t;
 
 #include "aes.h"
 
+// The PRF encrypts AES_CTR_PRF_BUFFER_BLOCKS counter blocks at a time into its
+// buffer (see aes256_enc_ctr_x8).
+#define AES_CTR_PRF_BUFFER_BLOCKS (AES256_CTR_X8_BLOCKS)
+#define AES_CTR_PRF_BUFFER_BYTES  (AES_CTR_PRF_BUFFER_BLOCKS * AES256_BLOCK_BYTES)
+
 typedef struct aes_ctr_prf_state_s {
   uint128_t   ctr;
-  uint128_t   buffer;
+  uint8_t     buffer[AES_CTR_PRF_BUFFER_BYTES];
   aes256_ks_t ks;
   size_t      curr_pos_in_buffer;
+  size_t      buffer_len;
   size_t      rem_invocations;
 } aes_ctr_prf_state_t;
 
@@ -0,0 +1,45 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include "bike_profile.h"
+
+// The instrumentation of the stages of bike_profile.h. Without BIKE_PROFILE
+// the macros only run "x", and PROFILE_BEGIN/PROFILE_END are empty.
+#if defined(BIKE_PROFILE)
+
+#  include "measurements.h"
+
+extern __thread bike_profile_t bike_profile_counters;
+
+#  define PROFILE_BEGIN(stage) const uint64_t profile_begin_##stage = get_cycles()
+
+#  define PROFILE_END(stage)                                              \
+    do {                                                                  \
+      bike_profile_counters.cycles[stage] +=                              \
+        get_cycles() - profile_begin_##stage;                             \
+      bike_profile_counters.calls[stage]++;                               \
+    } while(0)
+
+#  define PROFILE(stage, x) \
+    do {                    \
+      PROFILE_BEGIN(stage); \
+      x;                    \
+      PROFILE_END(stage);   \
+    } while(0)
+
+#else
+
+#  define PROFILE_BEGIN(stage)
+#  define PROFILE_END(stage)
+#  define PROFILE(stage, x) \
+    do {                    \
+      x;                    \
+    } while(0)
+
+#endif
@@ -22,10 +22,32 @@ typedef enum
   MUST_BE_ODD    = 1
 } must_be_odd_t;
 
-void get_seeds(OUT seeds_t *seeds);
+// Fills bytes buf[0..len-1] from the randomness source that is set by
+// bike_set_rng (see bike_rng.h).
+ret_t get_random_bytes(OUT uint8_t *buf, IN size_t len);
+
+// Replace the randomness source of the calling thread by a deterministic DRBG
+// that is seeded with the RNG_SEED_BYTES bytes of seed, or restore the source
+// that is set by bike_set_rng when seed is NULL (see bike_bulk_run).
+#define RNG_SEED_BYTES (32U)
+void set_thread_rng_seed(IN const uint8_t *seed);
+
+ret_t get_seeds(OUT seeds_t *seeds);
 
 ret_t generate_secret_key(OUT pad_r_t *h0, OUT pad_r_t *h1,
                           OUT idx_t *h0_wlist, OUT idx_t *h1_wlist,
                           IN const seed_t *seed);
 
+// Set h0 and h1 to the dense polynomials of the indices h0_wlist and h1_wlist
+// (D indices each, less than R_BITS).
+void secret_key_from_wlist(OUT pad_r_t *h0, OUT pad_r_t *h1,
+                           IN const idx_t *h0_wlist, IN const idx_t *h1_wlist);
+
 ret_t generate_error_vector(OUT pad_e_t *e, IN const seed_t *seed);
+
+// Set is_equal to 1 if e is the error vector that generate_error_vector
+// generates from seed, and to 0 otherwise, in constant time. It compares e
+// with the sampled indices directly, without generating the error vector.
+ret_t cmp_error_vector(OUT uint32_t *is_equal,
+                       IN const pad_e_t *e,
+                       IN const seed_t *seed);
@@ -20,6 +20,25 @@ void secure_set_bits_port(OUT pad_r_t *r,
                           IN const idx_t *wlist,
                           IN size_t       w_size);
 
+// Same as secure_set_bits_port, but sorts the indices with a constant-time
+// network and merges them into r in a single pass, instead of comparing every
+// QW of r with every index. It replaces secure_set_bits_port when the library
+// is built with SORTED_SET_BITS (the vectorized versions remain faster).
+void secure_set_bits_sorted(OUT pad_r_t *r,
+                            IN size_t    first_pos,
+                            IN const idx_t *wlist,
+                            IN size_t       w_size);
+
+// Return 1 if the set bits of e are exactly the bits of the indices
+// wlist[0..w_size-1] (the indices are distinct, and the ones that are not less
+// than N_BITS are ignored, as in generate_error_vector), and 0 otherwise, in
+// constant time. Used by the SPARSE_FO_CHECK decapsulation.
+uint32_t secure_cmp_e_wlist(IN const pad_e_t *e,
+                            IN const idx_t *  wlist,
+                            IN size_t         w_size);
+
+uint32_t is_idx_dup_port(IN idx_t idx, IN const idx_t *wlist, IN size_t w_size);
+
 #if defined(UNIFORM_SAMPLING)
 ret_t sample_error_vec_indices_port(OUT idx_t *out,
                                     IN OUT prf_state_t *prf_state);
@@ -36,6 +55,9 @@ void secure_set_bits_avx512(OUT pad_r_t *r,
                             IN const idx_t *wlist,
                             IN size_t       w_size);
 
+uint32_t is_idx_dup_avx2(IN idx_t idx, IN const idx_t *wlist, IN size_t w_size);
+uint32_t is_idx_dup_avx512(IN idx_t idx, IN const idx_t *wlist, IN size_t w_size);
+
 #if defined(UNIFORM_SAMPLING)
 ret_t sample_error_vec_indices_avx2(OUT idx_t *out,
                                     IN OUT prf_state_t *prf_state);
@@ -50,6 +72,10 @@ typedef struct sampling_ctx_st {
                           IN const idx_t *wlist,
                           IN size_t       w_size);
 
+  // Returns 1 if idx is one of wlist[0..w_size-1], and 0 otherwise.
+  // The run time depends only on w_size.
+  uint32_t (*is_idx_dup)(IN idx_t idx, IN const idx_t *wlist, IN size_t w_size);
+
 #if defined(UNIFORM_SAMPLING)
   ret_t (*sample_error_vec_indices)(OUT idx_t *out,
                                     IN OUT prf_state_t *prf_state);
@@ -61,11 +87,13 @@ _INLINE_ void sampling_ctx_init(sampling_ctx *ctx)
 #if defined(X86_64)
   if(is_avx512_enabled()) {
     ctx->secure_set_bits = secure_set_bits_avx512;
+    ctx->is_idx_dup      = is_idx_dup_avx512;
 #if defined(UNIFORM_SAMPLING)
     ctx->sample_error_vec_indices = sample_error_vec_indices_avx512;
 #endif
   } else if(is_avx2_enabled()) {
     ctx->secure_set_bits = secure_set_bits_avx2;
+    ctx->is_idx_dup      = is_idx_dup_avx2;
 #if defined(UNIFORM_SAMPLING)
     ctx->sample_error_vec_indices = sample_error_vec_indices_avx2;
 #endif
@@ -73,8 +101,12 @@ _INLINE_ void sampling_ctx_init(sampling_ctx *ctx)
 #endif
   {
     ctx->secure_set_bits = secure_set_bits_port;
+    ctx->is_idx_dup      = is_idx_dup_port;
 #if defined(UNIFORM_SAMPLING)
     ctx->sample_error_vec_indices = sample_error_vec_indices_port;
+#endif
+#if defined(SORTED_SET_BITS)
+    ctx->secure_set_bits = secure_set_bits_sorted;
 #endif
   }
 }
@@ -28,6 +28,14 @@ bike_static_assert(sizeof(sha384_dgst_t) == SHA384_DGST_BYTES, sha384_dgst_size)
 typedef sha384_dgst_t sha_dgst_t;
 CLEANUP_FUNC(sha_dgst, sha_dgst_t)
 
+// Besides the one-shot sha, every implementation has an incremental API:
+// sha_init, then sha_absorb any number of times, and sha_final, computes the
+// same digest as sha on the concatenation of the absorbed messages. It is
+// used to hash structures from their (padded) buffers without copying them.
+// The context holds secret values, it is cleaned by sha_ctx_cleanup.
+// When SHA_CTX_COPYABLE is defined, the context is a plain structure that can
+// be copied (e.g., to save the state after absorbing a common prefix).
+
 #if defined(STANDALONE_IMPL)
 
 # if defined(USE_SHA3_AND_SHAKE)
@@ -43,6 +51,36 @@ _INLINE_ ret_t sha(OUT sha_dgst_t *  dgst,
   return SUCCESS;
 }
 
+typedef struct sha_ctx_s {
+  uint64_t s_inc[26];
+} sha_ctx_t;
+CLEANUP_FUNC(sha_ctx, sha_ctx_t)
+
+#  define SHA_CTX_COPYABLE
+
+_INLINE_ ret_t sha_init(OUT sha_ctx_t *ctx)
+{
+  sha3_384_inc_init(ctx->s_inc);
+
+  return SUCCESS;
+}
+
+_INLINE_ ret_t sha_absorb(IN OUT sha_ctx_t *ctx,
+                          IN const uint8_t *msg,
+                          IN const size_t   byte_len)
+{
+  sha3_384_inc_absorb(ctx->s_inc, msg, byte_len);
+
+  return SUCCESS;
+}
+
+_INLINE_ ret_t sha_final(OUT sha_dgst_t *dgst, IN OUT sha_ctx_t *ctx)
+{
+  sha3_384_inc_finalize(dgst->u.raw, ctx->s_inc);
+
+  return SUCCESS;
+}
+
 # else // USE_SHA3_AND_SHAKE
 
 #  define HASH_BLOCK_BYTES 128ULL
@@ -55,12 +93,44 @@ typedef struct sha512_dgst_s {
 } sha512_dgst_t;
 bike_static_assert(sizeof(sha512_dgst_t) == SHA512_DGST_BYTES, sha512_dgst_size);
 
+#  define SHA512_ROUNDS 80
+
+// The round constants of SHA-512 (see sha.c)
+extern const uint64_t sha512_k[SHA512_ROUNDS];
+
 ret_t sha(OUT sha_dgst_t *dgst, IN uint32_t byte_len, IN const uint8_t *msg);
+
+#  if defined(SHA512_NI_SUPPORTED)
+// The compression of n blocks of msg with the x86 SHA512 extensions (used by
+// sha.c when the CPU has them).
+void sha512_update_ni(IN OUT sha512_dgst_t *dgst,
+                      IN const uint8_t *msg,
+                      IN size_t         n);
+#  endif
+
+// The intermediate hash value, the bytes of the current (partial) block, and
+// the total length of the absorbed messages.
+typedef struct sha_ctx_s {
+  sha512_dgst_t h;
+  uint8_t       block[HASH_BLOCK_BYTES];
+  uint64_t      block_len;
+  uint64_t      byte_len;
+} sha_ctx_t;
+CLEANUP_FUNC(sha_ctx, sha_ctx_t)
+
+#  define SHA_CTX_COPYABLE
+
+ret_t sha_init(OUT sha_ctx_t *ctx);
+
+ret_t sha_absorb(IN OUT sha_ctx_t *ctx, IN const uint8_t *msg, IN size_t byte_len);
+
+ret_t sha_final(OUT sha_dgst_t *dgst, IN OUT sha_ctx_t *ctx);
 #  endif //USE_SHA3_AND_SHAKE
 
 #else // USE_OPENSSL
 
 #  include "utilities.h"
+#  include <openssl/evp.h>
 #  include <openssl/sha.h>
 
 _INLINE_ ret_t sha(OUT sha_dgst_t *  dgst,
@@ -74,4 +144,96 @@ _INLINE_ ret_t sha(OUT sha_dgst_t *  dgst,
   return FAIL;
 }
 
+typedef struct sha_ctx_s {
+  EVP_MD_CTX *md;
+} sha_ctx_t;
+
+// EVP_MD_CTX_free also cleans the context
+_INLINE_ void sha_ctx_cleanup(IN OUT sha_ctx_t *ctx)
+{
+  if(ctx->md != NULL) {
+    EVP_MD_CTX_free(ctx->md);
+    ctx->md = NULL;
+  }
+}
+
+_INLINE_ ret_t sha_init(OUT sha_ctx_t *ctx)
+{
+  ctx->md = EVP_MD_CTX_new();
+  if((ctx->md == NULL) ||
+     (EVP_DigestInit_ex(ctx->md, EVP_sha384(), NULL) == 0)) {
+    BIKE_ERROR(EXTERNAL_LIB_ERROR_OPENSSL);
+  }
+
+  return SUCCESS;
+}
+
+_INLINE_ ret_t sha_absorb(IN OUT sha_ctx_t *ctx,
+                          IN const uint8_t *msg,
+                          IN const size_t   byte_len)
+{
+  if(EVP_DigestUpdate(ctx->md, msg, byte_len) == 0) {
+    BIKE_ERROR(EXTERNAL_LIB_ERROR_OPENSSL);
+  }
+
+  return SUCCESS;
+}
+
+_INLINE_ ret_t sha_final(OUT sha_dgst_t *dgst, IN OUT sha_ctx_t *ctx)
+{
+  if(EVP_DigestFinal_ex(ctx->md, dgst->u.raw, NULL) == 0) {
+    BIKE_ERROR(EXTERNAL_LIB_ERROR_OPENSSL);
+  }
+
+  return SUCCESS;
+}
+
 #endif // USE_OPENSSL
+
+// Multi-buffer hashing of SHA_X4_WAYS messages of the same length.
+// With SHA3 the messages are hashed together (see sha3_x4.h), and so they
+// are with the standalone SHA2 on AVX2 CPUs (see sha384_x4). Otherwise they
+// are hashed one after the other.
+#define SHA_X4_WAYS (4)
+
+typedef struct sha_dgst_x4_s {
+  sha_dgst_t val[SHA_X4_WAYS];
+} sha_dgst_x4_t;
+CLEANUP_FUNC(sha_dgst_x4, sha_dgst_x4_t)
+
+#if defined(USE_SHA3_AND_SHAKE)
+#  include "sha3_x4.h"
+#elif defined(STANDALONE_IMPL)
+ret_t sha384_x4(OUT sha_dgst_x4_t *dgst,
+                IN const uint32_t     byte_len,
+                IN const uint8_t *const msg[SHA_X4_WAYS]);
+
+#  if defined(X86_64)
+// The compression of n blocks of each of the SHA_X4_WAYS messages, with an
+// interleaved state, where word i of lane l is stored at s[i * ways + l].
+void sha512_update_x4_avx2(IN OUT uint64_t s[SHA512_DGST_QWORDS * SHA_X4_WAYS],
+                           IN const uint8_t *const msg[SHA_X4_WAYS],
+                           IN size_t               n);
+#  endif
+#endif
+
+_INLINE_ ret_t sha_x4(OUT sha_dgst_x4_t *dgst,
+                      IN const uint32_t     byte_len,
+                      IN const uint8_t *const msg[SHA_X4_WAYS])
+{
+#if defined(USE_SHA3_AND_SHAKE)
+  bike_static_assert(SHA_X4_WAYS == KECCAK_X4_WAYS, sha_x4_ways);
+
+  uint8_t *const h[SHA_X4_WAYS] = {dgst->val[0].u.raw, dgst->val[1].u.raw,
+                                   dgst->val[2].u.raw, dgst->val[3].u.raw};
+  sha3_384_x4(h, msg, byte_len);
+#elif defined(STANDALONE_IMPL)
+  GUARD(sha384_x4(dgst, byte_len, msg));
+#else
+  for(size_t i = 0; i < SHA_X4_WAYS; i++) {
+    GUARD(sha(&dgst->val[i], byte_len, msg[i]));
+  }
+#endif
+
+  return SUCCESS;
+}
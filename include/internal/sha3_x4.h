@@ -0,0 +1,50 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+// Multi-buffer SHA3-384 and SHAKE256. Every call processes 4 (or 8)
+// independent messages of the same length with an interleaved Keccak state,
+// where word i of lane l is stored at s[i * ways + l]. The results are
+// identical to calling sha3_384/shake256 on each message.
+
+#define KECCAK_STATE_QWORDS (25)
+#define KECCAK_X4_WAYS      (4)
+#define KECCAK_X8_WAYS      (8)
+
+void keccak_f1600_x4_port(
+  IN OUT uint64_t s[KECCAK_STATE_QWORDS * KECCAK_X4_WAYS]);
+
+#if defined(X86_64)
+void keccak_f1600_x4_avx2(
+  IN OUT uint64_t s[KECCAK_STATE_QWORDS * KECCAK_X4_WAYS]);
+void keccak_f1600_x8_avx512(
+  IN OUT uint64_t s[KECCAK_STATE_QWORDS * KECCAK_X8_WAYS]);
+#endif
+
+void sha3_384_x4(OUT uint8_t *const h[KECCAK_X4_WAYS],
+                 IN const uint8_t *const in[KECCAK_X4_WAYS],
+                 IN size_t               inlen);
+
+void shake256_x4(OUT uint8_t *const out[KECCAK_X4_WAYS],
+                 IN size_t               outlen,
+                 IN const uint8_t *const in[KECCAK_X4_WAYS],
+                 IN size_t               inlen);
+
+void sha3_384_x8(OUT uint8_t *const h[KECCAK_X8_WAYS],
+                 IN const uint8_t *const in[KECCAK_X8_WAYS],
+                 IN size_t               inlen);
+
+void shake256_x8(OUT uint8_t *const out[KECCAK_X8_WAYS],
+                 IN size_t               outlen,
+                 IN const uint8_t *const in[KECCAK_X8_WAYS],
+                 IN size_t               inlen);
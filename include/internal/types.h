@@ -77,6 +77,16 @@ typedef struct sk_s {
 
 typedef ALIGN(sizeof(idx_t)) sk_t aligned_sk_t;
 
+// The compact secret key holds only the indices of h0 and h1 (which are less
+// than R_BITS < 2^16) and sigma. The dense h0 and h1 and the public key are
+// computed from the indices (see crypto_kem_dec_key_init_compact).
+typedef uint16_t compact_idx_t;
+
+typedef struct compact_sk_s {
+  compact_idx_t wlist[N0][D];
+  m_t           sigma;
+} compact_sk_t;
+
 // Pad r to the next Block
 typedef struct pad_r_s {
   r_t     val;
@@ -101,22 +111,22 @@ typedef struct func_k_s {
   m_t c1;
 } func_k_t;
 
-#if defined(BIND_PK_AND_M)
-typedef struct pk_m_bind_s {
-  pk_t pk;
-  m_t  m;
-} pk_m_bind_t;
-#endif
-
 // For a faster rotate we triplicate the syndrome (into 3 copies)
 typedef struct syndrome_s {
-  uint64_t qw[3 * R_QWORDS];
+  uint64_t qw[SYNDROME_QWORDS];
 } ALIGN(ALIGN_BYTES) syndrome_t;
 
+// The slices of the UPC are padded only to the widest vector register of the
+// decoder (R_ZMM), and not to R_PADDED of the multiplication operands.
+typedef struct zmm_pad_r_s {
+  r_t     val;
+  uint8_t pad[(R_ZMM * BYTES_IN_ZMM) - sizeof(r_t)];
+} ALIGN(ALIGN_BYTES) zmm_pad_r_t;
+
 typedef struct upc_slice_s {
   union {
-    pad_r_t  r;
-    uint64_t qw[sizeof(pad_r_t) / sizeof(uint64_t)];
+    zmm_pad_r_t r;
+    uint64_t    qw[sizeof(zmm_pad_r_t) / sizeof(uint64_t)];
   } ALIGN(ALIGN_BYTES) u;
 } ALIGN(ALIGN_BYTES) upc_slice_t;
 
@@ -124,4 +134,21 @@ typedef struct upc_s {
   upc_slice_t slice[SLICES];
 } upc_t;
 
+// The multi-instance decoder (see decode_wide) processes WIDE_LANES decodings
+// in lockstep, in a transposed layout where the lane k of every wide_qw_t
+// holds a quadword of the instance k.
+#define WIDE_LANES (8)
+
+typedef struct wide_qw_s {
+  uint64_t lane[WIDE_LANES];
+} ALIGN(ALIGN_BYTES) wide_qw_t;
+
+typedef struct wide_syndrome_s {
+  wide_qw_t qw[3 * R_QWORDS];
+} wide_syndrome_t;
+
+typedef struct wide_upc_s {
+  wide_qw_t slice[SLICES][R_QWORDS];
+} wide_upc_t;
+
 #pragma pack(pop)
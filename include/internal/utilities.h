@@ -34,6 +34,17 @@ _INLINE_ uint64_t bswap_64(uint64_t x)
 
 uint64_t r_bits_vector_weight(IN const r_t *in);
 
+// The number of set bits in x (without the table of __builtin_popcount on
+// CPUs without a POPCNT instruction, whose memory accesses depend on x)
+_INLINE_ uint64_t popcount64(IN uint64_t x)
+{
+  x = x - ((x >> 1) & UINT64_C(0x5555555555555555));
+  x = (x & UINT64_C(0x3333333333333333)) +
+      ((x >> 2) & UINT64_C(0x3333333333333333));
+  x = (x + (x >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+  return (x * UINT64_C(0x0101010101010101)) >> 56;
+}
+
 // BSR returns ceil(log2(val)).
 _INLINE_ uint8_t bit_scan_reverse_vartime(IN uint64_t val)
 {
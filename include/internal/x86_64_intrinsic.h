@@ -82,10 +82,12 @@
 #  define SLLV_I32(a, b)   _mm256_sllv_epi32(a, b)
 
 #  define CMPGT_I16(a, b) _mm256_cmpgt_epi16(a, b)
+#  define CMPGT_I32(a, b) _mm256_cmpgt_epi32(a, b)
 #  define CMPEQ_I16(a, b) _mm256_cmpeq_epi16(a, b)
 #  define CMPEQ_I32(a, b) _mm256_cmpeq_epi32(a, b)
 #  define CMPEQ_I64(a, b) _mm256_cmpeq_epi64(a, b)
 
+#  define SAD_U8(a, b)          _mm256_sad_epu8(a, b)
 #  define SHUF_I8(a, b)         _mm256_shuffle_epi8(a, b)
 #  define BLENDV_I8(a, b, mask) _mm256_blendv_epi8(a, b, mask)
 #  define PERMVAR_I32(a, idx)   _mm256_permutevar8x32_epi32(a, idx)
@@ -94,13 +96,17 @@
 #  define MOVEMASK(a) _mm256_movemask_epi8(a)
 
 #  define MSTORE32(mem, mask, reg) _mm256_maskstore_epi32((int*)(mem), (mask), (reg))
+#  define MLOAD32(mem, mask)       _mm256_maskload_epi32((const int*)(mem), (mask))
 
 #elif defined(AVX512_INTERNAL)
 
 #  define MSTORE64(mem, mask, reg) _mm512_mask_storeu_epi64((mem), (mask), (reg))
 #  define MSTORE32(mem, mask, reg) _mm512_mask_storeu_epi32((mem), (mask), (reg))
+#  define MLOAD32(mem, mask)       _mm512_maskz_loadu_epi32((mask), (mem))
+#  define MLOAD64(mem, mask)       _mm512_maskz_loadu_epi64((mask), (mem))
 
 #  define SET1_I8(a)         _mm512_set1_epi8(a)
+#  define SET4_I32(...)      _mm512_set4_epi32(__VA_ARGS__)
 #  define SET1_I32(a)        _mm512_set1_epi32(a)
 #  define SET1_I64(a)        _mm512_set1_epi64(a)
 #  define SET1MZ_I8(mask, a) _mm512_maskz_set1_epi8(mask, a)
@@ -109,24 +115,40 @@
 #  define SET_I64(...)       _mm512_set_epi64(__VA_ARGS__)
 #  define SET_ZERO           _mm512_setzero_si512()
 
+#  define ADD_I8(a, b)              _mm512_add_epi8(a, b)
 #  define ADD_I16(a, b)             _mm512_add_epi16(a, b)
 #  define ADD_I32(a, b)             _mm512_add_epi32(a, b)
 #  define ADD_I64(a, b)             _mm512_add_epi64(a, b)
+#  define SUB_I64(a, b)             _mm512_sub_epi64(a, b)
 #  define MSUB_I16(src, k, a, b)    _mm512_mask_sub_epi16(src, k, a, b)
+#  define MSUB_I32(src, k, a, b)    _mm512_mask_sub_epi32(src, k, a, b)
+#  define MSUB_I64(src, k, a, b)    _mm512_mask_sub_epi64(src, k, a, b)
 #  define SRLI_I16(a, imm)          _mm512_srli_epi16(a, imm)
+#  define SRLI_I32(a, imm)          _mm512_srli_epi32(a, imm)
+#  define SRLV_I32(a, cnt)          _mm512_srlv_epi32(a, cnt)
 #  define SRLV_I64(a, cnt)          _mm512_srlv_epi64(a, cnt)
 #  define SLLV_I64(a, cnt)          _mm512_sllv_epi64(a, cnt)
 #  define MOR_I64(src, mask, a, b)  _mm512_mask_or_epi64(src, mask, a, b)
 #  define MXOR_I64(src, mask, a, b) _mm512_mask_xor_epi64(src, mask, a, b)
 #  define VALIGN(a, b, count)       _mm512_alignr_epi64(a, b, count)
+#  define MBLEND_I64(mask, a, b)    _mm512_mask_blend_epi64(mask, a, b)
 
 #  define CMPM_U8(a, b, cmp_op)  _mm512_cmp_epu8_mask(a, b, cmp_op)
 #  define CMPM_U16(a, b, cmp_op) _mm512_cmp_epu16_mask(a, b, cmp_op)
 #  define CMPM_U32(a, b, cmp_op) _mm512_cmp_epu32_mask(a, b, cmp_op)
+#  define CMPM_U64(a, b, cmp_op) _mm512_cmp_epu64_mask(a, b, cmp_op)
 #  define CMPMEQ_I64(a, b)       _mm512_cmp_epi64_mask(a, b, _MM_CMPINT_EQ)
+#  define TESTM_I32(a, b)        _mm512_test_epi32_mask(a, b)
 #  define MCMPMEQ_I32(mask, a, b) \
     _mm512_mask_cmp_epi32_mask(mask, a, b, _MM_CMPINT_EQ)
 
+#  define SAD_U8(a, b)     _mm512_sad_epu8(a, b)
+#  define SHUF_I8(a, b)    _mm512_shuffle_epi8(a, b)
+#  define POPCNT_I64(a)    _mm512_popcnt_epi64(a)
+#  define REDUCE_ADD_I64(a) _mm512_reduce_add_epi64(a)
+
+#  define GATHER_I32(idx, mem) _mm512_i32gather_epi32(idx, mem, 4)
+
 #  define PERMX_I64(a, imm)        _mm512_permutex_epi64(a, imm)
 #  define PERMX2VAR_I64(a, idx, b) _mm512_permutex2var_epi64(a, idx, b)
 #  define PERMXVAR_I64(idx, a)     _mm512_permutexvar_epi64(idx, a)
@@ -29,3 +29,214 @@ int crypto_kem_enc(OUT unsigned char *     ct,
 int crypto_kem_dec(OUT unsigned char *     ss,
                    IN const unsigned char *ct,
                    IN const unsigned char *sk);
+
+////////////////////////////////////////////////////////////////
+// Additional APIs (not defined by NIST):
+////////////////////////////////////////////////////////////////
+// The number of key pairs that share one inversion in crypto_kem_keypair_batch
+#define KEYPAIR_BATCH_SIZE (16)
+
+// Batched key generation - pk[i] is the i-th public key out of n,
+//                          sk[i] is the i-th private key out of n.
+// It is equivalent to n calls of crypto_kem_keypair, but the keys are
+// generated in batches that require only one polynomial inversion each.
+// When it fails, the private keys of the failed batch are cleaned.
+int crypto_kem_keypair_batch(OUT unsigned char *const pk[],
+                             OUT unsigned char *const sk[],
+                             IN size_t                n);
+
+// Aligned and padded views of a public key and of a ciphertext, in the layout
+// that the library works on. The _view variants of encapsulate/decapsulate
+// below take them instead of byte buffers, and use them in place without
+// copying them (the byte variants copy their inputs into views). The views
+// must be aligned to BIKE_WORKSPACE_ALIGN (e.g., allocated by aligned_alloc),
+// otherwise the _view variants fail with E_WORKSPACE_MISALIGNED. The padding
+// of pk and c0 must be zero, as set by the functions below.
+typedef struct bike_pk_view_s {
+  pad_r_t pk;
+} bike_pk_view_t;
+
+typedef struct bike_ct_view_s {
+  pad_r_t c0;
+  m_t     c1;
+} bike_ct_view_t;
+
+// Set view to the public key pk
+int bike_pk_view_init(OUT bike_pk_view_t *view, IN const unsigned char *pk);
+
+// Set view to the ciphertext ct
+int bike_ct_view_init(OUT bike_ct_view_t *view, IN const unsigned char *ct);
+
+// Copy the ciphertext of view to ct (of sizeof(ct_t) bytes)
+void bike_ct_view_export(OUT unsigned char *ct, IN const bike_ct_view_t *view);
+
+// Encapsulate - pk is the view of the public key,
+//               ct is the view of a key encapsulation message (ciphertext),
+//               ss is the shared secret.
+int crypto_kem_enc_view(OUT bike_ct_view_t *ct,
+                        OUT unsigned char *ss,
+                        IN const bike_pk_view_t *pk);
+
+// An expanded public key for repeated encapsulation to the same peer. It holds
+// the aligned and padded view of the public key, which is required by the
+// gf2x multiplication (and the hash state after absorbing it, see
+// BIND_PK_AND_M in README.md). It is an opaque buffer of
+// crypto_kem_enc_key_size() bytes that is aligned to BIKE_WORKSPACE_ALIGN
+// bytes (e.g., allocated by aligned_alloc).
+typedef struct bike_enc_key_s bike_enc_key_t;
+
+size_t crypto_kem_enc_key_size(void);
+
+// Expand the public key pk into key. It fails with E_WORKSPACE_MISALIGNED when
+// key is not aligned to BIKE_WORKSPACE_ALIGN.
+int crypto_kem_enc_key_init(OUT bike_enc_key_t *key, IN const unsigned char *pk);
+
+// Encapsulate - key is the expanded public key,
+//               ct is a key encapsulation message (ciphertext),
+//               ss is the shared secret.
+int crypto_kem_enc_with_key(OUT unsigned char *ct,
+                            OUT unsigned char *ss,
+                            IN const bike_enc_key_t *key);
+
+// An expanded private key for repeated decapsulation. It holds an aligned copy
+// of the private key together with all the state of the decoder that depends
+// only on the key. It is an opaque buffer of crypto_kem_dec_key_size() bytes
+// that is aligned to BIKE_WORKSPACE_ALIGN bytes (e.g., allocated by
+// aligned_alloc).
+typedef struct bike_dec_key_s bike_dec_key_t;
+
+size_t crypto_kem_dec_key_size(void);
+
+// Expand the private key sk into key. The expanded key holds secret data
+// and must be released with crypto_kem_dec_key_clean. It fails with
+// E_WORKSPACE_MISALIGNED when key is not aligned to BIKE_WORKSPACE_ALIGN.
+int crypto_kem_dec_key_init(OUT bike_dec_key_t *key, IN const unsigned char *sk);
+
+// Decapsulate - ct is a key encapsulation message (ciphertext),
+//               key is the expanded private key,
+//               ss is the shared secret
+int crypto_kem_dec_with_key(OUT unsigned char *     ss,
+                            IN const unsigned char *ct,
+                            IN const bike_dec_key_t *key);
+
+// Decapsulate - ct is the view of a key encapsulation message (ciphertext),
+//               key is the expanded private key,
+//               ss is the shared secret
+int crypto_kem_dec_view(OUT unsigned char *ss,
+                        IN const bike_ct_view_t *ct,
+                        IN const bike_dec_key_t *key);
+
+// Securely clean an expanded private key.
+void crypto_kem_dec_key_clean(IN OUT bike_dec_key_t *key);
+
+// A compact private key of BIKE_COMPACT_SK_BYTES bytes (instead of
+// sizeof(sk_t)), for storing many private keys. It holds only the indices of
+// the secret polynomials (in 16 bits each) and sigma.
+#define BIKE_COMPACT_SK_BYTES (sizeof(compact_sk_t))
+
+// Convert the private key sk into the compact private key csk.
+int crypto_kem_sk_compact(OUT unsigned char *csk, IN const unsigned char *sk);
+
+// Expand the compact private key csk into key (as crypto_kem_dec_key_init).
+// The dense polynomials are set from the indices, and the public key is
+// recomputed with one inversion, so the expansion costs about as much as a key
+// generation. The expanded key is intended to be cached and reused, the
+// decapsulations with it are as fast as with a key of crypto_kem_dec_key_init.
+// Returns -1 if an index of csk is not less than R_BITS, or if the indices of
+// a polynomial are not distinct.
+int crypto_kem_dec_key_init_compact(OUT bike_dec_key_t *key,
+                                    IN const unsigned char *csk);
+
+// Batched decapsulation - ct[i] is the i-th ciphertext out of n,
+//                         sk is the private key (common to all ciphertexts),
+//                         ss[i] is the shared secret of ct[i].
+int crypto_kem_dec_batch(OUT unsigned char *const     ss[],
+                         IN const unsigned char *const ct[],
+                         IN size_t                     n,
+                         IN const unsigned char *      sk);
+
+// A caller-owned workspace for the KEM operations. The _ws variants of
+// keypair/encapsulate/decapsulate below keep all their temporary values
+// (whose size depends on the parameters of the level) in the workspace instead
+// of the stack, and securely clean it before they return. Therefore, they
+// require only a small stack, e.g., for running them on small coroutine or
+// fiber stacks.
+// The workspace is an opaque buffer of bike_workspace_size() bytes that is
+// aligned to BIKE_WORKSPACE_ALIGN bytes (e.g., allocated by aligned_alloc).
+// It can be reused for any number of operations, but not by several threads
+// at the same time.
+typedef struct bike_workspace_s bike_workspace_t;
+
+#define BIKE_WORKSPACE_ALIGN ALIGN_BYTES
+
+size_t bike_workspace_size(void);
+
+int crypto_kem_keypair_ws(OUT unsigned char *pk,
+                          OUT unsigned char *sk,
+                          IN OUT bike_workspace_t *ws);
+
+int crypto_kem_enc_ws(OUT unsigned char *     ct,
+                      OUT unsigned char *     ss,
+                      IN const unsigned char *pk,
+                      IN OUT bike_workspace_t *ws);
+
+int crypto_kem_dec_ws(OUT unsigned char *     ss,
+                      IN const unsigned char *ct,
+                      IN const unsigned char *sk,
+                      IN OUT bike_workspace_t *ws);
+
+// A caller-owned context for the key generation, with the precomputed
+// permutation maps of the k-squarings of the inversion (which depend only on
+// the parameters of the level and on the ISA). It is an opaque buffer of
+// bike_keygen_ctx_size() bytes that is aligned to BIKE_WORKSPACE_ALIGN bytes,
+// and is computed once by bike_keygen_ctx_init. After that, it is read-only,
+// therefore it can be shared by any number of threads that call
+// crypto_kem_keypair_with_ctx, which generates the same keys as
+// crypto_kem_keypair.
+typedef struct bike_keygen_ctx_s bike_keygen_ctx_t;
+
+size_t bike_keygen_ctx_size(void);
+
+int bike_keygen_ctx_init(OUT bike_keygen_ctx_t *ctx);
+
+int crypto_kem_keypair_with_ctx(OUT unsigned char *pk,
+                                OUT unsigned char *sk,
+                                IN const bike_keygen_ctx_t *ctx);
+
+// A caller-owned pool of precomputed encapsulations to one peer (the public
+// key of an expanded key). The ciphertext (c0, c1) of an encapsulation depends
+// only on m and on the public key, therefore all of it, except the shared
+// secret K(m, c0, c1), is computed in advance by bike_enc_precompute (e.g.,
+// in idle time), and crypto_kem_enc_online computes only K.
+// The pool is an opaque buffer of bike_enc_pool_size(capacity) bytes that is
+// aligned to BIKE_WORKSPACE_ALIGN bytes. It holds secret data (the values of
+// m), so it must be cleaned with bike_enc_pool_clean before it is released.
+// A pool cannot be used by several threads at the same time.
+typedef struct bike_enc_pool_s bike_enc_pool_t;
+
+size_t bike_enc_pool_size(IN size_t capacity);
+
+// Set pool to an empty pool of capacity encapsulations to the public key of
+// key. Returns -1 if capacity is 0.
+int bike_enc_pool_init(OUT bike_enc_pool_t *pool,
+                       IN size_t                capacity,
+                       IN const bike_enc_key_t *key);
+
+// Precompute up to n encapsulations into pool (until it is full).
+int bike_enc_precompute(IN OUT bike_enc_pool_t *pool, IN size_t n);
+
+// The number of precomputed encapsulations in pool
+size_t bike_enc_pool_count(IN const bike_enc_pool_t *pool);
+
+// Encapsulate - pool holds the precomputed encapsulations,
+//               ct is a key encapsulation message (ciphertext),
+//               ss is the shared secret.
+// The oldest precomputed encapsulation is taken out of the pool, and its slot
+// is securely cleaned. When the pool is empty, the encapsulation is computed
+// in full (as crypto_kem_enc_with_key).
+int crypto_kem_enc_online(OUT unsigned char *ct,
+                          OUT unsigned char *ss,
+                          IN OUT bike_enc_pool_t *pool);
+
+// Securely clean all the encapsulations of pool.
+void bike_enc_pool_clean(IN OUT bike_enc_pool_t *pool);
@@ -0,0 +1,54 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+// A cache of expanded private keys (see crypto_kem_dec_key_init) for servers
+// that decapsulate with many private keys. The callers pass the raw private
+// keys, and a key that is in the cache is not expanded again.
+// The keys are looked up by the hash of the public key (in the private key),
+// and a cached key is used only if its whole private key is equal to the
+// given one. The cache is split into shards, each with its own lock, and the
+// least recently used key of a shard is evicted (and securely cleaned) when a
+// new key does not fit into the memory budget. A key is not evicted while it
+// is used by a decapsulation.
+typedef struct bike_key_cache_s bike_key_cache_t;
+
+typedef struct bike_key_cache_params_s {
+  size_t max_bytes;  // The memory budget of the cached keys
+  size_t num_shards; // Every shard must hold at least one key
+} bike_key_cache_params_t;
+
+typedef struct bike_key_cache_stats_s {
+  uint64_t hits;      // Decapsulations with a cached key
+  uint64_t misses;    // Decapsulations that expanded the key
+  uint64_t evictions; // Keys that were evicted to make room for other keys
+} bike_key_cache_stats_t;
+
+// The number of bytes of the memory budget that every cached key takes.
+size_t bike_key_cache_entry_size(void);
+
+int bike_key_cache_create(OUT bike_key_cache_t **cache,
+                          IN const bike_key_cache_params_t *params);
+
+// Decapsulate (as crypto_kem_dec) with the expanded key of sk, which is added
+// to the cache if it is not there already.
+int bike_key_cache_dec(IN OUT bike_key_cache_t *cache,
+                       OUT unsigned char *ss,
+                       IN const unsigned char *ct,
+                       IN const unsigned char *sk);
+
+void bike_key_cache_get_stats(OUT bike_key_cache_stats_t *stats,
+                              IN bike_key_cache_t *cache);
+
+// Securely clean all the cached keys and release the cache.
+void bike_key_cache_destroy(IN OUT bike_key_cache_t *cache);
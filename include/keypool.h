@@ -0,0 +1,58 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+// A pool of precomputed (ephemeral) key pairs. The pool is refilled by
+// background threads, so that taking a key pair from it does not require
+// running the key generation on the critical path.
+// The threads start refilling the pool when the number of key pairs in it
+// drops to low_watermark, and generate key pairs until it reaches
+// high_watermark. When the pool is empty, bike_keypool_pop generates a key
+// pair by itself (a miss).
+// The key pairs are in a lock-free ring, so bike_keypool_pop takes the lock of
+// the pool only when it asks the threads to start refilling it.
+// The threads back off after a failure of the key generation (e.g., of the
+// randomness source), and stop after several consecutive failures. Then
+// bike_keypool_pop generates every key pair by itself (and returns the errors
+// of the key generation), and refill_stopped is set in the statistics.
+typedef struct bike_keypool_s bike_keypool_t;
+
+typedef struct bike_keypool_params_s {
+  size_t capacity;       // The maximal number of key pairs in the pool
+  size_t low_watermark;  // Must be smaller than high_watermark
+  size_t high_watermark; // Must not be larger than capacity
+  size_t num_threads;    // The number of refill threads (at least one)
+} bike_keypool_params_t;
+
+typedef struct bike_keypool_stats_s {
+  uint64_t hits;            // Key pairs that were taken from the pool
+  uint64_t misses;          // Key pairs that were generated by bike_keypool_pop
+  uint64_t refill_failures; // Failed key generations of the refill threads
+  uint64_t refill_stopped;  // 1 when the threads stopped after failures
+} bike_keypool_stats_t;
+
+// Create a pool and start its refill threads.
+int bike_keypool_create(OUT bike_keypool_t **pool,
+                        IN const bike_keypool_params_t *params);
+
+// Take a key pair out of the pool. Its slot in the pool is securely cleaned.
+int bike_keypool_pop(IN OUT bike_keypool_t *pool,
+                     OUT unsigned char *pk,
+                     OUT unsigned char *sk);
+
+void bike_keypool_get_stats(OUT bike_keypool_stats_t *stats,
+                            IN bike_keypool_t *pool);
+
+// Stop the refill threads, securely clean all the key pairs that are left in
+// the pool, and release it.
+void bike_keypool_destroy(IN OUT bike_keypool_t *pool);
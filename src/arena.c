@@ -0,0 +1,218 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+// For MAP_ANONYMOUS, MAP_HUGETLB and syscall (or posix_memalign)
+#if defined(__linux__)
+#  define _GNU_SOURCE
+#  include <linux/mempolicy.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#else
+#  define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+
+#include "bike_arena.h"
+#include "cleanup.h"
+#include "kem.h"
+#include "utilities.h"
+
+bike_static_assert((BIKE_ARENA_ALIGN % BIKE_WORKSPACE_ALIGN) == 0,
+                   arena_align_too_small_for_workspace);
+
+#define PAGE_2M (2ULL << 20)
+#define PAGE_1G (1ULL << 30)
+
+// secure_clean wipes up to 4 GB at a time
+#define MAX_WIPE_BYTES PAGE_1G
+
+struct bike_arena_s {
+  uint8_t *          base;
+  size_t             size; // The mapped bytes
+  size_t             used;
+  bike_arena_pages_t pages;
+};
+
+_INLINE_ void wipe(OUT uint8_t *p, IN size_t len)
+{
+  while(len > 0) {
+    const size_t n = (len < MAX_WIPE_BYTES) ? len : MAX_WIPE_BYTES;
+    secure_clean(p, (uint32_t)n);
+    p += n;
+    len -= n;
+  }
+}
+
+#if defined(__linux__)
+
+#  if !defined(MAP_HUGE_SHIFT)
+#    define MAP_HUGE_SHIFT 26
+#  endif
+#  if !defined(MAP_HUGE_2MB)
+#    define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#  endif
+#  if !defined(MAP_HUGE_1GB)
+#    define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#  endif
+
+// The NUMA nodes that the memory can be bound to
+#  define MAX_NODES      1024
+#  define BITS_IN_ULONG  (8 * sizeof(unsigned long))
+#  define NODEMASK_ULONG (MAX_NODES / BITS_IN_ULONG)
+
+// Prefer the node for the pages of [p, p + size) (they are allocated from
+// other nodes when the node does not have free memory). The binding is best
+// effort, e.g., mbind is not permitted in some containers.
+_INLINE_ void bind_to_node(IN uint8_t *p, IN const size_t size, IN int node)
+{
+  unsigned long mask[NODEMASK_ULONG] = {0};
+
+  if(node == BIKE_ARENA_LOCAL_NODE) {
+    unsigned int cpu;
+    unsigned int local;
+    if(syscall(SYS_getcpu, &cpu, &local, NULL) != 0) {
+      return;
+    }
+    node = (int)local;
+  }
+
+  if((node < 0) || (node >= MAX_NODES)) {
+    return;
+  }
+
+  mask[node / BITS_IN_ULONG] = 1UL << (node % BITS_IN_ULONG);
+
+  // The kernel reads maxnode - 1 bits of the mask
+  (void)syscall(SYS_mbind, p, size, MPOL_PREFERRED, mask, MAX_NODES + 1, 0);
+}
+
+// Map the arena on the largest pages that fit it, of the pages that the
+// system reserved. The pages are bound to the node before they are touched.
+_INLINE_ ret_t map_arena(IN OUT bike_arena_t *a, IN const size_t size, IN int node)
+{
+  const struct {
+    bike_arena_pages_t pages;
+    size_t             page_size;
+    int                flags;
+  } kinds[] = {{BIKE_ARENA_PAGES_1G, PAGE_1G, MAP_HUGETLB | MAP_HUGE_1GB},
+               {BIKE_ARENA_PAGES_2M, PAGE_2M, MAP_HUGETLB | MAP_HUGE_2MB},
+               {BIKE_ARENA_PAGES_SMALL, PAGE_2M, 0}};
+
+  for(size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+    // An arena smaller than a page of 1 GB would waste most of it
+    if((kinds[i].page_size == PAGE_1G) && (size < PAGE_1G)) {
+      continue;
+    }
+
+    const size_t len = DIVIDE_AND_CEIL(size, kinds[i].page_size) *
+                       kinds[i].page_size;
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | kinds[i].flags, -1, 0);
+    if(p == MAP_FAILED) {
+      continue;
+    }
+
+    // Transparent huge pages are used when they are enabled (for madvise)
+    if(kinds[i].flags == 0) {
+      (void)madvise(p, len, MADV_HUGEPAGE);
+    }
+
+    a->base  = p;
+    a->size  = len;
+    a->pages = kinds[i].pages;
+    bind_to_node(a->base, a->size, node);
+
+    // Fault the pages in now, and not in the first run that uses them
+    bike_memset(a->base, 0, a->size);
+    return SUCCESS;
+  }
+
+  return FAIL;
+}
+
+_INLINE_ void unmap_arena(IN OUT bike_arena_t *a) { munmap(a->base, a->size); }
+
+#else // __linux__
+
+_INLINE_ ret_t map_arena(IN OUT bike_arena_t *a, IN const size_t size, IN int node)
+{
+  void *p = NULL;
+
+  (void)node;
+  if(posix_memalign(&p, BIKE_ARENA_ALIGN, size) != 0) {
+    return FAIL;
+  }
+
+  a->base  = p;
+  a->size  = size;
+  a->pages = BIKE_ARENA_PAGES_SMALL;
+  bike_memset(a->base, 0, a->size);
+  return SUCCESS;
+}
+
+_INLINE_ void unmap_arena(IN OUT bike_arena_t *a) { free(a->base); }
+
+#endif // __linux__
+
+int bike_arena_create(OUT bike_arena_t **arena, IN size_t size, IN int node)
+{
+  *arena = NULL;
+
+  if(size == 0) {
+    BIKE_ERROR(E_ARENA_INIT_FAIL);
+  }
+
+  bike_arena_t *a = calloc(1, sizeof(*a));
+  if(a == NULL) {
+    BIKE_ERROR(E_ARENA_INIT_FAIL);
+  }
+
+  if(map_arena(a, size, node) != SUCCESS) {
+    free(a);
+    BIKE_ERROR(E_ARENA_INIT_FAIL);
+  }
+
+  *arena = a;
+  return SUCCESS;
+}
+
+void *bike_arena_alloc(IN OUT bike_arena_t *arena, IN size_t size)
+{
+  const size_t off =
+    DIVIDE_AND_CEIL(arena->used, BIKE_ARENA_ALIGN) * BIKE_ARENA_ALIGN;
+
+  if((off > arena->size) || (size > (arena->size - off))) {
+    return NULL;
+  }
+
+  arena->used = off + size;
+  return &arena->base[off];
+}
+
+void bike_arena_reset(IN OUT bike_arena_t *arena)
+{
+  wipe(arena->base, arena->used);
+  arena->used = 0;
+}
+
+bike_arena_pages_t bike_arena_pages(IN const bike_arena_t *arena)
+{
+  return arena->pages;
+}
+
+void bike_arena_destroy(IN OUT bike_arena_t *arena)
+{
+  if(arena == NULL) {
+    return;
+  }
+
+  wipe(arena->base, arena->used);
+  unmap_arena(arena);
+  free(arena);
+}
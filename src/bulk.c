@@ -0,0 +1,257 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+// For posix_memalign
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "bike_bulk.h"
+#include "kem.h"
+#include "sampling.h"
+#include "sha.h"
+
+// The jobs jobs[next], ..., jobs[end - 1] of a thread. The thread takes its
+// jobs from next, and other threads steal jobs from end.
+typedef struct bulk_range_s {
+  size_t          next;
+  size_t          end;
+  pthread_mutex_t lock;
+} bulk_range_t;
+
+typedef struct bulk_run_s {
+  bike_bulk_job_t *jobs;
+  const uint8_t *  seed;
+  size_t           num_threads;
+  bulk_range_t *   ranges;
+} bulk_run_t;
+
+typedef struct bulk_worker_s {
+  bulk_run_t *run;
+  size_t      id;
+  pthread_t   thread;
+} bulk_worker_t;
+
+// The input of H(seed || i), the seed of the DRBG of the job i
+typedef struct job_seed_in_s {
+  uint8_t  seed[BIKE_BULK_SEED_BYTES];
+  uint64_t i;
+} job_seed_in_t;
+
+CLEANUP_FUNC(job_seed_in, job_seed_in_t)
+
+_INLINE_ int run_job(IN OUT bike_bulk_job_t *job, IN OUT bike_workspace_t *ws)
+{
+  switch(job->op) {
+    case BIKE_BULK_KEYPAIR: return crypto_kem_keypair_ws(job->pk, job->sk, ws);
+    case BIKE_BULK_ENC: return crypto_kem_enc_ws(job->ct, job->ss, job->pk, ws);
+    case BIKE_BULK_DEC: return crypto_kem_dec_ws(job->ss, job->ct, job->sk, ws);
+    default: return FAIL;
+  }
+}
+
+#if !defined(USE_NIST_RAND)
+
+_INLINE_ ret_t run_seeded_job(IN OUT bike_bulk_job_t *job,
+                              IN const size_t         i,
+                              IN const uint8_t *      seed,
+                              IN OUT bike_workspace_t *ws)
+{
+  if(seed == NULL) {
+    return run_job(job, ws);
+  }
+
+  DEFER_CLEANUP(job_seed_in_t in, job_seed_in_cleanup);
+  DEFER_CLEANUP(sha_dgst_t dgst = {0}, sha_dgst_cleanup);
+
+  bike_memcpy(in.seed, seed, sizeof(in.seed));
+  in.i = i;
+  GUARD(sha(&dgst, sizeof(in), (const uint8_t *)&in));
+
+  bike_static_assert(sizeof(dgst) >= RNG_SEED_BYTES, bulk_seed_size);
+  set_thread_rng_seed(dgst.u.raw);
+
+  const int res = run_job(job, ws);
+
+  set_thread_rng_seed(NULL);
+  return res;
+}
+
+// Take the next job of the range
+_INLINE_ int take_job(OUT size_t *i, IN OUT bulk_range_t *range)
+{
+  int found = 0;
+
+  pthread_mutex_lock(&range->lock);
+  if(range->next < range->end) {
+    *i    = range->next++;
+    found = 1;
+  }
+  pthread_mutex_unlock(&range->lock);
+
+  return found;
+}
+
+// Steal the second half of the remaining jobs of another thread into the
+// (empty) range of the thread id, and take the first of them.
+_INLINE_ int steal_jobs(OUT size_t *i,
+                        IN OUT bulk_run_t *run,
+                        IN const size_t    id)
+{
+  for(size_t k = 1; k < run->num_threads; k++) {
+    bulk_range_t *victim = &run->ranges[(id + k) % run->num_threads];
+    size_t        first  = 0;
+    size_t        end    = 0;
+
+    pthread_mutex_lock(&victim->lock);
+    if(victim->next < victim->end) {
+      end         = victim->end;
+      first       = victim->end - ((victim->end - victim->next + 1) / 2);
+      victim->end = first;
+    }
+    pthread_mutex_unlock(&victim->lock);
+
+    if(first < end) {
+      // The stolen jobs are not in any range until they are placed in the
+      // range of this thread, so the locks are not held together.
+      bulk_range_t *own = &run->ranges[id];
+
+      pthread_mutex_lock(&own->lock);
+      own->next = first + 1;
+      own->end  = end;
+      pthread_mutex_unlock(&own->lock);
+
+      *i = first;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static void *bulk_worker(void *arg)
+{
+  bulk_worker_t *w   = (bulk_worker_t *)arg;
+  bulk_run_t *   run = w->run;
+  void *         ws  = NULL;
+  size_t         i;
+
+  // The workspace of the thread is allocated and first written by the thread,
+  // so it is usually on the NUMA node of the thread, without mapping an arena
+  // in every call. The operations clean it before they return. A thread
+  // without a workspace does not take jobs (they are stolen by the other
+  // threads).
+  if(posix_memalign(&ws, BIKE_WORKSPACE_ALIGN, bike_workspace_size()) != 0) {
+    return NULL;
+  }
+
+  while(take_job(&i, &run->ranges[w->id]) || steal_jobs(&i, run, w->id)) {
+    run->jobs[i].res = run_seeded_job(&run->jobs[i], i, run->seed, ws);
+  }
+
+  free(ws);
+  return NULL;
+}
+
+int bike_bulk_run(IN OUT bike_bulk_job_t jobs[],
+                  IN const size_t        n,
+                  IN size_t              num_threads,
+                  IN const uint8_t *     seed)
+{
+  bulk_run_t     run     = {jobs, seed, 0, NULL};
+  bulk_worker_t *workers = NULL;
+
+  for(size_t i = 0; i < n; i++) {
+    jobs[i].res = FAIL;
+  }
+
+  num_threads = (num_threads == 0) ? 1 : num_threads;
+  num_threads = (num_threads > n) ? n : num_threads;
+
+  run.ranges = calloc(num_threads, sizeof(*run.ranges));
+  workers    = calloc(num_threads, sizeof(*workers));
+
+  // Split the jobs to num_threads contiguous ranges
+  for(size_t t = 0; (run.ranges != NULL) && (workers != NULL) &&
+                    (t < num_threads);
+      t++) {
+    if(pthread_mutex_init(&run.ranges[t].lock, NULL) != 0) {
+      break;
+    }
+
+    run.ranges[t].next = (t * n) / num_threads;
+    run.ranges[t].end  = ((t + 1) * n) / num_threads;
+    workers[t].run     = &run;
+    workers[t].id      = t;
+    run.num_threads++;
+  }
+
+  // If not all the ranges were initialized, the last range takes the rest
+  if((run.num_threads > 0) && (run.num_threads < num_threads)) {
+    run.ranges[run.num_threads - 1].end = n;
+  }
+
+  // The calling thread is worker 0. The ranges of the threads that could not
+  // be created are stolen by the other threads.
+  size_t num_started = 0;
+  for(size_t t = 1; t < run.num_threads; t++) {
+    if(pthread_create(&workers[t].thread, NULL, bulk_worker, &workers[t]) !=
+       0) {
+      break;
+    }
+    num_started++;
+  }
+
+  if(run.num_threads > 0) {
+    bulk_worker(&workers[0]);
+  }
+
+  for(size_t t = 1; t <= num_started; t++) {
+    pthread_join(workers[t].thread, NULL);
+  }
+
+  for(size_t t = 0; t < run.num_threads; t++) {
+    pthread_mutex_destroy(&run.ranges[t].lock);
+  }
+  free(run.ranges);
+  free(workers);
+
+  int res = SUCCESS;
+  for(size_t i = 0; i < n; i++) {
+    res |= jobs[i].res;
+  }
+
+  return (res == SUCCESS) ? SUCCESS : FAIL;
+}
+
+#else // USE_NIST_RAND
+
+int bike_bulk_run(IN OUT bike_bulk_job_t jobs[],
+                  IN const size_t        n,
+                  IN size_t              num_threads,
+                  IN const uint8_t *     seed)
+{
+  (void)num_threads;
+  (void)seed;
+
+  void *ws = NULL;
+  if(posix_memalign(&ws, BIKE_WORKSPACE_ALIGN, bike_workspace_size()) != 0) {
+    return FAIL;
+  }
+
+  int res = SUCCESS;
+  for(size_t i = 0; i < n; i++) {
+    jobs[i].res = run_job(&jobs[i], ws);
+    res |= jobs[i].res;
+  }
+
+  free(ws);
+  return (res == SUCCESS) ? SUCCESS : FAIL;
+}
+
+#endif // USE_NIST_RAND
@@ -6,18 +6,45 @@
  */
 
 #include "cpu_features.h"
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
-
-static uint32_t avx2_flag;
-static uint32_t avx512_flag;
-static uint32_t pclmul_flag;
-static uint32_t vpclmul_flag;
-
-uint32_t is_avx2_enabled(void) { return avx2_flag; }
-uint32_t is_avx512_enabled(void) { return avx512_flag; }
-uint32_t is_pclmul_enabled(void) { return pclmul_flag; }
-uint32_t is_vpclmul_enabled(void) { return vpclmul_flag; }
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct cpu_flags_s {
+  uint32_t avx2;
+  uint32_t avx512;
+  uint32_t pclmul;
+  uint32_t vpclmul;
+  uint32_t vaes;
+  uint32_t vpopcnt;
+  uint32_t rdrand;
+  uint32_t rdseed;
+  uint32_t sha512;
+} cpu_flags_t;
+
+// The features of the CPU, and the features that the library uses, which are
+// the features of the CPU capped by the forced ISA (see bike_isa.h).
+static cpu_flags_t detected;
+static cpu_flags_t flags;
+static bike_isa_t  isa_cap = BIKE_ISA_NATIVE;
+static uint32_t    generation;
+
+uint32_t is_avx2_enabled(void) { return flags.avx2; }
+uint32_t is_avx512_enabled(void) { return flags.avx512; }
+uint32_t is_pclmul_enabled(void) { return flags.pclmul; }
+uint32_t is_vpclmul_enabled(void) { return flags.vpclmul; }
+uint32_t is_vaes_enabled(void) { return flags.vaes; }
+uint32_t is_vpopcnt_enabled(void) { return flags.vpopcnt; }
+uint32_t is_rdrand_enabled(void) { return flags.rdrand; }
+uint32_t is_rdseed_enabled(void) { return flags.rdseed; }
+uint32_t is_sha512_enabled(void) { return flags.sha512; }
+
+uint32_t cpu_features_generation(void) { return generation; }
+
+static const char *const isa_names[] = {"portable", "pclmul",  "avx2",
+                                        "avx512",   "vpclmul", "native"};
 
 #if defined(X86_64)
 
@@ -25,11 +52,17 @@ uint32_t is_vpclmul_enabled(void) { return vpclmul_flag; }
 
 #  define EXTENDED_FEATURES_LEAF         7
 #  define EXTENDED_FEATURES_SUBLEAF_ZERO 0
+#  define EXTENDED_FEATURES_SUBLEAF_ONE  1
 
 #  define EBX_BIT_AVX2    (1 << 5)
 #  define EBX_BIT_AVX512  (1 << 16)
+#  define EBX_BIT_RDSEED  (1 << 18)
+#  define ECX_BIT_VAES    (1 << 9)
 #  define ECX_BIT_VPCLMUL (1 << 10)
+#  define ECX_BIT_VPOPCNT (1 << 14)
 #  define ECX_BIT_PCLMUL  (1 << 1)
+#  define ECX_BIT_RDRAND  (1 << 30)
+#  define EAX_BIT_SHA512  (1 << 0) // Leaf 7, sub-leaf 1
 
 static uint32_t get_cpuid_count(uint32_t  leaf,
                                 uint32_t  sub_leaf,
@@ -49,7 +82,7 @@ static uint32_t get_cpuid_count(uint32_t  leaf,
   return 1;
 }
 
-void cpu_features_init(void)
+static void cpu_flags_detect(void)
 {
   uint32_t eax, ebx, ecx, edx;
   if(!get_cpuid_count(EXTENDED_FEATURES_LEAF, EXTENDED_FEATURES_SUBLEAF_ZERO,
@@ -57,25 +90,133 @@ void cpu_features_init(void)
     return;
   }
 
-  avx2_flag    = ebx & EBX_BIT_AVX2;
-  avx512_flag  = ebx & EBX_BIT_AVX512;
-  vpclmul_flag = ecx & ECX_BIT_VPCLMUL;
+  detected.avx2    = ebx & EBX_BIT_AVX2;
+  detected.avx512  = ebx & EBX_BIT_AVX512;
+  detected.vpclmul = ecx & ECX_BIT_VPCLMUL;
+  detected.vaes    = ecx & ECX_BIT_VAES;
+  detected.vpopcnt = ecx & ECX_BIT_VPOPCNT;
+  detected.rdseed  = ebx & EBX_BIT_RDSEED;
+
+  // The SHA512 instructions are VEX encoded (with YMM registers)
+  if(detected.avx2 &&
+     get_cpuid_count(EXTENDED_FEATURES_LEAF, EXTENDED_FEATURES_SUBLEAF_ONE,
+                     &eax, &ebx, &ecx, &edx)) {
+    detected.sha512 = eax & EAX_BIT_SHA512;
+  }
 
   if(!get_cpuid_count(1, EXTENDED_FEATURES_SUBLEAF_ZERO,
                       &eax, &ebx, &ecx, &edx)) {
     return;
   }
-  pclmul_flag = ecx & ECX_BIT_PCLMUL;
+  detected.pclmul = ecx & ECX_BIT_PCLMUL;
+  detected.rdrand = ecx & ECX_BIT_RDRAND;
 }
 
 #else // X86_64
 
+// No features are used on other CPUs
+static void cpu_flags_detect(void) {}
+
+#endif
+
+// Cap the features of the CPU by the ISA
+static void apply_isa_cap(void)
+{
+  flags = detected;
+
+  if(isa_cap < BIKE_ISA_VPCLMUL) {
+    flags.vpclmul = 0;
+    flags.vaes    = 0;
+  }
+  if(isa_cap < BIKE_ISA_AVX512) {
+    flags.avx512  = 0;
+    flags.vpopcnt = 0;
+  }
+  if(isa_cap < BIKE_ISA_AVX2) {
+    flags.avx2   = 0;
+    flags.sha512 = 0;
+  }
+  if(isa_cap < BIKE_ISA_PCLMUL) {
+    flags.pclmul = 0;
+  }
+}
+
+static void cpu_features_detect(void)
+{
+  cpu_flags_detect();
+
+  // The BIKE_ISA environment variable caps the ISA from the start
+  const char *env = getenv("BIKE_ISA");
+  for(size_t i = 0; (env != NULL) && (i <= BIKE_ISA_NATIVE); i++) {
+    if(strcmp(env, isa_names[i]) == 0) {
+      isa_cap = (bike_isa_t)i;
+    }
+  }
+
+  apply_isa_cap();
+}
+
+// The flags are detected once. Calling cpu_features_init again (possibly
+// from several threads at the same time) has no effect.
 void cpu_features_init(void)
 {
-  avx2_flag    = 0;
-  avx512_flag  = 0;
-  pclmul_flag  = 0;
-  vpclmul_flag = 0;
+  static pthread_once_t cpu_features_once = PTHREAD_ONCE_INIT;
+  pthread_once(&cpu_features_once, cpu_features_detect);
 }
 
-#endif
+int bike_force_isa(IN const bike_isa_t isa)
+{
+  if((uint32_t)isa > BIKE_ISA_NATIVE) {
+    return -1;
+  }
+
+  cpu_features_init();
+
+  isa_cap = isa;
+  apply_isa_cap();
+  generation++;
+
+  return 0;
+}
+
+bike_isa_t bike_get_isa(void)
+{
+  cpu_features_init();
+
+  if(flags.avx512 && flags.vpclmul && flags.vaes) {
+    return BIKE_ISA_VPCLMUL;
+  }
+  if(flags.avx512) {
+    return BIKE_ISA_AVX512;
+  }
+  if(flags.avx2) {
+    return BIKE_ISA_AVX2;
+  }
+  if(flags.pclmul) {
+    return BIKE_ISA_PCLMUL;
+  }
+  return BIKE_ISA_PORTABLE;
+}
+
+int bike_isa_available(IN const bike_isa_t isa)
+{
+  cpu_features_init();
+
+  switch(isa) {
+    case BIKE_ISA_PORTABLE: return 1;
+    case BIKE_ISA_PCLMUL: return detected.pclmul != 0;
+    case BIKE_ISA_AVX2: return detected.pclmul && detected.avx2;
+    case BIKE_ISA_AVX512:
+      return detected.pclmul && detected.avx2 && detected.avx512;
+    case BIKE_ISA_VPCLMUL:
+      return detected.pclmul && detected.avx2 && detected.avx512 &&
+             detected.vpclmul && detected.vaes;
+    case BIKE_ISA_NATIVE: return 1;
+    default: return 0;
+  }
+}
+
+const char *bike_isa_name(IN const bike_isa_t isa)
+{
+  return ((uint32_t)isa <= BIKE_ISA_NATIVE) ? isa_names[isa] : "unknown";
+}
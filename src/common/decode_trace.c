@@ -0,0 +1,76 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include "decode_trace.h"
+#include "utilities.h"
+
+#if defined(DECODE_TRACE)
+
+// The records are written at (head % BIKE_DECODE_TRACE_SIZE), and the
+// unread ones are the (head - tail) records before it.
+typedef struct decode_trace_s {
+  bike_decode_record_t records[BIKE_DECODE_TRACE_SIZE];
+  uint64_t             head;
+  uint64_t             tail;
+  uint64_t             dropped;
+  uint32_t             decodes;
+} decode_trace_t;
+
+static __thread decode_trace_t trace;
+
+uint32_t decode_trace_begin(void) { return trace.decodes++; }
+
+void decode_trace_push(IN const bike_decode_record_t *rec)
+{
+  if((trace.head - trace.tail) == BIKE_DECODE_TRACE_SIZE) {
+    trace.tail++;
+    trace.dropped++;
+  }
+
+  trace.records[trace.head % BIKE_DECODE_TRACE_SIZE] = *rec;
+  trace.head++;
+}
+
+int bike_decode_trace_read(OUT bike_decode_record_t *records,
+                           IN const size_t           max_records,
+                           OUT size_t *num_records)
+{
+  size_t num = 0;
+  while((num < max_records) && (trace.tail != trace.head)) {
+    records[num++] = trace.records[trace.tail % BIKE_DECODE_TRACE_SIZE];
+    trace.tail++;
+  }
+
+  *num_records = num;
+  return SUCCESS;
+}
+
+uint64_t bike_decode_trace_dropped(void) { return trace.dropped; }
+
+void bike_decode_trace_reset(void)
+{
+  trace.head    = 0;
+  trace.tail    = 0;
+  trace.dropped = 0;
+  trace.decodes = 0;
+}
+
+#else
+
+int bike_decode_trace_read(OUT BIKE_UNUSED_ATT bike_decode_record_t *records,
+                           IN BIKE_UNUSED_ATT const size_t max_records,
+                           OUT size_t *num_records)
+{
+  *num_records = 0;
+  return FAIL;
+}
+
+uint64_t bike_decode_trace_dropped(void) { return 0; }
+
+void bike_decode_trace_reset(void) {}
+
+#endif
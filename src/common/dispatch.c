@@ -0,0 +1,36 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include <pthread.h>
+
+#include "dispatch.h"
+
+static dispatch_ctx   dispatch;
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+static uint32_t       dispatch_generation;
+
+static void dispatch_ctx_init(void)
+{
+  cpu_features_init();
+  dispatch_generation = cpu_features_generation();
+
+  gf2x_ctx_init(&dispatch.gf2x);
+  decode_ctx_init(&dispatch.decode);
+  sampling_ctx_init(&dispatch.sampling);
+}
+
+const dispatch_ctx *get_dispatch_ctx(void)
+{
+  pthread_once(&dispatch_once, dispatch_ctx_init);
+
+  // The ISA was forced (with bike_force_isa) after the table was initialized
+  if(dispatch_generation != cpu_features_generation()) {
+    dispatch_ctx_init();
+  }
+
+  return &dispatch;
+}
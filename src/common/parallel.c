@@ -0,0 +1,206 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+// For sched_yield
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "parallel.h"
+#include "utilities.h"
+
+#if defined(INTRA_OP_PARALLEL)
+
+// The threads wait by spinning, and yield the core after SPIN_LIMIT
+// iterations (e.g., the helpers between operations, or every thread when
+// there are fewer cores than threads).
+#  define SPIN_LIMIT (1U << 12)
+
+// The team synchronizes through a spin barrier: par_run publishes the tasks
+// and increments gen, every helper runs its task and increments done, and
+// par_run waits until done reaches num_helpers.
+typedef struct par_team_s {
+  par_task_t task;
+  void *     arg;
+  size_t     num_tasks;
+  uint32_t   gen;
+  uint32_t   done;
+  uint32_t   busy; // A par_run uses the team
+  uint32_t   stop;
+
+  // The value of gen when the helpers were started
+  uint32_t  start_gen;
+  size_t    num_helpers;
+  pthread_t threads[BIKE_PARALLEL_MAX_HELPERS];
+} par_team_t;
+
+static par_team_t      team;
+static pthread_mutex_t team_lock = PTHREAD_MUTEX_INITIALIZER;
+
+_INLINE_ void cpu_relax(void)
+{
+#  if defined(X86_64) || defined(X86)
+  __asm__ volatile("pause");
+#  elif defined(AARCH64)
+  __asm__ volatile("yield");
+#  endif
+}
+
+_INLINE_ void spin_pause(IN OUT uint32_t *spins)
+{
+  if(++(*spins) < SPIN_LIMIT) {
+    cpu_relax();
+  } else {
+    sched_yield();
+  }
+}
+
+static void *par_helper(void *arg)
+{
+  const size_t id  = (size_t)arg;
+  uint32_t     gen = team.start_gen;
+
+  while(1) {
+    uint32_t spins = 0;
+    while(__atomic_load_n(&team.gen, __ATOMIC_ACQUIRE) == gen) {
+      spin_pause(&spins);
+    }
+    gen = __atomic_load_n(&team.gen, __ATOMIC_ACQUIRE);
+
+    if(__atomic_load_n(&team.stop, __ATOMIC_ACQUIRE)) {
+      return NULL;
+    }
+
+    if(id < team.num_tasks) {
+      team.task(team.arg, id);
+    }
+
+    __atomic_add_fetch(&team.done, 1, __ATOMIC_RELEASE);
+  }
+}
+
+// Stop and join the first num_started helpers. Must be called with team_lock
+// held and without a par_run in progress.
+_INLINE_ void stop_helpers(IN const size_t num_started)
+{
+  __atomic_store_n(&team.stop, 1, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&team.gen, 1, __ATOMIC_RELEASE);
+
+  for(size_t i = 0; i < num_started; i++) {
+    pthread_join(team.threads[i], NULL);
+  }
+
+  __atomic_store_n(&team.num_helpers, 0, __ATOMIC_RELEASE);
+  team.stop = 0;
+}
+
+int bike_parallel_start(IN const size_t num_helpers)
+{
+  if((num_helpers == 0) || (num_helpers > BIKE_PARALLEL_MAX_HELPERS)) {
+    return FAIL;
+  }
+
+  pthread_mutex_lock(&team_lock);
+
+  if(team.num_helpers != 0) {
+    pthread_mutex_unlock(&team_lock);
+    return FAIL;
+  }
+
+  // The helper i runs the task i + 1 (the task 0 runs on the calling thread)
+  size_t num_started = 0;
+  team.start_gen     = team.gen;
+  for(size_t i = 0; i < num_helpers; i++) {
+    if(pthread_create(&team.threads[i], NULL, par_helper, (void *)(i + 1)) !=
+       0) {
+      break;
+    }
+    num_started++;
+  }
+
+  if(num_started < num_helpers) {
+    stop_helpers(num_started);
+    pthread_mutex_unlock(&team_lock);
+    return FAIL;
+  }
+
+  __atomic_store_n(&team.num_helpers, num_helpers, __ATOMIC_RELEASE);
+
+  pthread_mutex_unlock(&team_lock);
+  return SUCCESS;
+}
+
+void bike_parallel_stop(void)
+{
+  pthread_mutex_lock(&team_lock);
+
+  if(team.num_helpers != 0) {
+    // Wait for the par_run in progress (if any), and block the next ones
+    uint32_t spins = 0;
+    while(__atomic_exchange_n(&team.busy, 1, __ATOMIC_ACQUIRE)) {
+      spin_pause(&spins);
+    }
+
+    stop_helpers(team.num_helpers);
+    __atomic_store_n(&team.busy, 0, __ATOMIC_RELEASE);
+  }
+
+  pthread_mutex_unlock(&team_lock);
+}
+
+void par_run(IN const par_task_t task, IN OUT void *arg, IN const size_t num_tasks)
+{
+  size_t next = 1;
+
+  if((num_tasks > 1) && __atomic_load_n(&team.num_helpers, __ATOMIC_ACQUIRE) &&
+     !__atomic_exchange_n(&team.busy, 1, __ATOMIC_ACQUIRE)) {
+    const size_t num_helpers = team.num_helpers;
+
+    team.task      = task;
+    team.arg       = arg;
+    team.num_tasks = num_tasks;
+    team.done      = 0;
+    __atomic_add_fetch(&team.gen, 1, __ATOMIC_RELEASE);
+
+    task(arg, 0);
+    for(next = num_helpers + 1; next < num_tasks; next++) {
+      task(arg, next);
+    }
+
+    uint32_t spins = 0;
+    while(__atomic_load_n(&team.done, __ATOMIC_ACQUIRE) != num_helpers) {
+      spin_pause(&spins);
+    }
+
+    __atomic_store_n(&team.busy, 0, __ATOMIC_RELEASE);
+    return;
+  }
+
+  task(arg, 0);
+  for(; next < num_tasks; next++) {
+    task(arg, next);
+  }
+}
+
+#else
+
+int bike_parallel_start(IN BIKE_UNUSED_ATT const size_t num_helpers)
+{
+  return FAIL;
+}
+
+void bike_parallel_stop(void) {}
+
+void par_run(IN const par_task_t task, IN OUT void *arg, IN const size_t num_tasks)
+{
+  for(size_t i = 0; i < num_tasks; i++) {
+    task(arg, i);
+  }
+}
+
+#endif
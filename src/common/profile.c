@@ -0,0 +1,46 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include "profile.h"
+#include "utilities.h"
+
+static const char *const stage_names[BIKE_PROFILE_NUM_STAGES] = {
+  "compute_syndrome", "next_syndrome", "get_threshold", "find_err1",
+  "find_err2",        "function_h",    "gf2x_mod_mul",  "gf2x_mod_inv"};
+
+#if defined(BIKE_PROFILE)
+
+__thread bike_profile_t bike_profile_counters;
+
+int bike_profile_get(OUT bike_profile_t *profile)
+{
+  *profile = bike_profile_counters;
+  return SUCCESS;
+}
+
+void bike_profile_reset(void)
+{
+  bike_memset(&bike_profile_counters, 0, sizeof(bike_profile_counters));
+}
+
+#else
+
+int bike_profile_get(OUT bike_profile_t *profile)
+{
+  bike_memset(profile, 0, sizeof(*profile));
+  return FAIL;
+}
+
+void bike_profile_reset(void) {}
+
+#endif
+
+const char *bike_profile_stage_name(IN const bike_profile_stage_t stage)
+{
+  return ((uint32_t)stage < BIKE_PROFILE_NUM_STAGES) ? stage_names[stage]
+                                                      : "unknown";
+}
@@ -16,10 +16,10 @@ uint64_t r_bits_vector_weight(IN const r_t *in)
 {
   uint64_t acc = 0;
   for(size_t i = 0; i < (R_BYTES - 1); i++) {
-    acc += __builtin_popcount(in->raw[i]);
+    acc += popcount64(in->raw[i]);
   }
 
-  acc += __builtin_popcount(in->raw[R_BYTES - 1] & LAST_R_BYTE_MASK);
+  acc += popcount64(in->raw[R_BYTES - 1] & LAST_R_BYTE_MASK);
   return acc;
 }
 
@@ -35,166 +35,319 @@
  */
 
 #include <inttypes.h> // PRIu64 for portable uint64_t format specifier
+#include <math.h>     // isfinite for validating the decoder parameters
 
 #include "decode.h"
 #include "cleanup.h"
 #include "decode_internal.h"
+#include "decode_trace.h"
+#include "dispatch.h"
 #include "gf2x.h"
+#include "parallel.h"
+#include "profile.h"
 #include "utilities.h"
 
-// Decoding (bit-flipping) parameter
-#if defined(BG_DECODER)
-#  if(LEVEL == 1)
-#    define MAX_IT 3
-#  elif(LEVEL == 3)
-#    define MAX_IT 4
-#  else
-#    error "Level can only be 1/3"
-#  endif
-#elif defined(BGF_DECODER)
-#  if(LEVEL == 1)
-#    define MAX_IT 5
-#  elif(LEVEL == 3)
-#    define MAX_IT 5
-#  elif(LEVEL == 0)
-#    define MAX_IT 5
-#  elif(LEVEL == 10)
-#    define MAX_IT 5
-#  elif(LEVEL == 11)
-#    define MAX_IT 5
-#  elif(LEVEL == 12)
-#    define MAX_IT 5
-#  elif(LEVEL == 13)
-#    define MAX_IT 5
-#  elif(LEVEL == 14)
-#    define MAX_IT 5
-#  elif(LEVEL == 15)
-#    define MAX_IT 5
-#  elif(LEVEL == 16)
-#    define MAX_IT 5
-#  elif(LEVEL == 17)
-#    define MAX_IT 5
-#  elif(LEVEL == 18)
-#    define MAX_IT 5
-#  else
-#    error "Level can only be 1/3/0/10/11/12/13/14/15/16/17/18"
-#  endif
-#endif
-
 ret_t compute_syndrome(OUT syndrome_t *syndrome,
                        IN const pad_r_t *c0,
                        IN const pad_r_t *h0,
+                       IN const compressed_idx_d_t *h0_wlist,
+                       IN OUT gf2x_mul_ws_t *ws,
                        IN const decode_ctx *ctx)
 {
-  DEFER_CLEANUP(pad_r_t pad_s, pad_r_cleanup);
+  bike_static_assert(sizeof(*syndrome) >= sizeof(pad_r_t), syndrome_too_small);
 
-  gf2x_mod_mul(&pad_s, c0, h0);
-
-  bike_memcpy((uint8_t *)syndrome->qw, pad_s.val.raw, R_BYTES);
+  // The product is written (and reduced) directly into the first copy of the
+  // syndrome, which is then triplicated in place.
+  gf2x_mod_mul_sparse_ws((pad_r_t *)syndrome->qw, c0, h0, h0_wlist->val, D, ws);
   ctx->dup(syndrome);
 
   return SUCCESS;
 }
 
+#if defined(INCREMENTAL_SYNDROME)
+// Update the syndrome after the errors vector changed from prev_e to e.
+// Since pk * h0 = h1, the recomputed syndrome (c0 + e0 + e1 * pk) * h0 equals
+//   s + delta0 * h0 + delta1 * h1,
+// where delta = e + prev_e are the bits flipped by the last find_err step.
+// At the end prev_e is set to e for the next update.
+// The padding of ws->tmp is zero (see decode_internal).
+_INLINE_ ret_t update_syndrome(IN OUT syndrome_t *syndrome,
+                               IN OUT e_t *prev_e,
+                               IN const e_t *e,
+                               IN const decode_key_t *key,
+                               IN OUT decode_ws_t *ws)
+{
+  pad_r_t *delta = &ws->tmp[0];
+  pad_r_t *col   = &ws->tmp[1];
+
+  const pad_r_t *h[N0] = {&key->h0, &key->h1};
+  uint8_t *      s8    = (uint8_t *)syndrome->qw;
+
+  for(uint32_t i = 0; i < N0; i++) {
+    for(size_t j = 0; j < R_BYTES; j++) {
+      delta->val.raw[j] = e->val[i].raw[j] ^ prev_e->val[i].raw[j];
+    }
+
+    gf2x_mod_mul_sparse_ws(col, delta, h[i], key->wlist[i].val, D, &ws->mul);
+
+    for(size_t j = 0; j < R_BYTES; j++) {
+      s8[j] ^= col->val.raw[j];
+    }
+  }
+
+  *prev_e = *e;
+  key->ctx->dup(syndrome);
+
+  return SUCCESS;
+}
+#endif
+
+// The padding of ws->tmp is zero (see decode_internal).
 _INLINE_ ret_t recompute_syndrome(OUT syndrome_t *syndrome,
                                   IN const pad_r_t *c0,
                                   IN const pad_r_t *h0,
+                                  IN const compressed_idx_d_t *h0_wlist,
                                   IN const pad_r_t *pk,
                                   IN const e_t *e,
+                                  IN OUT decode_ws_t *ws,
                                   IN const decode_ctx *ctx)
 {
-  DEFER_CLEANUP(pad_r_t tmp_c0, pad_r_cleanup);
-  DEFER_CLEANUP(pad_r_t e0 = {0}, pad_r_cleanup);
-  DEFER_CLEANUP(pad_r_t e1 = {0}, pad_r_cleanup);
+  pad_r_t *tmp_c0 = &ws->tmp[0];
+  pad_r_t *e0     = &ws->tmp[1];
+  pad_r_t *e1     = &ws->tmp[2];
 
-  e0.val = e->val[0];
-  e1.val = e->val[1];
+  e0->val = e->val[0];
+  e1->val = e->val[1];
 
   // tmp_c0 = pk * e1 + c0 + e0
-  gf2x_mod_mul(&tmp_c0, &e1, pk);
-  gf2x_mod_add(&tmp_c0, &tmp_c0, c0);
-  gf2x_mod_add(&tmp_c0, &tmp_c0, &e0);
+  gf2x_mod_mul_ws(tmp_c0, e1, pk, &ws->mul);
+  gf2x_mod_add(tmp_c0, tmp_c0, c0);
+  gf2x_mod_add(tmp_c0, tmp_c0, e0);
 
   // Recompute the syndrome using the updated ciphertext
-  GUARD(compute_syndrome(syndrome, &tmp_c0, h0, ctx));
+  GUARD(compute_syndrome(syndrome, tmp_c0, h0, h0_wlist, &ws->mul, ctx));
 
   return SUCCESS;
 }
 
-_INLINE_ uint8_t get_threshold(IN const syndrome_t *s)
+// The parameters of the level for every decoding algorithm (see decode.h)
+#define DECODE_PARAMS(coeff0, coeff1, min, it, gray)                        \
+  {                                                                         \
+    .threshold_coeff0 = (coeff0), .threshold_coeff1 = (coeff1),             \
+    .threshold_min = (min), .delta = DELTA, .err2_threshold = MAJ_THRESHOLD, \
+    .max_it = (it), .gray_iters = (gray)                                    \
+  }
+
+#define DECODE_PARAMS_BGF \
+  DECODE_PARAMS(THRESHOLD_COEFF0, THRESHOLD_COEFF1, THRESHOLD_MIN, MAX_IT_BGF, 1)
+#define DECODE_PARAMS_BG                                                   \
+  DECODE_PARAMS(THRESHOLD_COEFF0, THRESHOLD_COEFF1, THRESHOLD_MIN, MAX_IT_BG, \
+                MAX_IT_BG)
+#define DECODE_PARAMS_MAJ \
+  DECODE_PARAMS(THRESHOLD_COEFF0, THRESHOLD_COEFF1, MAJ_THRESHOLD, MAX_IT_MAJ, 0)
+
+static const decode_params_t decode_alg_table[DECODER_ALGS] = {
+  [DECODER_BGF] = DECODE_PARAMS_BGF,
+  [DECODER_BG]  = DECODE_PARAMS_BG,
+  [DECODER_MAJ] = DECODE_PARAMS_MAJ,
+};
+
+#if defined(BG_DECODER)
+const decode_params_t decode_default_params = DECODE_PARAMS_BG;
+#elif defined(MAJ_DECODER)
+const decode_params_t decode_default_params = DECODE_PARAMS_MAJ;
+#else
+const decode_params_t decode_default_params = DECODE_PARAMS_BGF;
+#endif
+
+ret_t decode_alg_params(OUT decode_params_t *params, IN decoder_alg_t alg)
 {
-  bike_static_assert(sizeof(*s) >= sizeof(r_t), syndrome_is_large_enough);
+  if((uint32_t)alg >= DECODER_ALGS) {
+    BIKE_ERROR(E_DECODER_INVALID_PARAMS);
+  }
 
-  const uint32_t syndrome_weight = r_bits_vector_weight((const r_t *)s->qw);
+  *params = decode_alg_table[alg];
+  return SUCCESS;
+}
+
+_INLINE_ uint8_t get_threshold(IN const syndrome_t *s,
+                               IN const decode_params_t *params,
+                               IN const decode_ctx *     ctx)
+{
+  const uint32_t syndrome_weight = ctx->syndrome_weight(s);
+  const uint32_t thr_min         = params->threshold_min;
 
   // The equations below are defined in BIKE's specification p. 16, Section 5.2
-  uint32_t       thr  = THRESHOLD_COEFF0 + (THRESHOLD_COEFF1 * syndrome_weight);
-  const uint32_t mask = secure_l32_mask(thr, THRESHOLD_MIN);
-  thr = (u32_barrier(mask) & thr) | (u32_barrier(~mask) & THRESHOLD_MIN);
+  // The coefficients are at most D + 1 (see decode_with_params), so thr fits
+  // in 32 bits. It is clamped to D + 1, above every UPC, so that it fits in 8
+  // bits and in the signed range of the UPC slices.
+  uint32_t thr = params->threshold_coeff0 +
+                 (params->threshold_coeff1 * syndrome_weight);
+  uint32_t mask = secure_l32_mask(thr, thr_min);
+  thr = (u32_barrier(mask) & thr) | (u32_barrier(~mask) & thr_min);
+  mask = secure_l32_mask(thr, D + 1);
+  thr  = (u32_barrier(~mask) & thr) | (u32_barrier(mask) & (D + 1));
 
   DMSG("    Threshold: %d\n", thr);
   return thr;
 }
 
-// Calculate the Unsatisfied Parity Checks (UPCs) and update the errors
-// vector (e) accordingly. In addition, update the black and gray errors vector
-// with the relevant values.
-_INLINE_ void find_err1(OUT e_t *e,
-                        OUT e_t *black_e,
-                        OUT e_t *gray_e,
-                        IN const syndrome_t *          syndrome,
-                        IN const compressed_idx_d_ar_t wlist,
-                        IN const uint8_t               threshold,
-                        IN const decode_ctx *ctx)
+#if defined(DELTA_ROTATION)
+// The window of the delta rotations starts as the syndrome extended
+// periodically (the triplicated syndrome, followed by the bits that it does
+// not hold for the small test levels).
+_INLINE_ void delta_rot_win_init(OUT syndrome_t *win, IN const syndrome_t *s)
+{
+  const size_t n = (3 * R_BITS) / 64;
+
+  bike_memcpy(win->qw, s->qw, n * sizeof(uint64_t));
+  for(size_t i = n; i < DELTA_ROT_READ_QWORDS; i++) {
+    const size_t pos  = (64 * i) % R_BITS;
+    const size_t bits = pos % 64;
+    win->qw[i]        = (s->qw[pos / 64] >> bits) |
+                 ((s->qw[(pos / 64) + 1] << (63 - bits)) << 1);
+  }
+}
+#endif
+
+// Set upc to the sum of the syndrome rotated right by every index of the
+// column i of the key (step 1 of find_err1 and find_err2)
+_INLINE_ void column_upc(OUT upc_t *upc,
+                         OUT syndrome_t *rotated_syndrome,
+                         IN const syndrome_t *syndrome,
+                         IN const decode_key_t *key,
+                         IN const uint32_t      i,
+                         IN const decode_ctx *ctx)
+{
+  // UPC must start from zero at every iteration
+  bike_memset(upc, 0, sizeof(*upc));
+
+#if defined(DELTA_ROTATION)
+  // The window advances to the block of every sorted index, where the j-th
+  // index (j <= t) needs LOG2_MSB(j + 1) slices.
+  delta_rot_win_init(rotated_syndrome, syndrome);
+  for(size_t t = 0; t < DELTA_ROT_STEPS; t++) {
+    const size_t j = (t < D) ? t : (D - 1);
+    ctx->rotate_right_delta_add(upc, rotated_syndrome, &key->steps[i][t],
+                                LOG2_MSB(j + 1));
+  }
+#else
+  // Right-rotate the syndrome for every secret key set bit index
+  // Then slice-add it to the UPC array.
+  for(size_t j = 0; j < D; j++) {
+    ctx->rotate_right_add(upc, rotated_syndrome, syndrome,
+                          key->wlist[i].val[j], LOG2_MSB(j + 1));
+  }
+#endif
+}
+
+// Calculate the Unsatisfied Parity Checks (UPCs) of the column i and update
+// the errors vector (e) accordingly. In addition, update the black and gray
+// errors vector with the relevant values.
+_INLINE_ void find_err1_column(OUT e_t *e,
+                               OUT e_t *black_e,
+                               OUT e_t *gray_e,
+                               IN const syndrome_t *          syndrome,
+                               IN const decode_key_t *        key,
+                               IN const uint8_t               threshold,
+                               IN const uint8_t               delta,
+                               IN const uint32_t              i,
+                               OUT syndrome_t *rotated_syndrome,
+                               OUT upc_t *     upc,
+                               IN const decode_ctx *ctx)
 {
   // This function uses the bit-slice-adder methodology of [5]:
-  DEFER_CLEANUP(syndrome_t rotated_syndrome = {0}, syndrome_cleanup);
-  DEFER_CLEANUP(upc_t upc, upc_cleanup);
+  bike_memset(rotated_syndrome, 0, sizeof(*rotated_syndrome));
+
+  // 1) Right-rotate the syndrome for every secret key set bit index
+  //    Then slice-add it to the UPC array.
+  column_upc(upc, rotated_syndrome, syndrome, key, i, ctx);
+
+  // 2) Subtract the threshold from the UPC counters
+  ctx->bit_slice_full_subtract(upc, threshold);
+
+  // 3) Update the errors and the black errors vectors.
+  //    The last slice of the UPC array holds the MSB of the accumulated values
+  //    minus the threshold. Every zero bit indicates a potential error bit.
+  //    The errors values are stored in the black array and xored with the
+  //    errors Of the previous iteration.
+  const r_t *last_slice = &(upc->slice[SLICES - 1].u.r.val);
+  for(size_t j = 0; j < R_BYTES; j++) {
+    const uint8_t sum_msb  = (~last_slice->raw[j]);
+    black_e->val[i].raw[j] = sum_msb;
+    e->val[i].raw[j] ^= sum_msb;
+  }
 
-  for(uint32_t i = 0; i < N0; i++) {
-    // UPC must start from zero at every iteration
-    bike_memset(&upc, 0, sizeof(upc));
-
-    // 1) Right-rotate the syndrome for every secret key set bit index
-    //    Then slice-add it to the UPC array.
-    for(size_t j = 0; j < D; j++) {
-      ctx->rotate_right(&rotated_syndrome, syndrome, wlist[i].val[j]);
-      ctx->bit_sliced_adder(&upc, &rotated_syndrome, LOG2_MSB(j + 1));
-    }
+  // Ensure that the padding bits (upper bits of the last byte) are zero so
+  // they will not be included in the multiplication and in the hash function.
+  e->val[i].raw[R_BYTES - 1] &= LAST_R_BYTE_MASK;
 
-    // 2) Subtract the threshold from the UPC counters
-    ctx->bit_slice_full_subtract(&upc, threshold);
+  // 4) Calculate the gray error array by adding "delta" to the UPC array.
+  //    For that we reuse the rotated_syndrome variable setting it to all "1".
+  for(size_t l = 0; l < delta; l++) {
+    bike_memset((uint8_t *)rotated_syndrome->qw, 0xff, R_BYTES);
+    ctx->bit_sliced_adder(upc, rotated_syndrome, SLICES);
+  }
 
-    // 3) Update the errors and the black errors vectors.
-    //    The last slice of the UPC array holds the MSB of the accumulated values
-    //    minus the threshold. Every zero bit indicates a potential error bit.
-    //    The errors values are stored in the black array and xored with the
-    //    errors Of the previous iteration.
-    const r_t *last_slice = &(upc.slice[SLICES - 1].u.r.val);
-    for(size_t j = 0; j < R_BYTES; j++) {
-      const uint8_t sum_msb  = (~last_slice->raw[j]);
-      black_e->val[i].raw[j] = sum_msb;
-      e->val[i].raw[j] ^= sum_msb;
-    }
+  // 5) Update the gray list with the relevant bits that are not
+  //    set in the black list.
+  for(size_t j = 0; j < R_BYTES; j++) {
+    const uint8_t sum_msb = (~last_slice->raw[j]);
+    gray_e->val[i].raw[j] = (~(black_e->val[i].raw[j])) & sum_msb;
+  }
+}
 
-    // Ensure that the padding bits (upper bits of the last byte) are zero so
-    // they will not be included in the multiplication and in the hash function.
-    e->val[i].raw[R_BYTES - 1] &= LAST_R_BYTE_MASK;
+#if defined(INTRA_OP_PARALLEL)
+// The columns of find_err1 as tasks of par_run. The column 1 uses its own
+// UPC and rotated syndrome (see decode_ws_t).
+typedef struct find_err1_par_s {
+  e_t *                     e;
+  e_t *                     black_e;
+  e_t *                     gray_e;
+  const syndrome_t *        syndrome;
+  const decode_key_t *      key;
+  uint8_t                   threshold;
+  uint8_t                   delta;
+  decode_ws_t *             ws;
+  const decode_ctx *        ctx;
+} find_err1_par_t;
+
+static void find_err1_par_task(IN OUT void *arg, IN const size_t task)
+{
+  const find_err1_par_t *p  = (const find_err1_par_t *)arg;
+  decode_ws_t *          ws = p->ws;
 
-    // 4) Calculate the gray error array by adding "DELTA" to the UPC array.
-    //    For that we reuse the rotated_syndrome variable setting it to all "1".
-    for(size_t l = 0; l < DELTA; l++) {
-      bike_memset((uint8_t *)rotated_syndrome.qw, 0xff, R_BYTES);
-      ctx->bit_sliced_adder(&upc, &rotated_syndrome, SLICES);
-    }
+  find_err1_column(p->e, p->black_e, p->gray_e, p->syndrome, p->key,
+                   p->threshold, p->delta, task,
+                   (task == 0) ? &ws->rotated_syndrome : &ws->par_rotated_syndrome,
+                   (task == 0) ? &ws->upc : &ws->par_upc, p->ctx);
+}
+#endif
 
-    // 5) Update the gray list with the relevant bits that are not
-    //    set in the black list.
-    for(size_t j = 0; j < R_BYTES; j++) {
-      const uint8_t sum_msb = (~last_slice->raw[j]);
-      gray_e->val[i].raw[j] = (~(black_e->val[i].raw[j])) & sum_msb;
-    }
+// Calculate the Unsatisfied Parity Checks (UPCs) and update the errors
+// vector (e) accordingly. In addition, update the black and gray errors vector
+// with the relevant values.
+void find_err1(OUT e_t *e,
+               OUT e_t *black_e,
+               OUT e_t *gray_e,
+               IN const syndrome_t *          syndrome,
+               IN const decode_key_t *        key,
+               IN const uint8_t               threshold,
+               IN const uint8_t               delta,
+               IN OUT decode_ws_t *ws,
+               IN const decode_ctx *ctx)
+{
+#if defined(INTRA_OP_PARALLEL)
+  find_err1_par_t p = {e,     black_e, gray_e, syndrome, key,
+                       threshold, delta, ws,  ctx};
+
+  par_run(find_err1_par_task, &p, N0);
+#else
+  for(uint32_t i = 0; i < N0; i++) {
+    find_err1_column(e, black_e, gray_e, syndrome, key, threshold, delta, i,
+                     &ws->rotated_syndrome, &ws->upc, ctx);
   }
+#endif
 }
 
 // Recalculate the UPCs and update the errors vector (e) according to it
@@ -202,31 +355,28 @@ _INLINE_ void find_err1(OUT e_t *e,
 _INLINE_ void find_err2(OUT e_t *e,
                         IN e_t * pos_e,
                         IN const syndrome_t *          syndrome,
-                        IN const compressed_idx_d_ar_t wlist,
+                        IN const decode_key_t *        key,
                         IN const uint8_t               threshold,
+                        IN OUT decode_ws_t *ws,
                         IN const decode_ctx *ctx)
 {
-  DEFER_CLEANUP(syndrome_t rotated_syndrome = {0}, syndrome_cleanup);
-  DEFER_CLEANUP(upc_t upc, upc_cleanup);
+  syndrome_t *rotated_syndrome = &ws->rotated_syndrome;
+  upc_t *     upc              = &ws->upc;
 
-  for(uint32_t i = 0; i < N0; i++) {
-    // UPC must start from zero at every iteration
-    bike_memset(&upc, 0, sizeof(upc));
+  bike_memset(rotated_syndrome, 0, sizeof(*rotated_syndrome));
 
+  for(uint32_t i = 0; i < N0; i++) {
     // 1) Right-rotate the syndrome, for every index of a set bit in the secret
     // key. Then slice-add it to the UPC array.
-    for(size_t j = 0; j < D; j++) {
-      ctx->rotate_right(&rotated_syndrome, syndrome, wlist[i].val[j]);
-      ctx->bit_sliced_adder(&upc, &rotated_syndrome, LOG2_MSB(j + 1));
-    }
+    column_upc(upc, rotated_syndrome, syndrome, key, i, ctx);
 
     // 2) Subtract the threshold from the UPC counters
-    ctx->bit_slice_full_subtract(&upc, threshold);
+    ctx->bit_slice_full_subtract(upc, threshold);
 
     // 3) Update the errors vector.
     //    The last slice of the UPC array holds the MSB of the accumulated values
     //    minus the threshold. Every zero bit indicates a potential error bit.
-    const r_t *last_slice = &(upc.slice[SLICES - 1].u.r.val);
+    const r_t *last_slice = &(upc->slice[SLICES - 1].u.r.val);
     for(size_t j = 0; j < R_BYTES; j++) {
       const uint8_t sum_msb = (~last_slice->raw[j]);
       e->val[i].raw[j] ^= (pos_e->val[i].raw[j] & sum_msb);
@@ -238,65 +388,608 @@ _INLINE_ void find_err2(OUT e_t *e,
   }
 }
 
-ret_t decode(OUT e_t *e, IN const ct_t *ct, IN const sk_t *sk)
+#if defined(DELTA_ROTATION)
+// Sort the indices of a column of the secret key (in place), with a
+// constant-time network that compares and exchanges every pair of indices
+_INLINE_ void sort_wlist(IN OUT idx_t *val)
 {
-  // Initialize the decode methods struct
-  decode_ctx ctx;
-  decode_ctx_init(&ctx);
+  for(size_t i = 0; i < D; i++) {
+    for(size_t j = i + 1; j < D; j++) {
+      // -1 if val[j] < val[i], and 0 otherwise
+      const uint32_t mask = ~secure_l32_mask(val[j], val[i]);
+      const uint32_t diff = (val[i] ^ val[j]) & u32_barrier(mask);
+      val[i] ^= diff;
+      val[j] ^= diff;
+    }
+  }
+}
+
+// The steps of the delta rotations of the sorted indices val of a column, in
+// constant time: every step advances the window toward the block of the next
+// index by up to DELTA_ROT_MAX_ADV blocks, and adds it to the UPC if it
+// reaches that block. The steps that follow the last index do nothing.
+_INLINE_ void delta_rot_steps(OUT rot_step_t *steps, IN const idx_t *val)
+{
+  uint32_t block = 0; // The block of the window
+  uint32_t j     = 0; // The number of indices that were added
+
+  for(size_t t = 0; t < DELTA_ROT_STEPS; t++) {
+    // val[j], or the window itself after the last index
+    uint32_t pos = block * DELTA_ROT_BLOCK_BITS;
+    for(uint32_t l = 0; l < D; l++) {
+      const uint32_t mask = u32_barrier(0 - secure_cmp32(l, j));
+      pos                 = (pos & ~mask) | (val[l] & mask);
+    }
+
+    // adv = min(gap, DELTA_ROT_MAX_ADV)
+    const uint32_t gap  = (pos / DELTA_ROT_BLOCK_BITS) - block;
+    const uint32_t mask = secure_l32_mask(gap, DELTA_ROT_MAX_ADV + 1);
+    const uint32_t adv  = (gap & ~mask) | (DELTA_ROT_MAX_ADV & mask);
+    const uint32_t add  = secure_cmp32(gap, adv) & secure_l32(j, D);
+
+    steps[t].adv  = (uint8_t)adv;
+    steps[t].bits = (uint8_t)(pos % DELTA_ROT_BLOCK_BITS);
+    steps[t].mask = (uint8_t)(0 - add);
+
+    block += adv;
+    j += add;
+  }
+}
+#endif
 
-  DEFER_CLEANUP(e_t black_e = {0}, e_cleanup);
-  DEFER_CLEANUP(e_t gray_e = {0}, e_cleanup);
+void decode_key_init(OUT decode_key_t *key, IN const sk_t *sk)
+{
+  // The decode methods selected for the current CPU
+  key->ctx = &get_dispatch_ctx()->decode;
+
+  // Pad the secret key (h0) and the public key (h)
+  bike_memset(&key->h0, 0, sizeof(key->h0));
+  bike_memset(&key->pk, 0, sizeof(key->pk));
+  key->h0.val = sk->bin[0];
+  key->pk.val = sk->pk;
+#if defined(INCREMENTAL_SYNDROME)
+  bike_memset(&key->h1, 0, sizeof(key->h1));
+  key->h1.val = sk->bin[1];
+#endif
 
-  DEFER_CLEANUP(pad_r_t c0 = {0}, pad_r_cleanup);
-  DEFER_CLEANUP(pad_r_t h0 = {0}, pad_r_cleanup);
-  pad_r_t pk = {0};
+  bike_memcpy(key->wlist, sk->wlist, sizeof(key->wlist));
 
-  // Pad ciphertext (c0), secret key (h0), and public key (h)
-  c0.val = ct->c0;
-  h0.val = sk->bin[0];
-  pk.val = sk->pk;
+#if defined(DELTA_ROTATION)
+  for(size_t i = 0; i < N0; i++) {
+    sort_wlist(key->wlist[i].val);
+    delta_rot_steps(key->steps[i], key->wlist[i].val);
+  }
+#endif
+}
+
+// Compute the syndrome that corresponds to the updated errors vector (e)
+_INLINE_ ret_t next_syndrome(IN OUT syndrome_t *syndrome,
+                             IN OUT e_t *prev_e,
+                             IN const e_t *e,
+                             IN const pad_r_t *c0,
+                             IN const decode_key_t *key,
+                             IN OUT decode_ws_t *ws)
+{
+#if defined(INCREMENTAL_SYNDROME)
+  (void)c0;
+  PROFILE(BIKE_PROFILE_NEXT_SYNDROME,
+          GUARD(update_syndrome(syndrome, prev_e, e, key, ws)));
+#else
+  (void)prev_e;
+  PROFILE(BIKE_PROFILE_NEXT_SYNDROME,
+          GUARD(recompute_syndrome(syndrome, c0, &key->h0, &key->wlist[0],
+                                   &key->pk, e, ws, key->ctx)));
+#endif
+
+  return SUCCESS;
+}
+
+// Record in iters the first iteration at which the syndrome is zero
+// (only when the caller requested the statistics). iters is larger than
+// max_it until then.
+_INLINE_ void update_iters(OUT uint32_t *iters,
+                           IN const syndrome_t *s,
+                           IN const uint32_t    iter,
+                           IN const uint32_t    max_it,
+                           IN const decode_ctx *ctx)
+{
+  if((iters != NULL) && (*iters > max_it) && (ctx->syndrome_weight(s) == 0)) {
+    *iters = iter;
+  }
+}
+
+// In the variable-time mode, returns 1 when the syndrome is already zero and
+// the decoding can stop (iters is non NULL in this mode).
+_INLINE_ uint32_t vartime_done(IN const uint32_t vartime,
+                               OUT uint32_t *iters,
+                               IN const syndrome_t *s,
+                               IN const uint32_t    iter,
+                               IN const uint32_t    max_it,
+                               IN const decode_ctx *ctx)
+{
+  if(!vartime) {
+    return 0;
+  }
+
+  update_iters(iters, s, iter, max_it, ctx);
+  return (*iters <= max_it);
+}
+
+#if defined(DECODE_TRACE)
+// Set the weights after the step (0 before the step 1) in rec, and repeat
+// them for the steps after it (see bike_decode_trace.h).
+_INLINE_ void trace_weights(OUT bike_decode_record_t *rec,
+                            IN const size_t           step,
+                            IN const syndrome_t *s,
+                            IN const e_t *       e,
+                            IN const decode_ctx *ctx)
+{
+  const uint32_t s_wt = ctx->syndrome_weight(s);
+  const uint32_t e_wt =
+    r_bits_vector_weight(&e->val[0]) + r_bits_vector_weight(&e->val[1]);
+
+  for(size_t k = step; k <= BIKE_DECODE_TRACE_STEPS; k++) {
+    rec->syndrome_weight[k] = s_wt;
+    rec->e_weight[k]        = e_wt;
+  }
+}
+
+// Set the sizes of the black and gray sets of the step 1 in rec
+_INLINE_ void trace_sets(OUT bike_decode_record_t *rec,
+                         IN const e_t *           black_e,
+                         IN const e_t *           gray_e)
+{
+  rec->black_weight = r_bits_vector_weight(&black_e->val[0]) +
+                      r_bits_vector_weight(&black_e->val[1]);
+  rec->gray_weight =
+    r_bits_vector_weight(&gray_e->val[0]) + r_bits_vector_weight(&gray_e->val[1]);
+}
+#endif
+
+_INLINE_ ret_t decode_internal(OUT e_t *e,
+                               OUT uint32_t *iters,
+                               IN const pad_r_t *c0,
+                               IN const decode_key_t *key,
+                               IN const decode_params_t *params,
+                               IN const uint32_t         vartime,
+                               IN OUT decode_ws_t *ws)
+{
+  const decode_ctx *ctx    = key->ctx;
+  const uint32_t    max_it = params->max_it;
+
+  e_t *       black_e = &ws->black_e;
+  e_t *       gray_e  = &ws->gray_e;
+  e_t *       prev_e  = &ws->prev_e;
+  syndrome_t *s       = &ws->s;
+
+  bike_memset(black_e, 0, sizeof(*black_e));
+  bike_memset(gray_e, 0, sizeof(*gray_e));
+  bike_memset(prev_e, 0, sizeof(*prev_e));
+  bike_memset(ws->tmp, 0, sizeof(ws->tmp));
 
-  DEFER_CLEANUP(syndrome_t s = {0}, syndrome_cleanup);
   DMSG("  Computing s.\n");
-  GUARD(compute_syndrome(&s, &c0, &h0, &ctx));
-  ctx.dup(&s);
+  PROFILE(BIKE_PROFILE_COMPUTE_SYNDROME,
+          GUARD(compute_syndrome(s, c0, &key->h0, &key->wlist[0], &ws->mul,
+                                 ctx)));
 
   // Reset (init) the error because it is xored in the find_err functions.
   bike_memset(e, 0, sizeof(*e));
 
-  for(uint32_t iter = 0; iter < MAX_IT; iter++) {
-    const uint8_t threshold = get_threshold(&s);
+  if(iters != NULL) {
+    *iters = max_it + 1;
+  }
+
+#if defined(DECODE_TRACE)
+  bike_decode_record_t rec = {0};
+  rec.decode               = decode_trace_begin();
+#endif
+
+  for(uint32_t iter = 0; iter < max_it; iter++) {
+    update_iters(iters, s, iter, max_it, ctx);
+    if(vartime_done(vartime, iters, s, iter, max_it, ctx)) {
+      return SUCCESS;
+    }
+
+    uint8_t threshold;
+    PROFILE(BIKE_PROFILE_GET_THRESHOLD,
+            threshold = get_threshold(s, params, ctx));
+
+    DECODE_TRACE_RUN(rec.iter = iter; rec.threshold = threshold);
+    DECODE_TRACE_RUN(trace_weights(&rec, 0, s, e, ctx));
 
     DMSG("    Iteration: %d\n", iter);
     DMSG("    Weight of e: %" PRIu64 "\n",
          r_bits_vector_weight(&e->val[0]) + r_bits_vector_weight(&e->val[1]));
-    DMSG("    Weight of syndrome: %" PRIu64 "\n", r_bits_vector_weight((r_t *)s.qw));
+    DMSG("    Weight of syndrome: %" PRIu64 "\n", ctx->syndrome_weight(s));
+
+    PROFILE(BIKE_PROFILE_FIND_ERR1,
+            find_err1(e, black_e, gray_e, s, key, threshold, params->delta,
+                      ws, ctx));
+    GUARD(next_syndrome(s, prev_e, e, c0, key, ws));
+    DECODE_TRACE_RUN(trace_sets(&rec, black_e, gray_e));
+    DECODE_TRACE_RUN(trace_weights(&rec, 1, s, e, ctx));
+    if(vartime_done(vartime, iters, s, iter + 1, max_it, ctx)) {
+      DECODE_TRACE_RUN(decode_trace_push(&rec));
+      return SUCCESS;
+    }
 
-    find_err1(e, &black_e, &gray_e, &s, sk->wlist, threshold, &ctx);
-    GUARD(recompute_syndrome(&s, &c0, &h0, &pk, e, &ctx));
-#if defined(BGF_DECODER)
-    if(iter >= 1) {
+    // The BGF decoder runs the black and gray steps only in the first
+    // iteration
+    if(iter >= params->gray_iters) {
+      DECODE_TRACE_RUN(decode_trace_push(&rec));
       continue;
     }
-#endif
     DMSG("    Weight of e: %" PRIu64 "\n",
          r_bits_vector_weight(&e->val[0]) + r_bits_vector_weight(&e->val[1]));
-    DMSG("    Weight of syndrome: %" PRIu64 "\n", r_bits_vector_weight((r_t *)s.qw));
-
-    find_err2(e, &black_e, &s, sk->wlist, ((D + 1) / 2) + 1, &ctx);
-    GUARD(recompute_syndrome(&s, &c0, &h0, &pk, e, &ctx));
+    DMSG("    Weight of syndrome: %" PRIu64 "\n", ctx->syndrome_weight(s));
+
+    PROFILE(BIKE_PROFILE_FIND_ERR2,
+            find_err2(e, black_e, s, key, params->err2_threshold, ws, ctx));
+    GUARD(next_syndrome(s, prev_e, e, c0, key, ws));
+    DECODE_TRACE_RUN(trace_weights(&rec, 2, s, e, ctx));
+    if(vartime_done(vartime, iters, s, iter + 1, max_it, ctx)) {
+      DECODE_TRACE_RUN(decode_trace_push(&rec));
+      return SUCCESS;
+    }
 
     DMSG("    Weight of e: %" PRIu64 "\n",
          r_bits_vector_weight(&e->val[0]) + r_bits_vector_weight(&e->val[1]));
-    DMSG("    Weight of syndrome: %" PRIu64 "\n", r_bits_vector_weight((r_t *)s.qw));
+    DMSG("    Weight of syndrome: %" PRIu64 "\n", ctx->syndrome_weight(s));
 
-    find_err2(e, &gray_e, &s, sk->wlist, ((D + 1) / 2) + 1, &ctx);
-    GUARD(recompute_syndrome(&s, &c0, &h0, &pk, e, &ctx));
+    PROFILE(BIKE_PROFILE_FIND_ERR2,
+            find_err2(e, gray_e, s, key, params->err2_threshold, ws, ctx));
+    GUARD(next_syndrome(s, prev_e, e, c0, key, ws));
+    DECODE_TRACE_RUN(trace_weights(&rec, 3, s, e, ctx));
+    DECODE_TRACE_RUN(decode_trace_push(&rec));
   }
 
-  if(r_bits_vector_weight((r_t *)s.qw) > 0) {
+  update_iters(iters, s, max_it, max_it, ctx);
+
+  if(ctx->syndrome_weight(s) > 0) {
     BIKE_ERROR(E_DECODING_FAILURE);
   }
 
   return SUCCESS;
 }
+
+// Pad the ciphertext (c0) into ws->c0
+_INLINE_ const pad_r_t *pad_c0(IN const ct_t *ct, IN OUT decode_ws_t *ws)
+{
+  bike_memset(&ws->c0, 0, sizeof(ws->c0));
+  ws->c0.val = ct->c0;
+
+  return &ws->c0;
+}
+
+ret_t decode_with_key_ws(OUT e_t *e,
+                         IN const ct_t *ct,
+                         IN const decode_key_t *key,
+                         IN OUT decode_ws_t *ws)
+{
+  return decode_internal(e, NULL, pad_c0(ct, ws), key, &decode_default_params,
+                         0, ws);
+}
+
+ret_t decode_padded_ws(OUT e_t *e,
+                       IN const pad_r_t *c0,
+                       IN const decode_key_t *key,
+                       IN OUT decode_ws_t *ws)
+{
+  return decode_internal(e, NULL, c0, key, &decode_default_params, 0, ws);
+}
+
+ret_t decode_with_key(OUT e_t *e, IN const ct_t *ct, IN const decode_key_t *key)
+{
+  DEFER_CLEANUP(decode_ws_t ws, decode_ws_cleanup);
+
+  return decode_with_key_ws(e, ct, key, &ws);
+}
+
+ret_t decode_with_stats(OUT e_t *e,
+                        OUT uint32_t *iters,
+                        IN const ct_t *ct,
+                        IN const decode_key_t *key)
+{
+  DEFER_CLEANUP(decode_ws_t ws, decode_ws_cleanup);
+
+  return decode_internal(e, iters, pad_c0(ct, &ws), key,
+                         &decode_default_params, 0, &ws);
+}
+
+#if defined(DECODE_VARTIME)
+ret_t decode_vartime(OUT e_t *e,
+                     OUT uint32_t *iters,
+                     IN const ct_t *ct,
+                     IN const decode_key_t *key)
+{
+  DEFER_CLEANUP(decode_ws_t ws, decode_ws_cleanup);
+
+  return decode_internal(e, iters, pad_c0(ct, &ws), key,
+                         &decode_default_params, 1, &ws);
+}
+#endif
+
+ret_t decode_with_params(OUT e_t *e,
+                         OUT uint32_t *iters,
+                         IN const ct_t *ct,
+                         IN const decode_key_t *key,
+                         IN const decode_params_t *params)
+{
+  // The thresholds are compared with the UPCs, which are at most D, and the
+  // coefficients of the threshold must be finite and non-negative
+  if((params->max_it == 0) || (params->threshold_min > D) ||
+     (params->delta > D) || (params->err2_threshold > D) ||
+     !isfinite(params->threshold_coeff0) ||
+     !isfinite(params->threshold_coeff1) ||
+     (params->threshold_coeff0 < 0) || (params->threshold_coeff1 < 0)) {
+    BIKE_ERROR(E_DECODER_INVALID_PARAMS);
+  }
+
+  // get_threshold clamps the threshold to D + 1, so the coefficients above
+  // D + 1 give the same thresholds as D + 1 (the syndrome weight of a
+  // non-zero syndrome is at least 1). Clamping them keeps the threshold in 32
+  // bits before it is clamped.
+  decode_params_t l_params = *params;
+  if(l_params.threshold_coeff0 > (D + 1)) {
+    l_params.threshold_coeff0 = D + 1;
+  }
+  if(l_params.threshold_coeff1 > (D + 1)) {
+    l_params.threshold_coeff1 = D + 1;
+  }
+
+  DEFER_CLEANUP(decode_ws_t ws, decode_ws_cleanup);
+
+  return decode_internal(e, iters, pad_c0(ct, &ws), key, &l_params, 0, &ws);
+}
+
+ret_t decode(OUT e_t *e, IN const ct_t *ct, IN const sk_t *sk)
+{
+  DEFER_CLEANUP(decode_key_t key, decode_key_cleanup);
+  decode_key_init(&key, sk);
+
+  return decode_with_key(e, ct, &key);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The multi-instance decoder:
+////////////////////////////////////////////////////////////////////////////////
+
+// Set the lane k of ws->s to the (triplicated) syndrome of the decoding k
+_INLINE_ void wide_set_lane(IN OUT decode_wide_ws_t *ws, IN const size_t k)
+{
+  for(size_t i = 0; i < (3 * R_QWORDS); i++) {
+    ws->s.qw[i].lane[k] = ws->lane_s[k].qw[i];
+  }
+}
+
+// Set ws->msb to the complement of the last slice of the lane k of the UPC.
+// As in find_err1, every set bit indicates a potential error bit.
+_INLINE_ void wide_upc_msb(IN OUT decode_wide_ws_t *ws, IN const size_t k)
+{
+  for(size_t i = 0; i < R_QWORDS; i++) {
+    ws->msb.u.qw[i] = ~ws->upc.slice[SLICES - 1][i].lane[k];
+  }
+}
+
+// Compute the UPCs of the block i of all the decodings and subtract
+// threshold[k] from the UPC of the decoding k (steps 1 and 2 of find_err1).
+_INLINE_ void wide_upc(IN const decode_key_t *const key[DECODE_WIDE_LANES],
+                       IN const uint32_t            i,
+                       IN const uint8_t threshold[DECODE_WIDE_LANES],
+                       IN OUT decode_wide_ws_t *ws,
+                       IN const decode_ctx *ctx)
+{
+  uint32_t bitscount[DECODE_WIDE_LANES];
+
+  // UPC must start from zero at every iteration
+  bike_memset(&ws->upc, 0, sizeof(ws->upc));
+
+  for(size_t j = 0; j < D; j++) {
+    for(size_t k = 0; k < DECODE_WIDE_LANES; k++) {
+      bitscount[k] = key[k]->wlist[i].val[j];
+    }
+
+    ctx->rotate_right_add_wide(&ws->upc, &ws->rotated_syndrome, &ws->s,
+                               bitscount, LOG2_MSB(j + 1));
+  }
+
+  ctx->full_subtract_wide(&ws->upc, threshold);
+}
+
+// find_err1 for all the decodings
+_INLINE_ void find_err1_wide(IN const decode_key_t *const key[DECODE_WIDE_LANES],
+                             IN const uint8_t threshold[DECODE_WIDE_LANES],
+                             IN OUT decode_wide_ws_t *ws,
+                             IN const decode_ctx *ctx)
+{
+  // Adding DELTA to the UPC (step 4 of find_err1) is the same as subtracting
+  // -DELTA modulo 2^SLICES.
+  uint8_t minus_delta[DECODE_WIDE_LANES];
+  bike_memset(minus_delta, (uint8_t)(0 - DELTA), sizeof(minus_delta));
+
+  for(uint32_t i = 0; i < N0; i++) {
+    wide_upc(key, i, threshold, ws, ctx);
+
+    for(size_t k = 0; k < DECODE_WIDE_LANES; k++) {
+      wide_upc_msb(ws, k);
+      for(size_t j = 0; j < R_BYTES; j++) {
+        ws->black_e[k].val[i].raw[j] = ws->msb.u.r.val.raw[j];
+        ws->e[k].val[i].raw[j] ^= ws->msb.u.r.val.raw[j];
+      }
+      ws->e[k].val[i].raw[R_BYTES - 1] &= LAST_R_BYTE_MASK;
+    }
+
+    ctx->full_subtract_wide(&ws->upc, minus_delta);
+
+    for(size_t k = 0; k < DECODE_WIDE_LANES; k++) {
+      wide_upc_msb(ws, k);
+      for(size_t j = 0; j < R_BYTES; j++) {
+        ws->gray_e[k].val[i].raw[j] =
+          (~(ws->black_e[k].val[i].raw[j])) & ws->msb.u.r.val.raw[j];
+      }
+    }
+  }
+}
+
+// find_err2 for all the decodings, where pos_e[k] is the errors vector
+// (black or gray) of the decoding k
+_INLINE_ void find_err2_wide(IN const decode_key_t *const key[DECODE_WIDE_LANES],
+                             IN const e_t pos_e[DECODE_WIDE_LANES],
+                             IN OUT decode_wide_ws_t *ws,
+                             IN const decode_ctx *ctx)
+{
+  uint8_t threshold[DECODE_WIDE_LANES];
+  bike_memset(threshold, ((D + 1) / 2) + 1, sizeof(threshold));
+
+  for(uint32_t i = 0; i < N0; i++) {
+    wide_upc(key, i, threshold, ws, ctx);
+
+    for(size_t k = 0; k < DECODE_WIDE_LANES; k++) {
+      wide_upc_msb(ws, k);
+      for(size_t j = 0; j < R_BYTES; j++) {
+        ws->e[k].val[i].raw[j] ^= (pos_e[k].val[i].raw[j] & ws->msb.u.r.val.raw[j]);
+      }
+      ws->e[k].val[i].raw[R_BYTES - 1] &= LAST_R_BYTE_MASK;
+    }
+  }
+}
+
+// Compute the syndromes of all the decodings for their updated errors vectors
+_INLINE_ ret_t next_syndrome_wide(
+  IN const decode_key_t *const key[DECODE_WIDE_LANES],
+  IN OUT decode_wide_ws_t *ws)
+{
+  for(size_t k = 0; k < DECODE_WIDE_LANES; k++) {
+    GUARD(next_syndrome(&ws->lane_s[k], &ws->prev_e[k], &ws->e[k], &ws->c0[k],
+                        key[k], &ws->single));
+    wide_set_lane(ws, k);
+  }
+
+  return SUCCESS;
+}
+
+#define ITERS_LANE(iters, k) (((iters) != NULL) ? &(iters)[k] : NULL)
+
+// The same steps as decode_internal (in the constant-time mode) for
+// DECODE_WIDE_LANES decodings, where iters is NULL or as in decode_with_stats.
+_INLINE_ ret_t decode_wide_group(IN const ct_t *const ct[DECODE_WIDE_LANES],
+                                 IN const decode_key_t *const key[DECODE_WIDE_LANES],
+                                 OUT uint32_t iters[DECODE_WIDE_LANES],
+                                 IN OUT decode_wide_ws_t *ws)
+{
+  const decode_ctx *ctx = key[0]->ctx;
+  uint8_t           threshold[DECODE_WIDE_LANES];
+
+  bike_memset(ws->black_e, 0, sizeof(ws->black_e));
+  bike_memset(ws->gray_e, 0, sizeof(ws->gray_e));
+  bike_memset(ws->prev_e, 0, sizeof(ws->prev_e));
+  bike_memset(ws->e, 0, sizeof(ws->e));
+  bike_memset(ws->single.tmp, 0, sizeof(ws->single.tmp));
+  bike_memset(ws->c0, 0, sizeof(ws->c0));
+
+  for(size_t k = 0; k < DECODE_WIDE_LANES; k++) {
+    ws->c0[k].val = ct[k]->c0;
+    GUARD(compute_syndrome(&ws->lane_s[k], &ws->c0[k], &key[k]->h0,
+                           &key[k]->wlist[0], &ws->single.mul, ctx));
+    wide_set_lane(ws, k);
+  }
+
+  for(size_t k = 0; (iters != NULL) && (k < DECODE_WIDE_LANES); k++) {
+    iters[k] = MAX_IT + 1;
+  }
+
+  for(uint32_t iter = 0; iter < MAX_IT; iter++) {
+    for(size_t k = 0; k < DECODE_WIDE_LANES; k++) {
+      update_iters(ITERS_LANE(iters, k), &ws->lane_s[k], iter, MAX_IT, ctx);
+      threshold[k] = get_threshold(&ws->lane_s[k], &decode_default_params, ctx);
+    }
+
+    find_err1_wide(key, threshold, ws, ctx);
+    GUARD(next_syndrome_wide(key, ws));
+    if(iter >= decode_default_params.gray_iters) {
+      continue;
+    }
+    find_err2_wide(key, ws->black_e, ws, ctx);
+    GUARD(next_syndrome_wide(key, ws));
+
+    find_err2_wide(key, ws->gray_e, ws, ctx);
+    GUARD(next_syndrome_wide(key, ws));
+  }
+
+  for(size_t k = 0; k < DECODE_WIDE_LANES; k++) {
+    update_iters(ITERS_LANE(iters, k), &ws->lane_s[k], MAX_IT, MAX_IT, ctx);
+  }
+
+  return SUCCESS;
+}
+
+// Decode the ciphertexts in groups of DECODE_WIDE_LANES. When stats is set,
+// res[j] is set to the number of iterations of ct[j] (see decode_with_stats),
+// and otherwise to 1 when its decoding failed.
+_INLINE_ ret_t decode_wide_internal(OUT e_t e[],
+                                    OUT uint32_t res[],
+                                    IN const ct_t ct[],
+                                    IN const decode_key_t *const key[],
+                                    IN const size_t              n,
+                                    IN const uint32_t            stats,
+                                    IN OUT decode_wide_ws_t *ws)
+{
+  const ct_t *        g_ct[DECODE_WIDE_LANES];
+  const decode_key_t *g_key[DECODE_WIDE_LANES];
+  uint32_t            iters[DECODE_WIDE_LANES];
+
+  for(size_t i = 0; i < n; i += DECODE_WIDE_LANES) {
+    // Complete the last group with copies of its last decoding
+    for(size_t k = 0; k < DECODE_WIDE_LANES; k++) {
+      const size_t j = ((i + k) < n) ? (i + k) : (n - 1);
+      g_ct[k]        = &ct[j];
+      g_key[k]       = key[j];
+    }
+
+    GUARD(decode_wide_group(g_ct, g_key, stats ? iters : NULL, ws));
+
+    for(size_t k = 0; (k < DECODE_WIDE_LANES) && ((i + k) < n); k++) {
+      e[i + k] = ws->e[k];
+
+      if(stats) {
+        res[i + k] = iters[k];
+      } else {
+        res[i + k] = (key[0]->ctx->syndrome_weight(&ws->lane_s[k]) > 0);
+      }
+    }
+  }
+
+  return SUCCESS;
+}
+
+ret_t decode_wide_ws(OUT e_t e[],
+                     OUT uint32_t failed[],
+                     IN const ct_t ct[],
+                     IN const decode_key_t *const key[],
+                     IN const size_t              n,
+                     IN OUT decode_wide_ws_t *ws)
+{
+  return decode_wide_internal(e, failed, ct, key, n, 0, ws);
+}
+
+ret_t decode_wide(OUT e_t e[],
+                  OUT uint32_t failed[],
+                  IN const ct_t ct[],
+                  IN const decode_key_t *const key[],
+                  IN const size_t              n)
+{
+  DEFER_CLEANUP(decode_wide_ws_t ws, decode_wide_ws_cleanup);
+
+  return decode_wide_ws(e, failed, ct, key, n, &ws);
+}
+
+ret_t decode_wide_with_stats(OUT e_t e[],
+                             OUT uint32_t iters[],
+                             IN const ct_t ct[],
+                             IN const decode_key_t *const key[],
+                             IN const size_t              n)
+{
+  DEFER_CLEANUP(decode_wide_ws_t ws, decode_wide_ws_cleanup);
+
+  return decode_wide_internal(e, iters, ct, key, n, 1, &ws);
+}
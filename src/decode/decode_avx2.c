@@ -16,6 +16,9 @@
  *     “Optimized Implementation of QC-MDPC Code-Based Cryptography.”
  *     Concurrency and Computation: Practice and Experience 31 (18):
  *     e5089. https://doi.org/10.1002/cpe.5089.
+ *
+ * [3] Muła, W., Kurz, N., Lemire, D.: Faster Population Counts Using AVX2
+ *     Instructions. The Computer Journal 61(1), 111–120 (2018)
  */
 
 #include "decode.h"
@@ -103,6 +106,181 @@ void rotate_right_avx2(OUT syndrome_t *out,
   rotate256_small(out, out, (bitscount % BITS_IN_YMM));
 }
 
+// Add v to the bits [256 * ymm_idx, 256 * (ymm_idx + 1)) of the UPC, where
+// the carry of every slice stays in the register.
+_INLINE_ void upc_add256(OUT upc_t *upc,
+                         IN const size_t ymm_idx,
+                         IN __m256i      v,
+                         IN const size_t num_of_slices)
+{
+  for(size_t j = 0; j < num_of_slices; j++) {
+    const __m256i u = LOAD(&upc->slice[j].u.qw[4 * ymm_idx]);
+    STORE(&upc->slice[j].u.qw[4 * ymm_idx], u ^ v);
+    v = u & v;
+  }
+}
+
+// Add the first R_YMM registers of in rotated right by count (less than 256)
+// and masked by add_mask to the UPC (see rotate256_small).
+_INLINE_ void rotate256_small_add(OUT upc_t *upc,
+                                  IN const syndrome_t *in,
+                                  IN const size_t      count,
+                                  IN const __m256i     add_mask,
+                                  IN const size_t      num_of_slices)
+{
+  bike_static_assert(sizeof(upc->slice[0]) >= (BYTES_IN_YMM * R_YMM),
+                     upc_slice_ymm_err);
+
+  const int      count64    = (int)count & 0x3f;
+  const uint64_t count_mask = (count >> 5) & 0xe;
+
+  __m256i       idx       = SET_I32(7, 6, 5, 4, 3, 2, 1, 0);
+  const __m256i zero_mask = SET_I64(-1, -1, -1, 0);
+  const __m256i count_vet = SET1_I8(count_mask);
+
+  ALIGN(ALIGN_BYTES)
+  const uint8_t zero_mask2_buf[] = {
+    0x86, 0x86, 0x86, 0x86, 0x86, 0x86, 0x86, 0x86, 0x84, 0x84, 0x84,
+    0x84, 0x84, 0x84, 0x84, 0x84, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82,
+    0x82, 0x82, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80};
+  __m256i zero_mask2 = LOAD(zero_mask2_buf);
+
+  zero_mask2 = SUB_I8(zero_mask2, count_vet);
+  idx        = ADD_I8(idx, count_vet);
+
+  // Only the first R_YMM registers of the rotation are added to the UPC, the
+  // next one provides the carry of the last of them.
+  __m256i carry_in = PERMVAR_I32(LOAD(&in->qw[4 * R_YMM]), idx);
+
+  for(int i = R_YMM - 1; i >= 0; i--) {
+    __m256i in256 = LOAD(&in->qw[4 * i]);
+
+    __m256i carry_out = PERMVAR_I32(in256, idx);
+    in256             = BLENDV_I8(carry_in, carry_out, zero_mask2);
+
+    __m256i inner_carry = BLENDV_I8(carry_in, in256, zero_mask);
+    inner_carry         = PERM_I64(inner_carry, 0x39);
+    const __m256i out256 =
+      SRLI_I64(in256, count64) | SLLI_I64(inner_carry, (int)64 - count64);
+
+    upc_add256(upc, i, out256 & add_mask, num_of_slices);
+    carry_in = carry_out;
+  }
+}
+
+// Same as rotate_right_avx2 followed by bit_sliced_adder_avx2, where the
+// last step of the rotation (rotate256_small) adds every rotated 256 bits to
+// the UPC while they are in a register, instead of storing them in tmp and
+// loading them again for every slice.
+void rotate_right_add_avx2(OUT upc_t *upc,
+                           OUT syndrome_t *tmp,
+                           IN const syndrome_t *in,
+                           IN const uint32_t    bitscount,
+                           IN const size_t      num_of_slices)
+{
+  rotate256_big(tmp, in, (bitscount / BITS_IN_YMM));
+  rotate256_small_add(upc, tmp, bitscount % BITS_IN_YMM, SET1_I8(-1),
+                      num_of_slices);
+}
+
+// The blocks of the delta rotations are YMMs, and the window is advanced by
+// 2^k blocks in the pass k (see rotate_right_delta_add_port).
+void rotate_right_delta_add_avx2(OUT upc_t *upc,
+                                 IN OUT syndrome_t *win,
+                                 IN const rot_step_t *step,
+                                 IN const size_t      num_of_slices)
+{
+  bike_static_assert(DELTA_ROT_BLOCK_BITS == BITS_IN_YMM, delta_rot_block_err);
+  bike_static_assert(sizeof(*win) >= (8 * DELTA_ROT_READ_QWORDS),
+                     delta_rot_win_err);
+
+  for(size_t k = 0; k < DELTA_ROT_ADV_LOG; k++) {
+    const __m256i blend_mask = SET1_I8((int8_t)(0 - ((step->adv >> k) & 1)));
+    const size_t  off        = (size_t)1 << k;
+
+    for(size_t i = 0; i < (DELTA_ROT_WIN_QWORDS / 4); i++) {
+      const __m256i a = LOAD(&win->qw[4 * (i + off)]);
+      const __m256i b = LOAD(&win->qw[4 * i]);
+      STORE(&win->qw[4 * i], BLENDV_I8(b, a, blend_mask));
+    }
+  }
+
+  rotate256_small_add(upc, win, step->bits, SET1_I8((int8_t)step->mask),
+                      num_of_slices);
+}
+
+// The number of set bits in every 64-bit lane of v, using the 4-bit lookup
+// table of [3] (in a register, so the computation is constant-time).
+_INLINE_ __m256i popcnt256(IN const __m256i v)
+{
+  const __m256i lookup = SET_I8(4, 3, 3, 2, 3, 2, 2, 1, 3, 2, 2, 1, 2, 1, 1, 0,
+                                4, 3, 3, 2, 3, 2, 2, 1, 3, 2, 2, 1, 2, 1, 1, 0);
+  const __m256i low4   = SET1_I8(0x0f);
+
+  const __m256i lo = SHUF_I8(lookup, v & low4);
+  const __m256i hi = SHUF_I8(lookup, SRLI_I16(v, 4) & low4);
+
+  return SAD_U8(ADD_I8(lo, hi), SET_ZERO);
+}
+
+// Carry-save adder: (h, l) = a + b + c
+#define CSA(h, l, a, b, c)                \
+  do {                                    \
+    const __m256i u_ = (a) ^ (b);         \
+    (h)              = ((a) & (b)) | (u_ & (c)); \
+    (l)              = u_ ^ (c);          \
+  } while(0)
+
+// The weight of the first R_BITS of the syndrome, using the Harley-Seal
+// method of [3]: Every 8 registers are summed with carry-save adders, so
+// that only one of every 8 registers is counted with popcnt256.
+uint64_t syndrome_weight_avx2(IN const syndrome_t *s)
+{
+  // The first R_QWORDS - 1 quadwords (the last one is masked below)
+  const size_t n  = (R_QWORDS - 1) / 4;
+  const size_t n8 = n - (n % 8);
+
+  __m256i total = SET_ZERO;
+  __m256i ones  = SET_ZERO;
+  __m256i twos  = SET_ZERO;
+  __m256i fours = SET_ZERO;
+  __m256i twos_a, twos_b, fours_a, fours_b, eights;
+
+  for(size_t i = 0; i < n8; i += 8) {
+    CSA(twos_a, ones, ones, LOAD(&s->qw[4 * i]), LOAD(&s->qw[4 * (i + 1)]));
+    CSA(twos_b, ones, ones, LOAD(&s->qw[4 * (i + 2)]),
+        LOAD(&s->qw[4 * (i + 3)]));
+    CSA(fours_a, twos, twos, twos_a, twos_b);
+    CSA(twos_a, ones, ones, LOAD(&s->qw[4 * (i + 4)]),
+        LOAD(&s->qw[4 * (i + 5)]));
+    CSA(twos_b, ones, ones, LOAD(&s->qw[4 * (i + 6)]),
+        LOAD(&s->qw[4 * (i + 7)]));
+    CSA(fours_b, twos, twos, twos_a, twos_b);
+    CSA(eights, fours, fours, fours_a, fours_b);
+
+    total = ADD_I64(total, popcnt256(eights));
+  }
+
+  total = SLLI_I64(total, 3);
+  total = ADD_I64(total, SLLI_I64(popcnt256(fours), 2));
+  total = ADD_I64(total, SLLI_I64(popcnt256(twos), 1));
+  total = ADD_I64(total, popcnt256(ones));
+
+  for(size_t i = n8; i < n; i++) {
+    total = ADD_I64(total, popcnt256(LOAD(&s->qw[4 * i])));
+  }
+
+  ALIGN(ALIGN_BYTES) uint64_t lanes[4];
+  STORE(lanes, total);
+  uint64_t acc = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+  for(size_t j = 4 * n; j < (R_QWORDS - 1); j++) {
+    acc += popcount64(s->qw[j]);
+  }
+
+  return acc + popcount64(s->qw[R_QWORDS - 1] & LAST_R_QWORD_MASK);
+}
+
 // Duplicates the first R_BITS of the syndrome three times
 // |------------------------------------------|
 // |  Third copy | Second copy | first R_BITS |
@@ -15,6 +15,9 @@
  *     “Optimized Implementation of QC-MDPC Code-Based Cryptography.”
  *     Concurrency and Computation: Practice and Experience 31 (18):
  *     e5089. https://doi.org/10.1002/cpe.5089.
+ *
+ * [3] Muła, W., Kurz, N., Lemire, D.: Faster Population Counts Using AVX2
+ *     Instructions. The Computer Journal 61(1), 111–120 (2018)
  */
 
 #include "decode.h"
@@ -97,6 +100,129 @@ void rotate_right_avx512(OUT syndrome_t *out,
   rotate512_small(out, out, (bitscount % BITS_IN_ZMM));
 }
 
+// Add v to the bits [512 * zmm_idx, 512 * (zmm_idx + 1)) of the UPC, where
+// the carry of every slice stays in the register.
+_INLINE_ void upc_add512(OUT upc_t *upc,
+                         IN const size_t zmm_idx,
+                         IN __m512i      v,
+                         IN const size_t num_of_slices)
+{
+  for(size_t j = 0; j < num_of_slices; j++) {
+    const __m512i u = LOAD(&upc->slice[j].u.qw[8 * zmm_idx]);
+    STORE(&upc->slice[j].u.qw[8 * zmm_idx], u ^ v);
+    v = u & v;
+  }
+}
+
+// Add the first R_ZMM registers of in rotated right by count (less than 512)
+// and masked by add_mask to the UPC (see rotate512_small).
+_INLINE_ void rotate512_small_add(OUT upc_t *upc,
+                                  IN const syndrome_t *in,
+                                  IN const size_t      count,
+                                  IN const __m512i     add_mask,
+                                  IN const size_t      num_of_slices)
+{
+  bike_static_assert(sizeof(upc->slice[0]) >= (BYTES_IN_ZMM * R_ZMM),
+                     upc_slice_zmm_err);
+
+  const int     count64      = (int)count & 0x3f;
+  const __m512i count64_512  = SET1_I64(count64);
+  const __m512i count64_512r = SET1_I64((int)64 - count64);
+
+  const __m512i num_full_qw = SET1_I64(count >> 6);
+  const __m512i one         = SET1_I64(1);
+
+  __m512i idx  = SET_I64(7, 6, 5, 4, 3, 2, 1, 0);
+  idx          = ADD_I64(idx, num_full_qw);
+  __m512i idx1 = ADD_I64(idx, one);
+
+  // Only the first R_ZMM registers of the rotation are added to the UPC, the
+  // next one is loaded as their "previous" register.
+  __m512i previous = LOAD(&in->qw[8 * R_ZMM]);
+
+  for(int i = R_ZMM - 1; i >= 0; i--) {
+    const __m512i in512 = LOAD(&in->qw[8 * i]);
+
+    __m512i a0 = PERMX2VAR_I64(in512, idx, previous);
+    __m512i a1 = PERMX2VAR_I64(in512, idx1, previous);
+
+    a0 = SRLV_I64(a0, count64_512);
+    a1 = SLLV_I64(a1, count64_512r);
+
+    upc_add512(upc, i, (a0 | a1) & add_mask, num_of_slices);
+    previous = in512;
+  }
+}
+
+// Same as rotate_right_avx512 followed by bit_sliced_adder_avx512, where the
+// last step of the rotation (rotate512_small) adds every rotated 512 bits to
+// the UPC while they are in a register, instead of storing them in tmp and
+// loading them again for every slice.
+void rotate_right_add_avx512(OUT upc_t *upc,
+                             OUT syndrome_t *tmp,
+                             IN const syndrome_t *in,
+                             IN const uint32_t    bitscount,
+                             IN const size_t      num_of_slices)
+{
+  rotate512_big(tmp, in, (bitscount / BITS_IN_ZMM));
+  rotate512_small_add(upc, tmp, bitscount % BITS_IN_ZMM, SET1_I64(-1),
+                      num_of_slices);
+}
+
+// The window of the delta rotations is advanced by 2^k blocks of 256 bits
+// (half a ZMM) in the pass k (see rotate_right_delta_add_port).
+void rotate_right_delta_add_avx512(OUT upc_t *upc,
+                                   IN OUT syndrome_t *win,
+                                   IN const rot_step_t *step,
+                                   IN const size_t      num_of_slices)
+{
+  bike_static_assert(sizeof(*win) >= (8 * DELTA_ROT_READ_QWORDS),
+                     delta_rot_win_err);
+
+  for(size_t k = 0; k < DELTA_ROT_ADV_LOG; k++) {
+    const __mmask8 mask = (__mmask8)(0 - ((step->adv >> k) & 1));
+    const size_t   off  = (size_t)DELTA_ROT_BLOCK_QWORDS << k;
+
+    for(size_t i = 0; i < DELTA_ROT_WIN_QWORDS; i += 8) {
+      MSTORE64(&win->qw[i], mask, LOAD(&win->qw[i + off]));
+    }
+  }
+
+  rotate512_small_add(upc, win, step->bits,
+                      SET1_I64((int64_t)(int8_t)step->mask), num_of_slices);
+}
+
+// The number of set bits in every 64-bit lane of v, using the 4-bit lookup
+// table of [3] (in a register, so the computation is constant-time).
+_INLINE_ __m512i popcnt512(IN const __m512i v)
+{
+  const __m512i lookup =
+    SET4_I32(0x04030302, 0x03020201, 0x03020201, 0x02010100);
+  const __m512i low4 = SET1_I8(0x0f);
+
+  const __m512i lo = SHUF_I8(lookup, v & low4);
+  const __m512i hi = SHUF_I8(lookup, SRLI_I16(v, 4) & low4);
+
+  return SAD_U8(ADD_I8(lo, hi), SET_ZERO);
+}
+
+// The weight of the first R_BITS of the syndrome
+uint64_t syndrome_weight_avx512(IN const syndrome_t *s)
+{
+  // The first R_QWORDS - 1 quadwords (the last one is masked below)
+  const size_t   n    = (R_QWORDS - 1) / 8;
+  const __mmask8 tail = MASK((R_QWORDS - 1) % 8);
+
+  __m512i acc = SET_ZERO;
+  for(size_t i = 0; i < n; i++) {
+    acc = ADD_I64(acc, popcnt512(LOAD(&s->qw[8 * i])));
+  }
+  acc = ADD_I64(acc, popcnt512(MLOAD64(&s->qw[8 * n], tail)));
+
+  return REDUCE_ADD_I64(acc) +
+         popcount64(s->qw[R_QWORDS - 1] & LAST_R_QWORD_MASK);
+}
+
 // Duplicates the first R_BITS of the syndrome three times
 // |------------------------------------------|
 // |  Third copy | Second copy | first R_BITS |
@@ -159,3 +285,102 @@ void bit_slice_full_subtract_avx512(OUT upc_t *upc, IN uint8_t val)
     }
   }
 }
+
+// clang-3.9 doesn't recognize this macro
+#if !defined(_MM_CMPINT_NLT)
+#  define _MM_CMPINT_NLT (5)
+#endif
+
+#define R_QWORDS_HALF_LOG2 UPTOPOW2(R_QWORDS / 2)
+
+// The lanes of a wide_qw_t are the quadwords of a ZMM register
+bike_static_assert(sizeof(wide_qw_t) == BYTES_IN_ZMM, wide_qw_zmm_err);
+
+// The barrel shifter of rotr_big_wide (in decode_portable.c), where the
+// quadword rotation of every lane is selected by a mask register.
+_INLINE_ void rotr_big_wide(OUT wide_syndrome_t *out,
+                            IN const wide_syndrome_t *in,
+                            IN __m512i                qw_num)
+{
+  bike_static_assert(sizeof(*out) > (sizeof(wide_qw_t) *
+                                     (R_QWORDS + (2 * R_QWORDS_HALF_LOG2))),
+                     rotr_big_wide_err);
+
+  const wide_syndrome_t *src = in;
+
+  for(uint32_t idx = R_QWORDS_HALF_LOG2; idx >= 1; idx >>= 1) {
+    const __m512i  vidx = SET1_I64(idx);
+    const __mmask8 mask = CMPM_U64(qw_num, vidx, _MM_CMPINT_NLT);
+    qw_num              = MSUB_I64(qw_num, mask, qw_num, vidx);
+
+    for(size_t i = 0; i < (R_QWORDS + idx); i++) {
+      const __m512i a = LOAD(&src->qw[i]);
+      const __m512i b = LOAD(&src->qw[i + idx]);
+      STORE(&out->qw[i], MBLEND_I64(mask, a, b));
+    }
+    src = out;
+  }
+}
+
+void rotate_right_add_wide_avx512(OUT wide_upc_t *upc,
+                                  OUT wide_syndrome_t *tmp,
+                                  IN const wide_syndrome_t *in,
+                                  IN const uint32_t bitscount[WIDE_LANES],
+                                  IN const size_t   num_of_slices)
+{
+  uint64_t qw_num[WIDE_LANES], bits[WIDE_LANES];
+
+  for(size_t k = 0; k < WIDE_LANES; k++) {
+    qw_num[k] = bitscount[k] / 64;
+    bits[k]   = bitscount[k] % 64;
+  }
+
+  rotr_big_wide(tmp, in, LOAD(qw_num));
+
+  // A shift by 64 bits results in zero, therefore no special handling is
+  // required for bits[k] = 0.
+  const __m512i count  = LOAD(bits);
+  const __m512i countr = SUB_I64(SET1_I64(64), count);
+
+  __m512i next = LOAD(&tmp->qw[0]);
+
+  for(size_t i = 0; i < R_QWORDS; i++) {
+    const __m512i cur = next;
+    next              = LOAD(&tmp->qw[i + 1]);
+
+    __m512i v = SRLV_I64(cur, count) | SLLV_I64(next, countr);
+
+    for(size_t j = 0; j < num_of_slices; j++) {
+      const __m512i u = LOAD(&upc->slice[j][i]);
+      STORE(&upc->slice[j][i], u ^ v);
+      v = u & v;
+    }
+  }
+}
+
+void bit_slice_full_subtract_wide_avx512(OUT wide_upc_t *upc,
+                                         IN const uint8_t val[WIDE_LANES])
+{
+  __m512i  b[SLICES];
+  uint64_t lsb_mask[WIDE_LANES];
+
+  for(size_t j = 0; j < SLICES; j++) {
+    for(size_t k = 0; k < WIDE_LANES; k++) {
+      lsb_mask[k] = 0 - (uint64_t)((val[k] >> j) & 0x1);
+    }
+    b[j] = LOAD(lsb_mask);
+  }
+
+  // Perform a - b as in bit_slice_full_subtract_avx512, where the borrow
+  // of the quadwords i of all the slices stays in a register.
+  for(size_t i = 0; i < R_QWORDS; i++) {
+    __m512i br = SET_ZERO;
+
+    for(size_t j = 0; j < SLICES; j++) {
+      const __m512i a   = LOAD(&upc->slice[j][i]);
+      const __m512i tmp = (~a & b[j] & ~br) | ((~a | b[j]) & br);
+      STORE(&upc->slice[j][i], a ^ b[j] ^ br);
+      br = tmp;
+    }
+  }
+}
@@ -62,6 +62,138 @@ void rotate_right_port(OUT syndrome_t *out,
   rotr_small(out, out, (bitscount % 64));
 }
 
+// The number of quadwords that rotate_right_add_port adds to the UPC at a
+// time (so that the compiler can vectorize the additions).
+#define UPC_ADD_QWORDS 8
+
+// Same as rotate_right_port followed by bit_sliced_adder_port, where the
+// last step of the rotation (rotr_small) adds every UPC_ADD_QWORDS rotated
+// quadwords to the UPC while they are in registers, instead of storing them in
+// tmp and loading them again for every slice.
+void rotate_right_add_port(OUT upc_t *upc,
+                           OUT syndrome_t *tmp,
+                           IN const syndrome_t *in,
+                           IN const uint32_t    bitscount,
+                           IN const size_t      num_of_slices)
+{
+  bike_static_assert(sizeof(upc->slice[0]) >=
+                       (8 * UPC_ADD_QWORDS *
+                        DIVIDE_AND_CEIL(R_QWORDS, UPC_ADD_QWORDS)),
+                     upc_slice_qw_err);
+  bike_static_assert(sizeof(*tmp) >
+                       (8 * UPC_ADD_QWORDS *
+                        DIVIDE_AND_CEIL(R_QWORDS, UPC_ADD_QWORDS)),
+                     rotr_add_qw_err);
+
+  rotr_big(tmp, in, (bitscount / 64));
+
+  const size_t   bits       = bitscount % 64;
+  const uint64_t mask       = u64_barrier(0 - (!!bits));
+  const uint64_t high_shift = (64 - bits) & mask;
+
+  for(size_t i = 0; i < R_QWORDS; i += UPC_ADD_QWORDS) {
+    uint64_t carry[UPC_ADD_QWORDS];
+
+    for(size_t k = 0; k < UPC_ADD_QWORDS; k++) {
+      const uint64_t low_part  = tmp->qw[i + k] >> bits;
+      const uint64_t high_part = (tmp->qw[i + k + 1] << high_shift) & mask;
+      carry[k]                 = low_part | high_part;
+    }
+
+    for(size_t j = 0; j < num_of_slices; j++) {
+      for(size_t k = 0; k < UPC_ADD_QWORDS; k++) {
+        const uint64_t u          = upc->slice[j].u.qw[i + k];
+        upc->slice[j].u.qw[i + k] = u ^ carry[k];
+        carry[k]                  = u & carry[k];
+      }
+    }
+  }
+}
+
+// Advance the window by adv blocks, in DELTA_ROT_ADV_LOG constant-time passes
+// (the pass k advances it by 2^k blocks if the bit k of adv is set).
+_INLINE_ void delta_rot_advance(IN OUT syndrome_t *win, IN const uint8_t adv)
+{
+  bike_static_assert(sizeof(*win) >= (8 * DELTA_ROT_READ_QWORDS),
+                     delta_rot_win_err);
+
+  for(size_t k = 0; k < DELTA_ROT_ADV_LOG; k++) {
+    const uint64_t mask = u64_barrier(0 - (uint64_t)((adv >> k) & 1));
+    const size_t   off  = (size_t)DELTA_ROT_BLOCK_QWORDS << k;
+
+    for(size_t i = 0; i < DELTA_ROT_WIN_QWORDS; i++) {
+      win->qw[i] = (win->qw[i] & u64_barrier(~mask)) |
+                   (win->qw[i + off] & u64_barrier(mask));
+    }
+  }
+}
+
+// Select x[r] (r < 4) in constant time, where m0 and m1 are the masks of the
+// bits of r
+_INLINE_ uint64_t select4(IN const uint64_t *x,
+                          IN const uint64_t  m0,
+                          IN const uint64_t  m1)
+{
+  const uint64_t lo = (x[0] & ~m0) | (x[1] & m0);
+  const uint64_t hi = (x[2] & ~m0) | (x[3] & m0);
+  return (lo & ~m1) | (hi & m1);
+}
+
+void rotate_right_delta_add_port(OUT upc_t *upc,
+                                 IN OUT syndrome_t *win,
+                                 IN const rot_step_t *step,
+                                 IN const size_t      num_of_slices)
+{
+  bike_static_assert(DELTA_ROT_BLOCK_QWORDS == 4, delta_rot_block_err);
+  bike_static_assert(DELTA_ROT_WIN_QWORDS >=
+                       (UPC_ADD_QWORDS * DIVIDE_AND_CEIL(R_QWORDS, UPC_ADD_QWORDS)) +
+                         DELTA_ROT_BLOCK_QWORDS,
+                     delta_rot_add_qw_err);
+
+  delta_rot_advance(win, step->adv);
+
+  // The rotation by less than a block: by qw quadwords (selected from the
+  // 4 quadwords of the block) and then by bits
+  const uint32_t qw         = step->bits >> 6;
+  const size_t   bits       = step->bits & 0x3f;
+  const uint64_t m0         = u64_barrier(0 - (uint64_t)(qw & 1));
+  const uint64_t m1         = u64_barrier(0 - (uint64_t)(qw >> 1));
+  const uint64_t mask       = u64_barrier(0 - (!!bits));
+  const uint64_t high_shift = (64 - bits) & mask;
+  const uint64_t add_mask   = u64_barrier(0 - (uint64_t)(step->mask & 1));
+
+  for(size_t i = 0; i < R_QWORDS; i += UPC_ADD_QWORDS) {
+    uint64_t carry[UPC_ADD_QWORDS];
+
+    for(size_t k = 0; k < UPC_ADD_QWORDS; k++) {
+      const uint64_t low_part  = select4(&win->qw[i + k], m0, m1) >> bits;
+      const uint64_t high_part = select4(&win->qw[i + k + 1], m0, m1)
+                                 << high_shift;
+      carry[k] = (low_part | (high_part & mask)) & add_mask;
+    }
+
+    for(size_t j = 0; j < num_of_slices; j++) {
+      for(size_t k = 0; k < UPC_ADD_QWORDS; k++) {
+        const uint64_t u          = upc->slice[j].u.qw[i + k];
+        upc->slice[j].u.qw[i + k] = u ^ carry[k];
+        carry[k]                  = u & carry[k];
+      }
+    }
+  }
+}
+
+// The weight of the first R_BITS of the syndrome
+uint64_t syndrome_weight_port(IN const syndrome_t *s)
+{
+  uint64_t acc = popcount64(s->qw[R_QWORDS - 1] & LAST_R_QWORD_MASK);
+
+  for(size_t i = 0; i < (R_QWORDS - 1); i++) {
+    acc += popcount64(s->qw[i]);
+  }
+
+  return acc;
+}
+
 // Duplicates the first R_BITS of the syndrome three times
 // |------------------------------------------|
 // |  Third copy | Second copy | first R_BITS |
@@ -124,3 +256,105 @@ void bit_slice_full_subtract_port(OUT upc_t *upc, IN uint8_t val)
     }
   }
 }
+
+// rotr_big for every lane of a wide syndrome, where the lane k is rotated by
+// qw_num[k] quadwords. The first step reads the quadwords from in, and the
+// next steps from out, so that in does not need to be copied to out.
+_INLINE_ void rotr_big_wide(OUT wide_syndrome_t *out,
+                            IN const wide_syndrome_t *in,
+                            IN OUT uint32_t qw_num[WIDE_LANES])
+{
+  bike_static_assert(sizeof(*out) > (sizeof(wide_qw_t) *
+                                     (R_QWORDS + (2 * R_QWORDS_HALF_LOG2))),
+                     rotr_big_wide_err);
+
+  const wide_syndrome_t *src = in;
+  uint64_t               mask[WIDE_LANES], not_mask[WIDE_LANES];
+
+  for(uint32_t idx = R_QWORDS_HALF_LOG2; idx >= 1; idx >>= 1) {
+    for(size_t k = 0; k < WIDE_LANES; k++) {
+      // Convert 32 bit mask to 64 bit mask
+      const uint64_t m = ((uint32_t)secure_l32_mask(qw_num[k], idx) + 1U) - 1ULL;
+      qw_num[k]        = qw_num[k] - (idx & u64_barrier(m));
+      mask[k]          = u64_barrier(m);
+      not_mask[k]      = u64_barrier(~m);
+    }
+
+    for(size_t i = 0; i < (R_QWORDS + idx); i++) {
+      for(size_t k = 0; k < WIDE_LANES; k++) {
+        out->qw[i].lane[k] = (src->qw[i].lane[k] & not_mask[k]) |
+                             (src->qw[i + idx].lane[k] & mask[k]);
+      }
+    }
+    src = out;
+  }
+}
+
+// Same as rotate_right_add_port for every lane of a wide syndrome and of
+// a wide UPC, where the lane k is rotated by bitscount[k].
+void rotate_right_add_wide_port(OUT wide_upc_t *upc,
+                                OUT wide_syndrome_t *tmp,
+                                IN const wide_syndrome_t *in,
+                                IN const uint32_t bitscount[WIDE_LANES],
+                                IN const size_t   num_of_slices)
+{
+  uint32_t qw_num[WIDE_LANES];
+  uint64_t bits[WIDE_LANES], mask[WIDE_LANES], high_shift[WIDE_LANES];
+
+  for(size_t k = 0; k < WIDE_LANES; k++) {
+    qw_num[k]     = bitscount[k] / 64;
+    bits[k]       = bitscount[k] % 64;
+    mask[k]       = u64_barrier(0 - (!!bits[k]));
+    high_shift[k] = (64 - bits[k]) & mask[k];
+  }
+
+  rotr_big_wide(tmp, in, qw_num);
+
+  for(size_t i = 0; i < R_QWORDS; i++) {
+    uint64_t carry[WIDE_LANES];
+
+    for(size_t k = 0; k < WIDE_LANES; k++) {
+      const uint64_t low_part  = tmp->qw[i].lane[k] >> bits[k];
+      const uint64_t high_part = (tmp->qw[i + 1].lane[k] << high_shift[k]) &
+                                 mask[k];
+      carry[k] = low_part | high_part;
+    }
+
+    for(size_t j = 0; j < num_of_slices; j++) {
+      for(size_t k = 0; k < WIDE_LANES; k++) {
+        const uint64_t u         = upc->slice[j][i].lane[k];
+        upc->slice[j][i].lane[k] = u ^ carry[k];
+        carry[k]                 = u & carry[k];
+      }
+    }
+  }
+}
+
+// Same as bit_slice_full_subtract_port for every lane of a wide UPC, where
+// val[k] is subtracted from the lane k.
+void bit_slice_full_subtract_wide_port(OUT wide_upc_t *upc,
+                                       IN const uint8_t val[WIDE_LANES])
+{
+  uint64_t b[SLICES][WIDE_LANES];
+
+  for(size_t j = 0; j < SLICES; j++) {
+    for(size_t k = 0; k < WIDE_LANES; k++) {
+      b[j][k] = 0 - (uint64_t)((val[k] >> j) & 0x1);
+    }
+  }
+
+  for(size_t i = 0; i < R_QWORDS; i++) {
+    // Borrow
+    uint64_t br[WIDE_LANES] = {0};
+
+    for(size_t j = 0; j < SLICES; j++) {
+      for(size_t k = 0; k < WIDE_LANES; k++) {
+        const uint64_t a   = upc->slice[j][i].lane[k];
+        const uint64_t tmp = ((~a) & b[j][k] & (~br[k])) |
+                             (((~a) | b[j][k]) & br[k]);
+        upc->slice[j][i].lane[k] = a ^ b[j][k] ^ br[k];
+        br[k]                    = tmp;
+      }
+    }
+  }
+}
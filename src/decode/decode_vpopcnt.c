@@ -0,0 +1,29 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include "decode_internal.h"
+#include "utilities.h"
+
+#define AVX512_INTERNAL
+#include "x86_64_intrinsic.h"
+
+// The weight of the first R_BITS of the syndrome, using VPOPCNTQ
+uint64_t syndrome_weight_vpopcnt(IN const syndrome_t *s)
+{
+  // The first R_QWORDS - 1 quadwords (the last one is masked below)
+  const size_t   n    = (R_QWORDS - 1) / 8;
+  const __mmask8 tail = MASK((R_QWORDS - 1) % 8);
+
+  __m512i acc = SET_ZERO;
+  for(size_t i = 0; i < n; i++) {
+    acc = ADD_I64(acc, POPCNT_I64(LOAD(&s->qw[8 * i])));
+  }
+  acc = ADD_I64(acc, POPCNT_I64(MLOAD64(&s->qw[8 * n], tail)));
+
+  return REDUCE_ADD_I64(acc) +
+         popcount64(s->qw[R_QWORDS - 1] & LAST_R_QWORD_MASK);
+}
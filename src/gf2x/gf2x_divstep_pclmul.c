@@ -0,0 +1,63 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include <immintrin.h>
+
+#include "gf2x_internal.h"
+
+#define LOAD128(mem)       _mm_loadu_si128((const void *)(mem))
+#define STORE128(mem, reg) _mm_storeu_si128((void *)(mem), (reg))
+#define CLMUL(x, y, imm)   _mm_clmulepi64_si128((x), (y), (imm))
+#define BSRLI(x, imm)      _mm_bsrli_si128((x), (imm))
+#define BSLLI(x, imm)      _mm_bslli_si128((x), (imm))
+
+// The two quadwords i, i+1 of m_lo*x + m_hi*y, where m = [m_hi | m_lo].
+// The product is returned in lo (quadwords i, i+1) and hi (quadword i+2).
+_INLINE_ void mul2(OUT __m128i *lo,
+                   OUT __m128i *hi,
+                   IN const __m128i m,
+                   IN const __m128i x,
+                   IN const __m128i y)
+{
+  const __m128i t0 = CLMUL(m, x, 0x00) ^ CLMUL(m, y, 0x01);
+  const __m128i t1 = CLMUL(m, x, 0x10) ^ CLMUL(m, y, 0x11);
+
+  *lo = t0 ^ BSLLI(t1, 8);
+  *hi = BSRLI(t1, 8);
+}
+
+// c0 = m[0]*x + m[1]*y and c1 = m[2]*x + m[3]*y (see gf2x_divstep_mul_port).
+// qwords must be even (a multiple of DIVSTEP_ALIGN_QWORDS).
+void gf2x_divstep_mul_pclmul(OUT uint64_t *c0,
+                             OUT uint64_t *c1,
+                             IN const uint64_t m[4],
+                             IN const uint64_t *x,
+                             IN const uint64_t *y,
+                             IN const size_t    qwords)
+{
+  const __m128i m01    = LOAD128(&m[0]);
+  const __m128i m23    = LOAD128(&m[2]);
+  __m128i       carry0 = _mm_setzero_si128();
+  __m128i       carry1 = _mm_setzero_si128();
+  __m128i       lo, hi;
+
+  for(size_t i = 0; i < qwords; i += 2) {
+    const __m128i xi = LOAD128(&x[i]);
+    const __m128i yi = LOAD128(&y[i]);
+
+    mul2(&lo, &hi, m01, xi, yi);
+    STORE128(&c0[i], lo ^ carry0);
+    carry0 = hi;
+
+    mul2(&lo, &hi, m23, xi, yi);
+    STORE128(&c1[i], lo ^ carry1);
+    carry1 = hi;
+  }
+
+  c0[qwords] = (uint64_t)_mm_cvtsi128_si64(carry0);
+  c1[qwords] = (uint64_t)_mm_cvtsi128_si64(carry1);
+}
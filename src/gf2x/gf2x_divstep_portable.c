@@ -0,0 +1,38 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include "gf2x_internal.h"
+
+// c0 = m[0]*x + m[1]*y and c1 = m[2]*x + m[3]*y, where m[i] are polynomials
+// of 64 bits and x, y are of qwords quadwords (c0, c1 are of qwords + 1).
+void gf2x_divstep_mul_port(OUT uint64_t *c0,
+                           OUT uint64_t *c1,
+                           IN const uint64_t m[4],
+                           IN const uint64_t *x,
+                           IN const uint64_t *y,
+                           IN const size_t    qwords)
+{
+  uint64_t carry0 = 0;
+  uint64_t carry1 = 0;
+
+  for(size_t i = 0; i < qwords; i++) {
+    uint64_t t[4][2];
+
+    gf2x_mul_base_port(t[0], &m[0], &x[i]);
+    gf2x_mul_base_port(t[1], &m[1], &y[i]);
+    gf2x_mul_base_port(t[2], &m[2], &x[i]);
+    gf2x_mul_base_port(t[3], &m[3], &y[i]);
+
+    c0[i]  = t[0][0] ^ t[1][0] ^ carry0;
+    c1[i]  = t[2][0] ^ t[3][0] ^ carry1;
+    carry0 = t[0][1] ^ t[1][1];
+    carry1 = t[2][1] ^ t[3][1];
+  }
+
+  c0[qwords] = carry0;
+  c1[qwords] = carry1;
+}
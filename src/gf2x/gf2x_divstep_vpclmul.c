@@ -0,0 +1,62 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include "gf2x_internal.h"
+
+#define AVX512_INTERNAL
+#include "x86_64_intrinsic.h"
+
+#define CLMUL(x, y, imm) _mm512_clmulepi64_epi128((x), (y), (imm))
+#define BSRLI(x, imm)    _mm512_bsrli_epi128((x), (imm))
+#define BSLLI(x, imm)    _mm512_bslli_epi128((x), (imm))
+
+// The eight quadwords i..i+7 of m_lo*x + m_hi*y, where every 128-bit lane of
+// m is [m_hi | m_lo]. The quadwords that carry out of every lane are added to
+// the next lane, and the carry of the last lane is returned in carry (which
+// holds the carry of the previous eight quadwords on input).
+_INLINE_ __m512i mul8(IN OUT __m512i *carry,
+                      IN const __m512i m,
+                      IN const __m512i x,
+                      IN const __m512i y)
+{
+  const __m512i t0 = CLMUL(m, x, 0x00) ^ CLMUL(m, y, 0x01);
+  const __m512i t1 = CLMUL(m, x, 0x10) ^ CLMUL(m, y, 0x11);
+  const __m512i hi = BSRLI(t1, 8);
+  const __m512i lo = t0 ^ BSLLI(t1, 8) ^ VALIGN(hi, *carry, 6);
+
+  *carry = hi;
+  return lo;
+}
+
+// c0 = m[0]*x + m[1]*y and c1 = m[2]*x + m[3]*y (see gf2x_divstep_mul_port).
+// qwords must be a multiple of DIVSTEP_ALIGN_QWORDS.
+void gf2x_divstep_mul_vpclmul(OUT uint64_t *c0,
+                              OUT uint64_t *c1,
+                              IN const uint64_t m[4],
+                              IN const uint64_t *x,
+                              IN const uint64_t *y,
+                              IN const size_t    qwords)
+{
+  const __m512i m01    = SET_I64(m[1], m[0], m[1], m[0], m[1], m[0], m[1], m[0]);
+  const __m512i m23    = SET_I64(m[3], m[2], m[3], m[2], m[3], m[2], m[3], m[2]);
+  __m512i       carry0 = SET_ZERO;
+  __m512i       carry1 = SET_ZERO;
+
+  for(size_t i = 0; i < qwords; i += QWORDS_IN_ZMM) {
+    const __m512i xi = LOAD(&x[i]);
+    const __m512i yi = LOAD(&y[i]);
+
+    STORE(&c0[i], mul8(&carry0, m01, xi, yi));
+    STORE(&c1[i], mul8(&carry1, m23, xi, yi));
+  }
+
+  // The carry of the last lane is in quadword 6 of the carry
+  c0[qwords] = (uint64_t)_mm_cvtsi128_si64(
+    _mm512_castsi512_si128(VALIGN(SET_ZERO, carry0, 6)));
+  c1[qwords] = (uint64_t)_mm_cvtsi128_si64(
+    _mm512_castsi512_si128(VALIGN(SET_ZERO, carry1, 6)));
+}
@@ -8,32 +8,39 @@
  * [1] Nir Drucker, Shay Gueron, and Dusan Kostic. 2020. "Fast polynomial
  * inversion for post quantum QC-MDPC cryptography". Cryptology ePrint Archive,
  * 2020. https://eprint.iacr.org/2020/298.pdf
+ * [2] Daniel J. Bernstein and Bo-Yin Yang. 2019. "Fast constant-time gcd
+ * computation and modular inversion". IACR Transactions on Cryptographic
+ * Hardware and Embedded Systems, 2019(3), 340-398.
+ * https://eprint.iacr.org/2019/266.pdf
  */
 
 #include "cleanup.h"
+#include "dispatch.h"
 #include "gf2x.h"
 #include "gf2x_internal.h"
-
-// a = a^2 mod (x^r - 1)
-_INLINE_ void gf2x_mod_sqr_in_place(IN OUT pad_r_t *a,
-                                    OUT dbl_pad_r_t *secure_buffer,
-                                    IN const gf2x_ctx *ctx)
-{
-  ctx->sqr(secure_buffer, a);
-  ctx->red(a, secure_buffer);
-}
+#include "profile.h"
 
 // c = a^2^2^num_sqrs
 _INLINE_ void repeated_squaring(OUT pad_r_t *c,
                                 IN pad_r_t *    a,
                                 IN const size_t num_sqrs,
-                                OUT dbl_pad_r_t *sec_buf,
+                                OUT pad_r_t *sec_buf,
                                 IN const gf2x_ctx *ctx)
 {
-  c->val = a->val;
+  if(num_sqrs == 0) {
+    c->val = a->val;
+    return;
+  }
+
+  // The squarings (which are not in place) alternate between c and sec_buf,
+  // such that the last one is written to c
+  const pad_r_t *src = a;
+  pad_r_t *      dst = ((num_sqrs % 2) == 1) ? c : sec_buf;
 
   for(size_t i = 0; i < num_sqrs; i++) {
-    gf2x_mod_sqr_in_place(c, sec_buf, ctx);
+    ctx->mod_sqr(dst, src);
+    src = dst;
+    dst = (dst == c) ? sec_buf : c;
   }
 }
 
@@ -44,259 +51,406 @@ _INLINE_ void repeated_squaring(OUT pad_r_t *c,
 // exponentiation 0 (exp0) and exponentiation 1 (exp1) of the form f^(2^k).
 // These exponentiations are computed either by repeated squaring of f, k times,
 // or by a single k-squaring of f. The method for a specific value of k
-// is chosen based on the performance of squaring and k-squaring.
-//
-// Benchmarks on several platforms indicate that a good threshold
-// for switching from repeated squaring to k-squaring is k = 64.
-#define K_SQR_THR (64)
+// is chosen based on the performance of squaring and k-squaring of the
+// current CPU (ctx->k_sqr_thr, see gf2x_ctx_init).
 
 // k-squaring is computed by a permutation of bits of the input polynomial,
 // as defined in [1](Observation 1). The required parameter for the permutation
 // is l = (2^k)^-1 % R.
-// Therefore, there are two sets of parameters for every exponentiation:
-//   - exp0_k and exp1_k
-//   - exp0_l and exp1_l
 
 // Exponentiation 0 computes f^2^2^(i-1) for 0 < i < MAX_I.
 // Exponentiation 1 computes f^2^((r-2) % 2^i) for 0 < i < MAX_I,
-// only when the i-th bit of (r-2) is 1. Therefore, the value 0 in
-// exp1_k[i] and exp1_l[i] means that exp1 is skipped in i-th iteration.
-
-// To quickly generate all the required parameters in Sage:
-//   r = DESIRED_R
-//   max_i = floor(log(r-2, 2)) + 1
-//   exp0_k = [2^i for i in range(max_i)]
-//   exp0_l = [inverse_mod((2^k) % r, r) for k in exp0_k]
-//   exp1_k = [(r-2)%(2^i) if ((r-2) & (1<<i)) else 0 for i in range(max_i)]
-//   exp1_l = [inverse_mod((2^k) % r, r) if k != 0 else 0 for k in exp1_k]
-
-#if(LEVEL == 0)
-// The parameters below are hard-coded for R=2053
-bike_static_assert((R_BITS == 2053), gf2x_inv_r_doesnt_match_parameters);
-
-// MAX_I = floor(log(r-2)) + 1
-#  define MAX_I (12)
-#  define EXP0_K_VALS \
-    1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048
-#  define EXP0_L_VALS                                                           \
-    1027, 1540, 385, 409, 988, 969, 740, 1502, 1810, 1565, 2049, 16
-#  define EXP1_K_VALS 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3
-#  define EXP1_L_VALS 0, 1027, 0, 0, 0, 0, 0, 0, 0, 0, 0, 770
-
-#elif(LEVEL == 10)
-// The parameters below are hard-coded for R=7109
-bike_static_assert((R_BITS == 7109), gf2x_inv_r_doesnt_match_parameters);
-
-// MAX_I = floor(log(r-2)) + 1
-#  define MAX_I (13)
-#  define EXP0_K_VALS \
-    1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096
-#  define EXP0_L_VALS                                                           \
-    3555, 5332, 1333, 6748, 2359, 5643, 2238, 3908, 2332, 6948, 4594, 5324, 1393
-#  define EXP1_K_VALS 0, 1, 0, 0, 0, 0, 3, 67, 195, 451, 0, 963, 3011
-#  define EXP1_L_VALS 0, 3555, 0, 0, 0, 0, 2666, 2057, 5586, 2864, 0, 981, 4838
-
-#elif(LEVEL == 11)
-// The parameters below are hard-coded for R=773
-bike_static_assert((R_BITS == 773), gf2x_inv_r_doesnt_match_parameters);
-
-// MAX_I = floor(log(r-2)) + 1
-#  define  MAX_I (10)
-#  define  EXP0_K_VALS \
-    1, 2, 4, 8, 16, 32, 64, 128, 256, 512
-#  define  EXP0_L_VALS \
-    387, 580, 145, 154, 526, 715, 272, 549, 704, 123
-#  define  EXP1_K_VALS \
-    0, 1, 0, 0, 0, 0, 0, 0, 3, 259
-#  define  EXP1_L_VALS \
-    0, 387, 0, 0, 0, 0, 0, 0, 290, 88
-
-#elif(LEVEL == 12)
-// The parameters below are hard-coded for R=1019
-bike_static_assert((R_BITS == 1019), gf2x_inv_r_doesnt_match_parameters);
-
-// MAX_I = floor(log(r-2)) + 1
-#  define  MAX_I (10)
-#  define  EXP0_K_VALS \
-    1, 2, 4, 8, 16, 32, 64, 128, 256, 512
-#  define  EXP0_L_VALS \
-    510, 255, 828, 816, 449, 858, 446, 211, 704, 382
-#  define  EXP1_K_VALS \
-    0, 0, 0, 1, 9, 25, 57, 121, 249, 505
-#  define  EXP1_L_VALS \
-    0, 0, 0, 510, 408, 791, 24, 514, 440, 1003
-
-#elif(LEVEL == 13)
-// The parameters below are hard-coded for R=1283
-bike_static_assert((R_BITS == 1283), gf2x_inv_r_doesnt_match_parameters);
-
-// MAX_I = floor(log(r-2)) + 1
-#  define  MAX_I (11)
-#  define  EXP0_K_VALS \
-    1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024
-#  define  EXP0_L_VALS \
-    642, 321, 401, 426, 573, 1164, 48, 1021, 645, 333, 551
-#  define  EXP1_K_VALS \
-    0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 257
-#  define  EXP1_L_VALS \
-    0, 0, 0, 0, 0, 0, 0, 0, 642, 0, 964
-
-#elif(LEVEL == 14)
-// The parameters below are hard-coded for R=2029
-bike_static_assert((R_BITS == 2029), gf2x_inv_r_doesnt_match_parameters);
-
-// MAX_I = floor(log(r-2)) + 1
-#  define  MAX_I (11)
-#  define  EXP0_K_VALS \
-    1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024
-#  define  EXP0_L_VALS \
-    1015, 1522, 1395, 214, 1158, 1824, 1445, 184, 1392, 1998, 961
-#  define  EXP1_K_VALS \
-    0, 1, 0, 3, 0, 11, 43, 107, 235, 491, 1003
-#  define  EXP1_L_VALS \
-    0, 1015, 0, 761, 0, 534, 96, 748, 1689, 1506, 2010
-
-#elif(LEVEL == 15)
-// The parameters below are hard-coded for R=2053
-bike_static_assert((R_BITS == 2053), gf2x_inv_r_doesnt_match_parameters);
-
-// MAX_I = floor(log(r-2)) + 1
-#  define  MAX_I (12)
-#  define  EXP0_K_VALS \
-    1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048
-#  define  EXP0_L_VALS \
-    1027, 1540, 385, 409, 988, 969, 740, 1502, 1810, 1565, 2049, 16
-#  define  EXP1_K_VALS \
-    0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3
-#  define  EXP1_L_VALS \
-    0, 1027, 0, 0, 0, 0, 0, 0, 0, 0, 0, 770
-
-#elif(LEVEL == 16)
-// The parameters below are hard-coded for R=2069
-bike_static_assert((R_BITS == 2069), gf2x_inv_r_doesnt_match_parameters);
-
-// MAX_I = floor(log(r-2)) + 1
-#  define  MAX_I (12)
-#  define  EXP0_K_VALS \
-    1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048
-#  define  EXP0_L_VALS \
-    1035, 1552, 388, 1576, 976, 836, 1643, 1473, 1417, 959, 1045, 1662
-#  define  EXP1_K_VALS \
-    0, 1, 0, 0, 3, 0, 0, 0, 0, 0, 0, 19
-#  define  EXP1_L_VALS \
-    0, 1035, 0, 0, 776, 0, 0, 0, 0, 0, 0, 122
-
-#elif(LEVEL == 17)
-// The parameters below are hard-coded for R=4021
-bike_static_assert((R_BITS == 4021), gf2x_inv_r_doesnt_match_parameters);
-
-// MAX_I = floor(log(r-2)) + 1
-#  define  MAX_I (12)
-#  define  EXP0_K_VALS \
-    1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048
-#  define  EXP0_L_VALS \
-    2011, 3016, 754, 1555, 1404, 926, 1003, 759, 1078, 15, 225, 2373
-#  define  EXP1_K_VALS \
-    0, 1, 0, 0, 3, 19, 0, 51, 179, 435, 947, 1971
-#  define  EXP1_L_VALS \
-    0, 2011, 0, 0, 1508, 2186, 0, 1673, 3192, 3021, 1084, 2640
-
-#elif(LEVEL == 18)
-// The parameters below are hard-coded for R=4099
-bike_static_assert((R_BITS == 4099), gf2x_inv_r_doesnt_match_parameters);
-
-// MAX_I = floor(log(r-2)) + 1
-#  define  MAX_I (13)
-#  define  EXP0_K_VALS \
-    1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096
-#  define  EXP0_L_VALS \
-    2050, 1025, 1281, 1361, 3672, 1973, 2778, 2966, 702, 924, 1184, 4097, 4
-#  define  EXP1_K_VALS \
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1
-#  define  EXP1_L_VALS \
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2050
-
-#elif(LEVEL == 1)
-// The parameters below are hard-coded for R=12323
-bike_static_assert((R_BITS == 12323), gf2x_inv_r_doesnt_match_parameters);
-
-// MAX_I = floor(log(r-2)) + 1
-#  define MAX_I (14)
-#  define EXP0_K_VALS \
-    1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192
-#  define EXP0_L_VALS                                                           \
-    6162, 3081, 3851, 5632, 22, 484, 119, 1838, 1742, 3106, 10650, 1608, 10157, \
-      8816
-#  define EXP1_K_VALS 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 33, 4129
-#  define EXP1_L_VALS 0, 0, 0, 0, 0, 6162, 0, 0, 0, 0, 0, 0, 242, 5717
-
-#else
-// The parameters below are hard-coded for R=24659
-bike_static_assert((R_BITS == 24659), gf2x_inv_r_doesnt_match_parameters);
-
-// MAX_I = floor(log(r-2)) + 1
-#  define MAX_I (15)
-#  define EXP0_K_VALS \
-    1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384
-#  define EXP0_L_VALS                                                          \
-    12330, 6165, 7706, 3564, 2711, 1139, 15053, 1258, 4388, 20524, 9538, 6393, \
-      10486, 1715, 6804
-#  define EXP1_K_VALS 0, 0, 0, 0, 1, 0, 17, 0, 0, 0, 0, 0, 0, 81, 8273
-#  define EXP1_L_VALS 0, 0, 0, 0, 12330, 0, 13685, 0, 0, 0, 0, 0, 0, 23678, 19056
-
-#endif
+// only when the i-th bit of (r-2) is 1.
+// All the parameters are derived from R_BITS, therefore a new value of R
+// does not require new tables.
+
+// MAX_I = floor(log(r-2)) + 1, i.e., the number of bits of (r-2)
+_INLINE_ size_t max_i(void)
+{
+  size_t bits = 0;
+  for(size_t v = R_BITS - 2; v != 0; v >>= 1) {
+    bits++;
+  }
+  return bits;
+}
+
+// l = (2^k)^-1 % R = ((R + 1) / 2)^k % R
+_INLINE_ size_t k_sqr_l_param(IN size_t k)
+{
+  // R_BITS < 2^15 (see bike_defs.h), therefore the products fit in 32 bits
+  uint32_t l    = 1;
+  uint32_t base = (R_BITS + 1) / 2;
+
+  for(; k != 0; k >>= 1) {
+    if(k & 1) {
+      l = (l * base) % R_BITS;
+    }
+    base = (base * base) % R_BITS;
+  }
+
+  return l;
+}
+
+// c = a^(2^k), by the precomputed map of k (if maps has one)
+_INLINE_ void exp_pow2(OUT pad_r_t *c,
+                       IN pad_r_t *    a,
+                       IN const size_t k,
+                       IN const gf2x_ksqr_maps_t *maps,
+                       IN OUT gf2x_inv_ws_t *ws,
+                       IN const gf2x_ctx *ctx)
+{
+  if(k <= ctx->k_sqr_thr) {
+    repeated_squaring(c, a, k, &ws->sqr_buf, ctx);
+    return;
+  }
+
+  if(maps != NULL) {
+    for(size_t j = 0; j < maps->num_maps; j++) {
+      if(maps->k[j] == k) {
+        ctx->k_sqr_map(c, a, gf2x_ksqr_map(maps, j), &ws->u.k_sqr);
+        return;
+      }
+    }
+  }
+
+  ctx->k_sqr(c, a, k_sqr_l_param(k), &ws->u.k_sqr);
+}
+
+// Calls func(k, arg) for every exponent k of the inversion that is computed
+// by a k-squaring (i.e., k > ctx->k_sqr_thr), once per distinct k.
+_INLINE_ void for_each_ksqr_exp(IN void (*func)(size_t k, void *arg),
+                                IN OUT void *arg,
+                                IN const gf2x_ctx *ctx)
+{
+  const size_t r_minus_2 = R_BITS - 2;
+  const size_t num_i     = max_i();
+
+  for(size_t i = 1; i < num_i; i++) {
+    const size_t k0 = (size_t)1 << (i - 1);
+    if(k0 > ctx->k_sqr_thr) {
+      func(k0, arg);
+    }
+
+    const size_t k1 = r_minus_2 & MASK(i);
+    if(((r_minus_2 >> i) & 1) && (k1 > ctx->k_sqr_thr) &&
+       ((k1 & (k1 - 1)) != 0)) {
+      // Skip k1 if it is a power of 2 (then it is also an exponent of exp0)
+      func(k1, arg);
+    }
+  }
+}
 
 // Inversion in F_2[x]/(x^R - 1), [1](Algorithm 2).
 // c = a^{-1} mod x^r-1
-void gf2x_mod_inv(OUT pad_r_t *c, IN const pad_r_t *a)
+void gf2x_mod_inv_exp(OUT pad_r_t *c,
+                      IN const pad_r_t *a,
+                      IN const gf2x_ksqr_maps_t *maps,
+                      IN OUT gf2x_inv_ws_t *ws,
+                      IN const gf2x_ctx *ctx)
 {
-  // Initialize gf2x methods struct
-  gf2x_ctx ctx;
-  gf2x_ctx_init(&ctx);
-
-  // Note that exp0/1_k/l are predefined constants that depend only on the value
-  // of R. This value is public. Therefore, branches in this function, which
-  // depends on R, are also "public". Code that releases these branches
-  // (taken/not-taken) does not leak secret information.
-  const size_t exp0_k[MAX_I] = {EXP0_K_VALS};
-  const size_t exp0_l[MAX_I] = {EXP0_L_VALS};
-  const size_t exp1_k[MAX_I] = {EXP1_K_VALS};
-  const size_t exp1_l[MAX_I] = {EXP1_L_VALS};
-
-  DEFER_CLEANUP(pad_r_t f = {0}, pad_r_cleanup);
-  DEFER_CLEANUP(pad_r_t g = {0}, pad_r_cleanup);
-  DEFER_CLEANUP(pad_r_t t = {0}, pad_r_cleanup);
-  DEFER_CLEANUP(dbl_pad_r_t sec_buf = {0}, dbl_pad_r_cleanup);
+  // Note that the exponents depend only on the value of R. This value is
+  // public. Therefore, branches in this function, which depends on R, are also
+  // "public". Code that releases these branches (taken/not-taken) does not
+  // leak secret information.
+  const size_t r_minus_2 = R_BITS - 2;
+  const size_t num_i     = max_i();
+
+  pad_r_t *f = &ws->f;
+  pad_r_t *g = &ws->g;
+  pad_r_t *t = &ws->t;
+
+  bike_memset(f, 0, sizeof(*f));
+  bike_memset(g, 0, sizeof(*g));
+  bike_memset(t, 0, sizeof(*t));
+  bike_memset(&ws->sqr_buf, 0, sizeof(ws->sqr_buf));
 
   // Steps 2 and 3 in [1](Algorithm 2)
-  f.val = a->val;
-  t.val = a->val;
+  f->val = a->val;
+  t->val = a->val;
 
-  for(size_t i = 1; i < MAX_I; i++) {
+  for(size_t i = 1; i < num_i; i++) {
     // Step 5 in [1](Algorithm 2), exponentiation 0: g = f^2^2^(i-1)
-    if(exp0_k[i - 1] <= K_SQR_THR) {
-      repeated_squaring(&g, &f, exp0_k[i - 1], &sec_buf, &ctx);
-    } else {
-      ctx.k_sqr(&g, &f, exp0_l[i - 1]);
-    }
+    exp_pow2(g, f, (size_t)1 << (i - 1), maps, ws, ctx);
 
     // Step 6, [1](Algorithm 2): f = f*g
-    gf2x_mod_mul_with_ctx(&f, &g, &f, &ctx);
+    gf2x_mod_mul_with_ctx(f, g, f, &ws->u.mul, ctx);
 
-    if(exp1_k[i] != 0) {
+    if((r_minus_2 >> i) & 1) {
       // Step 8, [1](Algorithm 2), exponentiation 1: g = f^2^((r-2) % 2^i)
-      if(exp1_k[i] <= K_SQR_THR) {
-        repeated_squaring(&g, &f, exp1_k[i], &sec_buf, &ctx);
-      } else {
-        ctx.k_sqr(&g, &f, exp1_l[i]);
-      }
+      exp_pow2(g, f, r_minus_2 & MASK(i), maps, ws, ctx);
 
       // Step 9, [1](Algorithm 2): t = t*g;
-      gf2x_mod_mul_with_ctx(&t, &g, &t, &ctx);
+      gf2x_mod_mul_with_ctx(t, g, t, &ws->u.mul, ctx);
     }
   }
 
   // Step 10, [1](Algorithm 2): c = t^2
-  gf2x_mod_sqr_in_place(&t, &sec_buf, &ctx);
-  c->val = t.val;
+  ctx->mod_sqr(c, t);
+}
+
+// The gf2x_mod_inv_divstep function implements inversion in F_2[x]/(x^R - 1)
+// by the constant-time gcd of [2](Section 7), with f and g in the reversed
+// representation (the coefficient of x^i of a polynomial of degree d is the
+// coefficient of x^(d-i) of its reversal):
+//   f = x^R + 1 (the reversal of x^R - 1), g = the reversal of a (of R bits),
+// followed by 2R - 1 divsteps, each of them:
+//   if delta > 0 and g_0 = 1: (delta, f, g) = (1 - delta, g, (g + f)/x)
+//   otherwise:                (delta, f, g) = (1 + delta, f, (g + g_0*f)/x)
+// Starting from v = 0 and r = 1, every divstep also sets v = x*v, swaps v and
+// r when it swaps f and g, and adds g_0*v to r. At the end, a is invertible
+// iff delta = 0, and its inverse is the reversal of v (of R bits).
+// With D = diag(x, 1), the transition matrix of a divstep is D*E for (f, g)
+// (scaled by x) and E*D for (v, r). Therefore, if M is the matrix of (f, g)
+// after n divsteps, the matrix of (v, r) is D^-1*M*D:
+//   [M00, M01/x; x*M10, M11].
+
+// The divsteps are computed in batches of DIVSTEP_BATCH. A batch depends only
+// on delta and on the DIVSTEP_BATCH low bits of f and g, therefore it is first
+// run on these bits, which gives its transition matrices, and then the
+// matrices are applied to the full f, g, v, and r (by ctx->divstep_mul).
+// All the parameters are derived from R_BITS (and no table depends on R).
+// The number of divsteps is public, therefore the branches that depend on it
+// do not leak secret information.
+
+// The largest batch whose transition matrices have entries of 64 bits
+#define DIVSTEP_BATCH (63)
+
+// The polynomials f and g are of R + 1 bits, rounded up to a multiple of
+// DIVSTEP_ALIGN_QWORDS (for ctx->divstep_mul), and v and r are truncated to
+// R + 1 bits.
+#define DIVSTEP_R_QWORDS DIVIDE_AND_CEIL(R_BITS + 1, 64)
+#define DIVSTEP_FG_QWORDS                                    \
+  (DIVIDE_AND_CEIL(DIVSTEP_R_QWORDS, DIVSTEP_ALIGN_QWORDS) * \
+   DIVSTEP_ALIGN_QWORDS)
+#define DIVSTEP_TOP_MASK   MASK((R_BITS + 1) % 64)
+
+bike_static_assert((DIVSTEP_FG_QWORDS + 1) <= DIVSTEP_QWORDS,
+                   divstep_qwords_too_small);
+
+_INLINE_ void cswap(IN OUT uint64_t *x, IN OUT uint64_t *y, IN const uint64_t mask)
+{
+  const uint64_t t = mask & (*x ^ *y);
+
+  *x ^= t;
+  *y ^= t;
+}
+
+// Run n <= DIVSTEP_BATCH divsteps on the low bits of f and g, and return the
+// new delta and the transition matrix of the batch:
+//   x^n*f_new = m[0]*f + m[1]*g,  x^n*g_new = m[2]*f + m[3]*g.
+// The entries are of degree at most n (after i divsteps, they are of degree
+// at most i), and m[0] and m[1] are divisible by x.
+_INLINE_ int64_t divstep_batch(OUT uint64_t m[4],
+                               IN int64_t    delta,
+                               IN uint64_t   f,
+                               IN uint64_t   g,
+                               IN const size_t n)
+{
+  uint64_t u = 1, v = 0, q = 0, r = 1;
+
+  for(size_t i = 0; i < n; i++) {
+    // The masks of g_0 = 1, and of (delta > 0 and g_0 = 1)
+    const uint64_t g0   = 0 - (g & 1);
+    const uint64_t swap = g0 & (0 - ((uint64_t)(-delta) >> 63));
+
+    delta ^= (int64_t)(swap & ((uint64_t)delta ^ (uint64_t)(-delta)));
+    delta++;
+
+    cswap(&f, &g, swap);
+    cswap(&u, &q, swap);
+    cswap(&v, &r, swap);
+
+    g ^= g0 & f;
+    q ^= g0 & u;
+    r ^= g0 & v;
+
+    // g = g/x, i.e., the row of f is multiplied by x
+    g >>= 1;
+    u <<= 1;
+    v <<= 1;
+  }
+
+  m[0] = u;
+  m[1] = v;
+  m[2] = q;
+  m[3] = r;
+
+  return delta;
+}
+
+// out = in/x^n, where in is of qwords + 1 quadwords and 0 < n < 64
+_INLINE_ void divstep_shift(OUT uint64_t *out,
+                            IN const uint64_t *in,
+                            IN const size_t    n,
+                            IN const size_t    qwords)
+{
+  for(size_t i = 0; i < qwords; i++) {
+    out[i] = (in[i] >> n) | (in[i + 1] << (64 - n));
+  }
+}
+
+_INLINE_ uint64_t bit_reverse64(IN uint64_t x)
+{
+  x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+  x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+  x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+
+  return __builtin_bswap64(x);
+}
+
+// The reversal of the R low bits of in: out_i = in_(R-1-i), for 0 <= i < R.
+// The bits of out from R to 64*R_QWORDS are zero.
+_INLINE_ void reverse_r_bits(OUT uint64_t *out, IN const uint64_t *in)
+{
+  const size_t s = (64 * R_QWORDS) - R_BITS;
+
+  for(size_t i = 0; i < R_QWORDS; i++) {
+    out[i] = bit_reverse64(in[R_QWORDS - 1 - i]);
+  }
+
+  if(s != 0) {
+    for(size_t i = 0; i < (R_QWORDS - 1); i++) {
+      out[i] = (out[i] >> s) | (out[i + 1] << (64 - s));
+    }
+    out[R_QWORDS - 1] >>= s;
+  }
+}
+
+// Inversion in F_2[x]/(x^R - 1) by divsteps, [2](Section 7).
+// c = a^{-1} mod x^r-1
+void gf2x_mod_inv_divstep(OUT pad_r_t *c,
+                          IN const pad_r_t *a,
+                          IN BIKE_UNUSED_ATT const gf2x_ksqr_maps_t *maps,
+                          IN OUT gf2x_inv_ws_t *ws,
+                          IN const gf2x_ctx *ctx)
+{
+  const size_t num_divsteps = (2 * R_BITS) - 1;
+
+  gf2x_divstep_ws_t *w  = &ws->u.divstep;
+  uint64_t *         f  = w->f;
+  uint64_t *         g  = w->g;
+  uint64_t *         v  = w->v;
+  uint64_t *         r  = w->r;
+  uint64_t *         tf = w->t[0];
+  uint64_t *         tg = w->t[1];
+  uint64_t *         tv = w->t[2];
+  uint64_t *         tr = w->t[3];
+  uint64_t           mfg[4];
+  uint64_t           mvr[4];
+  int64_t            delta = 1;
+
+  bike_memset(w, 0, sizeof(*w));
+
+  f[0] = 1;
+  f[R_BITS / 64] |= BIT(R_BITS % 64);
+  reverse_r_bits(g, (const uint64_t *)a);
+  r[0] = 1;
+
+  for(size_t i = 0; i < num_divsteps; i += DIVSTEP_BATCH) {
+    const size_t n = ((num_divsteps - i) < DIVSTEP_BATCH) ? (num_divsteps - i)
+                                                           : DIVSTEP_BATCH;
+
+    delta  = divstep_batch(mfg, delta, f[0], g[0], n);
+    mvr[0] = mfg[0];
+    mvr[1] = mfg[1] >> 1;
+    mvr[2] = mfg[2] << 1;
+    mvr[3] = mfg[3];
+
+    ctx->divstep_mul(tf, tg, mfg, f, g, DIVSTEP_FG_QWORDS);
+    divstep_shift(f, tf, n, DIVSTEP_FG_QWORDS);
+    divstep_shift(g, tg, n, DIVSTEP_FG_QWORDS);
+
+    // Before the batch, v and r are of degree at most i. Therefore, only their
+    // low quadwords are multiplied (the others are zero).
+    size_t vr_qwords = DIVIDE_AND_CEIL(i + 1, 64 * DIVSTEP_ALIGN_QWORDS) *
+                       DIVSTEP_ALIGN_QWORDS;
+    if(vr_qwords > DIVSTEP_FG_QWORDS) {
+      vr_qwords = DIVSTEP_FG_QWORDS;
+    }
+
+    ctx->divstep_mul(tv, tr, mvr, v, r, vr_qwords);
+
+    // The products overwrite the previous v and r, which are shorter (the
+    // quadwords above them are zero). v and r are then truncated to R + 1
+    // bits (mod x^(R+1)), which does not change the low R bits of the result.
+    uint64_t *tmp = v;
+    v             = tv;
+    tv            = tmp;
+    tmp           = r;
+    r             = tr;
+    tr            = tmp;
+
+    for(size_t j = DIVSTEP_R_QWORDS; j <= vr_qwords; j++) {
+      v[j] = 0;
+      r[j] = 0;
+    }
+    if(DIVSTEP_TOP_MASK != 0) {
+      v[DIVSTEP_R_QWORDS - 1] &= DIVSTEP_TOP_MASK;
+      r[DIVSTEP_R_QWORDS - 1] &= DIVSTEP_TOP_MASK;
+    }
+  }
+
+  // The inverse (if delta = 0) is the reversal of v
+  bike_memset(c, 0, sizeof(*c));
+  reverse_r_bits((uint64_t *)c, v);
+}
+
+void gf2x_mod_inv_ws(OUT pad_r_t *c,
+                     IN const pad_r_t *a,
+                     IN const gf2x_ksqr_maps_t *maps,
+                     IN OUT gf2x_inv_ws_t *ws)
+{
+  const gf2x_ctx *ctx = &get_dispatch_ctx()->gf2x;
+
+  PROFILE_BEGIN(BIKE_PROFILE_GF2X_MOD_INV);
+
+  ctx->mod_inv(c, a, maps, ws, ctx);
+
+  PROFILE_END(BIKE_PROFILE_GF2X_MOD_INV);
+}
+
+void gf2x_mod_inv(OUT pad_r_t *c, IN const pad_r_t *a)
+{
+  DEFER_CLEANUP(gf2x_inv_ws_t ws, gf2x_inv_ws_cleanup);
+
+  gf2x_mod_inv_ws(c, a, NULL, &ws);
+}
+
+static void count_map(BIKE_UNUSED_ATT size_t k, void *arg)
+{
+  (*(size_t *)arg)++;
+}
+
+static void add_map(size_t k, void *arg)
+{
+  gf2x_ksqr_maps_t *maps = (gf2x_ksqr_maps_t *)arg;
+  uint16_t *        map  = (uint16_t *)&maps[1];
+  const size_t      l    = k_sqr_l_param(k);
+
+  map = &map[maps->num_maps * R_PADDED];
+
+  // The map of pi1 (see k_sqr_port): map[i] = (l * i) % R, for all the
+  // (padded) indices that the k-squaring implementations read
+  for(size_t i = 0; i < R_PADDED; i++) {
+    map[i] = (uint16_t)((i * l) % R_BITS);
+  }
+
+  maps->k[maps->num_maps] = (uint32_t)k;
+  maps->num_maps++;
+}
+
+size_t gf2x_ksqr_maps_size(void)
+{
+  size_t num_maps = 0;
+
+  for_each_ksqr_exp(count_map, &num_maps, &get_dispatch_ctx()->gf2x);
+
+  return sizeof(gf2x_ksqr_maps_t) + (num_maps * R_PADDED * sizeof(uint16_t));
+}
+
+void gf2x_ksqr_maps_init(OUT gf2x_ksqr_maps_t *maps)
+{
+  maps->num_maps = 0;
+
+  for_each_ksqr_exp(add_map, maps, &get_dispatch_ctx()->gf2x);
 }
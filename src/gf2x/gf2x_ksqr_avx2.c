@@ -159,24 +159,34 @@ _INLINE_ void bin_to_bytes(OUT uint8_t *bytes_buf, IN const pad_r_t *bin_buf)
 // For improved performance, we compute the result by inverted permutation pi1:
 //     pi1 : (j * 2^-k) % r --> j.
 // Input argument l_param is defined as the value (2^-k) % r.
-void k_sqr_avx2(OUT pad_r_t *c, IN const pad_r_t *a, IN const size_t l_param)
+void k_sqr_avx2(OUT pad_r_t *c,
+                IN const pad_r_t *a,
+                IN const size_t l_param,
+                OUT gf2x_ksqr_ws_t *ws)
 {
-  ALIGN(ALIGN_BYTES) uint16_t map[R_PADDED];
-  ALIGN(ALIGN_BYTES) uint8_t  a_bytes[R_PADDED];
-  ALIGN(ALIGN_BYTES) uint8_t  c_bytes[R_PADDED] = {0};
-
   // Generate the permutation map defined by pi1 and l_param.
-  generate_map(map, l_param);
+  generate_map(ws->map, l_param);
+
+  k_sqr_map_avx2(c, a, ws->map, ws);
+}
+
+// k-squaring by the given map of pi1 (generated by generate_map, or
+// precomputed by gf2x_ksqr_maps_init).
+void k_sqr_map_avx2(OUT pad_r_t *c,
+                    IN const pad_r_t *a,
+                    IN const uint16_t *map,
+                    OUT gf2x_ksqr_ws_t *ws)
+{
+  uint8_t *a_bytes = ws->a_bytes;
+  uint8_t *c_bytes = ws->c_bytes;
 
   bin_to_bytes(a_bytes, a);
 
-  // Permute "a" using the generated permutation map.
+  // Permute "a" using the permutation map.
   for(size_t i = 0; i < R_BITS; i++) {
     c_bytes[i] = a_bytes[map[i]];
   }
+  bike_memset(&c_bytes[R_BITS], 0, R_PADDED - R_BITS);
 
   bytes_to_bin(c, c_bytes);
-
-  secure_clean(a_bytes, sizeof(a_bytes));
-  secure_clean(c_bytes, sizeof(c_bytes));
 }
@@ -16,114 +16,121 @@
 #define AVX512_INTERNAL
 #include "x86_64_intrinsic.h"
 
-#define NUM_ZMMS    (2)
-#define NUM_OF_VALS (NUM_ZMMS * WORDS_IN_ZMM)
-
-// clang-3.9 doesn't recognize these two macros
-#if !defined(_MM_CMPINT_EQ)
-#  define _MM_CMPINT_EQ (0)
-#endif
+// Every iteration of k_sqr_avx512 computes a quadword of the result,
+// NUM_ZMMS * DWORDS_IN_ZMM = 64 bits, in NUM_ZMMS registers.
+#define NUM_ZMMS      (4)
+#define DWORDS_IN_ZMM (16)
+#define NUM_OF_VALS   (NUM_ZMMS * DWORDS_IN_ZMM)
 
+// clang-3.9 doesn't recognize this macro
 #if !defined(_MM_CMPINT_NLT)
 #  define _MM_CMPINT_NLT (5)
 #endif
 
-_INLINE_ void generate_map(OUT uint16_t *map, IN const size_t l_param)
+// The k-squaring function computes c = a^(2^k) % (x^r - 1),
+// By [1](Observation 1), if
+//     a = sum_{j in supp(a)} x^j,
+// then
+//     a^(2^k) % (x^r - 1) = sum_{j in supp(a)} x^((j * 2^k) % r).
+// Therefore, k-squaring can be computed as permutation of the bits of "a":
+//     pi0 : j --> (j * 2^k) % r.
+// For improved performance, we compute the result by inverted permutation pi1:
+//     pi1 : (j * 2^-k) % r --> j.
+// Input argument l_param is defined as the value (2^-k) % r.
+//
+// The bits of "a" are gathered directly from its binary representation: the
+// map of pi1 is computed in registers of 32-bit elements, as in the
+// generate_map function of k_sqr_avx2, and the bit map[i] of "a" is the bit
+// (map[i] % 32) of the dword (map[i] / 32), which is gathered with a single
+// instruction for 16 values of i. This avoids the expansion of "a" and "c"
+// to bytes, and the scalar permutation loop of the other implementations.
+// The gathered addresses depend only on l_param, which is public.
+// Since "c" is written while "a" is read, c and a must not overlap.
+void k_sqr_avx512(OUT pad_r_t *c,
+                  IN const pad_r_t *a,
+                  IN const size_t l_param,
+                  OUT gf2x_ksqr_ws_t *ws)
 {
-  __m512i   vmap[NUM_ZMMS], vr, inc;
-  __mmask32 mask[NUM_ZMMS];
-
-  // The permutation map is generated in the following way:
-  //   1. for i = 0 to map size:
-  //   2.  map[i] = (i * l_param) % r
-  // However, to avoid the expensive multiplication and modulo operations
-  // we modify the algorithm to:
-  //   1. map[0] = l_param
-  //   2. for i = 1 to map size:
-  //   3.   map[i] = map[i - 1] + l_param
-  //   4.   if map[i] >= r:
-  //   5.     map[i] = map[i] - r
-  // This algorithm is parallelized with vector instructions by processing
-  // certain number of values (NUM_OF_VALS) in parallel. Therefore,
-  // in the beginning we need to initialize the first NUM_OF_VALS elements.
+  (void)ws;
+
+  const int32_t *a32 = (const int32_t *)a;
+  uint64_t *     c64 = (uint64_t *)c;
+
+  __m512i  vmap[NUM_ZMMS], vr, inc, dw_mask, bit0, t;
+  uint32_t map[NUM_OF_VALS];
+
+  // Initialize the first NUM_OF_VALS elements of the map, and set the
+  // increment vector such that by adding it to vmap vectors we will obtain
+  // the next NUM_OF_VALS elements of the map (see generate_map of k_sqr_avx2).
   for(size_t i = 0; i < NUM_OF_VALS; i++) {
     map[i] = (i * l_param) % R_BITS;
   }
 
-  // Set the increment vector such that by adding it to vmap vectors
-  // we will obtain the next NUM_OF_VALS elements of the map.
-  inc = SET1_I16((l_param * NUM_OF_VALS) % R_BITS);
-  vr  = SET1_I16(R_BITS);
+  inc     = SET1_I32((l_param * NUM_OF_VALS) % R_BITS);
+  vr      = SET1_I32(R_BITS);
+  dw_mask = SET1_I32(31);
+  bit0    = SET1_I32(1);
 
-  // Load the first NUM_OF_VALS elements in the vmap vectors
   for(size_t i = 0; i < NUM_ZMMS; i++) {
-    vmap[i] = LOAD(&map[i * WORDS_IN_ZMM]);
+    vmap[i] = LOAD(&map[i * DWORDS_IN_ZMM]);
   }
 
-  for(size_t i = NUM_ZMMS; i < (R_PADDED / WORDS_IN_ZMM); i += NUM_ZMMS) {
-    for(size_t j = 0; j < NUM_ZMMS; j++) {
-      vmap[j] = ADD_I16(vmap[j], inc);
-      mask[j] = CMPM_U16(vmap[j], vr, _MM_CMPINT_NLT);
-      vmap[j] = MSUB_I16(vmap[j], mask[j], vmap[j], vr);
+  for(size_t i = 0; i < R_QWORDS; i++) {
+    uint64_t qw = 0;
 
-      STORE(&map[(i + j) * WORDS_IN_ZMM], vmap[j]);
+    for(size_t j = 0; j < NUM_ZMMS; j++) {
+      // Shift the bit map[i] of "a" to the first bit of its dword
+      t = GATHER_I32(SRLI_I32(vmap[j], 5), a32);
+      t = SRLV_I32(t, vmap[j] & dw_mask);
+      qw |= ((uint64_t)TESTM_I32(t, bit0)) << (j * DWORDS_IN_ZMM);
+
+      vmap[j] = ADD_I32(vmap[j], inc);
+      vmap[j] = MSUB_I32(vmap[j], CMPM_U32(vmap[j], vr, _MM_CMPINT_NLT),
+                         vmap[j], vr);
     }
+
+    c64[i] = qw;
   }
+
+  c64[R_QWORDS - 1] &= LAST_R_QWORD_MASK;
+  bike_memset(&c64[R_QWORDS], 0,
+              (R_PADDED_QWORDS - R_QWORDS) * sizeof(uint64_t));
 }
 
-// Convert from bytes representation where each byte holds a single bit
-// to binary representation where each byte holds 8 bits of the polynomial
-_INLINE_ void bytes_to_bin(OUT pad_r_t *bin_buf, IN const uint8_t *bytes_buf)
+// k-squaring by the precomputed map of pi1 (see gf2x_ksqr_maps_init): the
+// indices of every register are loaded from the map (and zero extended to
+// 32 bits), instead of being computed incrementally.
+void k_sqr_map_avx512(OUT pad_r_t *c,
+                      IN const pad_r_t *a,
+                      IN const uint16_t *map,
+                      OUT gf2x_ksqr_ws_t *ws)
 {
-  uint64_t *bin64 = (uint64_t *)bin_buf;
+  (void)ws;
 
-  __m512i first_bit_mask = SET1_I8(1);
-  for(size_t i = 0; i < R_QWORDS; i++) {
-    __m512i t = LOAD(&bytes_buf[i * BYTES_IN_ZMM]);
-    bin64[i]  = CMPM_U8(t, first_bit_mask, _MM_CMPINT_EQ);
-  }
-}
+  const int32_t *a32 = (const int32_t *)a;
+  uint64_t *     c64 = (uint64_t *)c;
 
-// Convert from binary representation where each byte holds 8 bits
-// to byte representation where each byte holds a single bit of the polynomial
-_INLINE_ void bin_to_bytes(OUT uint8_t *bytes_buf, IN const pad_r_t *bin_buf)
-{
-  const uint64_t *bin64 = (const uint64_t *)bin_buf;
+  const __m512i dw_mask = SET1_I32(31);
+  const __m512i bit0    = SET1_I32(1);
+  __m512i       vmap, t;
 
   for(size_t i = 0; i < R_QWORDS; i++) {
-    __m512i t = SET1MZ_I8(bin64[i], 1);
-    STORE(&bytes_buf[i * BYTES_IN_ZMM], t);
-  }
-}
-
-// The k-squaring function computes c = a^(2^k) % (x^r - 1),
-// By [1](Observation 1), if
-//     a = sum_{j in supp(a)} x^j,
-// then
-//     a^(2^k) % (x^r - 1) = sum_{j in supp(a)} x^((j * 2^k) % r).
-// Therefore, k-squaring can be computed as permutation of the bits of "a":
-//     pi0 : j --> (j * 2^k) % r.
-// For improved performance, we compute the result by inverted permutation pi1:
-//     pi1 : (j * 2^-k) % r --> j.
-// Input argument l_param is defined as the value (2^-k) % r.
-void k_sqr_avx512(OUT pad_r_t *c, IN const pad_r_t *a, IN const size_t l_param)
-{
-  ALIGN(ALIGN_BYTES) uint16_t map[R_PADDED];
-  ALIGN(ALIGN_BYTES) uint8_t  a_bytes[R_PADDED];
-  ALIGN(ALIGN_BYTES) uint8_t  c_bytes[R_PADDED] = {0};
+    uint64_t qw = 0;
 
-  // Generate the permutation map defined by pi1 and l_param.
-  generate_map(map, l_param);
+    for(size_t j = 0; j < NUM_ZMMS; j++) {
+      vmap = _mm512_cvtepu16_epi32(
+        _mm256_loadu_si256((const void *)&map[(i * NUM_OF_VALS) +
+                                              (j * DWORDS_IN_ZMM)]));
 
-  bin_to_bytes(a_bytes, a);
+      t = GATHER_I32(SRLI_I32(vmap, 5), a32);
+      t = SRLV_I32(t, vmap & dw_mask);
+      qw |= ((uint64_t)TESTM_I32(t, bit0)) << (j * DWORDS_IN_ZMM);
+    }
 
-  // Permute "a" using the generated permutation map.
-  for(size_t i = 0; i < R_BITS; i++) {
-    c_bytes[i] = a_bytes[map[i]];
+    c64[i] = qw;
   }
 
-  bytes_to_bin(c, c_bytes);
-
-  secure_clean(a_bytes, sizeof(a_bytes));
-  secure_clean(c_bytes, sizeof(c_bytes));
+  c64[R_QWORDS - 1] &= LAST_R_QWORD_MASK;
+  bike_memset(&c64[R_QWORDS], 0,
+              (R_PADDED_QWORDS - R_QWORDS) * sizeof(uint64_t));
 }
@@ -25,7 +25,10 @@
 // For improved performance, we compute the result by inverted permutation pi1:
 //     pi1 : (j * 2^-k) % r --> j.
 // Input argument l_param is defined as the value (2^-k) % r.
-void k_sqr_port(OUT pad_r_t *c, IN const pad_r_t *a, IN const size_t l_param)
+void k_sqr_port(OUT pad_r_t *c,
+                IN const pad_r_t *a,
+                IN const size_t l_param,
+                OUT BIKE_UNUSED_ATT gf2x_ksqr_ws_t *ws)
 {
   bike_memset(c->val.raw, 0, sizeof(c->val));
 
@@ -46,3 +49,24 @@ void k_sqr_port(OUT pad_r_t *c, IN const pad_r_t *a, IN const size_t l_param)
   }
   c->val.raw[R_BYTES - 1] &= LAST_R_BYTE_MASK;
 }
+
+// k-squaring by the precomputed map of pi1 (map[idx] = (l_param * idx) % r,
+// see gf2x_ksqr_maps_init), instead of computing it bit by bit.
+void k_sqr_map_port(OUT pad_r_t *c,
+                    IN const pad_r_t *a,
+                    IN const uint16_t *map,
+                    OUT BIKE_UNUSED_ATT gf2x_ksqr_ws_t *ws)
+{
+  bike_memset(c->val.raw, 0, sizeof(c->val));
+
+  size_t idx = 0;
+  for(size_t i = 0; i < R_BYTES; i++) {
+    for(size_t j = 0; j < BITS_IN_BYTE; j++, idx++) {
+      const size_t  pos = map[idx];
+      const uint8_t bit = (a->val.raw[pos >> 3] >> (pos & 7)) & 1;
+
+      c->val.raw[i] |= (bit << j);
+    }
+  }
+  c->val.raw[R_BYTES - 1] &= LAST_R_BYTE_MASK;
+}
@@ -8,17 +8,164 @@
 #include <assert.h>
 
 #include "cleanup.h"
+#include "dispatch.h"
 #include "gf2x.h"
 #include "gf2x_internal.h"
+#include "parallel.h"
+#include "profile.h"
 
-// The secure buffer size required for Karatsuba is computed by:
-//    size(n) = 3*n/2 + size(n/2) = 3*sum_{i}{n/2^i} < 3n
-#define SECURE_BUFFER_QWORDS (3 * R_PADDED_QWORDS)
+// A flat schedule multiplies operands of k <= KARATZUBA_FLAT_BLOCKS blocks
+// (of n = ctx->mul_base_qwords quadwords) without recursion:
+//   1) All the sums of the parts of the operands are computed first.
+//   2) The (independent) base multiplications of all the leaves follow.
+//   3) The products are combined, with the additions of the two passes of
+//      karatzuba_add2 and karatzuba_add3 fused (karatzuba_add23).
+// The schedules are lists of operations that are expanded at compile time
+// into straight-line code. Their arguments are blocks of the operands
+// (IN for a and b, and SUM for their sums, sa and sb) and of the products
+// (C for the output c, and PROD for the other products, p):
+//   FLAT_SUM(z, X, x, Y, y, len):    (sa, sb)[z] = X[x] + Y[y]
+//   FLAT_MUL(Z, z, X, x):            Z[z] = X[x] (of a) * X[x] (of b)
+//   FLAT_ADD(Z, z, X, x, Y, y, len): Z[z] = X[x] + Y[y]
+//   FLAT_COPY(Z, z, X, x, len):      Z[z] = X[x]
+//   FLAT_COMBINE(Z, z, X, x, len):   karatzuba_add23(Z[z], X[x])
+// where len is the number of blocks of the operation.
 
-// Karatsuba multiplication algorithm.
-// Input arguments a and b are padded with zeros, here:
-//   - n: real number of digits in a and b (R_QWORDS)
-//   - n_padded: padded number of digits of a and b (assumed to be power of 2)
+// 2 blocks: a = a0 + a1*X, the sum s0 = a0 + a1, and the middle product at p0
+#define FLAT_SCHEDULE2            \
+  FLAT_SUM(0, IN, 0, IN, 1, 1);   \
+  FLAT_MUL(C, 0, IN, 0);          \
+  FLAT_MUL(C, 2, IN, 1);          \
+  FLAT_MUL(PROD, 0, SUM, 0);      \
+  FLAT_COMBINE(C, 0, PROD, 0, 1)
+
+// 3 blocks: the 3-way split, with 6 multiplications instead of 7.
+// With a = a0 + a1*X + a2*X^2, b = b0 + b1*X + b2*X^2, and the products
+// P0 = a0*b0, P1 = a1*b1, P2 = a2*b2, P01 = (a0+a1)*(b0+b1),
+// P02 = (a0+a2)*(b0+b2), P12 = (a1+a2)*(b1+b2):
+//   c = P0 + (P01+P0+P1)*X + (P02+P0+P1+P2)*X^2 + (P12+P1+P2)*X^3 + P2*X^4
+// P0 and P2 are at c0 and c4, and P1, P01, P02, P12 are at p0, p2, p4, p6.
+#define FLAT_SCHEDULE3                    \
+  FLAT_SUM(0, IN, 0, IN, 1, 1);           \
+  FLAT_SUM(1, IN, 0, IN, 2, 1);           \
+  FLAT_SUM(2, IN, 1, IN, 2, 1);           \
+  FLAT_MUL(C, 0, IN, 0);                  \
+  FLAT_MUL(C, 4, IN, 2);                  \
+  FLAT_MUL(PROD, 0, IN, 1);               \
+  FLAT_MUL(PROD, 2, SUM, 0);              \
+  FLAT_MUL(PROD, 4, SUM, 1);              \
+  FLAT_MUL(PROD, 6, SUM, 2);              \
+  FLAT_ADD(PROD, 2, PROD, 2, C, 0, 2);    \
+  FLAT_ADD(PROD, 2, PROD, 2, PROD, 0, 2); \
+  FLAT_ADD(PROD, 4, PROD, 4, C, 0, 2);    \
+  FLAT_ADD(PROD, 4, PROD, 4, C, 4, 2);    \
+  FLAT_ADD(PROD, 6, PROD, 6, PROD, 0, 2); \
+  FLAT_ADD(PROD, 6, PROD, 6, C, 4, 2);    \
+  FLAT_COPY(C, 2, PROD, 0, 2);            \
+  FLAT_ADD(C, 1, C, 1, PROD, 2, 2);       \
+  FLAT_ADD(C, 2, C, 2, PROD, 4, 2);       \
+  FLAT_ADD(C, 3, C, 3, PROD, 6, 2)
+
+// 4 blocks: two levels of the 2-way split. The sum of the halves is at s0
+// (2 blocks) and their middle product at p0 (4 blocks). The sums of the
+// second level are at s2, s3, s4 and their middle products at p4, p6, p8.
+#define FLAT_SCHEDULE4                \
+  FLAT_SUM(0, IN, 0, IN, 2, 2);       \
+  FLAT_SUM(2, IN, 0, IN, 1, 1);       \
+  FLAT_SUM(3, IN, 2, IN, 3, 1);       \
+  FLAT_SUM(4, SUM, 0, SUM, 1, 1);     \
+  FLAT_MUL(C, 0, IN, 0);              \
+  FLAT_MUL(C, 2, IN, 1);              \
+  FLAT_MUL(PROD, 4, SUM, 2);          \
+  FLAT_MUL(C, 4, IN, 2);              \
+  FLAT_MUL(C, 6, IN, 3);              \
+  FLAT_MUL(PROD, 6, SUM, 3);          \
+  FLAT_MUL(PROD, 0, SUM, 0);          \
+  FLAT_MUL(PROD, 2, SUM, 1);          \
+  FLAT_MUL(PROD, 8, SUM, 4);          \
+  FLAT_COMBINE(C, 0, PROD, 4, 1);     \
+  FLAT_COMBINE(C, 4, PROD, 6, 1);     \
+  FLAT_COMBINE(PROD, 0, PROD, 8, 1);  \
+  FLAT_COMBINE(C, 0, PROD, 0, 2)
+
+// The buffers of the blocks of the schedules
+#define FLAT_A_IN          a
+#define FLAT_B_IN          b
+#define FLAT_A_SUM         sa
+#define FLAT_B_SUM         sb
+#define FLAT_P_C           c
+#define FLAT_P_PROD        p
+#define FLAT_BLK(buf, blk) (&(buf)[(blk)*n])
+
+#define FLAT_SUM(z, X, x, Y, y, len)                                \
+  do {                                                              \
+    ctx->karatzuba_add2(FLAT_BLK(sa, z), FLAT_BLK(FLAT_A_##X, x),   \
+                        FLAT_BLK(FLAT_A_##Y, y), (len)*n);          \
+    ctx->karatzuba_add2(FLAT_BLK(sb, z), FLAT_BLK(FLAT_B_##X, x),   \
+                        FLAT_BLK(FLAT_B_##Y, y), (len)*n);          \
+  } while(0)
+
+#define FLAT_MUL(Z, z, X, x)                                     \
+  ctx->mul_base(FLAT_BLK(FLAT_P_##Z, z), FLAT_BLK(FLAT_A_##X, x), \
+                FLAT_BLK(FLAT_B_##X, x))
+
+#define FLAT_ADD(Z, z, X, x, Y, y, len)                                   \
+  ctx->karatzuba_add2(FLAT_BLK(FLAT_P_##Z, z), FLAT_BLK(FLAT_P_##X, x),   \
+                      FLAT_BLK(FLAT_P_##Y, y), (len)*n)
+
+#define FLAT_COPY(Z, z, X, x, len)                                \
+  bike_memcpy(FLAT_BLK(FLAT_P_##Z, z), FLAT_BLK(FLAT_P_##X, x),   \
+              (len)*n * sizeof(uint64_t))
+
+#define FLAT_COMBINE(Z, z, X, x, len)                                    \
+  ctx->karatzuba_add23(FLAT_BLK(FLAT_P_##Z, z), FLAT_BLK(FLAT_P_##X, x), \
+                       (len)*n)
+
+// c = a * b, for a and b of k blocks, by the schedule FLAT_SCHEDULE<k> with
+// sum_blocks blocks of sa (and of sb). The sums and the products are stored
+// in a buffer sec_buf (of karatzuba_flat_buffer(k) blocks).
+#define FLAT_FUNC(k, sum_blocks)                                  \
+  _INLINE_ void karatzuba_flat##k(OUT uint64_t *c,                \
+                                  IN const uint64_t *a,           \
+                                  IN const uint64_t *b,           \
+                                  uint64_t *         sec_buf,     \
+                                  IN const gf2x_ctx *ctx)         \
+  {                                                               \
+    const size_t n  = ctx->mul_base_qwords;                       \
+    uint64_t *   sa = sec_buf;                                    \
+    uint64_t *   sb = &sec_buf[(sum_blocks)*n];                   \
+    uint64_t *   p  = &sec_buf[2 * (sum_blocks)*n];               \
+                                                                  \
+    FLAT_SCHEDULE##k;                                             \
+  }
+
+FLAT_FUNC(2, 1)
+FLAT_FUNC(3, 3)
+FLAT_FUNC(4, 5)
+
+#undef FLAT_A_IN
+#undef FLAT_B_IN
+#undef FLAT_A_SUM
+#undef FLAT_B_SUM
+#undef FLAT_P_C
+#undef FLAT_P_PROD
+#undef FLAT_BLK
+#undef FLAT_SUM
+#undef FLAT_MUL
+#undef FLAT_ADD
+#undef FLAT_COPY
+#undef FLAT_COMBINE
+#undef FLAT_FUNC
+
+// Karatsuba multiplication algorithm, c = a * b.
+// Input arguments a and b are of qwords_len quadwords (a multiple of
+// ctx->mul_base_qwords), and c is of 2 * qwords_len quadwords.
+// The operands are split into a low part of half_qw_len quadwords
+// (see karatzuba_half_qwords) and a high part of the remaining
+// hi_qw_len <= half_qw_len quadwords. Hence, the recursion follows the real
+// size of the operands (R_QWORDS), instead of padding them to a power of 2.
+// The recursion stops at operands of up to KARATZUBA_FLAT_BLOCKS base
+// multiplications, which are multiplied by a flat schedule (karatzuba_flat).
 // A buffer sec_buf is used for storing temporary data between recursion calls.
 // It might contain secrets, and therefore should be securely cleaned after
 // completion.
@@ -26,7 +173,6 @@ _INLINE_ void karatzuba(OUT uint64_t *c,
                         IN const uint64_t *a,
                         IN const uint64_t *b,
                         IN const size_t    qwords_len,
-                        IN const size_t    qwords_len_pad,
                         uint64_t *         sec_buf,
                         IN const gf2x_ctx *ctx)
 {
@@ -35,20 +181,33 @@ _INLINE_ void karatzuba(OUT uint64_t *c,
     return;
   }
 
-  const size_t half_qw_len = qwords_len_pad >> 1;
+  if(qwords_len <= (KARATZUBA_FLAT_BLOCKS * ctx->mul_base_qwords)) {
+    switch(qwords_len / ctx->mul_base_qwords) {
+      case 2: karatzuba_flat2(c, a, b, sec_buf, ctx); break;
+      case 3: karatzuba_flat3(c, a, b, sec_buf, ctx); break;
+      default: karatzuba_flat4(c, a, b, sec_buf, ctx); break;
+    }
+    return;
+  }
 
-  // Split a and b into low and high parts of size n_padded/2
+  const size_t half_qw_len =
+    karatzuba_half_qwords(qwords_len, ctx->mul_base_qwords);
+  const size_t hi_qw_len = qwords_len - half_qw_len;
+
+  // Split a and b into low parts of half_qw_len quadwords
+  // and high parts of hi_qw_len quadwords
   const uint64_t *a_lo = a;
   const uint64_t *b_lo = b;
   const uint64_t *a_hi = &a[half_qw_len];
   const uint64_t *b_hi = &b[half_qw_len];
 
-  // Split c into 4 parts of size n_padded/2 (the last ptr is not needed)
+  // Split c into 4 parts of half_qw_len quadwords (the last one, which is not
+  // needed, is of 2 * hi_qw_len - half_qw_len quadwords)
   uint64_t *c0 = c;
   uint64_t *c1 = &c[half_qw_len];
   uint64_t *c2 = &c[half_qw_len * 2];
 
-  // Allocate 3 ptrs of size n_padded/2  on sec_buf
+  // Allocate 3 ptrs of half_qw_len quadwords on sec_buf
   uint64_t *alah = sec_buf;
   uint64_t *blbh = &sec_buf[half_qw_len];
   uint64_t *tmp  = &sec_buf[half_qw_len * 2];
@@ -57,57 +216,193 @@ _INLINE_ void karatzuba(OUT uint64_t *c,
   sec_buf = &sec_buf[half_qw_len * 3];
 
   // Compute a_lo*b_lo and store the result in (c1|c0)
-  karatzuba(c0, a_lo, b_lo, half_qw_len, half_qw_len, sec_buf, ctx);
+  karatzuba(c0, a_lo, b_lo, half_qw_len, sec_buf, ctx);
 
-  // If the real number of digits n is less or equal to n_padded/2 then:
-  //     a_hi = 0 and b_hi = 0
-  // and
-  //     (a_hi|a_lo)*(b_hi|b_lo) = a_lo*b_lo
-  // so we can skip the remaining two multiplications
-  if(qwords_len > half_qw_len) {
-    // Compute a_hi*b_hi and store the result in (c3|c2)
-    karatzuba(c2, a_hi, b_hi, qwords_len - half_qw_len, half_qw_len, sec_buf,
-              ctx);
+  // Compute a_hi*b_hi and store the result in (c3|c2)
+  karatzuba(c2, a_hi, b_hi, hi_qw_len, sec_buf, ctx);
 
-    // Compute alah = (a_lo + a_hi) and blbh = (b_lo + b_hi)
-    ctx->karatzuba_add1(alah, blbh, a, b, half_qw_len);
+  // Compute alah = (a_lo + a_hi) and blbh = (b_lo + b_hi)
+  ctx->karatzuba_add1(alah, blbh, a, b, half_qw_len, hi_qw_len);
 
-    // Compute (c1 + c2) and store the result in tmp
-    ctx->karatzuba_add2(tmp, c1, c2, half_qw_len);
+  // Compute (c1 + c2) and store the result in tmp
+  ctx->karatzuba_add2(tmp, c1, c2, half_qw_len);
 
-    // Compute alah*blbh and store the result in (c2|c1)
-    karatzuba(c1, alah, blbh, half_qw_len, half_qw_len, sec_buf, ctx);
+  // Compute alah*blbh and store the result in (c2|c1)
+  karatzuba(c1, alah, blbh, half_qw_len, sec_buf, ctx);
 
-    // Add (tmp|tmp) and (c3|c0) to (c2|c1)
-    ctx->karatzuba_add3(c0, tmp, half_qw_len);
+  // Add (tmp|tmp) and (c3|c0) to (c2|c1)
+  ctx->karatzuba_add3(c0, tmp, half_qw_len, (2 * hi_qw_len) - half_qw_len);
+}
+
+#if defined(INTRA_OP_PARALLEL)
+// The top level of karatzuba with its three sub-multiplications as tasks of
+// par_run. They are independent when the middle product is written to
+// ws->par_mid, instead of to (c2|c1), and every task has its own secure
+// buffer. The combination is then the same as in karatzuba.
+typedef struct karatzuba_par_s {
+  uint64_t *        c;
+  const uint64_t *  a;
+  const uint64_t *  b;
+  size_t            half_qw_len;
+  size_t            hi_qw_len;
+  gf2x_dense_ws_t * ws;
+  const gf2x_ctx *  ctx;
+} karatzuba_par_t;
+
+static void karatzuba_par_task(IN OUT void *arg, IN const size_t task)
+{
+  const karatzuba_par_t *p   = (const karatzuba_par_t *)arg;
+  const size_t           h   = p->half_qw_len;
+  uint64_t *             buf = p->ws->secure_buffer;
+
+  switch(task) {
+    case 0:
+      // Compute a_lo*b_lo and store the result in (c1|c0)
+      karatzuba(p->c, p->a, p->b, h, &buf[h * 3], p->ctx);
+      break;
+    case 1:
+      // Compute a_hi*b_hi and store the result in (c3|c2)
+      karatzuba(&p->c[h * 2], &p->a[h], &p->b[h], p->hi_qw_len,
+                p->ws->par_buffer[0], p->ctx);
+      break;
+    default:
+      // Compute alah*blbh and store the result in par_mid
+      p->ctx->karatzuba_add1(buf, &buf[h], p->a, p->b, h, p->hi_qw_len);
+      karatzuba(p->ws->par_mid, buf, &buf[h], h, p->ws->par_buffer[1], p->ctx);
+      break;
   }
 }
 
+_INLINE_ void karatzuba_par(OUT uint64_t *c,
+                            IN const uint64_t *a,
+                            IN const uint64_t *b,
+                            IN const size_t    qwords_len,
+                            IN OUT gf2x_dense_ws_t *ws,
+                            IN const gf2x_ctx *ctx)
+{
+  if(qwords_len <= (KARATZUBA_FLAT_BLOCKS * ctx->mul_base_qwords)) {
+    karatzuba(c, a, b, qwords_len, ws->secure_buffer, ctx);
+    return;
+  }
+
+  const size_t h = karatzuba_half_qwords(qwords_len, ctx->mul_base_qwords);
+  karatzuba_par_t p = {c, a, b, h, qwords_len - h, ws, ctx};
+
+  assert(2 * h <= (sizeof(ws->par_mid) / sizeof(uint64_t)));
+
+  par_run(karatzuba_par_task, &p, 3);
+
+  // Compute (c1 + c2) and store the result in tmp, and move the middle
+  // product to (c2|c1)
+  uint64_t *tmp = &ws->secure_buffer[h * 2];
+  ctx->karatzuba_add2(tmp, &c[h], &c[h * 2], h);
+  bike_memcpy(&c[h], ws->par_mid, 2 * h * sizeof(uint64_t));
+
+  // Add (tmp|tmp) and (c3|c0) to (c2|c1)
+  ctx->karatzuba_add3(c, tmp, h, (2 * p.hi_qw_len) - h);
+}
+#endif
+
 void gf2x_mod_mul_with_ctx(OUT pad_r_t *c,
                            IN const pad_r_t *a,
                            IN const pad_r_t *b,
+                           OUT gf2x_dense_ws_t *ws,
                            IN const gf2x_ctx *ctx)
 {
   bike_static_assert((R_PADDED_BYTES % 2 == 0), karatzuba_n_is_odd);
 
-  DEFER_CLEANUP(dbl_pad_r_t t = {0}, dbl_pad_r_cleanup);
-  ALIGN(ALIGN_BYTES) uint64_t secure_buffer[SECURE_BUFFER_QWORDS];
+  PROFILE_BEGIN(BIKE_PROFILE_GF2X_MOD_MUL);
+
+  assert(karatzuba_buffer_qwords(ctx->mul_qwords, ctx->mul_base_qwords) <=
+         SECURE_BUFFER_QWORDS);
+
+  // karatzuba writes the 2 * ctx->mul_qwords lower quadwords of the product,
+  // the upper quadwords of t are zero.
+  uint64_t *t = (uint64_t *)&ws->t;
+  bike_memset(&t[2 * ctx->mul_qwords], 0,
+              sizeof(ws->t) - (2 * ctx->mul_qwords * sizeof(uint64_t)));
 
-  karatzuba((uint64_t *)&t, (const uint64_t *)a, (const uint64_t *)b, R_QWORDS,
-            R_PADDED_QWORDS, secure_buffer, ctx);
+#if defined(INTRA_OP_PARALLEL)
+  karatzuba_par(t, (const uint64_t *)a, (const uint64_t *)b, ctx->mul_qwords,
+                ws, ctx);
+#else
+  karatzuba(t, (const uint64_t *)a, (const uint64_t *)b, ctx->mul_qwords,
+            ws->secure_buffer, ctx);
+#endif
 
-  ctx->red(c, &t);
+  ctx->red(c, &ws->t);
 
-  secure_clean((uint8_t *)secure_buffer, sizeof(secure_buffer));
+  PROFILE_END(BIKE_PROFILE_GF2X_MOD_MUL);
+}
+
+void gf2x_mod_mul_ws(OUT pad_r_t *c,
+                     IN const pad_r_t *a,
+                     IN const pad_r_t *b,
+                     IN OUT gf2x_mul_ws_t *ws)
+{
+  gf2x_mod_mul_with_ctx(c, a, b, &ws->u.dense, &get_dispatch_ctx()->gf2x);
 }
 
 void gf2x_mod_mul(OUT pad_r_t *c, IN const pad_r_t *a, IN const pad_r_t *b)
 {
-  bike_static_assert((R_PADDED_BYTES % 2 == 0), karatzuba_n_is_odd);
+  DEFER_CLEANUP(gf2x_dense_ws_t ws, gf2x_dense_ws_cleanup);
+
+  gf2x_mod_mul_with_ctx(c, a, b, &ws, &get_dispatch_ctx()->gf2x);
+}
 
-  // Initialize gf2x methods struct
-  gf2x_ctx ctx;
-  gf2x_ctx_init(&ctx);
+void gf2x_mod_mul_sparse_with_ctx(OUT pad_r_t *c,
+                                  IN const pad_r_t *a,
+                                  IN const idx_t *wlist,
+                                  IN const size_t w,
+                                  OUT gf2x_sparse_ws_t *ws,
+                                  IN const gf2x_ctx *ctx)
+{
+  ctx->mul_sparse(c, a, wlist, w, ws);
+}
+
+// With clean, only the member of ws that the multiplication used is cleaned
+// (the other one was not touched).
+_INLINE_ void mul_sparse(OUT pad_r_t *c,
+                         IN const pad_r_t *a,
+                         IN const pad_r_t *b,
+                         IN const idx_t *wlist,
+                         IN const size_t w,
+                         IN OUT gf2x_mul_ws_t *ws,
+                         IN const int          clean)
+{
+  const gf2x_ctx *ctx = &get_dispatch_ctx()->gf2x;
+
+  // The choice depends only on the (public) weight and the CPU features
+  if(w <= ctx->mul_sparse_max_w) {
+    gf2x_mod_mul_sparse_with_ctx(c, a, wlist, w, &ws->u.sparse, ctx);
+    if(clean) {
+      gf2x_sparse_ws_cleanup(&ws->u.sparse);
+    }
+  } else {
+    gf2x_mod_mul_with_ctx(c, a, b, &ws->u.dense, ctx);
+    if(clean) {
+      gf2x_dense_ws_cleanup(&ws->u.dense);
+    }
+  }
+}
+
+void gf2x_mod_mul_sparse_ws(OUT pad_r_t *c,
+                            IN const pad_r_t *a,
+                            IN const pad_r_t *b,
+                            IN const idx_t *wlist,
+                            IN const size_t w,
+                            IN OUT gf2x_mul_ws_t *ws)
+{
+  mul_sparse(c, a, b, wlist, w, ws, 0);
+}
+
+void gf2x_mod_mul_sparse(OUT pad_r_t *c,
+                         IN const pad_r_t *a,
+                         IN const pad_r_t *b,
+                         IN const idx_t *wlist,
+                         IN const size_t w)
+{
+  gf2x_mul_ws_t ws;
 
-  gf2x_mod_mul_with_ctx(c, a, b, &ctx);
+  mul_sparse(c, a, b, wlist, w, &ws, 1);
 }
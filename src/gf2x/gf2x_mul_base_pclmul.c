@@ -7,6 +7,7 @@
 
 #include <immintrin.h>
 
+#include "cleanup.h"
 #include "gf2x_internal.h"
 
 #define LOAD128(mem)       _mm_loadu_si128((const void *)(mem))
@@ -16,6 +17,8 @@
 #define CLMUL(x, y, imm)   _mm_clmulepi64_si128((x), (y), (imm))
 #define BSRLI(x, imm)      _mm_bsrli_si128((x), (imm))
 #define BSLLI(x, imm)      _mm_bslli_si128((x), (imm))
+#define SLLI_I64(x, imm)   _mm_slli_epi64((x), (imm))
+#define SRLI_I64(x, imm)   _mm_srli_epi64((x), (imm))
 
 // 4x4 Karatsuba multiplication
 _INLINE_ void gf2x_mul4_int(OUT __m128i      c[4],
@@ -130,20 +133,52 @@ void gf2x_mul_base_pclmul(OUT uint64_t *c,
   STORE128(&c[7 * QWORDS_IN_XMM], hi[3]);
 }
 
-void gf2x_sqr_pclmul(OUT dbl_pad_r_t *c, IN const pad_r_t *a)
+// The square of the quadword k of a (zero for k >= R_QWORDS),
+// that is, the quadwords 2k and 2k + 1 of a^2
+_INLINE_ __m128i sqr_qword(IN const uint64_t *a64, IN const size_t k)
 {
-  __m128i va, vr0, vr1;
+  if(k >= R_QWORDS) {
+    return _mm_setzero_si128();
+  }
+
+  const __m128i va = _mm_loadl_epi64((const void *)&a64[k]);
+  return CLMUL(va, va, 0x00);
+}
 
+// c = a^2 mod (x^r - 1), where c and a do not overlap.
+// The square is reduced while it is computed, without storing it: the
+// quadwords i and i + 1 of c are the quadwords i, i + 1 of the square, and its
+// quadwords j, ..., j + 2 (for j = i + R_QWORDS - 1) shifted by R_BITS % 64.
+void gf2x_mod_sqr_pclmul(OUT pad_r_t *c, IN const pad_r_t *a)
+{
   const uint64_t *a64 = (const uint64_t *)a;
   uint64_t *      c64 = (uint64_t *)c;
 
-  for(size_t i = 0; i < (R_XMM * QWORDS_IN_XMM); i += QWORDS_IN_XMM) {
-    va = LOAD128(&a64[i]);
+  // j = 2k + (R_QWORDS - 1) % 2, where hi0 holds the quadwords 2k and 2k + 1
+  size_t  k   = (R_QWORDS - 1) / 2;
+  __m128i hi0 = sqr_qword(a64, k);
+  __m128i hi1, mid, w0, w1;
+
+  for(size_t i = 0; i < R_QWORDS; i += QWORDS_IN_XMM) {
+    const __m128i lo = sqr_qword(a64, i / 2);
 
-    vr0 = CLMUL(va, va, 0x00);
-    vr1 = CLMUL(va, va, 0x11);
+    hi1 = sqr_qword(a64, k + 1);
+    mid = BSRLI(hi0, 8) | BSLLI(hi1, 8);
 
-    STORE128(&c64[i * 2], vr0);
-    STORE128(&c64[i * 2 + QWORDS_IN_XMM], vr1);
+    // w0 = (quadwords j, j + 1) and w1 = (quadwords j + 1, j + 2)
+    w0 = (((R_QWORDS - 1) % 2) == 0) ? hi0 : mid;
+    w1 = (((R_QWORDS - 1) % 2) == 0) ? mid : hi1;
+
+    STORE128(&c64[i], lo ^ SRLI_I64(w0, LAST_R_QWORD_LEAD) ^
+                        SLLI_I64(w1, LAST_R_QWORD_TRAIL));
+
+    hi0 = hi1;
+    k++;
   }
+
+  c64[R_QWORDS - 1] &= LAST_R_QWORD_MASK;
+
+  // Clean the secrets from the upper part of c
+  secure_clean((uint8_t *)&c64[R_QWORDS],
+               (R_PADDED_QWORDS - R_QWORDS) * sizeof(uint64_t));
 }
@@ -5,6 +5,7 @@
  * AWS Cryptographic Algorithms Group.
  */
 
+#include "cleanup.h"
 #include "gf2x_internal.h"
 #include "utilities.h"
 
@@ -66,12 +67,43 @@ void gf2x_mul_base_port(OUT uint64_t *c,
 }
 
 // c = a^2
-void gf2x_sqr_port(OUT dbl_pad_r_t *c, IN const pad_r_t *a)
+// The bits of the lower 32 bits of x, interleaved with zeros
+// (the square of the lower 32 bits of x)
+_INLINE_ uint64_t spread32(IN const uint64_t x)
+{
+  uint64_t v = x & MASK(32);
+
+  v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+  v = (v | (v << 8)) & 0x00ff00ff00ff00ffULL;
+  v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  v = (v | (v << 2)) & 0x3333333333333333ULL;
+  v = (v | (v << 1)) & 0x5555555555555555ULL;
+
+  return v;
+}
+
+// c = a^2 mod (x^r - 1), where c and a do not overlap.
+// The quadword j of the (unreduced) square is the spread of the j-th half of a.
+// Therefore, the square is reduced while it is computed, without storing it.
+void gf2x_mod_sqr_port(OUT pad_r_t *c, IN const pad_r_t *a)
 {
   const uint64_t *a64 = (const uint64_t *)a;
   uint64_t *      c64 = (uint64_t *)c;
 
   for(size_t i = 0; i < R_QWORDS; i++) {
-    gf2x_mul_base_port(&c64[2 * i], &a64[i], &a64[i]);
+    // The quadwords j and j + 1 of the square are folded into quadword i
+    const size_t j = i + R_QWORDS - 1;
+
+    const uint64_t lo  = spread32(a64[i / 2] >> (32 * (i % 2)));
+    const uint64_t hi0 = spread32(a64[j / 2] >> (32 * (j % 2)));
+    const uint64_t hi1 = spread32(a64[(j + 1) / 2] >> (32 * ((j + 1) % 2)));
+
+    c64[i] = lo ^ (hi0 >> LAST_R_QWORD_LEAD) ^ (hi1 << LAST_R_QWORD_TRAIL);
   }
+
+  c64[R_QWORDS - 1] &= LAST_R_QWORD_MASK;
+
+  // Clean the secrets from the upper part of c
+  secure_clean((uint8_t *)&c64[R_QWORDS],
+               (R_PADDED_QWORDS - R_QWORDS) * sizeof(uint64_t));
 }
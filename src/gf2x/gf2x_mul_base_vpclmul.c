@@ -5,6 +5,7 @@
  * AWS Cryptographic Algorithms Group.
  */
 
+#include "cleanup.h"
 #include "gf2x_internal.h"
 
 #define AVX512_INTERNAL
@@ -107,23 +108,63 @@ void gf2x_mul_base_vpclmul(OUT uint64_t *c,
   STORE(&c[3 * QWORDS_IN_ZMM], hi[1]);
 }
 
-void gf2x_sqr_vpclmul(OUT dbl_pad_r_t *c, IN const pad_r_t *a)
+// The squares of the quadwords k, ..., k + 7 of a (zero from R_QWORDS on),
+// that is, the quadwords 2k, ..., 2k + 15 of a^2, in s[0] and s[1]
+_INLINE_ void sqr_zmm(OUT __m512i s[2], IN const uint64_t *a64, IN const size_t k)
 {
-  __m512i va, vm, vr0, vr1;
+  const __m512i vm = SET_I64(7, 3, 6, 2, 5, 1, 4, 0);
+  __m512i       va = SET_ZERO;
 
+  if((k + QWORDS_IN_ZMM) <= R_QWORDS) {
+    va = LOAD(&a64[k]);
+  } else if(k < R_QWORDS) {
+    va = MLOAD64(&a64[k], (__mmask8)MASK(R_QWORDS - k));
+  }
+
+  va   = PERMXVAR_I64(vm, va);
+  s[0] = CLMUL(va, va, 0x00);
+  s[1] = CLMUL(va, va, 0x11);
+}
+
+// c = a^2 mod (x^r - 1), where c and a do not overlap.
+// The square is reduced while it is computed, without storing it: the
+// quadwords i, ..., i + 15 of c are the quadwords i, ..., i + 15 of the square,
+// and its quadwords j, ..., j + 16 (for j = i + R_QWORDS - 1) shifted by
+// R_BITS % 64.
+void gf2x_mod_sqr_vpclmul(OUT pad_r_t *c, IN const pad_r_t *a)
+{
   const uint64_t *a64 = (const uint64_t *)a;
   uint64_t *      c64 = (uint64_t *)c;
 
-  vm = SET_I64(7, 3, 6, 2, 5, 1, 4, 0);
+  __m512i lo[2], hi[4], w0, w1;
 
-  for(size_t i = 0; i < (R_ZMM * QWORDS_IN_ZMM); i += QWORDS_IN_ZMM) {
-    va = LOAD(&a64[i]);
-    va = PERMXVAR_I64(vm, va);
+  // j = 2k + (R_QWORDS - 1) % 2, where hi[0] and hi[1] hold the quadwords
+  // 2k, ..., 2k + 15 of the square
+  size_t k = (R_QWORDS - 1) / 2;
+  sqr_zmm(hi, a64, k);
 
-    vr0 = CLMUL(va, va, 0x00);
-    vr1 = CLMUL(va, va, 0x11);
+  for(size_t i = 0; i < R_QWORDS; i += 2 * QWORDS_IN_ZMM) {
+    sqr_zmm(lo, a64, i / 2);
+    sqr_zmm(&hi[2], a64, k + QWORDS_IN_ZMM);
 
-    STORE(&c64[i * 2], vr0);
-    STORE(&c64[i * 2 + QWORDS_IN_ZMM], vr1);
+    for(size_t l = 0; l < 2; l++) {
+      // w0 = (quadwords j, ..., j + 7) and w1 = (quadwords j + 1, ..., j + 8)
+      w0 = VALIGN(hi[l + 1], hi[l], (R_QWORDS - 1) % 2);
+      w1 = VALIGN(hi[l + 1], hi[l], ((R_QWORDS - 1) % 2) + 1);
+
+      STORE(&c64[i + (l * QWORDS_IN_ZMM)],
+            lo[l] ^ SRLI_I64(w0, LAST_R_QWORD_LEAD) ^
+              SLLI_I64(w1, LAST_R_QWORD_TRAIL));
+    }
+
+    hi[0] = hi[2];
+    hi[1] = hi[3];
+    k += QWORDS_IN_ZMM;
   }
+
+  c64[R_QWORDS - 1] &= LAST_R_QWORD_MASK;
+
+  // Clean the secrets from the upper part of c
+  secure_clean((uint8_t *)&c64[R_QWORDS],
+               (R_PADDED_QWORDS - R_QWORDS) * sizeof(uint64_t));
 }
@@ -8,22 +8,30 @@
 #include <assert.h>
 
 #include "cleanup.h"
+#include "decode_internal.h"
 #include "gf2x_internal.h"
 
 #define PORTABLE_INTERNAL
 #include "x86_64_intrinsic.h"
 
+// alah = a_lo + a_hi and blbh = b_lo + b_hi, where the low parts are of
+// qwords_len quadwords and the high parts are of hi_qwords_len <= qwords_len
+// quadwords (padded with zeros to qwords_len quadwords)
 void karatzuba_add1_port(OUT uint64_t *alah,
                          OUT uint64_t *blbh,
                          IN const uint64_t *a,
                          IN const uint64_t *b,
-                         IN const size_t    qwords_len)
+                         IN const size_t    qwords_len,
+                         IN const size_t    hi_qwords_len)
 {
   assert(qwords_len % REG_QWORDS == 0);
+  assert(hi_qwords_len % REG_QWORDS == 0);
+  assert(hi_qwords_len <= qwords_len);
 
   REG_T va0, va1, vb0, vb1;
 
-  for(size_t i = 0; i < qwords_len; i += REG_QWORDS) {
+  size_t i = 0;
+  for(; i < hi_qwords_len; i += REG_QWORDS) {
     va0 = LOAD(&a[i]);
     va1 = LOAD(&a[i + qwords_len]);
     vb0 = LOAD(&b[i]);
@@ -32,6 +40,11 @@ void karatzuba_add1_port(OUT uint64_t *alah,
     STORE(&alah[i], va0 ^ va1);
     STORE(&blbh[i], vb0 ^ vb1);
   }
+
+  for(; i < qwords_len; i += REG_QWORDS) {
+    STORE(&alah[i], LOAD(&a[i]));
+    STORE(&blbh[i], LOAD(&b[i]));
+  }
 }
 
 void karatzuba_add2_port(OUT uint64_t *z,
@@ -51,11 +64,17 @@ void karatzuba_add2_port(OUT uint64_t *z,
   }
 }
 
+// Add (mid|mid) and (c3|c0) to (c2|c1), where c0, c1, c2 and mid are of
+// qwords_len quadwords, and c3 is of hi_qwords_len <= qwords_len quadwords
+// (padded with zeros to qwords_len quadwords)
 void karatzuba_add3_port(OUT uint64_t *c,
                          IN const uint64_t *mid,
-                         IN const size_t    qwords_len)
+                         IN const size_t    qwords_len,
+                         IN const size_t    hi_qwords_len)
 {
   assert(qwords_len % REG_QWORDS == 0);
+  assert(hi_qwords_len % REG_QWORDS == 0);
+  assert(hi_qwords_len <= qwords_len);
 
   REG_T vr0, vr1, vr2, vr3, vt;
 
@@ -64,7 +83,8 @@ void karatzuba_add3_port(OUT uint64_t *c,
   uint64_t *c2 = &c[2 * qwords_len];
   uint64_t *c3 = &c[3 * qwords_len];
 
-  for(size_t i = 0; i < qwords_len; i += REG_QWORDS) {
+  size_t i = 0;
+  for(; i < hi_qwords_len; i += REG_QWORDS) {
     vr0 = LOAD(&c0[i]);
     vr1 = LOAD(&c1[i]);
     vr2 = LOAD(&c2[i]);
@@ -74,6 +94,44 @@ void karatzuba_add3_port(OUT uint64_t *c,
     STORE(&c1[i], vt ^ vr0 ^ vr1);
     STORE(&c2[i], vt ^ vr2 ^ vr3);
   }
+
+  for(; i < qwords_len; i += REG_QWORDS) {
+    vr0 = LOAD(&c0[i]);
+    vr1 = LOAD(&c1[i]);
+    vr2 = LOAD(&c2[i]);
+    vt  = LOAD(&mid[i]);
+
+    STORE(&c1[i], vt ^ vr0 ^ vr1);
+    STORE(&c2[i], vt ^ vr2);
+  }
+}
+
+// Add (c3|c0), (c2|c1) and (m1|m0) to (c2|c1), where c0, c1, c2, c3 are of
+// qwords_len quadwords and mid = (m1|m0) is of 2 * qwords_len quadwords
+// (the additions of karatzuba_add2 and karatzuba_add3 in a single pass)
+void karatzuba_add23_port(OUT uint64_t *c,
+                          IN const uint64_t *mid,
+                          IN const size_t    qwords_len)
+{
+  assert(qwords_len % REG_QWORDS == 0);
+
+  REG_T vr0, vr1, vr2, vr3, vt;
+
+  uint64_t *c0 = c;
+  uint64_t *c1 = &c[qwords_len];
+  uint64_t *c2 = &c[2 * qwords_len];
+  uint64_t *c3 = &c[3 * qwords_len];
+
+  for(size_t i = 0; i < qwords_len; i += REG_QWORDS) {
+    vr0 = LOAD(&c0[i]);
+    vr1 = LOAD(&c1[i]);
+    vr2 = LOAD(&c2[i]);
+    vr3 = LOAD(&c3[i]);
+    vt  = vr1 ^ vr2;
+
+    STORE(&c1[i], vt ^ vr0 ^ LOAD(&mid[i]));
+    STORE(&c2[i], vt ^ vr3 ^ LOAD(&mid[i + qwords_len]));
+  }
 }
 
 // c = a mod (x^r - 1)
@@ -101,3 +159,42 @@ void gf2x_red_port(OUT pad_r_t *c, IN const dbl_pad_r_t *a)
   secure_clean((uint8_t *)&c64[R_QWORDS],
                (R_PADDED_QWORDS - R_QWORDS) * sizeof(uint64_t));
 }
+
+// c = a*b mod (x^r - 1), where b has w set bits at the positions wlist.
+// c is the sum of the rotations of a by every index of wlist, using the
+// constant-time rotation of the decoder.
+void gf2x_mod_mul_sparse_port(OUT pad_r_t *c,
+                              IN const pad_r_t *a,
+                              IN const idx_t *wlist,
+                              IN const size_t w,
+                              OUT gf2x_sparse_ws_t *ws)
+{
+  bike_static_assert(sizeof(syndrome_t) >= sizeof(pad_r_t), syndrome_too_small);
+
+  syndrome_t *s         = &ws->s;
+  syndrome_t *rotated_s = &ws->rotated_s;
+  uint64_t *  c64       = (uint64_t *)c;
+
+  bike_memset(ws, 0, sizeof(*ws));
+  bike_memcpy((uint8_t *)s->qw, a->val.raw, R_BYTES);
+  dup_port(s);
+
+  bike_memset(c, 0, sizeof(*c));
+
+  for(size_t j = 0; j < w; j++) {
+    rotate_right_port(rotated_s, s, sparse_rotation_bits(wlist[j]));
+
+    for(size_t i = 0; i < R_QWORDS; i += REG_QWORDS) {
+      REG_T vc = LOAD(&c64[i]);
+      REG_T vs = LOAD(&rotated_s->qw[i]);
+
+      STORE(&c64[i], vc ^ vs);
+    }
+  }
+
+  c64[R_QWORDS - 1] &= LAST_R_QWORD_MASK;
+
+  // Clean the secrets from the upper part of c
+  secure_clean((uint8_t *)&c64[R_QWORDS],
+               (R_PADDED_QWORDS - R_QWORDS) * sizeof(uint64_t));
+}
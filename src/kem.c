@@ -6,11 +6,80 @@
  */
 
 #include "kem.h"
+#include "kem_internal.h"
+#include "dec_stages.h"
 #include "decode.h"
 #include "gf2x.h"
+#include "profile.h"
 #include "sampling.h"
 #include "sha.h"
 
+#if defined(BIKE_NAMESPACE)
+#  include "bike_multi_level.h"
+#endif
+
+// The scratch memory of the KEM operations. All the temporary values whose
+// size depends on R are kept in the workspace of the operation (the digests,
+// seeds, hash contexts and PRF states, of a few hundred bytes, are kept on the
+// stack). The functions H, L and K hash their inputs incrementally from where
+// they are, without copying them to a contiguous buffer.
+
+typedef struct keypair_ws_s {
+  aligned_sk_t l_sk;
+  seeds_t      seeds;
+  pad_r_t      h0;
+  pad_r_t      h1;
+  pad_r_t      h0inv;
+  union {
+    gf2x_inv_ws_t inv;
+    gf2x_mul_ws_t mul;
+  } u;
+
+  // Public data (not cleaned)
+  pad_r_t h;
+} keypair_ws_t;
+
+typedef struct enc_ws_s {
+  m_t           m;
+  ss_t          l_ss;
+  seeds_t       seeds;
+  pad_e_t       e;
+  gf2x_mul_ws_t mul;
+
+  // Public data (not cleaned)
+  bike_ct_view_t l_ct;
+} enc_ws_t;
+
+typedef struct dec_ws_s {
+  ss_t        l_ss;
+  e_t         e;
+  m_t         m_prime;
+  pad_e_t     e_prime;
+  pad_e_t     e_tmp;
+  decode_ws_t decode;
+
+  // Public data (not cleaned)
+  bike_ct_view_t l_ct;
+} dec_ws_t;
+
+CLEANUP_FUNC_SECRET_PREFIX(keypair_ws, keypair_ws_t, h)
+CLEANUP_FUNC_SECRET_PREFIX(enc_ws, enc_ws_t, l_ct)
+CLEANUP_FUNC_SECRET_PREFIX(dec_ws, dec_ws_t, l_ct)
+
+struct bike_workspace_s {
+  union {
+    keypair_ws_t keypair;
+    struct {
+      bike_enc_key_t key;
+      enc_ws_t       ws;
+    } enc;
+    struct {
+      bike_dec_key_t key;
+      dec_ws_t       ws;
+    } dec;
+  } u;
+};
+
 // m_t and seed_t have the same size and thus can be considered
 // to be of the same type. However, for security reasons we distinguish
 // these types, even on the costs of small extra complexity.
@@ -37,30 +106,66 @@ _INLINE_ void convert_m_to_seed_type(OUT seed_t *seed, IN const m_t *m)
 
 #endif
 
-// (e0, e1) = H(m)
-_INLINE_ ret_t function_h(OUT pad_e_t *e, IN const m_t *m, IN const pk_t *pk)
+// The input of H besides m: the hash state after absorbing pk when it is
+// saved in the keys, and pk otherwise.
+#if defined(BIKE_PK_HASH_CACHED)
+typedef sha_ctx_t h_prefix_t;
+#  define ENC_KEY_H_PREFIX(key) (&(key)->pk_hash)
+#  define DEC_KEY_H_PREFIX(key) (&(key)->pk_hash)
+#else
+typedef pk_t h_prefix_t;
+#  define ENC_KEY_H_PREFIX(key) (&(key)->view.pk.val)
+#  define DEC_KEY_H_PREFIX(key) (&(key)->sk.pk)
+#endif
+
+#if defined(BIKE_PK_HASH_CACHED)
+// Save the hash state after absorbing pk into pk_hash
+_INLINE_ ret_t init_pk_hash(OUT sha_ctx_t *pk_hash, IN const pk_t *pk)
 {
-  DEFER_CLEANUP(seed_t seed = {0}, seed_cleanup);
+  GUARD(sha_init(pk_hash));
+  return sha_absorb(pk_hash, pk->raw, sizeof(*pk));
+}
+#endif
 
+// The seed of the error vector of H(m)
+_INLINE_ ret_t function_h_seed(OUT seed_t *seed,
+                               IN const m_t *m,
+                               IN const h_prefix_t *prefix)
+{
 #if defined(BIND_PK_AND_M)
-  DEFER_CLEANUP(sha_dgst_t  dgst = {0}, sha_dgst_cleanup);
-  DEFER_CLEANUP(pk_m_bind_t pk_m = {0}, pk_m_bind_cleanup);
-
-  // Coppy the public key and the message to a temporary buffer
-  pk_m.pk = *pk;
-  pk_m.m  = *m;
+  DEFER_CLEANUP(sha_dgst_t dgst = {0}, sha_dgst_cleanup);
+  DEFER_CLEANUP(sha_ctx_t ctx = {0}, sha_ctx_cleanup);
 
   // Hash the binded pk and m
-  GUARD(sha(&dgst, sizeof(pk_m), (uint8_t *)&pk_m));
-
-  convert_dgst_to_seed_type(&seed, &dgst);
+#  if defined(BIKE_PK_HASH_CACHED)
+  ctx = *prefix;
+#  else
+  GUARD(sha_init(&ctx));
+  GUARD(sha_absorb(&ctx, prefix->raw, sizeof(*prefix)));
+#  endif
+  GUARD(sha_absorb(&ctx, m->raw, sizeof(*m)));
+  GUARD(sha_final(&dgst, &ctx));
+
+  convert_dgst_to_seed_type(seed, &dgst);
 #else
-  // pk is unused parameter in this case so we do this to avoid
+  // prefix is an unused parameter in this case so we do this to avoid
   // clang sanitizers complaining.
-  (void)pk;
+  (void)prefix;
 
-  convert_m_to_seed_type(&seed, m);
+  convert_m_to_seed_type(seed, m);
 #endif
+  return SUCCESS;
+}
+
+// (e0, e1) = H(m)
+_INLINE_ ret_t function_h(OUT pad_e_t *e,
+                          IN const m_t *m,
+                          IN const h_prefix_t *prefix)
+{
+  DEFER_CLEANUP(seed_t seed = {0}, seed_cleanup);
+
+  GUARD(function_h_seed(&seed, m, prefix));
+
   return generate_error_vector(e, &seed);
 }
 
@@ -68,13 +173,13 @@ _INLINE_ ret_t function_h(OUT pad_e_t *e, IN const m_t *m, IN const pk_t *pk)
 _INLINE_ ret_t function_l(OUT m_t *out, IN const pad_e_t *e)
 {
   DEFER_CLEANUP(sha_dgst_t dgst = {0}, sha_dgst_cleanup);
-  DEFER_CLEANUP(e_t tmp, e_cleanup);
-
-  // Take the padding away
-  tmp.val[0] = e->val[0].val;
-  tmp.val[1] = e->val[1].val;
+  DEFER_CLEANUP(sha_ctx_t ctx = {0}, sha_ctx_cleanup);
 
-  GUARD(sha(&dgst, sizeof(tmp), (uint8_t *)&tmp));
+  // Hash e0 and e1 without their padding
+  GUARD(sha_init(&ctx));
+  GUARD(sha_absorb(&ctx, PE0_RAW(e), R_BYTES));
+  GUARD(sha_absorb(&ctx, PE1_RAW(e), R_BYTES));
+  GUARD(sha_final(&dgst, &ctx));
 
   // Truncate the SHA384 digest to a 256-bits m_t
   bike_static_assert(sizeof(dgst) >= sizeof(*out), dgst_size_lt_m_size);
@@ -84,17 +189,20 @@ _INLINE_ ret_t function_l(OUT m_t *out, IN const pad_e_t *e)
 }
 
 // Generate the Shared Secret K(m, c0, c1)
-_INLINE_ ret_t function_k(OUT ss_t *out, IN const m_t *m, IN const ct_t *ct)
+_INLINE_ ret_t function_k(OUT ss_t *out,
+                          IN const m_t *m,
+                          IN const r_t *c0,
+                          IN const m_t *c1)
 {
-  DEFER_CLEANUP(func_k_t tmp, func_k_cleanup);
   DEFER_CLEANUP(sha_dgst_t dgst = {0}, sha_dgst_cleanup);
+  DEFER_CLEANUP(sha_ctx_t ctx = {0}, sha_ctx_cleanup);
 
-  // Copy every element, padded to the nearest byte
-  tmp.m  = *m;
-  tmp.c0 = ct->c0;
-  tmp.c1 = ct->c1;
-
-  GUARD(sha(&dgst, sizeof(tmp), (uint8_t *)&tmp));
+  // Hash every element, padded to the nearest byte (as in func_k_t)
+  GUARD(sha_init(&ctx));
+  GUARD(sha_absorb(&ctx, m->raw, sizeof(*m)));
+  GUARD(sha_absorb(&ctx, c0->raw, sizeof(*c0)));
+  GUARD(sha_absorb(&ctx, c1->raw, sizeof(*c1)));
+  GUARD(sha_final(&dgst, &ctx));
 
   // Truncate the SHA384 digest to a 256-bits value
   // to subsequently use it as a seed.
@@ -104,22 +212,18 @@ _INLINE_ ret_t function_k(OUT ss_t *out, IN const m_t *m, IN const ct_t *ct)
   return SUCCESS;
 }
 
-_INLINE_ ret_t encrypt(OUT ct_t *ct,
+// The padding of ct->c0 is zero, as the padding of the reduced product and
+// of e0 is.
+_INLINE_ ret_t encrypt(OUT bike_ct_view_t *ct,
                        IN const pad_e_t *e,
-                       IN const pk_t *pk,
-                       IN const m_t *m)
+                       IN const pad_r_t *p_pk,
+                       IN const m_t *m,
+                       IN OUT enc_ws_t *ws)
 {
-  // Pad the public key and the ciphertext
-  pad_r_t p_ct = {0};
-  pad_r_t p_pk = {0};
-  p_pk.val     = *pk;
-
   // Generate the ciphertext
   // ct = pk * e1 + e0
-  gf2x_mod_mul(&p_ct, &e->val[1], &p_pk);
-  gf2x_mod_add(&p_ct, &p_ct, &e->val[0]);
-
-  ct->c0 = p_ct.val;
+  gf2x_mod_mul_ws(&ct->c0, &e->val[1], p_pk, &ws->mul);
+  gf2x_mod_add(&ct->c0, &ct->c0, &e->val[0]);
 
   // c1 = L(e0, e1)
   GUARD(function_l(&ct->c1, e));
@@ -131,13 +235,13 @@ _INLINE_ ret_t encrypt(OUT ct_t *ct,
 
   print("e0: ", (const uint64_t *)PE0_RAW(e), R_BITS);
   print("e1: ", (const uint64_t *)PE1_RAW(e), R_BITS);
-  print("c0:  ", (uint64_t *)ct->c0.raw, R_BITS);
+  print("c0:  ", (uint64_t *)ct->c0.val.raw, R_BITS);
   print("c1:  ", (uint64_t *)ct->c1.raw, M_BITS);
 
   return SUCCESS;
 }
 
-_INLINE_ ret_t reencrypt(OUT m_t *m, IN const pad_e_t *e, IN const ct_t *l_ct)
+_INLINE_ ret_t reencrypt(OUT m_t *m, IN const pad_e_t *e, IN const m_t *c1)
 {
   DEFER_CLEANUP(m_t tmp, m_cleanup);
 
@@ -145,58 +249,173 @@ _INLINE_ ret_t reencrypt(OUT m_t *m, IN const pad_e_t *e, IN const ct_t *l_ct)
 
   // m' = c1 ^ L(e')
   for(size_t i = 0; i < sizeof(*m); i++) {
-    m->raw[i] = tmp.raw[i] ^ l_ct->c1.raw[i];
+    m->raw[i] = tmp.raw[i] ^ c1->raw[i];
   }
 
   return SUCCESS;
 }
 
-////////////////////////////////////////////////////////////////////////////////
-// The three APIs below (keypair, encapsulate, decapsulate) are defined by NIST:
-////////////////////////////////////////////////////////////////////////////////
-int crypto_kem_keypair(OUT unsigned char *pk, OUT unsigned char *sk)
+// Generate the secret part (h0, h1, sigma) of a new key pair into ws->l_sk,
+// and set ws->h0 to the padded h0 (as required by the gf2x multiplication).
+_INLINE_ ret_t generate_sk(IN OUT keypair_ws_t *ws)
+{
+  aligned_sk_t *l_sk = &ws->l_sk;
+
+  // The randomness of the key generation
+  GUARD(get_seeds(&ws->seeds));
+  GUARD(generate_secret_key(&ws->h0, &ws->h1,
+                            l_sk->wlist[0].val, l_sk->wlist[1].val,
+                            &ws->seeds.seed[0]));
+
+  // Generate sigma
+  convert_seed_to_m_type(&l_sk->sigma, &ws->seeds.seed[1]);
+
+  // Fill the secret key data structure with contents - cancel the padding
+  l_sk->bin[0] = ws->h0.val;
+  l_sk->bin[1] = ws->h1.val;
+
+  return SUCCESS;
+}
+
+// Given ws->h0inv = h0^-1, calculate the public key h = (h0^-1 * h1) of the
+// key pair in ws->l_sk.
+_INLINE_ void compute_pk(IN OUT keypair_ws_t *ws)
+{
+  aligned_sk_t *l_sk = &ws->l_sk;
+
+  ws->h1.val = l_sk->bin[1];
+  gf2x_mod_mul_sparse_ws(&ws->h, &ws->h0inv, &ws->h1, l_sk->wlist[1].val, D,
+                         &ws->u.mul);
+  l_sk->pk = ws->h.val;
+}
+
+// Given ws->h0inv = h0^-1, calculate the public key of the key pair in
+// ws->l_sk, and copy the key pair to the output buffers pk and sk.
+_INLINE_ void complete_keypair(OUT unsigned char *pk,
+                               OUT unsigned char *sk,
+                               IN OUT keypair_ws_t *ws)
 {
-  DEFER_CLEANUP(aligned_sk_t l_sk = {0}, sk_cleanup);
+  aligned_sk_t *l_sk = &ws->l_sk;
 
+  compute_pk(ws);
+
+  // Copy the data to the output buffers
+  bike_memcpy(sk, l_sk, sizeof(*l_sk));
+  bike_memcpy(pk, &l_sk->pk, sizeof(l_sk->pk));
+
+  print("h:  ", (uint64_t *)&l_sk->pk, R_BITS);
+  print("h0: ", (uint64_t *)&l_sk->bin[0], R_BITS);
+  print("h1: ", (uint64_t *)&l_sk->bin[1], R_BITS);
+  print("h0 wlist:", (uint64_t *)&l_sk->wlist[0], SIZEOF_BITS(compressed_idx_d_t));
+  print("h1 wlist:", (uint64_t *)&l_sk->wlist[1], SIZEOF_BITS(compressed_idx_d_t));
+  print("sigma: ", (uint64_t *)l_sk->sigma.raw, M_BITS);
+}
+
+// The values of ws (except for the gf2x scratch memory) start from zero,
+// in particular the padding of the polynomials.
+_INLINE_ void keypair_ws_init(OUT keypair_ws_t *ws)
+{
+  bike_memset(ws, 0, offsetof(keypair_ws_t, u));
+  bike_memset(&ws->h, 0, sizeof(ws->h));
+}
+
+_INLINE_ ret_t keypair(OUT unsigned char *pk,
+                       OUT unsigned char *sk,
+                       IN const gf2x_ksqr_maps_t *maps,
+                       IN OUT keypair_ws_t *ws)
+{
   // The secret key is (h0, h1),
   // and the public key h=(h0^-1 * h1).
   // Padded structures are used internally, and are required by the
   // decoder and the gf2x multiplication.
-  DEFER_CLEANUP(pad_r_t h0 = {0}, pad_r_cleanup);
-  DEFER_CLEANUP(pad_r_t h1 = {0}, pad_r_cleanup);
-  DEFER_CLEANUP(pad_r_t h0inv = {0}, pad_r_cleanup);
-  DEFER_CLEANUP(pad_r_t h = {0}, pad_r_cleanup);
-
-  // The randomness of the key generation
-  DEFER_CLEANUP(seeds_t seeds = {0}, seeds_cleanup);
-
-  get_seeds(&seeds);
-  GUARD(generate_secret_key(&h0, &h1,
-                            l_sk.wlist[0].val, l_sk.wlist[1].val,
-                            &seeds.seed[0]));
+  keypair_ws_init(ws);
 
-  // Generate sigma
-  convert_seed_to_m_type(&l_sk.sigma, &seeds.seed[1]);
+  GUARD(generate_sk(ws));
 
   // Calculate the public key
-  gf2x_mod_inv(&h0inv, &h0);
-  gf2x_mod_mul(&h, &h1, &h0inv);
+  gf2x_mod_inv_ws(&ws->h0inv, &ws->h0, maps, &ws->u.inv);
+  complete_keypair(pk, sk, ws);
 
-  // Fill the secret key data structure with contents - cancel the padding
-  l_sk.bin[0] = h0.val;
-  l_sk.bin[1] = h1.val;
-  l_sk.pk     = h.val;
+  return SUCCESS;
+}
 
-  // Copy the data to the output buffers
-  bike_memcpy(sk, &l_sk, sizeof(l_sk));
-  bike_memcpy(pk, &l_sk.pk, sizeof(l_sk.pk));
+////////////////////////////////////////////////////////////////////////////////
+// The three APIs below (keypair, encapsulate, decapsulate) are defined by NIST:
+////////////////////////////////////////////////////////////////////////////////
+int crypto_kem_keypair(OUT unsigned char *pk, OUT unsigned char *sk)
+{
+  DEFER_CLEANUP(keypair_ws_t ws, keypair_ws_cleanup);
+
+  return keypair(pk, sk, NULL, &ws);
+}
 
-  print("h:  ", (uint64_t *)&l_sk.pk, R_BITS);
-  print("h0: ", (uint64_t *)&l_sk.bin[0], R_BITS);
-  print("h1: ", (uint64_t *)&l_sk.bin[1], R_BITS);
-  print("h0 wlist:", (uint64_t *)&l_sk.wlist[0], SIZEOF_BITS(compressed_idx_d_t));
-  print("h1 wlist:", (uint64_t *)&l_sk.wlist[1], SIZEOF_BITS(compressed_idx_d_t));
-  print("sigma: ", (uint64_t *)l_sk.sigma.raw, M_BITS);
+// Products of the h0 values of a batch of key pairs (see
+// crypto_kem_keypair_batch).
+typedef struct keypair_batch_s {
+  pad_r_t prod[KEYPAIR_BATCH_SIZE];
+} keypair_batch_t;
+CLEANUP_FUNC(keypair_batch, keypair_batch_t)
+
+// Batched key generation - pk[i], sk[i] is the i-th key pair out of n.
+// The keys are generated in batches of (up to) KEYPAIR_BATCH_SIZE key pairs.
+// The h0 values of a batch are inverted together with Montgomery's trick:
+// with prod[j] = h0[0] * ... * h0[j] (the products of the batch), one
+// inversion inv = prod[m-1]^-1 followed by the iterations
+//   h0[j]^-1 = inv * prod[j-1],  inv = inv * h0[j]  (for j = m-1, ..., 1)
+// give the inverses of all the m h0 values, with 3(m-1) multiplications.
+// The products are invertible because every h0 is (h0 has an odd weight).
+int crypto_kem_keypair_batch(OUT unsigned char *const pk[],
+                             OUT unsigned char *const sk[],
+                             IN const size_t          n)
+{
+  DEFER_CLEANUP(keypair_ws_t ws, keypair_ws_cleanup);
+  DEFER_CLEANUP(pad_r_t inv = {0}, pad_r_cleanup);
+  DEFER_CLEANUP(pad_r_t tmp = {0}, pad_r_cleanup);
+  DEFER_CLEANUP(keypair_batch_t b = {0}, keypair_batch_cleanup);
+
+  aligned_sk_t *l_sk = &ws.l_sk;
+
+  keypair_ws_init(&ws);
+
+  for(size_t i = 0; i < n; i += KEYPAIR_BATCH_SIZE) {
+    const size_t m = ((n - i) < KEYPAIR_BATCH_SIZE) ? (n - i) : KEYPAIR_BATCH_SIZE;
+
+    // Generate the secret keys of the batch into the output buffers. When
+    // it fails, the secret keys of the batch are cleaned, since they have no
+    // public keys yet.
+    for(size_t j = 0; j < m; j++) {
+      if(generate_sk(&ws) != SUCCESS) {
+        for(size_t k = 0; k < m; k++) {
+          secure_clean(sk[i + k], sizeof(sk_t));
+        }
+        return FAIL;
+      }
+      bike_memcpy(sk[i + j], l_sk, sizeof(*l_sk));
+
+      if(j == 0) {
+        b.prod[0] = ws.h0;
+      } else {
+        gf2x_mod_mul_ws(&b.prod[j], &b.prod[j - 1], &ws.h0, &ws.u.mul);
+      }
+    }
+
+    gf2x_mod_inv_ws(&inv, &b.prod[m - 1], NULL, &ws.u.inv);
+
+    for(size_t j = m; j-- > 0;) {
+      bike_memcpy(l_sk, sk[i + j], sizeof(*l_sk));
+
+      if(j == 0) {
+        ws.h0inv = inv;
+      } else {
+        ws.h0.val = l_sk->bin[0];
+        gf2x_mod_mul_ws(&ws.h0inv, &inv, &b.prod[j - 1], &ws.u.mul);
+        gf2x_mod_mul_ws(&tmp, &inv, &ws.h0, &ws.u.mul);
+        inv = tmp;
+      }
+
+      complete_keypair(pk[i + j], sk[i + j], &ws);
+    }
+  }
 
   return SUCCESS;
 }
@@ -209,35 +428,278 @@ int crypto_kem_enc(OUT unsigned char *     ct,
                    IN const unsigned char *pk)
 {
   // Public values (they do not require cleanup on exit).
-  pk_t l_pk;
-  ct_t l_ct;
+  bike_enc_key_t key;
+
+  GUARD(crypto_kem_enc_key_init(&key, pk));
+
+  return crypto_kem_enc_with_key(ct, ss, &key);
+}
+
+// Expand the public key pk into key, for repeated encapsulation.
+int crypto_kem_enc_key_init(OUT bike_enc_key_t *key, IN const unsigned char *pk)
+{
+  if(((uintptr_t)key % BIKE_WORKSPACE_ALIGN) != 0) {
+    BIKE_ERROR(E_WORKSPACE_MISALIGNED);
+  }
+
+  GUARD(bike_pk_view_init(&key->view, pk));
+
+#if defined(BIKE_PK_HASH_CACHED)
+  GUARD(init_pk_hash(&key->pk_hash, &key->view.pk.val));
+#endif
+
+  return SUCCESS;
+}
 
-  DEFER_CLEANUP(m_t m, m_cleanup);
-  DEFER_CLEANUP(ss_t l_ss, ss_cleanup);
-  DEFER_CLEANUP(seeds_t seeds = {0}, seeds_cleanup);
-  DEFER_CLEANUP(pad_e_t e, pad_e_cleanup);
+size_t crypto_kem_enc_key_size(void) { return sizeof(bike_enc_key_t); }
 
+int bike_pk_view_init(OUT bike_pk_view_t *view, IN const unsigned char *pk)
+{
   // Copy the data from the input buffer. This is required in order to avoid
-  // alignment issues on non x86_64 processors.
-  bike_memcpy(&l_pk, pk, sizeof(l_pk));
+  // alignment issues on non x86_64 processors. The padding is required by the
+  // gf2x multiplication.
+  bike_memset(&view->pk, 0, sizeof(view->pk));
+  bike_memcpy(&view->pk.val, pk, sizeof(view->pk.val));
+
+  return SUCCESS;
+}
+
+int bike_ct_view_init(OUT bike_ct_view_t *view, IN const unsigned char *ct)
+{
+  bike_static_assert(sizeof(ct_t) == (sizeof(r_t) + sizeof(m_t)), ct_size);
 
-  get_seeds(&seeds);
+  bike_memset(&view->c0, 0, sizeof(view->c0));
+  bike_memcpy(&view->c0.val, ct, sizeof(view->c0.val));
+  bike_memcpy(&view->c1, &ct[sizeof(r_t)], sizeof(view->c1));
+
+  return SUCCESS;
+}
+
+void bike_ct_view_export(OUT unsigned char *ct, IN const bike_ct_view_t *view)
+{
+  bike_memcpy(ct, &view->c0.val, sizeof(view->c0.val));
+  bike_memcpy(&ct[sizeof(r_t)], &view->c1, sizeof(view->c1));
+}
+
+// Draw m into ws->m and encrypt it into the view ct (all the encapsulation
+// except the shared secret, see bike_enc_precompute)
+_INLINE_ ret_t encapsulate_m(OUT bike_ct_view_t *ct,
+                             IN const bike_pk_view_t *pk,
+                             IN const h_prefix_t *prefix,
+                             IN OUT enc_ws_t *ws)
+{
+  bike_memset(&ws->seeds, 0, sizeof(ws->seeds));
+  GUARD(get_seeds(&ws->seeds));
 
   // e = H(m) = H(seed[0])
-  convert_seed_to_m_type(&m, &seeds.seed[0]);
-  GUARD(function_h(&e, &m, &l_pk));
+  convert_seed_to_m_type(&ws->m, &ws->seeds.seed[0]);
+  PROFILE(BIKE_PROFILE_FUNCTION_H,
+          GUARD(function_h(&ws->e, &ws->m, prefix)));
 
   // Calculate the ciphertext
-  GUARD(encrypt(&l_ct, &e, &l_pk, &m));
+  return encrypt(ct, &ws->e, &pk->pk, &ws->m, ws);
+}
+
+// Encapsulate into the view ct directly
+_INLINE_ ret_t encapsulate(OUT bike_ct_view_t *ct,
+                           OUT unsigned char *ss,
+                           IN const bike_pk_view_t *pk,
+                           IN const h_prefix_t *prefix,
+                           IN OUT enc_ws_t *ws)
+{
+  GUARD(encapsulate_m(ct, pk, prefix, ws));
 
   // Generate the shared secret
-  GUARD(function_k(&l_ss, &m, &l_ct));
+  GUARD(function_k(&ws->l_ss, &ws->m, &ct->c0.val, &ct->c1));
 
-  print("ss: ", (uint64_t *)l_ss.raw, SIZEOF_BITS(l_ss));
+  print("ss: ", (uint64_t *)ws->l_ss.raw, SIZEOF_BITS(ws->l_ss));
 
-  // Copy the data to the output buffers
-  bike_memcpy(ct, &l_ct, sizeof(l_ct));
-  bike_memcpy(ss, &l_ss, sizeof(l_ss));
+  // Copy the data to the output buffer
+  bike_memcpy(ss, &ws->l_ss, sizeof(ws->l_ss));
+
+  return SUCCESS;
+}
+
+_INLINE_ ret_t enc_with_key(OUT unsigned char *ct,
+                            OUT unsigned char *ss,
+                            IN const bike_enc_key_t *key,
+                            IN OUT enc_ws_t *ws)
+{
+  GUARD(encapsulate(&ws->l_ct, ss, &key->view, ENC_KEY_H_PREFIX(key), ws));
+
+  // Copy the data to the output buffer
+  bike_ct_view_export(ct, &ws->l_ct);
+
+  return SUCCESS;
+}
+
+// Encapsulate - key is the expanded public key,
+//               ct is a key encapsulation message (ciphertext),
+//               ss is the shared secret.
+int crypto_kem_enc_with_key(OUT unsigned char *ct,
+                            OUT unsigned char *ss,
+                            IN const bike_enc_key_t *key)
+{
+  DEFER_CLEANUP(enc_ws_t ws, enc_ws_cleanup);
+
+  return enc_with_key(ct, ss, key, &ws);
+}
+
+// Encapsulate - pk is the view of the public key,
+//               ct is the view of a key encapsulation message (ciphertext),
+//               ss is the shared secret.
+int crypto_kem_enc_view(OUT bike_ct_view_t *ct,
+                        OUT unsigned char *ss,
+                        IN const bike_pk_view_t *pk)
+{
+  DEFER_CLEANUP(enc_ws_t ws, enc_ws_cleanup);
+
+  if((((uintptr_t)ct % BIKE_WORKSPACE_ALIGN) != 0) ||
+     (((uintptr_t)pk % BIKE_WORKSPACE_ALIGN) != 0)) {
+    BIKE_ERROR(E_WORKSPACE_MISALIGNED);
+  }
+
+#if defined(BIKE_PK_HASH_CACHED)
+  // The view does not hold the hash state after absorbing pk (public value)
+  sha_ctx_t pk_hash;
+  GUARD(init_pk_hash(&pk_hash, &pk->pk.val));
+
+  return encapsulate(ct, ss, pk, &pk_hash, &ws);
+#else
+  return encapsulate(ct, ss, pk, &pk->pk.val, &ws);
+#endif
+}
+
+// Check if H(m') is equal to (e0', e1') (in constant-time), and replace m'
+// by sigma when it is not.
+// The value of H(m') is computed into e_tmp. With SPARSE_FO_CHECK, (e0', e1')
+// is compared with the indices of H(m') instead, and e_tmp is not used.
+_INLINE_ ret_t select_m_prime(IN OUT m_t *m_prime,
+                              IN const pad_e_t *e_prime,
+                              IN const bike_dec_key_t *key,
+                              OUT pad_e_t *e_tmp)
+{
+  const sk_t *l_sk = &key->sk;
+  volatile uint32_t success_cond;
+
+#if defined(SPARSE_FO_CHECK)
+  DEFER_CLEANUP(seed_t seed = {0}, seed_cleanup);
+  uint32_t is_equal;
+  (void)e_tmp;
+
+  PROFILE_BEGIN(BIKE_PROFILE_FUNCTION_H);
+  GUARD(function_h_seed(&seed, m_prime, DEC_KEY_H_PREFIX(key)));
+  GUARD(cmp_error_vector(&is_equal, e_prime, &seed));
+  PROFILE_END(BIKE_PROFILE_FUNCTION_H);
+  success_cond = is_equal;
+#else
+  PROFILE(BIKE_PROFILE_FUNCTION_H,
+          GUARD(function_h(e_tmp, m_prime, DEC_KEY_H_PREFIX(key))));
+
+  success_cond = secure_cmp(PE0_RAW(e_prime), PE0_RAW(e_tmp), R_BYTES);
+  success_cond &= secure_cmp(PE1_RAW(e_prime), PE1_RAW(e_tmp), R_BYTES);
+#endif
+
+  // Compute either K(m', C) or K(sigma, C) based on the success condition
+  uint32_t mask = secure_l32_mask(0, success_cond);
+  for(size_t i = 0; i < M_BYTES; i++) {
+    m_prime->raw[i] &= u8_barrier(~mask);
+    m_prime->raw[i] |= (u8_barrier(mask) & l_sk->sigma.raw[i]);
+  }
+
+  return SUCCESS;
+}
+
+// Decapsulate a single ciphertext with a key that was already copied into an
+// aligned structure and prepared for the decoder.
+_INLINE_ ret_t decapsulate(OUT ss_t *l_ss,
+                           IN const bike_ct_view_t *l_ct,
+                           IN const bike_dec_key_t *key,
+                           IN OUT dec_ws_t *ws)
+{
+  e_t *    e       = &ws->e;
+  m_t *    m_prime = &ws->m_prime;
+  pad_e_t *e_prime = &ws->e_prime;
+
+  bike_memset(e_prime, 0, sizeof(*e_prime));
+
+  // Decode. A decoding failure is detected by the re-encryption check below,
+  // so the result of the decoder is not used.
+  BIKE_UNUSED_ATT const int dec_res =
+    decode_padded_ws(e, &l_ct->c0, &key->dec, &ws->decode);
+
+  // Copy the error vector in the padded struct.
+  e_prime->val[0].val = e->val[0];
+  e_prime->val[1].val = e->val[1];
+
+  GUARD(reencrypt(m_prime, e_prime, &l_ct->c1));
+
+  GUARD(select_m_prime(m_prime, e_prime, key, &ws->e_tmp));
+
+  // Generate the shared secret
+  GUARD(function_k(l_ss, m_prime, &l_ct->c0.val, &l_ct->c1));
+
+  return SUCCESS;
+}
+
+// The state of SHA_X4_WAYS decapsulations that are computed together.
+typedef struct dec_x4_s {
+  e_t        e[SHA_X4_WAYS];
+  pad_e_t    e_prime[SHA_X4_WAYS];
+  m_t        m_prime[SHA_X4_WAYS];
+  func_k_t   k_in[SHA_X4_WAYS];
+} dec_x4_t;
+CLEANUP_FUNC(dec_x4, dec_x4_t)
+
+_INLINE_ void ss_x4_cleanup(IN OUT ss_t (*o)[SHA_X4_WAYS])
+{
+  secure_clean((uint8_t *)o, sizeof(*o));
+}
+
+// Decapsulate SHA_X4_WAYS ciphertexts. The functions L and K of all the
+// ciphertexts are computed by one multi-buffer hash call each.
+_INLINE_ ret_t decapsulate_x4(OUT ss_t l_ss[SHA_X4_WAYS],
+                              IN const ct_t l_ct[SHA_X4_WAYS],
+                              IN const bike_dec_key_t *key,
+                              IN OUT dec_ws_t *ws)
+{
+  DEFER_CLEANUP(dec_x4_t d, dec_x4_cleanup);
+  DEFER_CLEANUP(sha_dgst_x4_t dgst, sha_dgst_x4_cleanup);
+  const uint8_t *msg[SHA_X4_WAYS];
+
+  bike_memset(d.e_prime, 0, sizeof(d.e_prime));
+
+  for(size_t j = 0; j < SHA_X4_WAYS; j++) {
+    // Decode. A decoding failure is detected by the re-encryption check, so
+    // the result of the decoder is not used.
+    BIKE_UNUSED_ATT const int dec_res =
+      decode_with_key_ws(&d.e[j], &l_ct[j], &key->dec, &ws->decode);
+
+    d.e_prime[j].val[0].val = d.e[j].val[0];
+    d.e_prime[j].val[1].val = d.e[j].val[1];
+    msg[j]                  = (const uint8_t *)&d.e[j];
+  }
+
+  // m' = c1 ^ L(e')
+  GUARD(sha_x4(&dgst, sizeof(d.e[0]), msg));
+  for(size_t j = 0; j < SHA_X4_WAYS; j++) {
+    for(size_t i = 0; i < sizeof(d.m_prime[j]); i++) {
+      d.m_prime[j].raw[i] = dgst.val[j].u.raw[i] ^ l_ct[j].c1.raw[i];
+    }
+
+    GUARD(select_m_prime(&d.m_prime[j], &d.e_prime[j], key, &ws->e_tmp));
+
+    d.k_in[j].m  = d.m_prime[j];
+    d.k_in[j].c0 = l_ct[j].c0;
+    d.k_in[j].c1 = l_ct[j].c1;
+    msg[j]       = (const uint8_t *)&d.k_in[j];
+  }
+
+  // Generate the shared secrets K(m', C)
+  GUARD(sha_x4(&dgst, sizeof(d.k_in[0]), msg));
+  for(size_t j = 0; j < SHA_X4_WAYS; j++) {
+    bike_memcpy(l_ss[j].raw, dgst.val[j].u.raw, sizeof(l_ss[j]));
+  }
 
   return SUCCESS;
 }
@@ -249,48 +711,496 @@ int crypto_kem_dec(OUT unsigned char *     ss,
                    IN const unsigned char *ct,
                    IN const unsigned char *sk)
 {
-  // Public values, does not require a cleanup on exit
-  ct_t l_ct;
+  DEFER_CLEANUP(bike_dec_key_t key, bike_dec_key_cleanup);
 
-  DEFER_CLEANUP(ss_t l_ss, ss_cleanup);
-  DEFER_CLEANUP(aligned_sk_t l_sk, sk_cleanup);
-  DEFER_CLEANUP(e_t e, e_cleanup);
-  DEFER_CLEANUP(m_t m_prime, m_cleanup);
-  DEFER_CLEANUP(pad_e_t e_tmp, pad_e_cleanup);
-  DEFER_CLEANUP(pad_e_t e_prime = {0}, pad_e_cleanup);
+  GUARD(crypto_kem_dec_key_init(&key, sk));
 
-  // Copy the data from the input buffers. This is required in order to avoid
+  return crypto_kem_dec_with_key(ss, ct, &key);
+}
+
+// Expand the secret key sk into key, for repeated decapsulation.
+int crypto_kem_dec_key_init(OUT bike_dec_key_t *key, IN const unsigned char *sk)
+{
+  if(((uintptr_t)key % BIKE_WORKSPACE_ALIGN) != 0) {
+    BIKE_ERROR(E_WORKSPACE_MISALIGNED);
+  }
+
+  // Copy the data from the input buffer. This is required in order to avoid
   // alignment issues on non x86_64 processors.
-  bike_memcpy(&l_ct, ct, sizeof(l_ct));
+  bike_memcpy(&key->sk, sk, sizeof(key->sk));
+
+  decode_key_init(&key->dec, &key->sk);
+
+#if defined(BIKE_PK_HASH_CACHED)
+  GUARD(init_pk_hash(&key->pk_hash, &key->sk.pk));
+#endif
+
+  return SUCCESS;
+}
+
+// Convert the private key sk into the compact private key csk.
+int crypto_kem_sk_compact(OUT unsigned char *csk, IN const unsigned char *sk)
+{
+  DEFER_CLEANUP(aligned_sk_t l_sk, sk_cleanup);
+  DEFER_CLEANUP(compact_sk_t l_csk, compact_sk_cleanup);
+
+  bike_static_assert(R_BITS <= (1ULL << (8 * sizeof(compact_idx_t))),
+                     compact_idx_too_small);
+
   bike_memcpy(&l_sk, sk, sizeof(l_sk));
 
-  // Decode and check if success.
-  volatile uint32_t success_cond = (decode(&e, &l_ct, &l_sk) == SUCCESS);
+  for(size_t i = 0; i < N0; i++) {
+    for(size_t j = 0; j < D; j++) {
+      l_csk.wlist[i][j] = (compact_idx_t)l_sk.wlist[i].val[j];
+    }
+  }
+  l_csk.sigma = l_sk.sigma;
 
-  // Copy the error vector in the padded struct.
-  e_prime.val[0].val = e.val[0];
-  e_prime.val[1].val = e.val[1];
+  bike_memcpy(csk, &l_csk, sizeof(l_csk));
 
-  GUARD(reencrypt(&m_prime, &e_prime, &l_ct));
+  return SUCCESS;
+}
 
-  // Check if H(m') is equal to (e0', e1')
-  // (in constant-time)
-  GUARD(function_h(&e_tmp, &m_prime, &l_sk.pk));
-  success_cond = secure_cmp(PE0_RAW(&e_prime), PE0_RAW(&e_tmp), R_BYTES);
-  success_cond &= secure_cmp(PE1_RAW(&e_prime), PE1_RAW(&e_tmp), R_BYTES);
+// Expand the compact private key csk into key, for repeated decapsulation.
+int crypto_kem_dec_key_init_compact(OUT bike_dec_key_t *key,
+                                    IN const unsigned char *csk)
+{
+  DEFER_CLEANUP(compact_sk_t l_csk, compact_sk_cleanup);
+  DEFER_CLEANUP(keypair_ws_t ws, keypair_ws_cleanup);
 
-  // Compute either K(m', C) or K(sigma, C) based on the success condition
-  uint32_t mask = secure_l32_mask(0, success_cond);
-  for(size_t i = 0; i < M_BYTES; i++) {
-    m_prime.raw[i] &= u8_barrier(~mask);
-    m_prime.raw[i] |= (u8_barrier(mask) & l_sk.sigma.raw[i]);
+  aligned_sk_t *l_sk    = &ws.l_sk;
+  uint32_t      invalid = 0;
+
+  if(((uintptr_t)key % BIKE_WORKSPACE_ALIGN) != 0) {
+    BIKE_ERROR(E_WORKSPACE_MISALIGNED);
   }
 
-  // Generate the shared secret
-  GUARD(function_k(&l_ss, &m_prime, &l_ct));
+  bike_memcpy(&l_csk, csk, sizeof(l_csk));
+  keypair_ws_init(&ws);
+
+  // The indices are secret, only the validity of the whole key is revealed
+  for(size_t i = 0; i < N0; i++) {
+    for(size_t j = 0; j < D; j++) {
+      l_sk->wlist[i].val[j] = l_csk.wlist[i][j];
+      invalid |= secure_l32_mask(l_csk.wlist[i][j], R_BITS);
+    }
+  }
+
+  if(invalid != 0) {
+    BIKE_ERROR(E_COMPACT_SK_INVALID);
+  }
+
+  secret_key_from_wlist(&ws.h0, &ws.h1, l_sk->wlist[0].val, l_sk->wlist[1].val);
+
+  // The indices of a column are distinct only if its polynomial has weight D
+  invalid |= secure_cmp32((uint32_t)r_bits_vector_weight(&ws.h0.val), D) ^ 1;
+  invalid |= secure_cmp32((uint32_t)r_bits_vector_weight(&ws.h1.val), D) ^ 1;
+  if(invalid != 0) {
+    BIKE_ERROR(E_COMPACT_SK_INVALID);
+  }
+
+  l_sk->bin[0] = ws.h0.val;
+  l_sk->bin[1] = ws.h1.val;
+  l_sk->sigma  = l_csk.sigma;
+
+  // Recompute the public key
+  gf2x_mod_inv_ws(&ws.h0inv, &ws.h0, NULL, &ws.u.inv);
+  compute_pk(&ws);
+
+  bike_memcpy(&key->sk, l_sk, sizeof(key->sk));
+  decode_key_init(&key->dec, &key->sk);
+
+#if defined(BIKE_PK_HASH_CACHED)
+  GUARD(init_pk_hash(&key->pk_hash, &key->sk.pk));
+#endif
+
+  return SUCCESS;
+}
+
+_INLINE_ ret_t dec_with_key(OUT unsigned char *     ss,
+                            IN const unsigned char *ct,
+                            IN const bike_dec_key_t *key,
+                            IN OUT dec_ws_t *ws)
+{
+  // Copy the data from the input buffer. This is required in order to avoid
+  // alignment issues on non x86_64 processors.
+  GUARD(bike_ct_view_init(&ws->l_ct, ct));
+
+  GUARD(decapsulate(&ws->l_ss, &ws->l_ct, key, ws));
+
+  // Copy the data into the output buffer
+  bike_memcpy(ss, &ws->l_ss, sizeof(ws->l_ss));
+
+  return SUCCESS;
+}
+
+// Decapsulate - ct is a key encapsulation message (ciphertext),
+//               key is the expanded private key,
+//               ss is the shared secret
+int crypto_kem_dec_with_key(OUT unsigned char *     ss,
+                            IN const unsigned char *ct,
+                            IN const bike_dec_key_t *key)
+{
+  DEFER_CLEANUP(dec_ws_t ws, dec_ws_cleanup);
+
+  return dec_with_key(ss, ct, key, &ws);
+}
+
+// Decapsulate - ct is the view of a key encapsulation message (ciphertext),
+//               key is the expanded private key,
+//               ss is the shared secret
+int crypto_kem_dec_view(OUT unsigned char *ss,
+                        IN const bike_ct_view_t *ct,
+                        IN const bike_dec_key_t *key)
+{
+  DEFER_CLEANUP(dec_ws_t ws, dec_ws_cleanup);
+
+  if((((uintptr_t)ct % BIKE_WORKSPACE_ALIGN) != 0) ||
+     (((uintptr_t)key % BIKE_WORKSPACE_ALIGN) != 0)) {
+    BIKE_ERROR(E_WORKSPACE_MISALIGNED);
+  }
+
+  GUARD(decapsulate(&ws.l_ss, ct, key, &ws));
 
   // Copy the data into the output buffer
-  bike_memcpy(ss, &l_ss, sizeof(l_ss));
+  bike_memcpy(ss, &ws.l_ss, sizeof(ws.l_ss));
+
+  return SUCCESS;
+}
+
+size_t crypto_kem_dec_key_size(void) { return sizeof(bike_dec_key_t); }
+
+void crypto_kem_dec_key_clean(IN OUT bike_dec_key_t *key)
+{
+  bike_dec_key_cleanup(key);
+}
+
+// Batched decapsulation - ct[i] is the i-th ciphertext out of n,
+//                         sk is the private key (common to all ciphertexts),
+//                         ss[i] is the shared secret of ct[i].
+// The secret key is expanded only once, and the ciphertexts are decapsulated
+// in groups of SHA_X4_WAYS (see decapsulate_x4).
+int crypto_kem_dec_batch(OUT unsigned char *const     ss[],
+                         IN const unsigned char *const ct[],
+                         IN const size_t               n,
+                         IN const unsigned char *      sk)
+{
+  // Public values, does not require a cleanup on exit
+  ct_t l_ct[SHA_X4_WAYS];
+
+  DEFER_CLEANUP(bike_dec_key_t key, bike_dec_key_cleanup);
+  DEFER_CLEANUP(ss_t l_ss[SHA_X4_WAYS], ss_x4_cleanup);
+  DEFER_CLEANUP(dec_ws_t ws, dec_ws_cleanup);
+
+  GUARD(crypto_kem_dec_key_init(&key, sk));
+
+  size_t i = 0;
+  for(; (i + SHA_X4_WAYS) <= n; i += SHA_X4_WAYS) {
+    for(size_t j = 0; j < SHA_X4_WAYS; j++) {
+      bike_memcpy(&l_ct[j], ct[i + j], sizeof(l_ct[j]));
+    }
+
+    GUARD(decapsulate_x4(l_ss, l_ct, &key, &ws));
+
+    for(size_t j = 0; j < SHA_X4_WAYS; j++) {
+      bike_memcpy(ss[i + j], &l_ss[j], sizeof(l_ss[j]));
+    }
+  }
+
+  for(; i < n; i++) {
+    GUARD(dec_with_key(ss[i], ct[i], &key, &ws));
+  }
+
+  return SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The stages of a decapsulation (see dec_stages.h):
+////////////////////////////////////////////////////////////////////////////////
+ret_t dec_stage_decode(IN OUT dec_stage_t *st, IN OUT decode_ws_t *ws)
+{
+  bike_memset(&st->e_prime, 0, sizeof(st->e_prime));
+
+  // Decode. A decoding failure is detected by the check stage.
+  BIKE_UNUSED_ATT const int dec_res =
+    decode_with_key_ws(&st->e, &st->l_ct, &st->key->dec, ws);
+
+  // Copy the error vector in the padded struct.
+  st->e_prime.val[0].val = st->e.val[0];
+  st->e_prime.val[1].val = st->e.val[1];
+
+  return SUCCESS;
+}
+
+void dec_stage_check(IN OUT dec_stage_t *const st[],
+                     OUT int                   res[],
+                     IN const size_t           n)
+{
+  int batched = 0;
+
+  // m' = c1 ^ L(e')
+  if(n == SHA_X4_WAYS) {
+    DEFER_CLEANUP(sha_dgst_x4_t dgst, sha_dgst_x4_cleanup);
+    const uint8_t *msg[SHA_X4_WAYS];
+
+    for(size_t j = 0; j < SHA_X4_WAYS; j++) {
+      msg[j] = (const uint8_t *)&st[j]->e;
+    }
+
+    if(sha_x4(&dgst, sizeof(st[0]->e), msg) == SUCCESS) {
+      for(size_t j = 0; j < SHA_X4_WAYS; j++) {
+        for(size_t i = 0; i < sizeof(st[j]->m_prime); i++) {
+          st[j]->m_prime.raw[i] = dgst.val[j].u.raw[i] ^ st[j]->l_ct.c1.raw[i];
+        }
+      }
+      batched = 1;
+    }
+  }
+
+  for(size_t j = 0; j < n; j++) {
+    res[j] = SUCCESS;
+    if(!batched) {
+      res[j] = reencrypt(&st[j]->m_prime, &st[j]->e_prime, &st[j]->l_ct.c1);
+    }
+    if(res[j] == SUCCESS) {
+      res[j] = select_m_prime(&st[j]->m_prime, &st[j]->e_prime, st[j]->key,
+                              &st[j]->e_tmp);
+    }
+  }
+}
+
+void dec_stage_kdf(IN OUT dec_stage_t *const st[],
+                   OUT int                   res[],
+                   IN const size_t           n)
+{
+  // Generate the shared secrets K(m', C)
+  if(n == SHA_X4_WAYS) {
+    DEFER_CLEANUP(sha_dgst_x4_t dgst, sha_dgst_x4_cleanup);
+    const uint8_t *msg[SHA_X4_WAYS];
+
+    for(size_t j = 0; j < SHA_X4_WAYS; j++) {
+      st[j]->k_in.m  = st[j]->m_prime;
+      st[j]->k_in.c0 = st[j]->l_ct.c0;
+      st[j]->k_in.c1 = st[j]->l_ct.c1;
+      msg[j]         = (const uint8_t *)&st[j]->k_in;
+    }
+
+    if(sha_x4(&dgst, sizeof(st[0]->k_in), msg) == SUCCESS) {
+      for(size_t j = 0; j < SHA_X4_WAYS; j++) {
+        bike_memcpy(st[j]->l_ss.raw, dgst.val[j].u.raw, sizeof(st[j]->l_ss));
+        res[j] = SUCCESS;
+      }
+      return;
+    }
+  }
+
+  for(size_t j = 0; j < n; j++) {
+    res[j] = function_k(&st[j]->l_ss, &st[j]->m_prime, &st[j]->l_ct.c0,
+                        &st[j]->l_ct.c1);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The APIs with a caller-provided workspace:
+////////////////////////////////////////////////////////////////////////////////
+size_t bike_workspace_size(void) { return sizeof(bike_workspace_t); }
+
+_INLINE_ ret_t check_workspace(IN const bike_workspace_t *ws)
+{
+  if(((uintptr_t)ws % BIKE_WORKSPACE_ALIGN) != 0) {
+    BIKE_ERROR(E_WORKSPACE_MISALIGNED);
+  }
+
+  return SUCCESS;
+}
+
+int crypto_kem_keypair_ws(OUT unsigned char *pk,
+                          OUT unsigned char *sk,
+                          IN OUT bike_workspace_t *ws)
+{
+  GUARD(check_workspace(ws));
+
+  const int res = keypair(pk, sk, NULL, &ws->u.keypair);
+
+  keypair_ws_cleanup(&ws->u.keypair);
+  return res;
+}
+
+int crypto_kem_enc_ws(OUT unsigned char *     ct,
+                      OUT unsigned char *     ss,
+                      IN const unsigned char *pk,
+                      IN OUT bike_workspace_t *ws)
+{
+  GUARD(check_workspace(ws));
+  GUARD(crypto_kem_enc_key_init(&ws->u.enc.key, pk));
+
+  const int res = enc_with_key(ct, ss, &ws->u.enc.key, &ws->u.enc.ws);
+
+  enc_ws_cleanup(&ws->u.enc.ws);
+  return res;
+}
+
+int crypto_kem_dec_ws(OUT unsigned char *     ss,
+                      IN const unsigned char *ct,
+                      IN const unsigned char *sk,
+                      IN OUT bike_workspace_t *ws)
+{
+  GUARD(check_workspace(ws));
+  GUARD(crypto_kem_dec_key_init(&ws->u.dec.key, sk));
+
+  const int res = dec_with_key(ss, ct, &ws->u.dec.key, &ws->u.dec.ws);
+
+  bike_dec_key_cleanup(&ws->u.dec.key);
+  dec_ws_cleanup(&ws->u.dec.ws);
+  return res;
+}
+
+// The keygen context holds the maps of the k-squarings of the inversion
+// (gf2x_ksqr_maps_t, followed by the maps themselves).
+struct bike_keygen_ctx_s {
+  gf2x_ksqr_maps_t maps;
+};
+
+size_t bike_keygen_ctx_size(void) { return gf2x_ksqr_maps_size(); }
+
+int bike_keygen_ctx_init(OUT bike_keygen_ctx_t *ctx)
+{
+  if(((uintptr_t)ctx % BIKE_WORKSPACE_ALIGN) != 0) {
+    BIKE_ERROR(E_WORKSPACE_MISALIGNED);
+  }
+
+  gf2x_ksqr_maps_init(&ctx->maps);
+
+  return SUCCESS;
+}
+
+int crypto_kem_keypair_with_ctx(OUT unsigned char *pk,
+                                OUT unsigned char *sk,
+                                IN const bike_keygen_ctx_t *ctx)
+{
+  DEFER_CLEANUP(keypair_ws_t ws, keypair_ws_cleanup);
+
+  return keypair(pk, sk, &ctx->maps, &ws);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The offline/online encapsulation:
+////////////////////////////////////////////////////////////////////////////////
+// A precomputed encapsulation: m and its ciphertext
+typedef struct enc_pool_entry_s {
+  m_t  m;
+  ct_t ct;
+} enc_pool_entry_t;
+
+CLEANUP_FUNC(enc_pool_entry, enc_pool_entry_t)
+
+// The entries of the pool are a ring of capacity entries, the precomputed
+// encapsulations are in entries[head], ..., entries[head + count - 1]
+// (mod capacity).
+struct bike_enc_pool_s {
+  bike_enc_key_t   key;
+  size_t           capacity;
+  size_t           head;
+  size_t           count;
+  enc_pool_entry_t entries[];
+};
+
+size_t bike_enc_pool_size(IN const size_t capacity)
+{
+  return sizeof(bike_enc_pool_t) + (capacity * sizeof(enc_pool_entry_t));
+}
+
+int bike_enc_pool_init(OUT bike_enc_pool_t *pool,
+                       IN const size_t          capacity,
+                       IN const bike_enc_key_t *key)
+{
+  if(((uintptr_t)pool % BIKE_WORKSPACE_ALIGN) != 0) {
+    BIKE_ERROR(E_WORKSPACE_MISALIGNED);
+  }
+  if(capacity == 0) {
+    BIKE_ERROR(E_ENC_POOL_INVALID_PARAMS);
+  }
+
+  pool->key      = *key;
+  pool->capacity = capacity;
+  pool->head     = 0;
+  pool->count    = 0;
+  bike_memset(pool->entries, 0, capacity * sizeof(enc_pool_entry_t));
+
+  return SUCCESS;
+}
+
+int bike_enc_precompute(IN OUT bike_enc_pool_t *pool, IN const size_t n)
+{
+  DEFER_CLEANUP(enc_ws_t ws, enc_ws_cleanup);
+
+  for(size_t i = 0; (i < n) && (pool->count < pool->capacity); i++) {
+    const size_t      tail  = (pool->head + pool->count) % pool->capacity;
+    enc_pool_entry_t *entry = &pool->entries[tail];
+
+    GUARD(encapsulate_m(&ws.l_ct, &pool->key.view, ENC_KEY_H_PREFIX(&pool->key),
+                        &ws));
+
+    entry->m = ws.m;
+    bike_ct_view_export((unsigned char *)&entry->ct, &ws.l_ct);
+    pool->count++;
+  }
 
   return SUCCESS;
 }
+
+size_t bike_enc_pool_count(IN const bike_enc_pool_t *pool)
+{
+  return pool->count;
+}
+
+int crypto_kem_enc_online(OUT unsigned char *ct,
+                          OUT unsigned char *ss,
+                          IN OUT bike_enc_pool_t *pool)
+{
+  if(pool->count == 0) {
+    return crypto_kem_enc_with_key(ct, ss, &pool->key);
+  }
+
+  DEFER_CLEANUP(ss_t l_ss = {0}, ss_cleanup);
+  enc_pool_entry_t *entry = &pool->entries[pool->head];
+
+  pool->head = (pool->head + 1) % pool->capacity;
+  pool->count--;
+
+  // Generate the shared secret, and clean the slot of the entry
+  const int res = function_k(&l_ss, &entry->m, &entry->ct.c0, &entry->ct.c1);
+  if(res == SUCCESS) {
+    bike_memcpy(ct, &entry->ct, sizeof(entry->ct));
+    bike_memcpy(ss, &l_ss, sizeof(l_ss));
+  }
+  enc_pool_entry_cleanup(entry);
+
+  return res;
+}
+
+void bike_enc_pool_clean(IN OUT bike_enc_pool_t *pool)
+{
+  secure_clean((uint8_t *)pool->entries,
+               pool->capacity * sizeof(enc_pool_entry_t));
+  pool->head  = 0;
+  pool->count = 0;
+}
+
+#if defined(BIKE_NAMESPACE)
+// The parameters of this level in a multi-level build (see bike_multi_level.h)
+const bike_level_params_t bike_level_params = {
+  .level    = LEVEL,
+  .sk_bytes = sizeof(sk_t),
+  .pk_bytes = sizeof(pk_t),
+  .ct_bytes = sizeof(ct_t),
+  .ss_bytes = sizeof(ss_t),
+  .keypair  = crypto_kem_keypair,
+  .enc      = crypto_kem_enc,
+  .dec      = crypto_kem_dec,
+
+  .workspace_bytes = sizeof(bike_workspace_t),
+  .keypair_ws      = crypto_kem_keypair_ws,
+  .enc_ws          = crypto_kem_enc_ws,
+  .dec_ws          = crypto_kem_dec_ws};
+#endif
@@ -0,0 +1,277 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+// For posix_memalign
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cleanup.h"
+#include "kem_internal.h"
+#include "keycache.h"
+#include "sha.h"
+#include "utilities.h"
+
+#define NO_ENTRY SIZE_MAX
+
+typedef struct cache_entry_s {
+  bike_dec_key_t key;
+  sha_dgst_t     pk_hash;
+
+  // The LRU list of the shard (by the indices of the entries)
+  size_t prev;
+  size_t next;
+
+  // The number of decapsulations that use the key (it is not evicted
+  // before they end)
+  size_t refs;
+  int    valid;
+} cache_entry_t;
+
+typedef struct cache_shard_s {
+  cache_entry_t *entries;
+
+  // The valid entries from the most recently used (head) to the least
+  // recently used (tail)
+  size_t head;
+  size_t tail;
+
+  bike_key_cache_stats_t stats;
+  pthread_mutex_t        lock;
+} cache_shard_t;
+
+struct bike_key_cache_s {
+  cache_shard_t *shards;
+  size_t         num_shards;
+  size_t         shard_capacity;
+};
+
+size_t bike_key_cache_entry_size(void) { return sizeof(cache_entry_t); }
+
+// The LRU lists must be updated with the lock of the shard held
+_INLINE_ void lru_unlink(IN OUT cache_shard_t *shard, IN const size_t i)
+{
+  cache_entry_t *e = &shard->entries[i];
+
+  if(e->prev == NO_ENTRY) {
+    shard->head = e->next;
+  } else {
+    shard->entries[e->prev].next = e->next;
+  }
+
+  if(e->next == NO_ENTRY) {
+    shard->tail = e->prev;
+  } else {
+    shard->entries[e->next].prev = e->prev;
+  }
+}
+
+_INLINE_ void lru_push_head(IN OUT cache_shard_t *shard, IN const size_t i)
+{
+  cache_entry_t *e = &shard->entries[i];
+
+  e->prev = NO_ENTRY;
+  e->next = shard->head;
+  if(shard->head == NO_ENTRY) {
+    shard->tail = i;
+  } else {
+    shard->entries[shard->head].prev = i;
+  }
+  shard->head = i;
+}
+
+// Find the entry of sk (with the lock of the shard held)
+_INLINE_ size_t find_entry(IN const bike_key_cache_t *cache,
+                           IN const cache_shard_t *shard,
+                           IN const sha_dgst_t *pk_hash,
+                           IN const unsigned char *sk)
+{
+  for(size_t i = 0; i < cache->shard_capacity; i++) {
+    const cache_entry_t *e = &shard->entries[i];
+
+    // The hash of the public key is not secret, but the rest of the private
+    // key is compared in constant time
+    if(e->valid &&
+       (0 == memcmp(e->pk_hash.u.raw, pk_hash->u.raw, sizeof(*pk_hash))) &&
+       secure_cmp((const uint8_t *)&e->key.sk, sk, sizeof(e->key.sk))) {
+      return i;
+    }
+  }
+
+  return NO_ENTRY;
+}
+
+// Find an entry for a new key: a free entry, or else the least recently used
+// entry that is not used by a decapsulation, which is evicted. Returns
+// NO_ENTRY if all the entries are in use (with the lock of the shard held).
+_INLINE_ size_t alloc_entry(IN const bike_key_cache_t *cache,
+                            IN OUT cache_shard_t *shard)
+{
+  for(size_t i = 0; i < cache->shard_capacity; i++) {
+    if(!shard->entries[i].valid) {
+      return i;
+    }
+  }
+
+  for(size_t i = shard->tail; i != NO_ENTRY; i = shard->entries[i].prev) {
+    cache_entry_t *e = &shard->entries[i];
+    if(e->refs == 0) {
+      lru_unlink(shard, i);
+      crypto_kem_dec_key_clean(&e->key);
+      e->valid = 0;
+      shard->stats.evictions++;
+      return i;
+    }
+  }
+
+  return NO_ENTRY;
+}
+
+int bike_key_cache_create(OUT bike_key_cache_t **cache,
+                          IN const bike_key_cache_params_t *params)
+{
+  *cache = NULL;
+
+  if((params->num_shards == 0) ||
+     ((params->max_bytes / sizeof(cache_entry_t)) < params->num_shards)) {
+    BIKE_ERROR(E_KEY_CACHE_INVALID_PARAMS);
+  }
+
+  bike_key_cache_t *c = calloc(1, sizeof(*c));
+  if(c == NULL) {
+    BIKE_ERROR(E_KEY_CACHE_INIT_FAIL);
+  }
+
+  c->shard_capacity =
+    (params->max_bytes / sizeof(cache_entry_t)) / params->num_shards;
+  c->shards = calloc(params->num_shards, sizeof(*c->shards));
+  if(c->shards == NULL) {
+    free(c);
+    BIKE_ERROR(E_KEY_CACHE_INIT_FAIL);
+  }
+
+  for(; c->num_shards < params->num_shards; c->num_shards++) {
+    cache_shard_t *shard = &c->shards[c->num_shards];
+    void *         mem   = NULL;
+
+    if(posix_memalign(&mem, ALIGN_BYTES,
+                      c->shard_capacity * sizeof(cache_entry_t)) != 0) {
+      break;
+    }
+
+    if(pthread_mutex_init(&shard->lock, NULL) != 0) {
+      free(mem);
+      break;
+    }
+
+    shard->entries = mem;
+    shard->head    = NO_ENTRY;
+    shard->tail    = NO_ENTRY;
+    for(size_t i = 0; i < c->shard_capacity; i++) {
+      shard->entries[i].valid = 0;
+      shard->entries[i].refs  = 0;
+    }
+  }
+
+  if(c->num_shards != params->num_shards) {
+    bike_key_cache_destroy(c);
+    BIKE_ERROR(E_KEY_CACHE_INIT_FAIL);
+  }
+
+  *cache = c;
+  return SUCCESS;
+}
+
+int bike_key_cache_dec(IN OUT bike_key_cache_t *cache,
+                       OUT unsigned char *ss,
+                       IN const unsigned char *ct,
+                       IN const unsigned char *sk)
+{
+  DEFER_CLEANUP(sha_dgst_t pk_hash, sha_dgst_cleanup);
+
+  GUARD(sha(&pk_hash, sizeof(pk_t), &sk[offsetof(sk_t, pk)]));
+
+  cache_shard_t *shard = &cache->shards[pk_hash.u.qw[0] % cache->num_shards];
+
+  pthread_mutex_lock(&shard->lock);
+
+  size_t i = find_entry(cache, shard, &pk_hash, sk);
+  if(i != NO_ENTRY) {
+    shard->stats.hits++;
+    lru_unlink(shard, i);
+  } else {
+    shard->stats.misses++;
+    i = alloc_entry(cache, shard);
+
+    // All the keys of the shard are in use, decapsulate without caching
+    if(i == NO_ENTRY) {
+      pthread_mutex_unlock(&shard->lock);
+      return crypto_kem_dec(ss, ct, sk);
+    }
+
+    if(crypto_kem_dec_key_init(&shard->entries[i].key, sk) != SUCCESS) {
+      crypto_kem_dec_key_clean(&shard->entries[i].key);
+      pthread_mutex_unlock(&shard->lock);
+      return FAIL;
+    }
+    shard->entries[i].pk_hash = pk_hash;
+    shard->entries[i].valid   = 1;
+  }
+
+  // Decapsulate without holding the lock of the shard
+  cache_entry_t *e = &shard->entries[i];
+  lru_push_head(shard, i);
+  e->refs++;
+  pthread_mutex_unlock(&shard->lock);
+
+  const int res = crypto_kem_dec_with_key(ss, ct, &e->key);
+
+  pthread_mutex_lock(&shard->lock);
+  e->refs--;
+  pthread_mutex_unlock(&shard->lock);
+
+  return res;
+}
+
+void bike_key_cache_get_stats(OUT bike_key_cache_stats_t *stats,
+                              IN bike_key_cache_t *cache)
+{
+  bike_memset(stats, 0, sizeof(*stats));
+
+  for(size_t s = 0; s < cache->num_shards; s++) {
+    cache_shard_t *shard = &cache->shards[s];
+
+    pthread_mutex_lock(&shard->lock);
+    stats->hits += shard->stats.hits;
+    stats->misses += shard->stats.misses;
+    stats->evictions += shard->stats.evictions;
+    pthread_mutex_unlock(&shard->lock);
+  }
+}
+
+void bike_key_cache_destroy(IN OUT bike_key_cache_t *cache)
+{
+  if(cache == NULL) {
+    return;
+  }
+
+  for(size_t s = 0; s < cache->num_shards; s++) {
+    cache_shard_t *shard = &cache->shards[s];
+
+    for(size_t i = 0; i < cache->shard_capacity; i++) {
+      crypto_kem_dec_key_clean(&shard->entries[i].key);
+    }
+
+    pthread_mutex_destroy(&shard->lock);
+    free(shard->entries);
+  }
+
+  free(cache->shards);
+  free(cache);
+}
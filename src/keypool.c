@@ -0,0 +1,392 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+// For clock_gettime
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "cleanup.h"
+#include "kem.h"
+#include "keypool.h"
+
+// The refill threads wait KEYPOOL_BACKOFF_MS << (failures - 1) milliseconds
+// after a failure of the key generation, and stop after KEYPOOL_MAX_FAILURES
+// consecutive failures.
+#define KEYPOOL_BACKOFF_MS   1
+#define KEYPOOL_MAX_FAILURES 8
+
+typedef struct keypair_slot_s {
+  uint8_t pk[sizeof(pk_t)];
+  uint8_t sk[sizeof(sk_t)];
+} keypair_slot_t;
+
+CLEANUP_FUNC(keypair_slot, keypair_slot_t)
+
+// A cell of the ring. The push of position pos takes the cell
+// (pos mod capacity) when its seq is pos, and sets seq to pos + 1 after the
+// key pair was copied into it. The pop of position pos takes the cell when its
+// seq is pos + 1, and sets seq to pos + capacity (the next push of the cell)
+// after the key pair was copied out of it and the cell was cleaned.
+typedef struct ring_cell_s {
+  size_t         seq;
+  keypair_slot_t kp;
+} ring_cell_t;
+
+struct bike_keypool_s {
+  bike_keypool_params_t params;
+
+  // A bounded lock-free ring of params.capacity cells (see ring_cell_t),
+  // with the key pairs at the positions pop_pos, ..., push_pos - 1.
+  ring_cell_t *cells;
+  size_t       push_pos;
+  size_t       pop_pos;
+
+  // Set when the pool drops to low_watermark, and cleared by the refill
+  // threads when it reaches high_watermark.
+  uint32_t refilling;
+
+  // Updated atomically
+  bike_keypool_stats_t stats;
+
+  // The lock protects the fields below, and the waits of the refill threads
+  // on refill_cond.
+  pthread_mutex_t lock;
+  pthread_cond_t  refill_cond;
+
+  // The number of key pairs that are being generated by the refill threads
+  size_t in_flight;
+  size_t failures; // Consecutive failures of the key generation
+  int    stop;
+
+  // Every refill thread generates up to KEYPAIR_BATCH_SIZE key pairs at a time
+  // (with crypto_kem_keypair_batch) into its own staging area.
+  pthread_t *     threads;
+  keypair_slot_t *staging;
+  size_t          num_started;
+};
+
+typedef struct refill_arg_s {
+  bike_keypool_t *pool;
+  keypair_slot_t *staging;
+} refill_arg_t;
+
+// The number of key pairs in the ring (including the pushes and the pops that
+// are in progress).
+_INLINE_ size_t ring_count(IN bike_keypool_t *pool)
+{
+  // pop_pos is loaded first, so that it is not larger than push_pos
+  const size_t pop = __atomic_load_n(&pool->pop_pos, __ATOMIC_SEQ_CST);
+  return __atomic_load_n(&pool->push_pos, __ATOMIC_SEQ_CST) - pop;
+}
+
+// Returns 0 when the ring is full
+_INLINE_ int ring_push(IN OUT bike_keypool_t *pool, IN const keypair_slot_t *kp)
+{
+  size_t pos = __atomic_load_n(&pool->push_pos, __ATOMIC_RELAXED);
+
+  while(1) {
+    ring_cell_t *  cell = &pool->cells[pos % pool->params.capacity];
+    const size_t   seq  = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    const intptr_t diff = (intptr_t)(seq - pos);
+
+    if(diff < 0) {
+      // The cell still holds the key pair of pos - capacity
+      return 0;
+    }
+
+    if(diff > 0) {
+      // Another push took the position
+      pos = __atomic_load_n(&pool->push_pos, __ATOMIC_RELAXED);
+    } else if(__atomic_compare_exchange_n(&pool->push_pos, &pos, pos + 1, 0,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      cell->kp = *kp;
+      __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+      return 1;
+    }
+  }
+}
+
+// Returns 0 when the ring is empty
+_INLINE_ int ring_pop(IN OUT bike_keypool_t *pool,
+                      OUT unsigned char *pk,
+                      OUT unsigned char *sk)
+{
+  size_t pos = __atomic_load_n(&pool->pop_pos, __ATOMIC_RELAXED);
+
+  while(1) {
+    ring_cell_t *  cell = &pool->cells[pos % pool->params.capacity];
+    const size_t   seq  = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    const intptr_t diff = (intptr_t)(seq - (pos + 1));
+
+    if(diff < 0) {
+      // The key pair of pos was not pushed yet
+      return 0;
+    }
+
+    if(diff > 0) {
+      // Another pop took the position
+      pos = __atomic_load_n(&pool->pop_pos, __ATOMIC_RELAXED);
+    } else if(__atomic_compare_exchange_n(&pool->pop_pos, &pos, pos + 1, 0,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      bike_memcpy(pk, cell->kp.pk, sizeof(cell->kp.pk));
+      bike_memcpy(sk, cell->kp.sk, sizeof(cell->kp.sk));
+      keypair_slot_cleanup(&cell->kp);
+      __atomic_store_n(&cell->seq, pos + pool->params.capacity,
+                       __ATOMIC_RELEASE);
+      return 1;
+    }
+  }
+}
+
+// Must be called with the lock held
+_INLINE_ size_t num_to_refill(IN bike_keypool_t *pool)
+{
+  const size_t expected = ring_count(pool) + pool->in_flight;
+
+  if(!__atomic_load_n(&pool->refilling, __ATOMIC_SEQ_CST) ||
+     (pool->failures >= KEYPOOL_MAX_FAILURES) ||
+     (expected >= pool->params.high_watermark)) {
+    return 0;
+  }
+
+  const size_t n = pool->params.high_watermark - expected;
+  return (n < KEYPAIR_BATCH_SIZE) ? n : KEYPAIR_BATCH_SIZE;
+}
+
+// Wake the refill threads (unless they are already refilling)
+_INLINE_ void request_refill(IN OUT bike_keypool_t *pool)
+{
+  if(__atomic_load_n(&pool->refilling, __ATOMIC_SEQ_CST)) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  __atomic_store_n(&pool->refilling, 1, __ATOMIC_SEQ_CST);
+  pthread_cond_broadcast(&pool->refill_cond);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+// Count a failure of the key generation, and back off before the next try
+// (which is not made after KEYPOOL_MAX_FAILURES consecutive failures, see
+// num_to_refill). Must be called with the lock held.
+_INLINE_ void refill_failed(IN OUT bike_keypool_t *pool)
+{
+  __atomic_add_fetch(&pool->stats.refill_failures, 1, __ATOMIC_RELAXED);
+
+  if(++pool->failures >= KEYPOOL_MAX_FAILURES) {
+    __atomic_store_n(&pool->stats.refill_stopped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  const long      ms = (long)KEYPOOL_BACKOFF_MS << (pool->failures - 1);
+  struct timespec until;
+  clock_gettime(CLOCK_REALTIME, &until);
+  until.tv_sec += ms / 1000;
+  until.tv_nsec += (ms % 1000) * 1000000;
+  if(until.tv_nsec >= 1000000000) {
+    until.tv_sec++;
+    until.tv_nsec -= 1000000000;
+  }
+
+  // refill_cond is also signaled by bike_keypool_pop, only stop ends the wait
+  while(!pool->stop) {
+    if(pthread_cond_timedwait(&pool->refill_cond, &pool->lock, &until) ==
+       ETIMEDOUT) {
+      break;
+    }
+  }
+}
+
+static void *refill_thread(void *arg)
+{
+  bike_keypool_t *pool    = ((refill_arg_t *)arg)->pool;
+  keypair_slot_t *staging = ((refill_arg_t *)arg)->staging;
+  unsigned char * pk[KEYPAIR_BATCH_SIZE];
+  unsigned char * sk[KEYPAIR_BATCH_SIZE];
+
+  for(size_t i = 0; i < KEYPAIR_BATCH_SIZE; i++) {
+    pk[i] = staging[i].pk;
+    sk[i] = staging[i].sk;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  while(!pool->stop) {
+    const size_t n = num_to_refill(pool);
+    if(n == 0) {
+      pthread_cond_wait(&pool->refill_cond, &pool->lock);
+      continue;
+    }
+
+    // Generate the key pairs without holding the lock. The ring has room
+    // for them, because count + in_flight <= high_watermark <= capacity
+    // (except for a cell whose pop is still in progress, then the key pair is
+    // dropped).
+    pool->in_flight += n;
+    pthread_mutex_unlock(&pool->lock);
+    const int res = crypto_kem_keypair_batch(pk, sk, n);
+    for(size_t i = 0; (res == SUCCESS) && (i < n); i++) {
+      ring_push(pool, &staging[i]);
+    }
+    for(size_t i = 0; i < n; i++) {
+      keypair_slot_cleanup(&staging[i]);
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->in_flight -= n;
+
+    if(res != SUCCESS) {
+      refill_failed(pool);
+      continue;
+    }
+    pool->failures = 0;
+
+    if(ring_count(pool) >= pool->params.high_watermark) {
+      __atomic_store_n(&pool->refilling, 0, __ATOMIC_SEQ_CST);
+
+      // The pops that drained the pool in the meantime may not have seen
+      // the store (they request a refill only when refilling is clear).
+      if(ring_count(pool) <= pool->params.low_watermark) {
+        __atomic_store_n(&pool->refilling, 1, __ATOMIC_SEQ_CST);
+      }
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  free(arg);
+  return NULL;
+}
+
+int bike_keypool_create(OUT bike_keypool_t **pool,
+                        IN const bike_keypool_params_t *params)
+{
+  *pool = NULL;
+
+  if((params->num_threads == 0) ||
+     (params->low_watermark >= params->high_watermark) ||
+     (params->high_watermark > params->capacity)) {
+    BIKE_ERROR(E_KEYPOOL_INVALID_PARAMS);
+  }
+
+  bike_keypool_t *p = calloc(1, sizeof(*p));
+  if(p == NULL) {
+    BIKE_ERROR(E_KEYPOOL_INIT_FAIL);
+  }
+
+  p->params    = *params;
+  p->refilling = 1;
+  p->cells     = calloc(params->capacity, sizeof(*p->cells));
+  p->threads   = calloc(params->num_threads, sizeof(*p->threads));
+  p->staging =
+    calloc(params->num_threads * KEYPAIR_BATCH_SIZE, sizeof(*p->staging));
+
+  if((p->cells == NULL) || (p->threads == NULL) || (p->staging == NULL) ||
+     (pthread_mutex_init(&p->lock, NULL) != 0)) {
+    free(p->cells);
+    free(p->threads);
+    free(p->staging);
+    free(p);
+    BIKE_ERROR(E_KEYPOOL_INIT_FAIL);
+  }
+
+  if(pthread_cond_init(&p->refill_cond, NULL) != 0) {
+    pthread_mutex_destroy(&p->lock);
+    free(p->cells);
+    free(p->threads);
+    free(p->staging);
+    free(p);
+    BIKE_ERROR(E_KEYPOOL_INIT_FAIL);
+  }
+
+  for(size_t i = 0; i < params->capacity; i++) {
+    p->cells[i].seq = i;
+  }
+
+  for(size_t i = 0; i < params->num_threads; i++) {
+    refill_arg_t *arg = malloc(sizeof(*arg));
+    if(arg == NULL) {
+      break;
+    }
+
+    arg->pool    = p;
+    arg->staging = &p->staging[i * KEYPAIR_BATCH_SIZE];
+    if(pthread_create(&p->threads[i], NULL, refill_thread, arg) != 0) {
+      free(arg);
+      break;
+    }
+    p->num_started++;
+  }
+
+  if(p->num_started != params->num_threads) {
+    bike_keypool_destroy(p);
+    BIKE_ERROR(E_KEYPOOL_INIT_FAIL);
+  }
+
+  *pool = p;
+  return SUCCESS;
+}
+
+int bike_keypool_pop(IN OUT bike_keypool_t *pool,
+                     OUT unsigned char *pk,
+                     OUT unsigned char *sk)
+{
+  if(!ring_pop(pool, pk, sk)) {
+    __atomic_add_fetch(&pool->stats.misses, 1, __ATOMIC_RELAXED);
+    request_refill(pool);
+
+    return crypto_kem_keypair(pk, sk);
+  }
+
+  __atomic_add_fetch(&pool->stats.hits, 1, __ATOMIC_RELAXED);
+
+  if(ring_count(pool) <= pool->params.low_watermark) {
+    request_refill(pool);
+  }
+
+  return SUCCESS;
+}
+
+void bike_keypool_get_stats(OUT bike_keypool_stats_t *stats,
+                            IN bike_keypool_t *pool)
+{
+  stats->hits   = __atomic_load_n(&pool->stats.hits, __ATOMIC_RELAXED);
+  stats->misses = __atomic_load_n(&pool->stats.misses, __ATOMIC_RELAXED);
+  stats->refill_failures =
+    __atomic_load_n(&pool->stats.refill_failures, __ATOMIC_RELAXED);
+  stats->refill_stopped =
+    __atomic_load_n(&pool->stats.refill_stopped, __ATOMIC_RELAXED);
+}
+
+void bike_keypool_destroy(IN OUT bike_keypool_t *pool)
+{
+  if(pool == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = 1;
+  pthread_cond_broadcast(&pool->refill_cond);
+  pthread_mutex_unlock(&pool->lock);
+
+  for(size_t i = 0; i < pool->num_started; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+
+  for(size_t i = 0; i < pool->params.capacity; i++) {
+    keypair_slot_cleanup(&pool->cells[i].kp);
+  }
+
+  pthread_cond_destroy(&pool->refill_cond);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->cells);
+  free(pool->threads);
+  free(pool->staging);
+  free(pool);
+}
@@ -0,0 +1,42 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include "bike_multi_level.h"
+
+// BIKE_LEVEL_LIST is set by the build system to X(l1)X(l2)...
+// for the levels of the build.
+#if !defined(BIKE_LEVEL_LIST)
+#  error "BIKE_LEVEL_LIST must be defined in a multi-level build"
+#endif
+
+#define X(l) extern const bike_level_params_t bike_l##l##_level_params;
+BIKE_LEVEL_LIST
+#undef X
+
+#define X(l) &bike_l##l##_level_params,
+static const bike_level_params_t *const levels[] = {BIKE_LEVEL_LIST};
+#undef X
+
+#define NUM_OF_LEVELS (sizeof(levels) / sizeof(levels[0]))
+
+const bike_level_params_t *bike_get_level(IN const uint32_t level)
+{
+  for(size_t i = 0; i < NUM_OF_LEVELS; i++) {
+    if(levels[i]->level == level) {
+      return levels[i];
+    }
+  }
+
+  return NULL;
+}
+
+size_t bike_num_levels(void) { return NUM_OF_LEVELS; }
+
+const bike_level_params_t *bike_get_level_by_index(IN const size_t i)
+{
+  return (i < NUM_OF_LEVELS) ? levels[i] : NULL;
+}
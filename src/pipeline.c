@@ -0,0 +1,394 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+// For pthread_setaffinity_np
+#if defined(__linux__)
+#  define _GNU_SOURCE
+#  include <sched.h>
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "bike_pipeline.h"
+#include "cleanup.h"
+#include "dec_stages.h"
+
+// A decapsulation in the pipeline
+typedef struct pipeline_slot_s {
+  dec_stage_t st;
+
+  unsigned char *         ss;
+  bike_pipeline_done_cb_t done;
+  void *                  arg;
+  int                     res;
+} pipeline_slot_t;
+
+// A bounded queue of slots. The queues hold at most max_in_flight slots in
+// total, so a slot never waits for room in a queue.
+typedef struct slot_queue_s {
+  pipeline_slot_t **items;
+  size_t            head;
+  size_t            count;
+
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+} slot_queue_t;
+
+// The stage s reads its slots from queue[s], and the free slots are in
+// queue[FREE_SLOTS].
+#define FREE_SLOTS BIKE_PIPELINE_NUM_STAGES
+#define NUM_QUEUES (BIKE_PIPELINE_NUM_STAGES + 1)
+
+struct bike_pipeline_s {
+  bike_pipeline_params_t params;
+
+  pipeline_slot_t *slots;
+  slot_queue_t     queue[NUM_QUEUES];
+  int              stop;
+
+  pthread_t *threads;
+  size_t     num_started;
+};
+
+typedef struct stage_arg_s {
+  bike_pipeline_t *pipeline;
+  int              stage;
+} stage_arg_t;
+
+_INLINE_ int queue_init(OUT slot_queue_t *q, IN const size_t capacity)
+{
+  q->head  = 0;
+  q->count = 0;
+  q->items = calloc(capacity, sizeof(*q->items));
+  if(q->items == NULL) {
+    return FAIL;
+  }
+
+  if(pthread_mutex_init(&q->lock, NULL) != 0) {
+    free(q->items);
+    return FAIL;
+  }
+
+  if(pthread_cond_init(&q->cond, NULL) != 0) {
+    pthread_mutex_destroy(&q->lock);
+    free(q->items);
+    return FAIL;
+  }
+
+  return SUCCESS;
+}
+
+_INLINE_ void queue_destroy(IN OUT slot_queue_t *q)
+{
+  pthread_cond_destroy(&q->cond);
+  pthread_mutex_destroy(&q->lock);
+  free(q->items);
+}
+
+_INLINE_ void queue_push(IN OUT slot_queue_t *q,
+                         IN pipeline_slot_t *slot,
+                         IN const size_t     capacity)
+{
+  pthread_mutex_lock(&q->lock);
+  q->items[(q->head + q->count) % capacity] = slot;
+  q->count++;
+  pthread_cond_broadcast(&q->cond);
+  pthread_mutex_unlock(&q->lock);
+}
+
+// Wait for a slot in q, and take up to max_n slots out of it. Returns 0 when
+// q is empty and stop is set.
+_INLINE_ size_t queue_pop(OUT pipeline_slot_t *slots[],
+                          IN OUT slot_queue_t *q,
+                          IN const size_t      max_n,
+                          IN const size_t      capacity,
+                          IN const int *       stop)
+{
+  pthread_mutex_lock(&q->lock);
+  while((q->count == 0) && !(*stop)) {
+    pthread_cond_wait(&q->cond, &q->lock);
+  }
+
+  size_t n = 0;
+  for(; (n < max_n) && (q->count > 0); n++) {
+    slots[n] = q->items[q->head];
+    q->head  = (q->head + 1) % capacity;
+    q->count--;
+  }
+
+  pthread_mutex_unlock(&q->lock);
+
+  return n;
+}
+
+// Run the stage on the n slots, skipping the slots that already failed. The
+// result of every slot is recorded separately.
+_INLINE_ void run_stage(IN const int stage,
+                        IN OUT pipeline_slot_t *slots[],
+                        IN const size_t         n,
+                        IN OUT decode_ws_t *ws)
+{
+  pipeline_slot_t *ok[SHA_X4_WAYS];
+  dec_stage_t *    st[SHA_X4_WAYS];
+  int              res[SHA_X4_WAYS];
+  size_t           num_ok = 0;
+
+  for(size_t i = 0; i < n; i++) {
+    if(slots[i]->res == SUCCESS) {
+      ok[num_ok]   = slots[i];
+      st[num_ok++] = &slots[i]->st;
+    }
+  }
+
+  switch(stage) {
+    case BIKE_PIPELINE_DECODE:
+      for(size_t i = 0; i < num_ok; i++) {
+        res[i] = dec_stage_decode(st[i], ws);
+      }
+      break;
+    case BIKE_PIPELINE_CHECK: dec_stage_check(st, res, num_ok); break;
+    default: dec_stage_kdf(st, res, num_ok); break;
+  }
+
+  for(size_t i = 0; i < num_ok; i++) {
+    ok[i]->res = res[i];
+  }
+}
+
+// Copy the shared secret to the output buffer, call the callback, and clean
+// and release the slot. The slot is released after the callback returns, so
+// that bike_pipeline_flush returns only after all the callbacks returned.
+_INLINE_ void complete_slot(IN OUT bike_pipeline_t *pipeline,
+                            IN OUT pipeline_slot_t *slot)
+{
+  if(slot->res == SUCCESS) {
+    bike_memcpy(slot->ss, &slot->st.l_ss, sizeof(slot->st.l_ss));
+  }
+  dec_stage_cleanup(&slot->st);
+
+  slot->done(slot->arg, slot->res);
+
+  queue_push(&pipeline->queue[FREE_SLOTS], slot, pipeline->params.max_in_flight);
+}
+
+static void *stage_thread(void *arg)
+{
+  bike_pipeline_t *pipeline = ((stage_arg_t *)arg)->pipeline;
+  const int        stage    = ((stage_arg_t *)arg)->stage;
+  const size_t     cap      = pipeline->params.max_in_flight;
+  pipeline_slot_t *slots[SHA_X4_WAYS];
+
+  free(arg);
+
+  // The decoder processes one slot at a time, and the hash bound stages take
+  // all the waiting slots (up to SHA_X4_WAYS).
+  const size_t max_n = (stage == BIKE_PIPELINE_DECODE) ? 1 : SHA_X4_WAYS;
+
+  DEFER_CLEANUP(decode_ws_t ws, decode_ws_cleanup);
+
+  while(1) {
+    const size_t n = queue_pop(slots, &pipeline->queue[stage], max_n, cap,
+                               &pipeline->stop);
+    if(n == 0) {
+      break;
+    }
+
+    run_stage(stage, slots, n, &ws);
+
+    for(size_t i = 0; i < n; i++) {
+      if(stage == BIKE_PIPELINE_KDF) {
+        complete_slot(pipeline, slots[i]);
+      } else {
+        queue_push(&pipeline->queue[stage + 1], slots[i], cap);
+      }
+    }
+  }
+
+  return NULL;
+}
+
+_INLINE_ int pin_thread(IN const pthread_t thread, IN const int cpu)
+{
+  if(cpu < 0) {
+    return SUCCESS;
+  }
+
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+
+  return (pthread_setaffinity_np(thread, sizeof(set), &set) == 0) ? SUCCESS
+                                                                  : FAIL;
+#else
+  (void)thread;
+  return FAIL;
+#endif
+}
+
+_INLINE_ int start_threads(IN OUT bike_pipeline_t *p)
+{
+  for(int s = 0; s < BIKE_PIPELINE_NUM_STAGES; s++) {
+    for(size_t i = 0; i < p->params.num_threads[s]; i++) {
+      stage_arg_t *arg = malloc(sizeof(*arg));
+      if(arg == NULL) {
+        return FAIL;
+      }
+
+      arg->pipeline = p;
+      arg->stage    = s;
+      if(pthread_create(&p->threads[p->num_started], NULL, stage_thread, arg) !=
+         0) {
+        free(arg);
+        return FAIL;
+      }
+      p->num_started++;
+
+      const int first_cpu = p->params.first_cpu[s];
+      if(pin_thread(p->threads[p->num_started - 1],
+                    (first_cpu < 0) ? first_cpu : (first_cpu + (int)i)) !=
+         SUCCESS) {
+        return FAIL;
+      }
+    }
+  }
+
+  return SUCCESS;
+}
+
+int bike_pipeline_create(OUT bike_pipeline_t **pipeline,
+                         IN const bike_pipeline_params_t *params)
+{
+  *pipeline = NULL;
+
+  size_t total_threads = 0;
+  for(int s = 0; s < BIKE_PIPELINE_NUM_STAGES; s++) {
+    if(params->num_threads[s] == 0) {
+      BIKE_ERROR(E_PIPELINE_INVALID_PARAMS);
+    }
+    total_threads += params->num_threads[s];
+  }
+
+  if(params->max_in_flight == 0) {
+    BIKE_ERROR(E_PIPELINE_INVALID_PARAMS);
+  }
+
+  bike_pipeline_t *p = calloc(1, sizeof(*p));
+  if(p == NULL) {
+    BIKE_ERROR(E_PIPELINE_INIT_FAIL);
+  }
+
+  p->params  = *params;
+  p->slots   = calloc(params->max_in_flight, sizeof(*p->slots));
+  p->threads = calloc(total_threads, sizeof(*p->threads));
+
+  size_t num_queues = 0;
+  if((p->slots != NULL) && (p->threads != NULL)) {
+    while((num_queues < NUM_QUEUES) &&
+          (queue_init(&p->queue[num_queues], params->max_in_flight) == SUCCESS)) {
+      num_queues++;
+    }
+  }
+
+  if(num_queues != NUM_QUEUES) {
+    for(size_t i = 0; i < num_queues; i++) {
+      queue_destroy(&p->queue[i]);
+    }
+    free(p->slots);
+    free(p->threads);
+    free(p);
+    BIKE_ERROR(E_PIPELINE_INIT_FAIL);
+  }
+
+  for(size_t i = 0; i < params->max_in_flight; i++) {
+    queue_push(&p->queue[FREE_SLOTS], &p->slots[i], params->max_in_flight);
+  }
+
+  if(start_threads(p) != SUCCESS) {
+    bike_pipeline_destroy(p);
+    BIKE_ERROR(E_PIPELINE_INIT_FAIL);
+  }
+
+  *pipeline = p;
+  return SUCCESS;
+}
+
+int bike_pipeline_submit(IN OUT bike_pipeline_t *pipeline,
+                         OUT unsigned char *     ss,
+                         IN const unsigned char *ct,
+                         IN const bike_dec_key_t *key,
+                         IN bike_pipeline_done_cb_t done,
+                         IN OUT void *              arg)
+{
+  const int        no_stop = 0;
+  pipeline_slot_t *slot;
+
+  // Wait for a free slot
+  (void)queue_pop(&slot, &pipeline->queue[FREE_SLOTS], 1,
+                  pipeline->params.max_in_flight, &no_stop);
+
+  // Copy the data from the input buffer. This is required in order to avoid
+  // alignment issues on non x86_64 processors.
+  bike_memcpy(&slot->st.l_ct, ct, sizeof(slot->st.l_ct));
+  slot->st.key = key;
+  slot->ss     = ss;
+  slot->done   = done;
+  slot->arg    = arg;
+  slot->res    = SUCCESS;
+
+  queue_push(&pipeline->queue[BIKE_PIPELINE_DECODE], slot,
+             pipeline->params.max_in_flight);
+
+  return SUCCESS;
+}
+
+void bike_pipeline_flush(IN OUT bike_pipeline_t *pipeline)
+{
+  slot_queue_t *q = &pipeline->queue[FREE_SLOTS];
+
+  pthread_mutex_lock(&q->lock);
+  while(q->count != pipeline->params.max_in_flight) {
+    pthread_cond_wait(&q->cond, &q->lock);
+  }
+  pthread_mutex_unlock(&q->lock);
+}
+
+void bike_pipeline_destroy(IN OUT bike_pipeline_t *pipeline)
+{
+  if(pipeline == NULL) {
+    return;
+  }
+
+  bike_pipeline_flush(pipeline);
+
+  // The stop flag is read by the threads under the locks of the queues
+  for(int s = 0; s < BIKE_PIPELINE_NUM_STAGES; s++) {
+    pthread_mutex_lock(&pipeline->queue[s].lock);
+  }
+  pipeline->stop = 1;
+  for(int s = 0; s < BIKE_PIPELINE_NUM_STAGES; s++) {
+    pthread_cond_broadcast(&pipeline->queue[s].cond);
+    pthread_mutex_unlock(&pipeline->queue[s].lock);
+  }
+
+  for(size_t i = 0; i < pipeline->num_started; i++) {
+    pthread_join(pipeline->threads[i], NULL);
+  }
+
+  for(size_t i = 0; i < pipeline->params.max_in_flight; i++) {
+    dec_stage_cleanup(&pipeline->slots[i].st);
+  }
+
+  for(int s = 0; s < BIKE_PIPELINE_NUM_STAGES; s++) {
+    queue_destroy(&pipeline->queue[s]);
+  }
+  queue_destroy(&pipeline->queue[FREE_SLOTS]);
+  free(pipeline->slots);
+  free(pipeline->threads);
+  free(pipeline);
+}
@@ -10,6 +10,7 @@
 #endif
 
 #include "aes.h"
+#include "cpu_features.h"
 #include "utilities.h"
 
 #define AESENC(m, key)     (_mm_aesenc_si128(m, key))
@@ -45,6 +46,39 @@ ret_t aes256_enc(OUT uint8_t *ct, IN const uint8_t *pt, IN const aes256_ks_t *ks
   return SUCCESS;
 }
 
+ret_t aes256_enc_ctr_x8(OUT uint8_t *ct,
+                        IN const uint128_t *ctr,
+                        IN const aes256_ks_t *ks)
+{
+#if defined(X86_64)
+  if(is_vaes_enabled() && is_avx512_enabled()) {
+    return aes256_enc_ctr_x8_vaes(ct, ctr, ks);
+  }
+#endif
+
+  // The independent blocks hide the latency of AESENC
+  __m128i blocks[AES256_CTR_X8_BLOCKS];
+
+  for(size_t j = 0; j < AES256_CTR_X8_BLOCKS; j++) {
+    blocks[j] = _mm_set_epi64x((int64_t)ctr->u.qw[1],
+                               (int64_t)(ctr->u.qw[0] + j));
+    blocks[j] ^= ks->keys[0];
+  }
+
+  for(size_t i = 1; i < AES256_ROUNDS; i++) {
+    for(size_t j = 0; j < AES256_CTR_X8_BLOCKS; j++) {
+      blocks[j] = AESENC(blocks[j], ks->keys[i]);
+    }
+  }
+
+  for(size_t j = 0; j < AES256_CTR_X8_BLOCKS; j++) {
+    blocks[j] = AESENCLAST(blocks[j], ks->keys[AES256_ROUNDS]);
+    STORE128(&ct[j * AES256_BLOCK_BYTES], blocks[j]);
+  }
+
+  return SUCCESS;
+}
+
 #define ROUND(in, t)          \
   do {                        \
     (t) = SLL128_I128(in, 4); \
@@ -24,37 +24,53 @@ ret_t init_prf_state(OUT aes_ctr_prf_state_t *s, IN size_t max_num_invocations,
 
   GUARD(aes256_key_expansion(&s->ks, &key));
 
-  // Initialize buffer and counter
-  s->ctr.u.qw[0]    = 0;
-  s->ctr.u.qw[1]    = 0;
-  s->buffer.u.qw[0] = 0;
-  s->buffer.u.qw[1] = 0;
+  // Initialize buffer and counter (the buffer is empty)
+  s->ctr.u.qw[0] = 0;
+  s->ctr.u.qw[1] = 0;
+  bike_memset(s->buffer, 0, sizeof(s->buffer));
 
-  s->curr_pos_in_buffer = AES256_BLOCK_BYTES;
+  s->curr_pos_in_buffer = 0;
+  s->buffer_len         = 0;
   s->rem_invocations    = max_num_invocations;
 
   DMSG("    Init aes_prf_ctr state:\n");
-  DMSG("      s.curr_pos_in_buffer = %d\n", s->curr_pos_in_buffer);
-  DMSG("      s.rem_invocations = %u\n", s->rem_invocations);
+  DMSG("      s.curr_pos_in_buffer = %zu\n", s->curr_pos_in_buffer);
+  DMSG("      s.rem_invocations = %zu\n", s->rem_invocations);
 
   return SUCCESS;
 }
 
-_INLINE_ ret_t perform_aes(OUT uint8_t *ct, IN OUT aes_ctr_prf_state_t *s)
+// Encrypt nblocks counter blocks into ct. Every block counts as one AES
+// invocation. Full groups of AES256_CTR_X8_BLOCKS blocks are encrypted in
+// parallel.
+_INLINE_ ret_t perform_aes(OUT uint8_t *ct,
+                           IN size_t    nblocks,
+                           IN OUT aes_ctr_prf_state_t *s)
 {
   // Ensure that the CTR is large enough
   bike_static_assert(
     ((sizeof(s->ctr.u.qw[0]) == 8) && (BIT(33) >= MAX_PRF_INVOCATION)),
     ctr_size_is_too_small);
 
-  if(0 == s->rem_invocations) {
+  if((0 == nblocks) || (nblocks > s->rem_invocations)) {
     BIKE_ERROR(E_AES_OVER_USED);
   }
 
-  GUARD(aes256_enc(ct, s->ctr.u.bytes, &s->ks));
+  for(; nblocks >= AES256_CTR_X8_BLOCKS; nblocks -= AES256_CTR_X8_BLOCKS) {
+    GUARD(aes256_enc_ctr_x8(ct, &s->ctr, &s->ks));
+
+    s->ctr.u.qw[0] += AES256_CTR_X8_BLOCKS;
+    s->rem_invocations -= AES256_CTR_X8_BLOCKS;
+    ct += AES256_CTR_X8_BLOCKS * AES256_BLOCK_BYTES;
+  }
 
-  s->ctr.u.qw[0]++;
-  s->rem_invocations--;
+  for(; nblocks > 0; nblocks--) {
+    GUARD(aes256_enc(ct, s->ctr.u.bytes, &s->ks));
+
+    s->ctr.u.qw[0]++;
+    s->rem_invocations--;
+    ct += AES256_BLOCK_BYTES;
+  }
 
   return SUCCESS;
 }
@@ -64,32 +80,34 @@ ret_t get_prf_output(OUT uint8_t *out, IN OUT aes_ctr_prf_state_t *s,
 {
   // When Len is smaller then use what's left in the buffer,
   // there is no need for additional AES invocations.
-  if((len + s->curr_pos_in_buffer) <= AES256_BLOCK_BYTES) {
-    bike_memcpy(out, &s->buffer.u.bytes[s->curr_pos_in_buffer], len);
+  if((len + s->curr_pos_in_buffer) <= s->buffer_len) {
+    bike_memcpy(out, &s->buffer[s->curr_pos_in_buffer], len);
     s->curr_pos_in_buffer += len;
 
     return SUCCESS;
   }
 
-  // If s.curr_pos_in_buffer != AES256_BLOCK_BYTES then copy what's left
-  // in the buffer.
-  uint32_t idx = AES256_BLOCK_BYTES - s->curr_pos_in_buffer;
-  bike_memcpy(out, &s->buffer.u.bytes[s->curr_pos_in_buffer], idx);
-
-  // Init s.curr_pos_in_buffer
-  s->curr_pos_in_buffer = 0;
+  // Copy what's left in the buffer.
+  size_t idx = s->buffer_len - s->curr_pos_in_buffer;
+  bike_memcpy(out, &s->buffer[s->curr_pos_in_buffer], idx);
 
-  // Copy full AES blocks
-  while((len - idx) >= AES256_BLOCK_BYTES) {
-    GUARD(perform_aes(&out[idx], s));
-    idx += AES256_BLOCK_BYTES;
+  // Encrypt full AES blocks directly into the output
+  const size_t nblocks = (len - idx) / AES256_BLOCK_BYTES;
+  if(nblocks != 0) {
+    GUARD(perform_aes(&out[idx], nblocks, s));
+    idx += nblocks * AES256_BLOCK_BYTES;
   }
 
-  GUARD(perform_aes(s->buffer.u.bytes, s));
+  // Refill the buffer with up to AES_CTR_PRF_BUFFER_BLOCKS blocks
+  const size_t nrefill = (s->rem_invocations < AES_CTR_PRF_BUFFER_BLOCKS)
+                           ? s->rem_invocations
+                           : AES_CTR_PRF_BUFFER_BLOCKS;
+  GUARD(perform_aes(s->buffer, nrefill, s));
+  s->buffer_len = nrefill * AES256_BLOCK_BYTES;
 
   // Copy the tail
   s->curr_pos_in_buffer = len - idx;
-  bike_memcpy(&out[idx], s->buffer.u.bytes, s->curr_pos_in_buffer);
+  bike_memcpy(&out[idx], s->buffer, s->curr_pos_in_buffer);
 
   return SUCCESS;
 }
@@ -0,0 +1,48 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include "aes.h"
+#include "utilities.h"
+
+#define NUM_ZMMS (AES256_CTR_X8_BLOCKS / 4)
+
+// Every ZMM register holds 4 counter blocks, and every round key is
+// broadcast to the 4 lanes of a ZMM register.
+ret_t aes256_enc_ctr_x8_vaes(OUT uint8_t *ct,
+                             IN const uint128_t *ctr,
+                             IN const aes256_ks_t *ks)
+{
+  const __m512i inc  = _mm512_set_epi64(0, 4, 0, 4, 0, 4, 0, 4);
+  const __m512i base = _mm512_broadcast_i32x4(
+    _mm_set_epi64x((int64_t)ctr->u.qw[1], (int64_t)ctr->u.qw[0]));
+
+  __m512i blocks[NUM_ZMMS];
+  __m512i key = _mm512_broadcast_i32x4(ks->keys[0]);
+
+  // Counter blocks ctr, ..., ctr + 3 and ctr + 4, ..., ctr + 7
+  blocks[0] = _mm512_add_epi64(base, _mm512_set_epi64(0, 3, 0, 2, 0, 1, 0, 0));
+  blocks[1] = _mm512_add_epi64(blocks[0], inc);
+
+  for(size_t j = 0; j < NUM_ZMMS; j++) {
+    blocks[j] = _mm512_xor_si512(blocks[j], key);
+  }
+
+  for(size_t i = 1; i < AES256_ROUNDS; i++) {
+    key = _mm512_broadcast_i32x4(ks->keys[i]);
+    for(size_t j = 0; j < NUM_ZMMS; j++) {
+      blocks[j] = _mm512_aesenc_epi128(blocks[j], key);
+    }
+  }
+
+  key = _mm512_broadcast_i32x4(ks->keys[AES256_ROUNDS]);
+  for(size_t j = 0; j < NUM_ZMMS; j++) {
+    blocks[j] = _mm512_aesenclast_epi128(blocks[j], key);
+    _mm512_storeu_si512((void *)&ct[j * 4 * AES256_BLOCK_BYTES], blocks[j]);
+  }
+
+  return SUCCESS;
+}
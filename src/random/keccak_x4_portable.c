@@ -0,0 +1,130 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include "sha3_x4.h"
+
+#define KECCAK_ROUNDS (24)
+
+#define XOR(a, b)                ((a) ^ (b))
+#define XOR5(a0, a1, a2, a3, a4) ((a0) ^ (a1) ^ (a2) ^ (a3) ^ (a4))
+#define ROL(a, n)                (((a) << (n)) | ((a) >> (64 - (n))))
+#define CHI(a0, a1, a2)          ((a0) ^ (~(a1) & (a2)))
+#define SET1(a)                  (a)
+
+// Keccak round constants
+static const uint64_t keccak_rc[KECCAK_ROUNDS] = {
+  0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+  0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+  0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+  0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+  0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+  0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+  0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+  0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL};
+
+// The Keccak-f[1600] permutation of a single state
+_INLINE_ void keccak_f1600(IN OUT uint64_t s[KECCAK_STATE_QWORDS])
+{
+  uint64_t a[KECCAK_STATE_QWORDS], b[KECCAK_STATE_QWORDS], c[5], d[5];
+
+  for(size_t i = 0; i < KECCAK_STATE_QWORDS; i++) {
+    a[i] = s[i];
+  }
+
+  for(size_t round = 0; round < KECCAK_ROUNDS; round++) {
+    // Theta
+    c[0] = XOR5(a[0], a[5], a[10], a[15], a[20]);
+    c[1] = XOR5(a[1], a[6], a[11], a[16], a[21]);
+    c[2] = XOR5(a[2], a[7], a[12], a[17], a[22]);
+    c[3] = XOR5(a[3], a[8], a[13], a[18], a[23]);
+    c[4] = XOR5(a[4], a[9], a[14], a[19], a[24]);
+    d[0] = XOR(c[4], ROL(c[1], 1));
+    d[1] = XOR(c[0], ROL(c[2], 1));
+    d[2] = XOR(c[1], ROL(c[3], 1));
+    d[3] = XOR(c[2], ROL(c[4], 1));
+    d[4] = XOR(c[3], ROL(c[0], 1));
+
+    // Theta (cont.), Rho and Pi
+    b[ 0] = XOR(a[ 0], d[0]);
+    b[10] = ROL(XOR(a[ 1], d[1]), 1);
+    b[20] = ROL(XOR(a[ 2], d[2]), 62);
+    b[ 5] = ROL(XOR(a[ 3], d[3]), 28);
+    b[15] = ROL(XOR(a[ 4], d[4]), 27);
+    b[16] = ROL(XOR(a[ 5], d[0]), 36);
+    b[ 1] = ROL(XOR(a[ 6], d[1]), 44);
+    b[11] = ROL(XOR(a[ 7], d[2]), 6);
+    b[21] = ROL(XOR(a[ 8], d[3]), 55);
+    b[ 6] = ROL(XOR(a[ 9], d[4]), 20);
+    b[ 7] = ROL(XOR(a[10], d[0]), 3);
+    b[17] = ROL(XOR(a[11], d[1]), 10);
+    b[ 2] = ROL(XOR(a[12], d[2]), 43);
+    b[12] = ROL(XOR(a[13], d[3]), 25);
+    b[22] = ROL(XOR(a[14], d[4]), 39);
+    b[23] = ROL(XOR(a[15], d[0]), 41);
+    b[ 8] = ROL(XOR(a[16], d[1]), 45);
+    b[18] = ROL(XOR(a[17], d[2]), 15);
+    b[ 3] = ROL(XOR(a[18], d[3]), 21);
+    b[13] = ROL(XOR(a[19], d[4]), 8);
+    b[14] = ROL(XOR(a[20], d[0]), 18);
+    b[24] = ROL(XOR(a[21], d[1]), 2);
+    b[ 9] = ROL(XOR(a[22], d[2]), 61);
+    b[19] = ROL(XOR(a[23], d[3]), 56);
+    b[ 4] = ROL(XOR(a[24], d[4]), 14);
+
+    // Chi
+    a[ 0] = CHI(b[ 0], b[ 1], b[ 2]);
+    a[ 1] = CHI(b[ 1], b[ 2], b[ 3]);
+    a[ 2] = CHI(b[ 2], b[ 3], b[ 4]);
+    a[ 3] = CHI(b[ 3], b[ 4], b[ 0]);
+    a[ 4] = CHI(b[ 4], b[ 0], b[ 1]);
+    a[ 5] = CHI(b[ 5], b[ 6], b[ 7]);
+    a[ 6] = CHI(b[ 6], b[ 7], b[ 8]);
+    a[ 7] = CHI(b[ 7], b[ 8], b[ 9]);
+    a[ 8] = CHI(b[ 8], b[ 9], b[ 5]);
+    a[ 9] = CHI(b[ 9], b[ 5], b[ 6]);
+    a[10] = CHI(b[10], b[11], b[12]);
+    a[11] = CHI(b[11], b[12], b[13]);
+    a[12] = CHI(b[12], b[13], b[14]);
+    a[13] = CHI(b[13], b[14], b[10]);
+    a[14] = CHI(b[14], b[10], b[11]);
+    a[15] = CHI(b[15], b[16], b[17]);
+    a[16] = CHI(b[16], b[17], b[18]);
+    a[17] = CHI(b[17], b[18], b[19]);
+    a[18] = CHI(b[18], b[19], b[15]);
+    a[19] = CHI(b[19], b[15], b[16]);
+    a[20] = CHI(b[20], b[21], b[22]);
+    a[21] = CHI(b[21], b[22], b[23]);
+    a[22] = CHI(b[22], b[23], b[24]);
+    a[23] = CHI(b[23], b[24], b[20]);
+    a[24] = CHI(b[24], b[20], b[21]);
+
+    // Iota
+    a[0] = XOR(a[0], SET1(keccak_rc[round]));
+  }
+
+  for(size_t i = 0; i < KECCAK_STATE_QWORDS; i++) {
+    s[i] = a[i];
+  }
+}
+
+void keccak_f1600_x4_port(
+  IN OUT uint64_t s[KECCAK_STATE_QWORDS * KECCAK_X4_WAYS])
+{
+  uint64_t lane[KECCAK_STATE_QWORDS];
+
+  for(size_t l = 0; l < KECCAK_X4_WAYS; l++) {
+    for(size_t i = 0; i < KECCAK_STATE_QWORDS; i++) {
+      lane[i] = s[(i * KECCAK_X4_WAYS) + l];
+    }
+
+    keccak_f1600(lane);
+
+    for(size_t i = 0; i < KECCAK_STATE_QWORDS; i++) {
+      s[(i * KECCAK_X4_WAYS) + l] = lane[i];
+    }
+  }
+}
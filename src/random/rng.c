@@ -0,0 +1,266 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#if defined(__linux__)
+#  include <sys/random.h>
+#endif
+
+#include "bike_rng.h"
+#include "cpu_features.h"
+#include "sampling.h"
+#include "sha.h"
+#include "utilities.h"
+
+static bike_rng_t rng_source = bike_rng_drbg;
+
+void bike_set_rng(IN bike_rng_t rng)
+{
+  rng_source = (rng == NULL) ? bike_rng_drbg : rng;
+}
+
+int bike_rng_getrandom(OUT uint8_t *buf, IN size_t len)
+{
+#if defined(__linux__)
+  while(len > 0) {
+    const ssize_t ret = getrandom(buf, len, 0);
+    if(ret < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      return FAIL;
+    }
+    buf += ret;
+    len -= ret;
+  }
+#else
+  FILE *f = fopen("/dev/urandom", "rb");
+  if(f == NULL) {
+    return FAIL;
+  }
+  const size_t ret = fread(buf, 1, len, f);
+  fclose(f);
+  if(ret != len) {
+    return FAIL;
+  }
+#endif
+
+  return SUCCESS;
+}
+
+#if defined(X86_64)
+
+// The number of retries that Intel recommends for RDRAND. RDSEED may fail
+// more often when it is used heavily, so it is retried more times.
+#  define RDRAND_RETRIES (10)
+#  define RDSEED_RETRIES (1000)
+
+_INLINE_ uint8_t rdrand64(OUT uint64_t *v)
+{
+  uint8_t ok;
+  __asm__ __volatile__("rdrand %0; setc %1" : "=r"(*v), "=qm"(ok) : : "cc");
+  return ok;
+}
+
+_INLINE_ uint8_t rdseed64(OUT uint64_t *v)
+{
+  uint8_t ok;
+  __asm__ __volatile__("rdseed %0; setc %1" : "=r"(*v), "=qm"(ok) : : "cc");
+  return ok;
+}
+
+_INLINE_ int rd_instruction(OUT uint8_t *buf,
+                            IN size_t    len,
+                            IN uint8_t (*rd64)(OUT uint64_t *v),
+                            IN const size_t retries)
+{
+  uint64_t v   = 0;
+  size_t   off = 0;
+
+  while(off < len) {
+    size_t i = 0;
+    while((i < retries) && (rd64(&v) == 0)) {
+      i++;
+    }
+    if(i == retries) {
+      // Do not leave a partial random value in v or in buf
+      secure_clean((uint8_t *)&v, sizeof(v));
+      secure_clean(buf, (uint32_t)off);
+      return FAIL;
+    }
+
+    const size_t n = ((len - off) < sizeof(v)) ? (len - off) : sizeof(v);
+    bike_memcpy(&buf[off], &v, n);
+    off += n;
+  }
+
+  secure_clean((uint8_t *)&v, sizeof(v));
+  return SUCCESS;
+}
+
+int bike_rng_rdrand(OUT uint8_t *buf, IN size_t len)
+{
+  cpu_features_init();
+  if(!is_rdrand_enabled()) {
+    return FAIL;
+  }
+
+  return rd_instruction(buf, len, rdrand64, RDRAND_RETRIES);
+}
+
+int bike_rng_rdseed(OUT uint8_t *buf, IN size_t len)
+{
+  cpu_features_init();
+  if(!is_rdseed_enabled()) {
+    return FAIL;
+  }
+
+  return rd_instruction(buf, len, rdseed64, RDSEED_RETRIES);
+}
+
+#else // X86_64
+
+int bike_rng_rdrand(OUT BIKE_UNUSED_ATT uint8_t *buf, IN BIKE_UNUSED_ATT size_t len)
+{
+  return FAIL;
+}
+
+int bike_rng_rdseed(OUT BIKE_UNUSED_ATT uint8_t *buf, IN BIKE_UNUSED_ATT size_t len)
+{
+  return FAIL;
+}
+
+#endif // X86_64
+
+// The DRBG holds a key K. Every refill of its buffer computes the hashes
+// H(K || 0), ..., H(K || 3) (with the multi-buffer sha_x4), replaces K with
+// the first DRBG_KEY_BYTES of them, and buffers the rest. The output bytes
+// are cleaned from the buffer once they are used, so the state never holds
+// previous outputs or the keys that derived them.
+#define DRBG_KEY_BYTES       (32U)
+#define DRBG_BUFFER_BYTES    ((SHA_X4_WAYS * SHA384_DGST_BYTES) - DRBG_KEY_BYTES)
+#define DRBG_RESEED_INTERVAL (1ULL << 16) // The number of refills
+
+typedef struct drbg_state_s {
+  uint8_t  key[DRBG_KEY_BYTES];
+  uint8_t  buffer[DRBG_BUFFER_BYTES];
+  size_t   avail;       // The unused bytes are at the end of the buffer
+  uint64_t rem_refills; // The DRBG is (re)seeded when it reaches zero
+} drbg_state_t;
+
+static __thread drbg_state_t drbg_state;
+static pthread_once_t        drbg_atfork_once = PTHREAD_ONCE_INIT;
+
+// A child process must not repeat the outputs of its parent.
+// The handler runs in the (only) thread of the child, which is the thread
+// that called fork.
+static void drbg_atfork_child(void)
+{
+  secure_clean((uint8_t *)&drbg_state, sizeof(drbg_state));
+}
+
+static void drbg_atfork_init(void)
+{
+  pthread_atfork(NULL, NULL, drbg_atfork_child);
+}
+
+_INLINE_ ret_t drbg_refill(IN OUT drbg_state_t *s)
+{
+  DEFER_CLEANUP(sha_dgst_x4_t dgst, sha_dgst_x4_cleanup);
+  uint8_t        msg[SHA_X4_WAYS][DRBG_KEY_BYTES + 1];
+  const uint8_t *m[SHA_X4_WAYS];
+
+  if(s->rem_refills == 0) {
+    GUARD(bike_rng_getrandom(s->key, sizeof(s->key)));
+    s->rem_refills = DRBG_RESEED_INTERVAL;
+  }
+
+  for(size_t i = 0; i < SHA_X4_WAYS; i++) {
+    bike_memcpy(msg[i], s->key, sizeof(s->key));
+    msg[i][DRBG_KEY_BYTES] = i;
+    m[i]                   = msg[i];
+  }
+
+  GUARD(sha_x4(&dgst, sizeof(msg[0]), m));
+  secure_clean((uint8_t *)msg, sizeof(msg));
+
+  bike_static_assert(sizeof(dgst) == (DRBG_KEY_BYTES + DRBG_BUFFER_BYTES),
+                     drbg_dgst_size);
+  const uint8_t *out = dgst.val[0].u.raw;
+  bike_memcpy(s->key, out, DRBG_KEY_BYTES);
+  bike_memcpy(s->buffer, &out[DRBG_KEY_BYTES], DRBG_BUFFER_BYTES);
+
+  s->avail = DRBG_BUFFER_BYTES;
+  s->rem_refills--;
+
+  return SUCCESS;
+}
+
+_INLINE_ ret_t drbg_read(IN OUT drbg_state_t *s,
+                         OUT uint8_t *buf,
+                         IN size_t    len)
+{
+  while(len > 0) {
+    if(s->avail == 0) {
+      GUARD(drbg_refill(s));
+    }
+
+    const size_t n   = (len < s->avail) ? len : s->avail;
+    uint8_t *    src = &s->buffer[DRBG_BUFFER_BYTES - s->avail];
+
+    bike_memcpy(buf, src, n);
+    secure_clean(src, n);
+
+    s->avail -= n;
+    buf += n;
+    len -= n;
+  }
+
+  return SUCCESS;
+}
+
+int bike_rng_drbg(OUT uint8_t *buf, IN size_t len)
+{
+  pthread_once(&drbg_atfork_once, drbg_atfork_init);
+
+  return drbg_read(&drbg_state, buf, len);
+}
+
+// The deterministic DRBG of the thread (see set_thread_rng_seed). It is the
+// same DRBG as above, with the seed as its initial key, and it is never
+// reseeded.
+static __thread drbg_state_t seeded_state;
+static __thread int          seeded;
+
+void set_thread_rng_seed(IN const uint8_t *seed)
+{
+  bike_static_assert(RNG_SEED_BYTES == DRBG_KEY_BYTES, rng_seed_size);
+
+  secure_clean((uint8_t *)&seeded_state, sizeof(seeded_state));
+  seeded = (seed != NULL);
+
+  if(seeded) {
+    bike_memcpy(seeded_state.key, seed, sizeof(seeded_state.key));
+    seeded_state.rem_refills = UINT64_MAX;
+  }
+}
+
+ret_t get_random_bytes(OUT uint8_t *buf, IN const size_t len)
+{
+  if(seeded) {
+    return drbg_read(&seeded_state, buf, len);
+  }
+
+  if(rng_source(buf, len) != 0) {
+    BIKE_ERROR(E_RNG_FAIL);
+  }
+
+  return SUCCESS;
+}
@@ -8,24 +8,23 @@
 #include <assert.h>
 
 #include "cleanup.h"
+#include "dispatch.h"
 #include "prf_internal.h"
 #include "sampling.h"
 #include "sampling_internal.h"
 
-void get_seeds(OUT seeds_t *seeds)
+ret_t get_seeds(OUT seeds_t *seeds)
 {
 #if defined(USE_NIST_RAND)
   randombytes((uint8_t *)seeds, NUM_OF_SEEDS * sizeof(seed_t));
 #else
-  for(uint32_t i = 0; i < NUM_OF_SEEDS; ++i) {
-    for(uint32_t j = 0; j < sizeof(seed_t); ++j) {
-      seeds->seed[i].raw[j] = rand();
-    }
-  }
+  GUARD(get_random_bytes((uint8_t *)seeds, NUM_OF_SEEDS * sizeof(seed_t)));
 #endif
   for(uint32_t i = 0; i < NUM_OF_SEEDS; ++i) {
     print("s: ", (uint64_t *)&seeds->seed[i], SIZEOF_BITS(seed_t));
   }
+
+  return SUCCESS;
 }
 
 #if defined(UNIFORM_SAMPLING)
@@ -90,7 +89,8 @@ ret_t sample_uniform_r_bits_with_fixed_prf_context(
 ret_t generate_indices_mod_z(OUT idx_t *     out,
                              IN const size_t num_indices,
                              IN const size_t z,
-                             IN OUT prf_state_t *prf_state)
+                             IN OUT prf_state_t *prf_state,
+                             IN const sampling_ctx *ctx)
 {
   size_t ctr = 0;
 
@@ -99,14 +99,7 @@ ret_t generate_indices_mod_z(OUT idx_t *     out,
     GUARD(get_rand_mod_len(&out[ctr], z, prf_state));
 
     // Check if the index is new and increment the counter if it is.
-    int is_new = 1;
-    for (size_t i = 0; i < ctr; i++) {
-      if (out[i] == out[ctr]) {
-        is_new = 0;
-        break;
-      }
-    }
-    ctr += is_new;
+    ctr += 1 - ctx->is_idx_dup(out[ctr], out, ctr);
   } while(ctr < num_indices);
 
   return SUCCESS;
@@ -116,7 +109,8 @@ ret_t generate_indices_mod_z(OUT idx_t *     out,
 ret_t sample_indices_fisher_yates(OUT idx_t *out,
                                   IN  size_t num_indices,
                                   IN  idx_t max_idx_val,
-                                  IN OUT prf_state_t *prf_state) {
+                                  IN OUT prf_state_t *prf_state,
+                                  IN const sampling_ctx *ctx) {
 
     for (size_t i = num_indices; i-- > 0;) {
 #define CWW_RAND_BYTES 4
@@ -127,11 +121,8 @@ ret_t sample_indices_fisher_yates(OUT idx_t *out,
 		// new index l is such that i <= l < max_idx_val
         uint32_t l = i + (uint32_t)(rand >> (CWW_RAND_BYTES * 8));
 
-		// Loop over (the end of) the output array to determine if l is a duplicate
-        uint32_t is_dup = 0;
-        for (size_t j = i + 1; j < num_indices; ++j) {
-            is_dup |= secure_cmp32(l, out[j]);
-        }
+		// Check (the end of) the output array to determine if l is a duplicate
+        uint32_t is_dup = ctx->is_idx_dup(l, &out[i + 1], num_indices - i - 1);
 
 		// if l is a duplicate out[i] gets i else out[i] gets l
 		// mask is all 1 if l is a duplicate, all 0 else
@@ -145,14 +136,14 @@ ret_t sample_indices_fisher_yates(OUT idx_t *out,
 _INLINE_ ret_t generate_sparse_rep_for_sk(OUT pad_r_t *r,
                                           OUT idx_t *wlist,
                                           IN OUT prf_state_t *prf_state,
-                                          IN sampling_ctx *ctx)
+                                          IN const sampling_ctx *ctx)
 {
   idx_t wlist_temp[D] = {0};
 
 #if defined(UNIFORM_SAMPLING)
-  GUARD(generate_indices_mod_z(wlist_temp, D, R_BITS, prf_state));
+  GUARD(generate_indices_mod_z(wlist_temp, D, R_BITS, prf_state, ctx));
 #else
-  GUARD(sample_indices_fisher_yates(wlist_temp, D, R_BITS, prf_state));
+  GUARD(sample_indices_fisher_yates(wlist_temp, D, R_BITS, prf_state, ctx));
 #endif
 
   bike_memcpy(wlist, wlist_temp, D * sizeof(idx_t));
@@ -166,40 +157,54 @@ ret_t generate_secret_key(OUT pad_r_t *h0, OUT pad_r_t *h1,
                           OUT idx_t *h0_wlist, OUT idx_t *h1_wlist,
                           IN const seed_t *seed)
 {
-  // Initialize the sampling context.
-  sampling_ctx ctx = {0};
-  sampling_ctx_init(&ctx);
+  const sampling_ctx *ctx = &get_dispatch_ctx()->sampling;
 
   DEFER_CLEANUP(prf_state_t prf_state = {0}, clean_prf_state);
 
   GUARD(init_prf_state(&prf_state, MAX_PRF_INVOCATION, seed));
 
-  GUARD(generate_sparse_rep_for_sk(h0, h0_wlist, &prf_state, &ctx));
-  GUARD(generate_sparse_rep_for_sk(h1, h1_wlist, &prf_state, &ctx));
+  GUARD(generate_sparse_rep_for_sk(h0, h0_wlist, &prf_state, ctx));
+  GUARD(generate_sparse_rep_for_sk(h1, h1_wlist, &prf_state, ctx));
 
   return SUCCESS;
 }
 
-ret_t generate_error_vector(OUT pad_e_t *e, IN const seed_t *seed)
+void secret_key_from_wlist(OUT pad_r_t *h0, OUT pad_r_t *h1,
+                           IN const idx_t *h0_wlist, IN const idx_t *h1_wlist)
 {
-  // Initialize the sampling context.
-  sampling_ctx ctx;
-  sampling_ctx_init(&ctx);
+  const sampling_ctx *ctx = &get_dispatch_ctx()->sampling;
 
+  ctx->secure_set_bits(h0, 0, h0_wlist, D);
+  ctx->secure_set_bits(h1, 0, h1_wlist, D);
+}
+
+_INLINE_ ret_t generate_error_indices(OUT idx_t *wlist,
+                                      IN const seed_t *seed,
+                                      IN const sampling_ctx *ctx)
+{
   DEFER_CLEANUP(prf_state_t prf_state = {0}, clean_prf_state);
 
   GUARD(init_prf_state(&prf_state, MAX_PRF_INVOCATION, seed));
 
-  idx_t wlist[T];
 #if defined(UNIFORM_SAMPLING)
-  GUARD(ctx.sample_error_vec_indices(wlist, &prf_state));
+  GUARD(ctx->sample_error_vec_indices(wlist, &prf_state));
 #else
-  GUARD(sample_indices_fisher_yates(wlist, T, N_BITS, &prf_state));
+  GUARD(sample_indices_fisher_yates(wlist, T, N_BITS, &prf_state, ctx));
 #endif
 
+  return SUCCESS;
+}
+
+ret_t generate_error_vector(OUT pad_e_t *e, IN const seed_t *seed)
+{
+  const sampling_ctx *ctx = &get_dispatch_ctx()->sampling;
+
+  idx_t wlist[T];
+  GUARD(generate_error_indices(wlist, seed, ctx));
+
   // (e0, e1) hold bits 0..R_BITS-1 and R_BITS..2*R_BITS-1 of the error, resp.
-  ctx.secure_set_bits(&e->val[0], 0, wlist, T);
-  ctx.secure_set_bits(&e->val[1], R_BITS, wlist, T);
+  ctx->secure_set_bits(&e->val[0], 0, wlist, T);
+  ctx->secure_set_bits(&e->val[1], R_BITS, wlist, T);
 
   // Clean the padding of the elements.
   PE0_RAW(e)[R_BYTES - 1] &= LAST_R_BYTE_MASK;
@@ -211,3 +216,19 @@ ret_t generate_error_vector(OUT pad_e_t *e, IN const seed_t *seed)
 
   return SUCCESS;
 }
+
+ret_t cmp_error_vector(OUT uint32_t *is_equal,
+                       IN const pad_e_t *e,
+                       IN const seed_t *seed)
+{
+  const sampling_ctx *ctx = &get_dispatch_ctx()->sampling;
+
+  idx_t wlist[T];
+  GUARD(generate_error_indices(wlist, seed, ctx));
+
+  *is_equal = secure_cmp_e_wlist(e, wlist, T);
+
+  secure_clean((uint8_t *)wlist, sizeof(wlist));
+
+  return SUCCESS;
+}
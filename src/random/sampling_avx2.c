@@ -84,6 +84,29 @@ void secure_set_bits_avx2(OUT pad_r_t *   r,
   }
 }
 
+uint32_t is_idx_dup_avx2(IN const idx_t  idx,
+                         IN const idx_t *wlist,
+                         IN const size_t w_size)
+{
+  const REG_T vidx = SET1_I32(idx);
+  REG_T       vdup = SET_ZERO;
+  size_t      i    = 0;
+
+  // Compare idx with REG_DWORDS elements of wlist at a time
+  for(; (i + REG_DWORDS) <= w_size; i += REG_DWORDS) {
+    vdup |= CMPEQ_I32(vidx, LOAD(&wlist[i]));
+  }
+
+  // Compare with the remaining (less than REG_DWORDS) elements. The masked
+  // load does not access memory beyond wlist[w_size - 1], and sets the
+  // masked out elements to zero. Therefore, we mask the result as well.
+  const REG_T vrem = SET1_I32(w_size - i);
+  const REG_T mask = CMPGT_I32(vrem, SET_I32(7, 6, 5, 4, 3, 2, 1, 0));
+  vdup |= mask & CMPEQ_I32(vidx, MLOAD32(&wlist[i], mask));
+
+  return 1 - secure_cmp32(MOVEMASK(vdup), 0);
+}
+
 #if defined(UNIFORM_SAMPLING)
 // We need the list of indices to be a multiple of avx2 register.
 #define WLIST_SIZE_ADJUSTED_T \
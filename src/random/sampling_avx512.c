@@ -5,8 +5,6 @@
  * AWS Cryptographic Algorithms Group.
  */
 
-#include <assert.h>
-
 #include "utilities.h"
 #include "sampling_internal.h"
 
@@ -14,74 +12,102 @@
 #include "x86_64_intrinsic.h"
 
 // For improved performance, we process NUM_ZMMS amount of data in parallel.
-#define NUM_ZMMS    (8)
-#define ZMMS_QWORDS (QWORDS_IN_ZMM * NUM_ZMMS)
-
-void secure_set_bits_avx512(OUT pad_r_t *   r,
+// r is padded to a multiple of 1024 bits (two ZMMs), and its last
+// (R_PADDED_ZMMS % NUM_ZMMS) ZMMs are processed together.
+#define R_PADDED_ZMMS (R_PADDED_QWORDS / QWORDS_IN_ZMM)
+#define NUM_ZMMS      (8)
+#define TAIL_ZMMS     (R_PADDED_ZMMS % NUM_ZMMS)
+
+// Set the bits of wlist (relative to first_pos) that are in the num_zmms ZMMs
+// of r64 at the quadword qw, and clear the other bits of these ZMMs.
+_INLINE_ void set_bits_zmms(OUT uint64_t *r64,
+                            IN const size_t qw,
+                            IN const size_t num_zmms,
                             IN const size_t first_pos,
                             IN const idx_t *wlist,
                             IN const size_t w_size)
 {
-  // The function assumes that the size of r is a multiple
-  // of the cumulative size of used ZMM registers.
-  assert((sizeof(*r) / sizeof(uint64_t)) % ZMMS_QWORDS == 0);
-
-  // va vectors hold the bits of the output array "r"
-  // va_pos_qw vectors hold the qw position indices of "r"
+  // va vectors hold the bits of r64
+  // va_pos_qw vectors hold the qw position indices of r64
   // The algorithm works as follows:
-  //   1. Initialize va_pos_qw with starting positions of qw's of "r"
-  //      va_pos_qw = (7, 6, 5, 4, 3, 2, 1, 0);
-  //   2. While the size of "r" is not exceeded:
-  //   3.   For each w in wlist:
-  //   4.     Compare the pos_qw of w with positions in va_pos_qw
-  //          and for the position which is equal set the appropriate
-  //          bit in va vector.
-  //   5.   Set va_pos_qw to the next qw positions of "r"
+  //   1. Initialize va_pos_qw with the positions of the qw's of the ZMMs
+  //      va_pos_qw = (qw + 7, qw + 6, ..., qw);
+  //   2. For each w in wlist:
+  //   3.   Compare the pos_qw of w with positions in va_pos_qw
+  //        and for the position which is equal set the appropriate
+  //        bit in va vector.
   __m512i  va[NUM_ZMMS], va_pos_qw[NUM_ZMMS];
   __m512i  w_pos_qw, w_pos_bit, one, inc;
   __mmask8 va_mask;
 
-  uint64_t *r64 = (uint64_t *)r;
-
   one = SET1_I64(1);
   inc = SET1_I64(QWORDS_IN_ZMM);
 
   // 1. Initialize
-  va_pos_qw[0] = SET_I64(7, 6, 5, 4, 3, 2, 1, 0);
-  for(size_t i = 1; i < NUM_ZMMS; i++) {
+  va_pos_qw[0] = ADD_I64(SET_I64(7, 6, 5, 4, 3, 2, 1, 0), SET1_I64(qw));
+  va[0]        = SET_ZERO;
+  for(size_t i = 1; i < num_zmms; i++) {
     va_pos_qw[i] = ADD_I64(va_pos_qw[i - 1], inc);
+    va[i]        = SET_ZERO;
   }
 
-  // va_pos_qw vectors hold qw positions 0 .. (NUM_ZMMS * QWORDS_IN_ZMM - 1)
-  // Therefore, we set the increment vector inc such that by adding it to
-  // va_pos_qw vectors they hold the next ZMMS_QWORDS qw positions.
-  inc = SET1_I64(ZMMS_QWORDS);
+  for(size_t w_iter = 0; w_iter < w_size; w_iter++) {
+    int32_t w = wlist[w_iter] - first_pos;
+    w_pos_qw  = SET1_I64(w >> 6);
+    w_pos_bit = SLLI_I64(one, w & MASK(6));
 
-  for(size_t i = 0; i < (sizeof(*r) / sizeof(uint64_t)); i += ZMMS_QWORDS) {
-    for(size_t va_iter = 0; va_iter < NUM_ZMMS; va_iter++) {
-      va[va_iter] = SET_ZERO;
+    // 3. Compare the positions in va_pos_qw with w_pos_qw
+    //    and set the appropriate bit in va
+    for(size_t va_iter = 0; va_iter < num_zmms; va_iter++) {
+      va_mask     = CMPMEQ_I64(va_pos_qw[va_iter], w_pos_qw);
+      va[va_iter] = MOR_I64(va[va_iter], va_mask, va[va_iter], w_pos_bit);
     }
+  }
 
-    for(size_t w_iter = 0; w_iter < w_size; w_iter++) {
-      int32_t w = wlist[w_iter] - first_pos;
-      w_pos_qw  = SET1_I64(w >> 6);
-      w_pos_bit = SLLI_I64(one, w & MASK(6));
-
-      // 4. Compare the positions in va_pos_qw with w_pos_qw
-      //    and set the appropriate bit in va
-      for(size_t va_iter = 0; va_iter < NUM_ZMMS; va_iter++) {
-        va_mask     = CMPMEQ_I64(va_pos_qw[va_iter], w_pos_qw);
-        va[va_iter] = MOR_I64(va[va_iter], va_mask, va[va_iter], w_pos_bit);
-      }
-    }
+  for(size_t va_iter = 0; va_iter < num_zmms; va_iter++) {
+    STORE(&r64[qw + (va_iter * QWORDS_IN_ZMM)], va[va_iter]);
+  }
+}
 
-    // 5. Set the va_pos_qw to the next qw positions of r
-    //    and store the previously computed data in r
-    for(size_t va_iter = 0; va_iter < NUM_ZMMS; va_iter++) {
-      STORE(&r64[i + (va_iter * QWORDS_IN_ZMM)], va[va_iter]);
-      va_pos_qw[va_iter] = ADD_I64(va_pos_qw[va_iter], inc);
-    }
+void secure_set_bits_avx512(OUT pad_r_t *   r,
+                            IN const size_t first_pos,
+                            IN const idx_t *wlist,
+                            IN const size_t w_size)
+{
+  bike_static_assert(sizeof(*r) == (R_PADDED_ZMMS * BYTES_IN_ZMM),
+                     pad_r_t_size_is_not_r_padded_zmms);
+
+  uint64_t *   r64     = (uint64_t *)r;
+  const size_t main_qw = (R_PADDED_ZMMS - TAIL_ZMMS) * QWORDS_IN_ZMM;
+
+  for(size_t qw = 0; qw < main_qw; qw += NUM_ZMMS * QWORDS_IN_ZMM) {
+    set_bits_zmms(r64, qw, NUM_ZMMS, first_pos, wlist, w_size);
   }
+
+  if(TAIL_ZMMS != 0) {
+    set_bits_zmms(r64, main_qw, TAIL_ZMMS, first_pos, wlist, w_size);
+  }
+}
+
+uint32_t is_idx_dup_avx512(IN const idx_t  idx,
+                           IN const idx_t *wlist,
+                           IN const size_t w_size)
+{
+  const REG_T vidx   = SET1_I32(idx);
+  uint16_t    is_dup = 0;
+  size_t      i      = 0;
+
+  // Compare idx with REG_DWORDS elements of wlist at a time
+  for(; (i + REG_DWORDS) <= w_size; i += REG_DWORDS) {
+    is_dup |= CMPM_U32(vidx, LOAD(&wlist[i]), _MM_CMPINT_EQ);
+  }
+
+  // Compare with the remaining (less than REG_DWORDS) elements. The masked
+  // load does not access memory beyond wlist[w_size - 1].
+  const uint16_t mask = MASK(w_size - i);
+  is_dup |= MCMPMEQ_I32(mask, vidx, MLOAD32(&wlist[i], mask));
+
+  return 1 - secure_cmp32(is_dup, 0);
 }
 
 #if defined(UNIFORM_SAMPLING)
@@ -7,6 +7,7 @@
 
 #include <assert.h>
 
+#include "cleanup.h"
 #include "utilities.h"
 #include "sampling_internal.h"
 
@@ -48,6 +49,256 @@ void secure_set_bits_port(OUT pad_r_t *   r,
   }
 }
 
+// secure_set_bits_sorted builds r from a single sorted list that holds a key
+// per index and a marker key per QW of r, in constant time. The key of an
+// index w is (w << 1) and the key of the marker of QW i is
+// ((i << 7) | MARKER_BITS), so that every marker follows the indices of its QW.
+#define MARKER_BITS   (MASK(7))
+#define SORT_INF_KEY  (BIT(62))
+#define SORT_MAX_SIZE (2 * (R_PADDED_QWORDS + (2 * MAX_WLIST_SIZE)))
+#define SORT_MAX_CMPS ((SORT_MAX_SIZE / 2) * 12)
+
+bike_static_assert(SORT_MAX_SIZE <= BIT(12), sort_max_size_too_large);
+
+// Swap a and b if b < a (for keys smaller than 2^63), and return the mask of
+// the swap.
+_INLINE_ uint64_t cmp_swap(IN OUT uint64_t *a, IN OUT uint64_t *b)
+{
+  const uint64_t mask = 0 - ((*b - *a) >> 63);
+  const uint64_t diff = (*a ^ *b) & mask;
+
+  *a ^= diff;
+  *b ^= diff;
+
+  return mask;
+}
+
+_INLINE_ size_t next_pow2(IN const size_t n)
+{
+  size_t p = 1;
+  while(p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+// Sort keys[0..n-1] (n is a power of 2) with a bitonic sorting network
+_INLINE_ void bitonic_sort(IN OUT uint64_t *keys, IN const size_t n)
+{
+  for(size_t k = 2; k <= n; k <<= 1) {
+    for(size_t j = k >> 1; j > 0; j >>= 1) {
+      for(size_t i = 0; i < n; i++) {
+        const size_t l = i ^ j;
+        if(l <= i) {
+          continue;
+        }
+        if((i & k) == 0) {
+          cmp_swap(&keys[i], &keys[l]);
+        } else {
+          cmp_swap(&keys[l], &keys[i]);
+        }
+      }
+    }
+  }
+}
+
+void secure_set_bits_sorted(OUT pad_r_t *   r,
+                            IN const size_t first_pos,
+                            IN const idx_t *wlist,
+                            IN const size_t w_size)
+{
+  assert(w_size <= MAX_WLIST_SIZE);
+
+  bike_static_assert(offsetof(pad_r_t, val) == 0, val_wrong_pos_in_pad_r_t);
+  bike_static_assert(sizeof(pad_r_t) == (R_PADDED_QWORDS * sizeof(uint64_t)),
+                     pad_r_t_size_is_not_r_padded);
+  uint64_t *a64 = (uint64_t *)r;
+
+  uint64_t keys[SORT_MAX_SIZE];
+  uint64_t swaps[DIVIDE_AND_CEIL(SORT_MAX_CMPS, 64)] = {0};
+
+  const size_t w_pow2 = next_pow2(w_size);
+  const size_t n      = next_pow2(R_PADDED_QWORDS + w_pow2);
+  assert(n <= SORT_MAX_SIZE);
+
+  // The markers in ascending order, followed by padding keys, followed by
+  // the indices in descending order. This sequence is bitonic.
+  for(size_t i = 0; i < R_PADDED_QWORDS; i++) {
+    keys[i] = (i << 7) | MARKER_BITS;
+  }
+  for(size_t i = R_PADDED_QWORDS; i < n; i++) {
+    keys[i] = SORT_INF_KEY;
+  }
+
+  // Indices outside r wrap around to large keys, which follow all the markers
+  uint64_t *w_keys = &keys[n - w_pow2];
+  for(size_t i = 0; i < w_size; i++) {
+    w_keys[i] = ((uint64_t)(uint32_t)(wlist[i] - first_pos)) << 1;
+  }
+  bitonic_sort(w_keys, w_pow2);
+  for(size_t i = 0; i < (w_pow2 / 2); i++) {
+    const uint64_t tmp     = w_keys[i];
+    w_keys[i]              = w_keys[w_pow2 - 1 - i];
+    w_keys[w_pow2 - 1 - i] = tmp;
+  }
+
+  // Merge the markers and the indices with a bitonic merging network, and
+  // record its swaps
+  size_t c = 0;
+  for(size_t j = n >> 1; j > 0; j >>= 1) {
+    for(size_t i = 0; i < n; i++) {
+      if((i & j) == 0) {
+        swaps[c >> 6] |= cmp_swap(&keys[i], &keys[i + j]) & BIT(c & 63);
+        c++;
+      }
+    }
+  }
+
+  // A single pass accumulates the bits of the indices of every QW and stores
+  // them in place of its marker (the padding keys behave as markers)
+  uint64_t acc = 0;
+  for(size_t i = 0; i < n; i++) {
+    const uint64_t key       = keys[i];
+    const uint64_t is_marker = 0 - (uint64_t)secure_cmp32(key & MARKER_BITS,
+                                                          MARKER_BITS);
+
+    acc |= BIT((key >> 1) & 63) & ~is_marker;
+    keys[i] = acc & is_marker;
+    acc &= ~is_marker;
+  }
+
+  // Undo the merge, which moves every marker back to the position of its QW
+  for(size_t j = 1; j < n; j <<= 1) {
+    for(size_t i = n; i-- > 0;) {
+      if((i & j) == 0) {
+        c--;
+        const uint64_t mask = 0 - ((swaps[c >> 6] >> (c & 63)) & 1);
+        const uint64_t diff = (keys[i] ^ keys[i + j]) & mask;
+        keys[i] ^= diff;
+        keys[i + j] ^= diff;
+      }
+    }
+  }
+
+  bike_memcpy(a64, keys, sizeof(*r));
+  secure_clean((uint8_t *)keys, sizeof(keys));
+  secure_clean((uint8_t *)swaps, sizeof(swaps));
+}
+
+// secure_cmp_e_wlist merges the indices into a sorted list that holds a
+// marker per QW of e (the QWs of e0 followed by the QWs of e1). The key of the
+// marker of QW i is (i << 7), and the key of an index at bit b of QW i is
+// ((i << 7) | (b << 1) | 1), so that every marker precedes the indices of its
+// QW. The invalid indices (not less than N_BITS) get the key E_INVALID_KEY,
+// which follows all the markers.
+#define E_QWORDS       (N0 * R_PADDED_QWORDS)
+#define E_INVALID_KEY  ((E_QWORDS << 7) | 1)
+#define E_CMP_MAX_SIZE (2 * (E_QWORDS + MAX_WLIST_SIZE))
+
+// Return 1 if v1 < v2 (for values smaller than 2^63), and 0 otherwise
+_INLINE_ uint64_t less_than64(IN const uint64_t v1, IN const uint64_t v2)
+{
+  return (v1 - v2) >> 63;
+}
+
+uint32_t secure_cmp_e_wlist(IN const pad_e_t *e,
+                            IN const idx_t *  wlist,
+                            IN const size_t   w_size)
+{
+  assert(w_size <= MAX_WLIST_SIZE);
+
+  bike_static_assert(sizeof(pad_e_t) == (E_QWORDS * sizeof(uint64_t)),
+                     pad_e_t_size_is_not_e_qwords);
+  const uint64_t *e64 = (const uint64_t *)e;
+
+  uint64_t keys[E_CMP_MAX_SIZE];
+  uint64_t vals[E_CMP_MAX_SIZE];
+  uint64_t w_keys[2 * MAX_WLIST_SIZE];
+
+  const size_t w_pow2 = next_pow2(w_size);
+  const size_t n      = next_pow2(E_QWORDS + w_size);
+  assert(n <= E_CMP_MAX_SIZE);
+
+  // The markers in ascending order, followed by padding keys, followed by
+  // the indices in descending order. This sequence is bitonic.
+  uint64_t weight = 0;
+  for(size_t i = 0; i < E_QWORDS; i++) {
+    keys[i] = i << 7;
+    vals[i] = e64[i];
+    weight += popcount64(e64[i]);
+  }
+  for(size_t i = E_QWORDS; i < n; i++) {
+    keys[i] = SORT_INF_KEY;
+    vals[i] = 0;
+  }
+
+  uint64_t count = 0;
+  for(size_t i = 0; i < w_size; i++) {
+    const uint64_t w     = wlist[i];
+    const uint64_t valid = less_than64(w, N_BITS);
+    const uint64_t in_e1 = 1 - less_than64(w, R_BITS);
+    const uint64_t pos   = w - (R_BITS & (0 - in_e1));
+    const uint64_t qw    = (pos >> 6) + (R_PADDED_QWORDS & (0 - in_e1));
+    const uint64_t key   = (qw << 7) | ((pos & MASK(6)) << 1) | 1;
+
+    w_keys[i] = (key & (0 - valid)) | (E_INVALID_KEY & (valid - 1));
+    count += valid;
+  }
+  for(size_t i = w_size; i < w_pow2; i++) {
+    w_keys[i] = SORT_INF_KEY;
+  }
+  bitonic_sort(w_keys, w_pow2);
+  for(size_t i = 0; i < w_size; i++) {
+    keys[n - 1 - i] = w_keys[i];
+  }
+
+  // Merge the markers and the indices with a bitonic merging network
+  for(size_t j = n >> 1; j > 0; j >>= 1) {
+    for(size_t i = 0; i < n; i++) {
+      if((i & j) == 0) {
+        const uint64_t mask = cmp_swap(&keys[i], &keys[i + j]);
+        const uint64_t diff = (vals[i] ^ vals[i + j]) & mask;
+        vals[i] ^= diff;
+        vals[i + j] ^= diff;
+      }
+    }
+  }
+
+  // A single pass carries the value of every QW to its indices (the padding
+  // keys behave as markers), and checks that their bits are set
+  uint64_t cur     = 0;
+  uint64_t all_set = 1;
+  for(size_t i = 0; i < n; i++) {
+    const uint64_t key       = keys[i];
+    const uint64_t is_marker = (key & 1) - 1;
+    const uint64_t is_index  = ~is_marker & (0 - less_than64(key, E_QWORDS << 7));
+
+    cur = (vals[i] & is_marker) | (cur & ~is_marker);
+    all_set &= ((cur >> ((key >> 1) & MASK(6))) | ~is_index) & 1;
+  }
+
+  secure_clean((uint8_t *)keys, sizeof(keys));
+  secure_clean((uint8_t *)vals, sizeof(vals));
+  secure_clean((uint8_t *)w_keys, sizeof(w_keys));
+
+  // The indices are distinct, so e holds exactly their bits when all of them
+  // are set and the weight of e is their number
+  return (uint32_t)all_set & (uint32_t)(1 - (less_than64(weight, count) |
+                                             less_than64(count, weight)));
+}
+
+uint32_t is_idx_dup_port(IN const idx_t  idx,
+                         IN const idx_t *wlist,
+                         IN const size_t w_size)
+{
+  uint32_t is_dup = 0;
+  for(size_t i = 0; i < w_size; i++) {
+    is_dup |= secure_cmp32(idx, wlist[i]);
+  }
+
+  return is_dup;
+}
+
 #if defined(UNIFORM_SAMPLING)
 ret_t sample_error_vec_indices_port(OUT idx_t *out,
                                     IN OUT prf_state_t *prf_state)
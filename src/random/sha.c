@@ -8,46 +8,57 @@
 // A SHA-384 implementation based on
 // https://csrc.nist.gov/publications/detail/fips/180/4/final
 
+#include "cpu_features.h"
 #include "sha.h"
 #include "utilities.h"
 
 #define INIT_HASH                                                 \
   {                                                               \
-    0xcbbb9d5dc1059ed8, 0x629a292a367cd507, 0x9159015a3070dd17,   \
-      0x152fecd8f70e5939, 0x67332667ffc00b31, 0x8eb44a8768581511, \
-      0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4                      \
+  0xcbbb9d5dc1059ed8, 0x629a292a367cd507, 0x9159015a3070dd17,   \
+  0x152fecd8f70e5939, 0x67332667ffc00b31, 0x8eb44a8768581511, \
+  0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4                      \
   }
 
-#define K                                                         \
-  {                                                               \
-    0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f,   \
-      0xe9b5dba58189dbbc, 0x3956c25bf348b538, 0x59f111f1b605d019, \
-      0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, \
-      0x12835b0145706fbe, 0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, \
-      0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235, \
-      0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, \
-      0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65, 0x2de92c6f592b0275, \
-      0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, \
-      0x983e5152ee66dfab, 0xa831c66d2db43210, 0xb00327c898fb213f, \
-      0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725, \
-      0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, \
-      0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed, 0x53380d139d95b3df, \
-      0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, \
-      0x92722c851482353b, 0xa2bfe8a14cf10364, 0xa81a664bbc423001, \
-      0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218, \
-      0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, \
-      0x19a4c116b8d2d0c8, 0x1e376c085141ab53, 0x2748774cdf8eeb99, \
-      0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, \
-      0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, \
-      0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec, \
-      0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, \
-      0xc67178f2e372532b, 0xca273eceea26619c, 0xd186b8c721c0c207, \
-      0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, \
-      0x0a637dc5a2c898a6, 0x113f9804bef90dae, 0x1b710b35131c471b, \
-      0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc, \
-      0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, \
-      0x5fcb6fab3ad6faec, 0x6c44198c4a475817                      \
-  }
+const uint64_t sha512_k[SHA512_ROUNDS] = {
+  0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f,
+  0xe9b5dba58189dbbc, 0x3956c25bf348b538, 0x59f111f1b605d019,
+  0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242,
+  0x12835b0145706fbe, 0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2,
+  0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+  0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3,
+  0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65, 0x2de92c6f592b0275,
+  0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5,
+  0x983e5152ee66dfab, 0xa831c66d2db43210, 0xb00327c898fb213f,
+  0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+  0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc,
+  0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed, 0x53380d139d95b3df,
+  0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6,
+  0x92722c851482353b, 0xa2bfe8a14cf10364, 0xa81a664bbc423001,
+  0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+  0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8,
+  0x19a4c116b8d2d0c8, 0x1e376c085141ab53, 0x2748774cdf8eeb99,
+  0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb,
+  0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc,
+  0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+  0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915,
+  0xc67178f2e372532b, 0xca273eceea26619c, 0xd186b8c721c0c207,
+  0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba,
+  0x0a637dc5a2c898a6, 0x113f9804bef90dae, 0x1b710b35131c471b,
+  0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+  0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a,
+  0x5fcb6fab3ad6faec, 0x6c44198c4a475817};
+
+// The SHA512 extensions are used only when both the CPU has them and the
+// library was built with SHA512_NI (sha512_ni.c).
+_INLINE_ uint32_t sha512_ni_available(void)
+{
+#if defined(SHA512_NI_SUPPORTED)
+  cpu_features_init();
+  return is_sha512_enabled();
+#else
+  return 0;
+#endif
+}
 
 _INLINE_ ret_t sha_update(IN OUT sha512_dgst_t *dgst,
                           IN const uint8_t *msg,
@@ -55,14 +66,19 @@ _INLINE_ ret_t sha_update(IN OUT sha512_dgst_t *dgst,
 {
   uint64_t a, b, c, d, e, f, g, h;
   uint64_t s0, s1, S0, S1, maj, ch, t1, t2;
-  uint64_t w[80];
-
-  uint64_t k[] = K;
+  uint64_t w[SHA512_ROUNDS];
 
   if(NULL == dgst || NULL == msg) {
     return FAIL;
   }
 
+#if defined(SHA512_NI_SUPPORTED)
+  if(sha512_ni_available()) {
+    sha512_update_ni(dgst, msg, n);
+    return SUCCESS;
+  }
+#endif
+
   while(n > 0) {
     a = dgst->u.qw[0];
     b = dgst->u.qw[1];
@@ -73,7 +89,7 @@ _INLINE_ ret_t sha_update(IN OUT sha512_dgst_t *dgst,
     g = dgst->u.qw[6];
     h = dgst->u.qw[7];
 
-    for(size_t i = 0; i < 80; i++) {
+    for(size_t i = 0; i < SHA512_ROUNDS; i++) {
       if(i < 16) {
         // memcpy is used to pass alignment issue.
         bike_memcpy(&w[i], &msg[8 * i], 8);
@@ -91,7 +107,7 @@ _INLINE_ ret_t sha_update(IN OUT sha512_dgst_t *dgst,
       ch  = g ^ (e & (f ^ g));
 
       t2 = s0 + maj;
-      t1 = h + s1 + ch + k[i] + w[i];
+      t1 = h + s1 + ch + sha512_k[i] + w[i];
 
       h = g;
       g = f;
@@ -121,20 +137,16 @@ _INLINE_ ret_t sha_update(IN OUT sha512_dgst_t *dgst,
   return SUCCESS;
 }
 
-ret_t sha(OUT sha_dgst_t *dgst, IN const uint32_t byte_len, IN const uint8_t *msg)
+// The padded last block(s) of a message of byte_len bytes: the bytes after
+// its whole blocks, the bit 1, the zeros, and the bit length. Returns the
+// number of bytes of the padded blocks.
+_INLINE_ uint32_t sha_last_blocks(OUT uint8_t last_block[2 * HASH_BLOCK_BYTES],
+                                  IN const uint32_t byte_len,
+                                  IN const uint8_t *msg)
 {
-  uint64_t       i;
+  uint32_t       i;
   uint32_t       last_len;
-  const uint64_t encoded_len             = bswap_64((uint64_t)byte_len * 8);
-  const uint64_t tmp[SHA512_DGST_QWORDS] = INIT_HASH;
-  sha512_dgst_t  _dgst;
-  bike_memcpy(_dgst.u.raw, (const uint8_t *)tmp, sizeof(_dgst));
-
-  uint8_t last_block[(2 * HASH_BLOCK_BYTES)];
-
-  if((NULL == dgst) || (NULL == msg)) {
-    return FAIL;
-  }
+  const uint64_t encoded_len = bswap_64((uint64_t)byte_len * 8);
 
   if((byte_len % HASH_BLOCK_BYTES) < 112) {
     last_len = HASH_BLOCK_BYTES;
@@ -154,6 +166,25 @@ ret_t sha(OUT sha_dgst_t *dgst, IN const uint32_t byte_len, IN const uint8_t *ms
 
   bike_memcpy(&last_block[last_len - 8], &encoded_len, sizeof(encoded_len));
 
+  return last_len;
+}
+
+ret_t sha(OUT sha_dgst_t *dgst, IN const uint32_t byte_len, IN const uint8_t *msg)
+{
+  uint64_t       i;
+  uint32_t       last_len;
+  const uint64_t tmp[SHA512_DGST_QWORDS] = INIT_HASH;
+  sha512_dgst_t  _dgst;
+  bike_memcpy(_dgst.u.raw, (const uint8_t *)tmp, sizeof(_dgst));
+
+  uint8_t last_block[(2 * HASH_BLOCK_BYTES)];
+
+  if((NULL == dgst) || (NULL == msg)) {
+    return FAIL;
+  }
+
+  last_len = sha_last_blocks(last_block, byte_len, msg);
+
   GUARD(sha_update(&_dgst, msg, byte_len / HASH_BLOCK_BYTES));
   GUARD(sha_update(&_dgst, last_block, last_len / HASH_BLOCK_BYTES));
 
@@ -166,3 +197,118 @@ ret_t sha(OUT sha_dgst_t *dgst, IN const uint32_t byte_len, IN const uint8_t *ms
 
   return SUCCESS;
 }
+
+// The messages are hashed together with the 4-way AVX2 implementation,
+// unless the SHA512 extensions are available (they hash a single message
+// faster than the 4-way implementation hashes every one of the messages).
+ret_t sha384_x4(OUT sha_dgst_x4_t *dgst,
+                IN const uint32_t     byte_len,
+                IN const uint8_t *const msg[SHA_X4_WAYS])
+{
+#if defined(X86_64)
+  cpu_features_init();
+  if(is_avx2_enabled() && !sha512_ni_available()) {
+    const uint64_t init[SHA512_DGST_QWORDS] = INIT_HASH;
+    uint64_t       s[SHA512_DGST_QWORDS * SHA_X4_WAYS];
+    uint8_t        last_block[SHA_X4_WAYS][2 * HASH_BLOCK_BYTES];
+    const uint8_t *last[SHA_X4_WAYS];
+    uint32_t       last_len = 0;
+
+    for(size_t l = 0; l < SHA_X4_WAYS; l++) {
+      for(size_t i = 0; i < SHA512_DGST_QWORDS; i++) {
+        s[(i * SHA_X4_WAYS) + l] = init[i];
+      }
+      last_len = sha_last_blocks(last_block[l], byte_len, msg[l]);
+      last[l]  = last_block[l];
+    }
+
+    sha512_update_x4_avx2(s, msg, byte_len / HASH_BLOCK_BYTES);
+    sha512_update_x4_avx2(s, last, last_len / HASH_BLOCK_BYTES);
+
+    for(size_t l = 0; l < SHA_X4_WAYS; l++) {
+      for(size_t i = 0; i < (sizeof(sha_dgst_t) / 8); i++) {
+        dgst->val[l].u.qw[i] = bswap_64(s[(i * SHA_X4_WAYS) + l]);
+      }
+    }
+
+    secure_clean((uint8_t *)s, sizeof(s));
+    secure_clean((uint8_t *)last_block, sizeof(last_block));
+
+    return SUCCESS;
+  }
+#endif
+
+  for(size_t l = 0; l < SHA_X4_WAYS; l++) {
+    GUARD(sha(&dgst->val[l], byte_len, msg[l]));
+  }
+
+  return SUCCESS;
+}
+
+ret_t sha_init(OUT sha_ctx_t *ctx)
+{
+  const uint64_t tmp[SHA512_DGST_QWORDS] = INIT_HASH;
+
+  bike_memcpy(ctx->h.u.raw, (const uint8_t *)tmp, sizeof(ctx->h));
+  ctx->block_len = 0;
+  ctx->byte_len  = 0;
+
+  return SUCCESS;
+}
+
+ret_t sha_absorb(IN OUT sha_ctx_t *ctx, IN const uint8_t *msg, IN size_t byte_len)
+{
+  ctx->byte_len += byte_len;
+
+  // Complete the partial block
+  if(ctx->block_len != 0) {
+    const size_t left = HASH_BLOCK_BYTES - ctx->block_len;
+    const size_t n    = (byte_len < left) ? byte_len : left;
+    bike_memcpy(&ctx->block[ctx->block_len], msg, n);
+    ctx->block_len += n;
+    msg += n;
+    byte_len -= n;
+
+    if(ctx->block_len < HASH_BLOCK_BYTES) {
+      return SUCCESS;
+    }
+
+    GUARD(sha_update(&ctx->h, ctx->block, 1));
+    ctx->block_len = 0;
+  }
+
+  // The whole blocks are hashed directly from msg
+  GUARD(sha_update(&ctx->h, msg, byte_len / HASH_BLOCK_BYTES));
+  msg += (byte_len / HASH_BLOCK_BYTES) * HASH_BLOCK_BYTES;
+
+  ctx->block_len = byte_len % HASH_BLOCK_BYTES;
+  bike_memcpy(ctx->block, msg, ctx->block_len);
+
+  return SUCCESS;
+}
+
+ret_t sha_final(OUT sha_dgst_t *dgst, IN OUT sha_ctx_t *ctx)
+{
+  const uint64_t encoded_len = bswap_64(ctx->byte_len * 8);
+  uint64_t       i           = ctx->block_len;
+
+  ctx->block[i++] = 0x80;
+
+  // The length does not fit in the last block
+  if(i > (HASH_BLOCK_BYTES - 16)) {
+    bike_memset(&ctx->block[i], 0, HASH_BLOCK_BYTES - i);
+    GUARD(sha_update(&ctx->h, ctx->block, 1));
+    i = 0;
+  }
+
+  bike_memset(&ctx->block[i], 0, HASH_BLOCK_BYTES - 8 - i);
+  bike_memcpy(&ctx->block[HASH_BLOCK_BYTES - 8], &encoded_len,
+              sizeof(encoded_len));
+  GUARD(sha_update(&ctx->h, ctx->block, 1));
+
+  for(i = 0; i < (sizeof(sha_dgst_t) / 8); i++) {
+    dgst->u.qw[i] = bswap_64(ctx->h.u.qw[i]);
+  }
+
+  return SUCCESS;
+}
@@ -0,0 +1,204 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "cleanup.h"
+#include "cpu_features.h"
+#include "fips202.h"
+#include "sha3_x4.h"
+
+// Domain separation bytes of SHA3 and SHAKE
+#define SHA3_DS  (0x06)
+#define SHAKE_DS (0x1f)
+
+#define SHA3_384_DGST_BYTES (48)
+#define MAX_RATE            (SHAKE256_RATE)
+
+typedef void (*keccak_permute_t)(IN OUT uint64_t *s);
+
+typedef struct keccak_mb_ctx_s {
+  keccak_permute_t permute_x4;
+
+  // NULL when there is no 8-way implementation for the current CPU,
+  // in which case the 8-way APIs use the 4-way permutation twice.
+  keccak_permute_t permute_x8;
+} keccak_mb_ctx;
+
+static keccak_mb_ctx  mb_ctx;
+static pthread_once_t mb_ctx_once = PTHREAD_ONCE_INIT;
+static uint32_t       mb_ctx_generation;
+
+static void keccak_mb_ctx_init(void)
+{
+  cpu_features_init();
+  mb_ctx_generation = cpu_features_generation();
+
+  mb_ctx.permute_x4 = keccak_f1600_x4_port;
+  mb_ctx.permute_x8 = NULL;
+
+#if defined(X86_64)
+  if(is_avx2_enabled()) {
+    mb_ctx.permute_x4 = keccak_f1600_x4_avx2;
+  }
+  if(is_avx512_enabled()) {
+    mb_ctx.permute_x8 = keccak_f1600_x8_avx512;
+  }
+#endif
+}
+
+_INLINE_ const keccak_mb_ctx *get_keccak_mb_ctx(void)
+{
+  pthread_once(&mb_ctx_once, keccak_mb_ctx_init);
+
+  if(mb_ctx_generation != cpu_features_generation()) {
+    keccak_mb_ctx_init();
+  }
+
+  return &mb_ctx;
+}
+
+_INLINE_ uint64_t load64(IN const uint8_t x[8])
+{
+  uint64_t r = 0;
+  for(size_t i = 0; i < 8; i++) {
+    r |= (uint64_t)x[i] << (8 * i);
+  }
+  return r;
+}
+
+// Absorb the (equal length) messages in[0..ways-1] into the interleaved
+// state s, including the padding of the last block. The state holds the
+// (possibly secret) messages, and must be cleaned by the caller.
+static void keccak_absorb_xn(OUT uint64_t *s,
+                             IN const size_t ways,
+                             IN const size_t rate,
+                             IN const uint8_t *const in[],
+                             IN size_t                inlen,
+                             IN const uint8_t         ds,
+                             IN keccak_permute_t      permute)
+{
+  uint8_t t[MAX_RATE];
+  size_t  off = 0;
+
+  memset(s, 0, KECCAK_STATE_QWORDS * ways * sizeof(uint64_t));
+
+  for(; inlen >= rate; inlen -= rate, off += rate) {
+    for(size_t i = 0; i < rate / 8; i++) {
+      for(size_t l = 0; l < ways; l++) {
+        s[(i * ways) + l] ^= load64(&in[l][off + (8 * i)]);
+      }
+    }
+    permute(s);
+  }
+
+  for(size_t l = 0; l < ways; l++) {
+    memset(t, 0, rate);
+    memcpy(t, &in[l][off], inlen);
+    t[inlen] = ds;
+    t[rate - 1] |= 128;
+
+    for(size_t i = 0; i < rate / 8; i++) {
+      s[(i * ways) + l] ^= load64(&t[8 * i]);
+    }
+  }
+
+  secure_clean(t, sizeof(t));
+}
+
+// Squeeze outlen bytes from every lane of the interleaved state s
+static void keccak_squeeze_xn(OUT uint8_t *const out[],
+                              IN size_t          outlen,
+                              IN OUT uint64_t *s,
+                              IN const size_t  ways,
+                              IN const size_t  rate,
+                              IN keccak_permute_t permute)
+{
+  for(size_t off = 0; outlen > 0; off += rate) {
+    const size_t len = (outlen < rate) ? outlen : rate;
+
+    permute(s);
+
+    for(size_t l = 0; l < ways; l++) {
+      for(size_t i = 0; i < len; i++) {
+        out[l][off + i] = (uint8_t)(s[((i / 8) * ways) + l] >> (8 * (i % 8)));
+      }
+    }
+    outlen -= len;
+  }
+}
+
+void sha3_384_x4(OUT uint8_t *const h[KECCAK_X4_WAYS],
+                 IN const uint8_t *const in[KECCAK_X4_WAYS],
+                 IN size_t               inlen)
+{
+  const keccak_mb_ctx *ctx = get_keccak_mb_ctx();
+  uint64_t             s[KECCAK_STATE_QWORDS * KECCAK_X4_WAYS];
+
+  keccak_absorb_xn(s, KECCAK_X4_WAYS, SHA3_384_RATE, in, inlen, SHA3_DS,
+                   ctx->permute_x4);
+  keccak_squeeze_xn(h, SHA3_384_DGST_BYTES, s, KECCAK_X4_WAYS, SHA3_384_RATE,
+                    ctx->permute_x4);
+  secure_clean((uint8_t *)s, sizeof(s));
+}
+
+void shake256_x4(OUT uint8_t *const out[KECCAK_X4_WAYS],
+                 IN size_t               outlen,
+                 IN const uint8_t *const in[KECCAK_X4_WAYS],
+                 IN size_t               inlen)
+{
+  const keccak_mb_ctx *ctx = get_keccak_mb_ctx();
+  uint64_t             s[KECCAK_STATE_QWORDS * KECCAK_X4_WAYS];
+
+  keccak_absorb_xn(s, KECCAK_X4_WAYS, SHAKE256_RATE, in, inlen, SHAKE_DS,
+                   ctx->permute_x4);
+  keccak_squeeze_xn(out, outlen, s, KECCAK_X4_WAYS, SHAKE256_RATE,
+                    ctx->permute_x4);
+  secure_clean((uint8_t *)s, sizeof(s));
+}
+
+void sha3_384_x8(OUT uint8_t *const h[KECCAK_X8_WAYS],
+                 IN const uint8_t *const in[KECCAK_X8_WAYS],
+                 IN size_t               inlen)
+{
+  const keccak_mb_ctx *ctx = get_keccak_mb_ctx();
+  uint64_t             s[KECCAK_STATE_QWORDS * KECCAK_X8_WAYS];
+
+  if(ctx->permute_x8 == NULL) {
+    sha3_384_x4(&h[0], &in[0], inlen);
+    sha3_384_x4(&h[KECCAK_X4_WAYS], &in[KECCAK_X4_WAYS], inlen);
+    return;
+  }
+
+  keccak_absorb_xn(s, KECCAK_X8_WAYS, SHA3_384_RATE, in, inlen, SHA3_DS,
+                   ctx->permute_x8);
+  keccak_squeeze_xn(h, SHA3_384_DGST_BYTES, s, KECCAK_X8_WAYS, SHA3_384_RATE,
+                    ctx->permute_x8);
+  secure_clean((uint8_t *)s, sizeof(s));
+}
+
+void shake256_x8(OUT uint8_t *const out[KECCAK_X8_WAYS],
+                 IN size_t               outlen,
+                 IN const uint8_t *const in[KECCAK_X8_WAYS],
+                 IN size_t               inlen)
+{
+  const keccak_mb_ctx *ctx = get_keccak_mb_ctx();
+  uint64_t             s[KECCAK_STATE_QWORDS * KECCAK_X8_WAYS];
+
+  if(ctx->permute_x8 == NULL) {
+    shake256_x4(&out[0], outlen, &in[0], inlen);
+    shake256_x4(&out[KECCAK_X4_WAYS], outlen, &in[KECCAK_X4_WAYS], inlen);
+    return;
+  }
+
+  keccak_absorb_xn(s, KECCAK_X8_WAYS, SHAKE256_RATE, in, inlen, SHAKE_DS,
+                   ctx->permute_x8);
+  keccak_squeeze_xn(out, outlen, s, KECCAK_X8_WAYS, SHAKE256_RATE,
+                    ctx->permute_x8);
+  secure_clean((uint8_t *)s, sizeof(s));
+}
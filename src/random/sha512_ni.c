@@ -0,0 +1,87 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include "sha.h"
+
+#define AVX2_INTERNAL
+#include "x86_64_intrinsic.h"
+
+// The SHA512 instructions hold the state in two registers, (A, B, E, F) and
+// (C, D, G, H) from the most significant qword, and compute two rounds at a
+// time (VSHA512RNDS2). A register of the message schedule holds 4 words,
+// W[i + 4] is computed from W[i] with VSHA512MSG1 and VSHA512MSG2.
+
+#define ADD(a, b) _mm256_add_epi64(a, b)
+
+// Words 1, 2, 3 of a and word 0 of b
+#define ALIGNR_QW(b, a) \
+  _mm256_permute4x64_epi64(_mm256_blend_epi32(a, b, 0x03), 0x39)
+
+#define MSG_VECS (HASH_BLOCK_BYTES / BYTES_IN_YMM)
+
+void sha512_update_ni(IN OUT sha512_dgst_t *dgst,
+                      IN const uint8_t *msg,
+                      IN size_t         n)
+{
+  // Reverses the bytes of every qword
+  const __m256i bswap =
+    _mm256_set_epi64x(0x08090a0b0c0d0e0f, 0x0001020304050607,
+                      0x08090a0b0c0d0e0f, 0x0001020304050607);
+
+  // (D, C, B, A) and (H, G, F, E) to (A, B, E, F) and (C, D, G, H)
+  const __m256i dcba = _mm256_permute4x64_epi64(LOAD(&dgst->u.qw[0]), 0x1b);
+  const __m256i hgfe = _mm256_permute4x64_epi64(LOAD(&dgst->u.qw[4]), 0x1b);
+  __m256i       abef = _mm256_permute2x128_si256(hgfe, dcba, 0x31);
+  __m256i       cdgh = _mm256_permute2x128_si256(hgfe, dcba, 0x20);
+
+  __m256i w[MSG_VECS];
+
+  for(; n > 0; n--) {
+    const __m256i abef_prev = abef;
+    const __m256i cdgh_prev = cdgh;
+
+    for(size_t i = 0; i < (SHA512_ROUNDS / 4); i++) {
+      const size_t j = i % MSG_VECS;
+
+      if(i < MSG_VECS) {
+        w[j] = _mm256_shuffle_epi8(LOAD(&msg[j * BYTES_IN_YMM]), bswap);
+      } else {
+        // W[i] + s0(W[i + 1]) + W[i + 9] + s1(W[i + 14])
+        const __m256i w3 = w[(j + 3) % MSG_VECS];
+        __m256i       t  = _mm256_sha512msg1_epi64(
+          w[j], _mm256_castsi256_si128(w[(j + 1) % MSG_VECS]));
+        t    = ADD(t, ALIGNR_QW(w3, w[(j + 2) % MSG_VECS]));
+        w[j] = _mm256_sha512msg2_epi64(t, w3);
+      }
+
+      const __m256i wk = ADD(w[j], LOAD(&sha512_k[4 * i]));
+
+      __m256i t = _mm256_sha512rnds2_epi64(cdgh, abef,
+                                           _mm256_castsi256_si128(wk));
+      cdgh      = abef;
+      abef      = t;
+
+      t    = _mm256_sha512rnds2_epi64(cdgh, abef,
+                                      _mm256_extracti128_si256(wk, 1));
+      cdgh = abef;
+      abef = t;
+    }
+
+    abef = ADD(abef, abef_prev);
+    cdgh = ADD(cdgh, cdgh_prev);
+    msg += HASH_BLOCK_BYTES;
+  }
+
+  STORE(&dgst->u.qw[0],
+        _mm256_permute4x64_epi64(
+          _mm256_permute2x128_si256(cdgh, abef, 0x31), 0x1b));
+  STORE(&dgst->u.qw[4],
+        _mm256_permute4x64_epi64(
+          _mm256_permute2x128_si256(cdgh, abef, 0x20), 0x1b));
+
+  secure_clean((uint8_t *)w, sizeof(w));
+}
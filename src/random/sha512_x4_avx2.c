@@ -0,0 +1,115 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ */
+
+#include "sha.h"
+#include "utilities.h"
+
+#define AVX2_INTERNAL
+#include "x86_64_intrinsic.h"
+
+// Every register holds the same word of the 4 interleaved states (or of the
+// message schedules of the 4 messages)
+#define ADD(a, b)   _mm256_add_epi64(a, b)
+#define ROR(a, n)   (SRLI_I64(a, n) | SLLI_I64(a, 64 - (n)))
+#define SET1(a)     _mm256_set1_epi64x((int64_t)(a))
+#define BIG_S0(a)   (ROR(a, 28) ^ ROR(a, 34) ^ ROR(a, 39))
+#define BIG_S1(a)   (ROR(a, 14) ^ ROR(a, 18) ^ ROR(a, 41))
+#define SMALL_S0(a) (ROR(a, 1) ^ ROR(a, 8) ^ SRLI_I64(a, 7))
+#define SMALL_S1(a) (ROR(a, 19) ^ ROR(a, 61) ^ SRLI_I64(a, 6))
+
+#define BLOCK_QWORDS (HASH_BLOCK_BYTES / 8)
+
+// Word i of the block of every message, in big endian
+_INLINE_ __m256i load_w(IN const uint8_t *const msg[SHA_X4_WAYS],
+                        IN const size_t         off)
+{
+  uint64_t w[SHA_X4_WAYS];
+
+  for(size_t l = 0; l < SHA_X4_WAYS; l++) {
+    // memcpy is used to pass alignment issue.
+    bike_memcpy(&w[l], &msg[l][off], 8);
+    w[l] = bswap_64(w[l]);
+  }
+
+  return _mm256_set_epi64x((int64_t)w[3], (int64_t)w[2], (int64_t)w[1],
+                           (int64_t)w[0]);
+}
+
+// One round, where the roles of the state words rotate instead of the words
+#define ROUND(a, b, c, d, e, f, g, h, wk)                                  \
+  do {                                                                     \
+    const __m256i ch  = (g) ^ ((e) & ((f) ^ (g)));                         \
+    const __m256i maj = ((b) & (c)) | ((a) & ((b) ^ (c)));                 \
+    const __m256i t1  = ADD(ADD(h, BIG_S1(e)), ADD(ch, wk));               \
+    (d)               = ADD(d, t1);                                        \
+    (h)               = ADD(t1, ADD(BIG_S0(a), maj));                      \
+  } while(0)
+
+void sha512_update_x4_avx2(IN OUT uint64_t s[SHA512_DGST_QWORDS * SHA_X4_WAYS],
+                           IN const uint8_t *const msg[SHA_X4_WAYS],
+                           IN size_t               n)
+{
+  __m256i        st[SHA512_DGST_QWORDS];
+  __m256i        w[SHA512_ROUNDS];
+  __m256i        wk[SHA512_ROUNDS];
+  const uint8_t *m[SHA_X4_WAYS];
+
+  for(size_t i = 0; i < SHA512_DGST_QWORDS; i++) {
+    st[i] = LOAD(&s[i * SHA_X4_WAYS]);
+  }
+  for(size_t l = 0; l < SHA_X4_WAYS; l++) {
+    m[l] = msg[l];
+  }
+
+  for(; n > 0; n--) {
+    // The message schedule (with the round constants) is computed first, so
+    // that the rounds keep only the state in registers
+    for(size_t i = 0; i < SHA512_ROUNDS; i++) {
+      if(i < BLOCK_QWORDS) {
+        w[i] = load_w(m, 8 * i);
+      } else {
+        w[i] = ADD(ADD(w[i - 16], SMALL_S0(w[i - 15])),
+                   ADD(w[i - 7], SMALL_S1(w[i - 2])));
+      }
+      wk[i] = ADD(w[i], SET1(sha512_k[i]));
+    }
+
+    __m256i a = st[0], b = st[1], c = st[2], d = st[3];
+    __m256i e = st[4], f = st[5], g = st[6], h = st[7];
+
+    for(size_t i = 0; i < SHA512_ROUNDS; i += 8) {
+      ROUND(a, b, c, d, e, f, g, h, wk[i]);
+      ROUND(h, a, b, c, d, e, f, g, wk[i + 1]);
+      ROUND(g, h, a, b, c, d, e, f, wk[i + 2]);
+      ROUND(f, g, h, a, b, c, d, e, wk[i + 3]);
+      ROUND(e, f, g, h, a, b, c, d, wk[i + 4]);
+      ROUND(d, e, f, g, h, a, b, c, wk[i + 5]);
+      ROUND(c, d, e, f, g, h, a, b, wk[i + 6]);
+      ROUND(b, c, d, e, f, g, h, a, wk[i + 7]);
+    }
+
+    st[0] = ADD(st[0], a);
+    st[1] = ADD(st[1], b);
+    st[2] = ADD(st[2], c);
+    st[3] = ADD(st[3], d);
+    st[4] = ADD(st[4], e);
+    st[5] = ADD(st[5], f);
+    st[6] = ADD(st[6], g);
+    st[7] = ADD(st[7], h);
+
+    for(size_t l = 0; l < SHA_X4_WAYS; l++) {
+      m[l] += HASH_BLOCK_BYTES;
+    }
+  }
+
+  for(size_t i = 0; i < SHA512_DGST_QWORDS; i++) {
+    STORE(&s[i * SHA_X4_WAYS], st[i]);
+  }
+
+  secure_clean((uint8_t *)w, sizeof(w));
+  secure_clean((uint8_t *)wk, sizeof(wk));
+}
@@ -19,39 +19,77 @@ ret_t init_prf_state(OUT shake256_prf_state_t *s, IN size_t max_num_invocations,
   // Initialize the SHAKE state with the given seed.
   shake256_absorb(s->s, seed->raw, sizeof(*seed));
 
-  // Initialize the PRF parameters.
-  s->curr_pos_in_buffer = SHAKE256_RATE;
+  // Initialize the PRF parameters (the buffer is empty).
+  s->curr_pos_in_buffer = 0;
+  s->buffer_len         = 0;
   s->rem_invocations    = max_num_invocations;
 
   return SUCCESS;
 }
 
-ret_t get_prf_output(OUT uint8_t *out, IN OUT shake256_prf_state_t *s,
-                     IN size_t len)
+// Squeeze nblocks blocks of SHAKE256_RATE bytes into out.
+// Every block counts as one SHAKE invocation.
+_INLINE_ ret_t squeeze_blocks(OUT uint8_t *out,
+                              IN size_t    nblocks,
+                              IN OUT shake256_prf_state_t *s)
 {
   // Check if the maximum number of SHAKE invocations is reached.
-  if (s->rem_invocations == 0)
-  {
+  if((nblocks == 0) || (nblocks > s->rem_invocations)) {
     BIKE_ERROR(E_SHAKE_OVER_USED);
   }
 
-  // When |len| is smaller then use what's left in the buffer,
+  shake256_squeeze(out, nblocks, s->s);
+  s->rem_invocations -= nblocks;
+
+  return SUCCESS;
+}
+
+// The output is one contiguous SHAKE256 stream, regardless of the lengths
+// of the individual requests.
+ret_t get_prf_output(OUT uint8_t *out, IN OUT shake256_prf_state_t *s,
+                     IN size_t len)
+{
+  const size_t avail = s->buffer_len - s->curr_pos_in_buffer;
+
+  // When |len| is smaller than what's left in the buffer,
   // there is no need for additional SHAKE256 invocations.
-  if((len + s->curr_pos_in_buffer) <= SHAKE256_RATE) {
+  if(len <= avail) {
     bike_memcpy(out, &s->buffer[s->curr_pos_in_buffer], len);
     s->curr_pos_in_buffer += len;
 
     return SUCCESS;
   }
 
-  // Generate one block (SHAKE256_RATE bytes) of random data with SHAKE256.
-  shake256_squeeze(s->buffer, 1, s->s);
+  // Use what's left in the buffer.
+  bike_memcpy(out, &s->buffer[s->curr_pos_in_buffer], avail);
+  out += avail;
+  len -= avail;
+
+  s->curr_pos_in_buffer = 0;
+  s->buffer_len         = 0;
+
+  // Squeeze the whole blocks of the request directly into the output.
+  const size_t nblocks = len / SHAKE256_RATE;
+  if(nblocks != 0) {
+    GUARD(squeeze_blocks(out, nblocks, s));
+    out += nblocks * SHAKE256_RATE;
+    len -= nblocks * SHAKE256_RATE;
+  }
+
+  if(len == 0) {
+    return SUCCESS;
+  }
+
+  // Refill the buffer with up to SHAKE_PRF_BUFFER_BLOCKS blocks and copy
+  // the rest of the request from it.
+  const size_t nrefill = (s->rem_invocations < SHAKE_PRF_BUFFER_BLOCKS)
+                           ? s->rem_invocations
+                           : SHAKE_PRF_BUFFER_BLOCKS;
+  GUARD(squeeze_blocks(s->buffer, nrefill, s));
 
-  // Copy |len| bytes to the output, set the new buffer position indicator,
-  // and update the remaining allowable number of SHAKE invocations.
   bike_memcpy(out, s->buffer, len);
   s->curr_pos_in_buffer = len;
-  s->rem_invocations -= 1;
+  s->buffer_len         = nrefill * SHAKE256_RATE;
 
   return SUCCESS;
 }
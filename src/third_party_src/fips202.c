@@ -395,6 +395,83 @@ static void keccak_absorb(uint64_t s[25],
     s[i] ^= load64(t + 8*i);
 }
 
+/*************************************************
+* Name:        keccak_inc_init
+*
+* Description: Initializes the incremental Keccak state to zero.
+*
+* Arguments:   - uint64_t *s_inc: pointer to the incremental Keccak state
+**************************************************/
+static void keccak_inc_init(uint64_t s_inc[26])
+{
+  size_t i;
+
+  for(i=0;i<26;i++)
+    s_inc[i] = 0;
+}
+
+/*************************************************
+* Name:        keccak_inc_absorb
+*
+* Description: Incremental absorb step of Keccak. Can be called multiple
+*              times; the input of all the calls is absorbed as if it was
+*              given to keccak_absorb at once. The whole words of the input
+*              are absorbed with load64 when the position in the block is
+*              a multiple of 8, and the other bytes one at a time.
+*
+* Arguments:   - uint64_t *s_inc: pointer to the incremental Keccak state
+*              - unsigned int r: rate in bytes (e.g., 168 for SHAKE128)
+*              - const uint8_t *m: pointer to input to be absorbed into s
+*              - size_t mlen: length of input in bytes
+**************************************************/
+static void keccak_inc_absorb(uint64_t s_inc[26],
+                              unsigned int r,
+                              const uint8_t *m,
+                              size_t mlen)
+{
+  uint64_t pos = s_inc[25];
+
+  while(mlen > 0) {
+    if(((pos & 7) == 0) && (mlen >= 8)) {
+      s_inc[pos >> 3] ^= load64(m);
+      pos += 8;
+      m += 8;
+      mlen -= 8;
+    } else {
+      s_inc[pos >> 3] ^= (uint64_t)m[0] << (8 * (pos & 7));
+      pos++;
+      m++;
+      mlen--;
+    }
+
+    if(pos == r) {
+      KeccakF1600_StatePermute(s_inc);
+      pos = 0;
+    }
+  }
+
+  s_inc[25] = pos;
+}
+
+/*************************************************
+* Name:        keccak_inc_finalize
+*
+* Description: Finalizes the incremental absorb step of Keccak: adds the
+*              domain-separation byte and the padding. The state can then be
+*              squeezed with keccak_squeezeblocks.
+*
+* Arguments:   - uint64_t *s_inc: pointer to the incremental Keccak state
+*              - unsigned int r: rate in bytes (e.g., 168 for SHAKE128)
+*              - uint8_t p: domain-separation byte for different
+*                           Keccak-derived functions
+**************************************************/
+static void keccak_inc_finalize(uint64_t s_inc[26], unsigned int r, uint8_t p)
+{
+  s_inc[s_inc[25] >> 3] ^= (uint64_t)p << (8 * (s_inc[25] & 7));
+  s_inc[(r - 1) >> 3] ^= (uint64_t)128 << (8 * ((r - 1) & 7));
+  s_inc[25] = 0;
+}
+
 /*************************************************
 * Name:        keccak_squeezeblocks
 *
@@ -454,6 +531,32 @@ void shake256_squeeze(uint8_t *out, size_t nblocks, uint64_t state[25])
   keccak_squeezeblocks(out, nblocks, state, SHAKE256_RATE);
 }
 
+/*************************************************
+* Name:        shake256_inc_init, shake256_inc_absorb, shake256_inc_finalize
+*
+* Description: Incremental absorb step of the SHAKE256 XOF. After
+*              shake256_inc_finalize, the output is squeezed by
+*              shake256_squeeze (on the first 25 words of s_inc).
+*
+* Arguments:   - uint64_t *s_inc:  pointer to the incremental Keccak state
+*              - const uint8_t *in: pointer to input to be absorbed into s
+*              - size_t inlen:      length of input in bytes
+**************************************************/
+void shake256_inc_init(uint64_t s_inc[26])
+{
+  keccak_inc_init(s_inc);
+}
+
+void shake256_inc_absorb(uint64_t s_inc[26], const uint8_t *in, size_t inlen)
+{
+  keccak_inc_absorb(s_inc, SHAKE256_RATE, in, inlen);
+}
+
+void shake256_inc_finalize(uint64_t s_inc[26])
+{
+  keccak_inc_finalize(s_inc, SHAKE256_RATE, 0x1F);
+}
+
 /*************************************************
 * Name:        shake256
 *
@@ -505,3 +608,35 @@ void sha3_384(uint8_t h[48], const uint8_t *in, size_t inlen)
   for(i=0;i<48;i++)
     h[i] = t[i];
 }
+
+/*************************************************
+* Name:        sha3_384_inc_init, sha3_384_inc_absorb, sha3_384_inc_finalize
+*
+* Description: SHA3-384 with incremental API
+*
+* Arguments:   - uint64_t *s_inc:  pointer to the incremental Keccak state
+*              - const uint8_t *in: pointer to input
+*              - size_t inlen:      length of input in bytes
+*              - uint8_t *h:        pointer to output (48 bytes)
+**************************************************/
+void sha3_384_inc_init(uint64_t s_inc[26])
+{
+  keccak_inc_init(s_inc);
+}
+
+void sha3_384_inc_absorb(uint64_t s_inc[26], const uint8_t *in, size_t inlen)
+{
+  keccak_inc_absorb(s_inc, SHA3_384_RATE, in, inlen);
+}
+
+void sha3_384_inc_finalize(uint8_t h[48], uint64_t s_inc[26])
+{
+  unsigned int i;
+  uint8_t t[SHA3_384_RATE];
+
+  keccak_inc_finalize(s_inc, SHA3_384_RATE, 0x06);
+  keccak_squeezeblocks(t, 1, s_inc, SHA3_384_RATE);
+
+  for(i=0;i<48;i++)
+    h[i] = t[i];
+}
@@ -23,3 +23,14 @@ void sha3_384(uint8_t h[48], const uint8_t *in, size_t inlen);
 void shake256(uint8_t *out, size_t outlen, const uint8_t *in, size_t inlen);
 void shake256_absorb(uint64_t state[25], const uint8_t *in, size_t inlen);
 void shake256_squeeze(uint8_t *out, size_t nblocks, uint64_t state[25]);
+
+/* Incremental API: s_inc[0..24] is the Keccak state and s_inc[25] is the
+ * number of bytes that were absorbed into the current block. After
+ * shake256_inc_finalize, the output is squeezed with shake256_squeeze. */
+void sha3_384_inc_init(uint64_t s_inc[26]);
+void sha3_384_inc_absorb(uint64_t s_inc[26], const uint8_t *in, size_t inlen);
+void sha3_384_inc_finalize(uint8_t h[48], uint64_t s_inc[26]);
+
+void shake256_inc_init(uint64_t s_inc[26]);
+void shake256_inc_absorb(uint64_t s_inc[26], const uint8_t *in, size_t inlen);
+void shake256_inc_finalize(uint64_t s_inc[26]);
@@ -9,9 +9,23 @@
 #include <openssl/conf.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <string.h>
 
-AES256_CTR_DRBG_struct DRBG_ctx;
+// Every thread has its own DRBG, so that bike-katcheck can check several
+// records in parallel. randombytes_init seeds the DRBG of the calling thread.
+// A thread that calls randombytes before seeding its DRBG (e.g., a helper
+// thread of the library) is seeded from the main DRBG - the one seeded by the
+// first call to randombytes_init - with a per-thread nonce as the
+// personalization string.
+static __thread AES256_CTR_DRBG_struct DRBG_ctx;
+static __thread int                    DRBG_seeded;
+
+static AES256_CTR_DRBG_struct main_DRBG_ctx;
+static int                    main_DRBG_seeded;
+static uint64_t               main_DRBG_nonce;
+static pthread_mutex_t        main_DRBG_lock = PTHREAD_MUTEX_INITIALIZER;
 
 void
 AES256_ECB(unsigned char *key, unsigned char *ctr, unsigned char *buffer);
@@ -138,10 +152,10 @@ AES256_ECB(unsigned char *key, unsigned char *ctr, unsigned char *buffer)
   EVP_CIPHER_CTX_free(ctx);
 }
 
-void
-randombytes_init(unsigned char *             entropy_input,
-                 unsigned char *             personalization_string,
-                 __attribute__((unused)) int security_strength)
+static void
+drbg_init(AES256_CTR_DRBG_struct *ctx,
+          unsigned char *         entropy_input,
+          unsigned char *         personalization_string)
 {
   unsigned char seed_material[48];
 
@@ -149,14 +163,16 @@ randombytes_init(unsigned char *             entropy_input,
   if(personalization_string)
     for(int i = 0; i < 48; i++)
       seed_material[i] ^= personalization_string[i];
-  memset(DRBG_ctx.Key, 0x00, 32);
-  memset(DRBG_ctx.V, 0x00, 16);
-  AES256_CTR_DRBG_Update(seed_material, DRBG_ctx.Key, DRBG_ctx.V);
-  DRBG_ctx.reseed_counter = 1;
+  memset(ctx->Key, 0x00, 32);
+  memset(ctx->V, 0x00, 16);
+  AES256_CTR_DRBG_Update(seed_material, ctx->Key, ctx->V);
+  ctx->reseed_counter = 1;
 }
 
-int
-randombytes(unsigned char *x, unsigned long long xlen)
+static void
+drbg_generate(AES256_CTR_DRBG_struct *ctx,
+              unsigned char *         x,
+              unsigned long long      xlen)
 {
   unsigned char block[16];
   int           i = 0;
@@ -166,15 +182,15 @@ randombytes(unsigned char *x, unsigned long long xlen)
     // increment V
     for(int j = 15; j >= 0; j--)
     {
-      if(DRBG_ctx.V[j] == 0xff)
-        DRBG_ctx.V[j] = 0x00;
+      if(ctx->V[j] == 0xff)
+        ctx->V[j] = 0x00;
       else
       {
-        DRBG_ctx.V[j]++;
+        ctx->V[j]++;
         break;
       }
     }
-    AES256_ECB(DRBG_ctx.Key, DRBG_ctx.V, block);
+    AES256_ECB(ctx->Key, ctx->V, block);
     if(xlen > 15)
     {
       memcpy(x + i, block, 16);
@@ -187,8 +203,51 @@ randombytes(unsigned char *x, unsigned long long xlen)
       xlen = 0;
     }
   }
-  AES256_CTR_DRBG_Update(NULL, DRBG_ctx.Key, DRBG_ctx.V);
-  DRBG_ctx.reseed_counter++;
+  AES256_CTR_DRBG_Update(NULL, ctx->Key, ctx->V);
+  ctx->reseed_counter++;
+}
+
+// Seed the DRBG of the calling thread from the main DRBG
+static void
+seed_from_main(void)
+{
+  unsigned char entropy_input[48];
+  unsigned char personalization_string[48] = {0};
+
+  pthread_mutex_lock(&main_DRBG_lock);
+  drbg_generate(&main_DRBG_ctx, entropy_input, sizeof(entropy_input));
+  const uint64_t nonce = ++main_DRBG_nonce;
+  pthread_mutex_unlock(&main_DRBG_lock);
+
+  memcpy(personalization_string, &nonce, sizeof(nonce));
+  drbg_init(&DRBG_ctx, entropy_input, personalization_string);
+  DRBG_seeded = 1;
+}
+
+void
+randombytes_init(unsigned char *             entropy_input,
+                 unsigned char *             personalization_string,
+                 __attribute__((unused)) int security_strength)
+{
+  drbg_init(&DRBG_ctx, entropy_input, personalization_string);
+  DRBG_seeded = 1;
+
+  pthread_mutex_lock(&main_DRBG_lock);
+  if(!main_DRBG_seeded)
+  {
+    drbg_init(&main_DRBG_ctx, entropy_input, personalization_string);
+    main_DRBG_seeded = 1;
+  }
+  pthread_mutex_unlock(&main_DRBG_lock);
+}
+
+int
+randombytes(unsigned char *x, unsigned long long xlen)
+{
+  if(!DRBG_seeded)
+    seed_from_main();
+
+  drbg_generate(&DRBG_ctx, x, xlen);
 
   return RNG_SUCCESS;
 }
@@ -0,0 +1,625 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ *
+ * Benchmarks of the KEM and of its main primitives.
+ * Every call is measured separately, and the distribution of the measurements
+ * (median, p90, p99, mean and standard deviation, in cycles) is reported as
+ * text, CSV or JSON. By default, the benchmarks run once for every ISA that
+ * the CPU supports (see bike_isa.h), to compare the backends in one run.
+ * With -p, the hardware performance counters of every measured operation are
+ * also read (through perf_event_open on Linux) and reported per call.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+// For syscall
+#define _DEFAULT_SOURCE
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#endif
+
+#include "bike_isa.h"
+#include "cpu_features.h"
+#include "decode.h"
+#include "dispatch.h"
+#include "gf2x.h"
+#include "kem.h"
+#include "measurements.h"
+#include "sampling.h"
+#include "sha.h"
+#include "utilities.h"
+
+#if defined(USE_SHA3_AND_SHAKE)
+#  include "sha3_x4.h"
+#endif
+
+#define DEFAULT_SAMPLES 1000
+#define MAX_RESULTS     128
+
+// The hardware counters that are read with -p. There is no generic event
+// for the L2 misses (only raw, vendor specific ones), so they are not
+// reported. A counter that the kernel or the CPU does not support is skipped.
+typedef enum
+{
+  PERF_INSTRUCTIONS = 0,
+  PERF_CYCLES,
+  PERF_L1D_MISSES,
+  PERF_LLC_MISSES,
+  PERF_BRANCH_MISSES,
+  PERF_NUM_COUNTERS
+} perf_counter_t;
+
+static const char *const perf_names[PERF_NUM_COUNTERS] = {
+  "instructions", "cycles", "l1d_misses", "llc_misses", "branch_misses"};
+
+typedef enum
+{
+  FORMAT_TEXT = 0,
+  FORMAT_CSV  = 1,
+  FORMAT_JSON = 2
+} bench_format_t;
+
+typedef struct bench_result_s {
+  const char *name;
+  const char *backend;
+  size_t      samples;
+  uint64_t    median;
+  uint64_t    p90;
+  uint64_t    p99;
+  double      mean;
+  double      stddev;
+
+  // The average count per call of every counter (with -p), where the bit i
+  // of perf_valid is set if the counter i was read.
+  double   perf[PERF_NUM_COUNTERS];
+  uint32_t perf_valid;
+} bench_result_t;
+
+typedef struct bench_s {
+  uint64_t *     samples;
+  size_t         num_samples;
+  bench_result_t results[MAX_RESULTS];
+  size_t         num_results;
+
+  // The file descriptors of the counters (-1 if not opened), and their
+  // counts over the last measured loop.
+  int      perf_enabled;
+  int      perf_fd[PERF_NUM_COUNTERS];
+  uint64_t perf_count[PERF_NUM_COUNTERS];
+  uint32_t perf_valid;
+} bench_t;
+
+// Measure every one of num_samples runs of "x" (after num_samples / 10
+// warmup runs), and add the statistics of the measurements to b.
+// The counters include the (small) overhead of reading the cycle counter.
+#define BENCH(b, label, x)                                      \
+  do {                                                          \
+    for(size_t bench_i = 0; bench_i < (b)->num_samples / 10;    \
+        bench_i++) {                                            \
+      x;                                                        \
+    }                                                           \
+    perf_start(b);                                              \
+    for(size_t bench_i = 0; bench_i < (b)->num_samples;         \
+        bench_i++) {                                            \
+      const uint64_t bench_start = get_cycles();                \
+      x;                                                        \
+      (b)->samples[bench_i] = get_cycles() - bench_start;       \
+    }                                                           \
+    perf_stop(b);                                               \
+    add_result((b), (label));                                   \
+  } while(0)
+
+#if defined(__linux__)
+
+static void perf_open(IN OUT bench_t *b)
+{
+  static const struct {
+    uint32_t type;
+    uint64_t config;
+  } events[PERF_NUM_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                           (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+                           (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+  };
+
+  for(size_t i = 0; i < PERF_NUM_COUNTERS; i++) {
+    struct perf_event_attr attr = {0};
+    attr.type           = events[i].type;
+    attr.size           = sizeof(attr);
+    attr.config         = events[i].config;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    b->perf_fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+}
+
+static void perf_close(IN OUT bench_t *b)
+{
+  for(size_t i = 0; i < PERF_NUM_COUNTERS; i++) {
+    if(b->perf_fd[i] >= 0) {
+      close(b->perf_fd[i]);
+      b->perf_fd[i] = -1;
+    }
+  }
+}
+
+static void perf_start(IN OUT bench_t *b)
+{
+  for(size_t i = 0; b->perf_enabled && (i < PERF_NUM_COUNTERS); i++) {
+    if(b->perf_fd[i] >= 0) {
+      ioctl(b->perf_fd[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(b->perf_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+static void perf_stop(IN OUT bench_t *b)
+{
+  b->perf_valid = 0;
+  for(size_t i = 0; b->perf_enabled && (i < PERF_NUM_COUNTERS); i++) {
+    if(b->perf_fd[i] >= 0) {
+      ioctl(b->perf_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+      if(read(b->perf_fd[i], &b->perf_count[i], sizeof(uint64_t)) ==
+         sizeof(uint64_t)) {
+        b->perf_valid |= BIT(i);
+      }
+    }
+  }
+}
+
+#else
+
+static void perf_open(IN OUT bench_t *b)
+{
+  for(size_t i = 0; i < PERF_NUM_COUNTERS; i++) {
+    b->perf_fd[i] = -1;
+  }
+}
+
+static void perf_close(IN OUT BIKE_UNUSED_ATT bench_t *b) {}
+
+static void perf_start(IN OUT BIKE_UNUSED_ATT bench_t *b) {}
+
+static void perf_stop(IN OUT bench_t *b) { b->perf_valid = 0; }
+
+#endif
+
+static int cmp_u64(const void *a, const void *b)
+{
+  const uint64_t x = *(const uint64_t *)a;
+  const uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// The nearest-rank percentile of the sorted samples
+static uint64_t percentile(IN const uint64_t *sorted,
+                           IN const size_t    n,
+                           IN const size_t    p)
+{
+  const size_t rank = DIVIDE_AND_CEIL(p * n, 100);
+  return sorted[(rank == 0) ? 0 : (rank - 1)];
+}
+
+static void add_result(IN OUT bench_t *b, IN const char *name)
+{
+  if(b->num_results == MAX_RESULTS) {
+    return;
+  }
+
+  bench_result_t *r = &b->results[b->num_results++];
+  const size_t    n = b->num_samples;
+
+  qsort(b->samples, n, sizeof(b->samples[0]), cmp_u64);
+
+  double sum = 0;
+  for(size_t i = 0; i < n; i++) {
+    sum += (double)b->samples[i];
+  }
+
+  double var = 0;
+  for(size_t i = 0; i < n; i++) {
+    const double d = (double)b->samples[i] - (sum / n);
+    var += d * d;
+  }
+
+  r->name    = name;
+  r->backend = bike_isa_name(bike_get_isa());
+  r->samples = n;
+  r->median  = percentile(b->samples, n, 50);
+  r->p90     = percentile(b->samples, n, 90);
+  r->p99     = percentile(b->samples, n, 99);
+  r->mean    = sum / n;
+  r->stddev  = (n > 1) ? sqrt(var / (n - 1)) : 0;
+
+  r->perf_valid = b->perf_valid;
+  for(size_t i = 0; i < PERF_NUM_COUNTERS; i++) {
+    r->perf[i] = (double)b->perf_count[i] / n;
+  }
+}
+
+// Format the average count per call of the counter i of r (or the IPC, for
+// i == PERF_NUM_COUNTERS), or return missing if it was not read.
+static const char *format_perf(OUT char *                buf,
+                               IN const size_t           len,
+                               IN const bench_result_t *r,
+                               IN const size_t           i,
+                               IN const char *           missing)
+{
+  if(i == PERF_NUM_COUNTERS) {
+    const uint32_t mask = BIT(PERF_INSTRUCTIONS) | BIT(PERF_CYCLES);
+    if(((r->perf_valid & mask) != mask) || (r->perf[PERF_CYCLES] == 0)) {
+      return missing;
+    }
+    snprintf(buf, len, "%.2f",
+             r->perf[PERF_INSTRUCTIONS] / r->perf[PERF_CYCLES]);
+  } else {
+    if((r->perf_valid & BIT(i)) == 0) {
+      return missing;
+    }
+    snprintf(buf, len, "%.1f", r->perf[i]);
+  }
+
+  return buf;
+}
+
+static void print_results(IN const bench_t *b, IN const bench_format_t fmt)
+{
+  const bench_result_t *r = b->results;
+  char                  buf[32];
+
+  switch(fmt) {
+    case FORMAT_CSV:
+      printf("level,name,backend,samples,median,p90,p99,mean,stddev");
+      for(size_t j = 0; b->perf_enabled && (j < PERF_NUM_COUNTERS); j++) {
+        printf(",%s", perf_names[j]);
+      }
+      printf(b->perf_enabled ? ",ipc\n" : "\n");
+      for(size_t i = 0; i < b->num_results; i++) {
+        printf("%d,%s,%s,%zu,%lu,%lu,%lu,%.1f,%.1f", LEVEL, r[i].name,
+               r[i].backend, r[i].samples, (unsigned long)r[i].median,
+               (unsigned long)r[i].p90, (unsigned long)r[i].p99, r[i].mean,
+               r[i].stddev);
+        for(size_t j = 0; b->perf_enabled && (j <= PERF_NUM_COUNTERS); j++) {
+          printf(",%s", format_perf(buf, sizeof(buf), &r[i], j, ""));
+        }
+        printf("\n");
+      }
+      break;
+
+    case FORMAT_JSON:
+      printf("{\"level\": %d, \"r_bits\": %d, \"results\": [\n", LEVEL, R_BITS);
+      for(size_t i = 0; i < b->num_results; i++) {
+        printf("  {\"name\": \"%s\", \"backend\": \"%s\", \"samples\": %zu, "
+               "\"median\": %lu, \"p90\": %lu, \"p99\": %lu, "
+               "\"mean\": %.1f, \"stddev\": %.1f",
+               r[i].name, r[i].backend, r[i].samples,
+               (unsigned long)r[i].median, (unsigned long)r[i].p90,
+               (unsigned long)r[i].p99, r[i].mean, r[i].stddev);
+        for(size_t j = 0; b->perf_enabled && (j <= PERF_NUM_COUNTERS); j++) {
+          printf(", \"%s\": %s",
+                 (j == PERF_NUM_COUNTERS) ? "ipc" : perf_names[j],
+                 format_perf(buf, sizeof(buf), &r[i], j, "null"));
+        }
+        printf("}%s\n", (i + 1 < b->num_results) ? "," : "");
+      }
+      printf("]}\n");
+      break;
+
+    default:
+      printf("Benchmark: level %d, R_BITS %d, D %d, T %d, %zu samples "
+             "(cycles)\n",
+             LEVEL, R_BITS, D, T, b->num_samples);
+      printf("%-22s %-9s %10s %10s %10s %12s %10s\n", "name", "backend",
+             "median", "p90", "p99", "mean", "stddev");
+      for(size_t i = 0; i < b->num_results; i++) {
+        printf("%-22s %-9s %10lu %10lu %10lu %12.1f %10.1f\n", r[i].name,
+               r[i].backend, (unsigned long)r[i].median,
+               (unsigned long)r[i].p90, (unsigned long)r[i].p99, r[i].mean,
+               r[i].stddev);
+      }
+
+      if(b->perf_enabled) {
+        printf("\nHardware counters (average per call)\n");
+        printf("%-22s %-9s", "name", "backend");
+        for(size_t j = 0; j < PERF_NUM_COUNTERS; j++) {
+          printf(" %13s", perf_names[j]);
+        }
+        printf(" %6s\n", "ipc");
+        for(size_t i = 0; i < b->num_results; i++) {
+          printf("%-22s %-9s", r[i].name, r[i].backend);
+          for(size_t j = 0; j < PERF_NUM_COUNTERS; j++) {
+            printf(" %13s", format_perf(buf, sizeof(buf), &r[i], j, "-"));
+          }
+          printf(" %6s\n", format_perf(buf, sizeof(buf), &r[i],
+                                        PERF_NUM_COUNTERS, "-"));
+        }
+      }
+      break;
+  }
+}
+
+static int bench_kem(IN OUT bench_t *b)
+{
+  uint8_t pk[sizeof(pk_t)];
+  uint8_t sk[sizeof(sk_t)];
+  uint8_t ct[sizeof(ct_t)];
+  uint8_t ss[sizeof(ss_t)];
+  int     res      = 0;
+  void *  kg_ctx   = NULL;
+  void *  enc_key  = NULL;
+  void *  enc_pool = NULL;
+
+  BENCH(b, "keypair", res |= crypto_kem_keypair(pk, sk));
+  if(posix_memalign(&kg_ctx, BIKE_WORKSPACE_ALIGN, bike_keygen_ctx_size()) ==
+     0) {
+    res |= bike_keygen_ctx_init(kg_ctx);
+    BENCH(b, "keypair_with_ctx",
+          res |= crypto_kem_keypair_with_ctx(pk, sk, kg_ctx));
+    free(kg_ctx);
+  }
+  BENCH(b, "enc", res |= crypto_kem_enc(ct, ss, pk));
+
+  // The pool holds the precomputed encapsulations of all the runs of
+  // enc_online (including the warmup runs)
+  const size_t enc_runs = b->num_samples + (b->num_samples / 10);
+  if((posix_memalign(&enc_key, BIKE_WORKSPACE_ALIGN,
+                     crypto_kem_enc_key_size()) == 0) &&
+     (posix_memalign(&enc_pool, BIKE_WORKSPACE_ALIGN,
+                     bike_enc_pool_size(enc_runs)) == 0)) {
+    res |= crypto_kem_enc_key_init(enc_key, pk);
+    res |= bike_enc_pool_init(enc_pool, enc_runs, enc_key);
+    res |= bike_enc_precompute(enc_pool, enc_runs);
+    BENCH(b, "enc_online", res |= crypto_kem_enc_online(ct, ss, enc_pool));
+    bike_enc_pool_clean(enc_pool);
+    free(enc_pool);
+  }
+  free(enc_key);
+  BENCH(b, "dec", res |= crypto_kem_dec(ss, ct, sk));
+
+  return res;
+}
+
+#if defined(USE_SHA3_AND_SHAKE)
+// The Keccak permutation that sha3_x4.c selects for the current ISA
+_INLINE_ void keccak_f1600_x4(
+  IN OUT uint64_t s[KECCAK_STATE_QWORDS * KECCAK_X4_WAYS])
+{
+#  if defined(X86_64)
+  if(is_avx2_enabled()) {
+    keccak_f1600_x4_avx2(s);
+    return;
+  }
+#  endif
+  keccak_f1600_x4_port(s);
+}
+#endif
+
+static int bench_primitives(IN OUT bench_t *b)
+{
+  uint8_t      pk_raw[sizeof(pk_t)];
+  uint8_t      sk_raw[sizeof(sk_t)];
+  uint8_t      ct_raw[sizeof(ct_t)];
+  uint8_t      ss[sizeof(ss_t)];
+  aligned_sk_t sk;
+  ct_t         ct;
+  decode_key_t key;
+  pad_r_t      a = {0}, h = {0}, c = {0}, c0 = {0};
+  pad_e_t      pad_e = {0};
+  e_t          e = {0}, black_e = {0}, gray_e = {0};
+  syndrome_t   s = {0};
+  decode_ws_t  ws;
+  seed_t       seed;
+  int          res = 0;
+
+  // The kernels of the current ISA
+  const dispatch_ctx *ctx = get_dispatch_ctx();
+  dbl_pad_r_t         dbl = {0};
+  gf2x_ksqr_ws_t      ksqr_ws;
+  gf2x_inv_ws_t       inv_ws;
+  void *              ksqr_maps = NULL;
+  syndrome_t          rotated_s = {0};
+  upc_t               upc;
+  uint64_t            base_a[16] = {0}, base_b[16] = {0}, base_c[32];
+#if defined(USE_SHA3_AND_SHAKE)
+  uint64_t keccak_s[KECCAK_STATE_QWORDS * KECCAK_X4_WAYS] = {0};
+#endif
+
+  res |= crypto_kem_keypair(pk_raw, sk_raw);
+  res |= crypto_kem_enc(ct_raw, ss, pk_raw);
+  res |= get_random_bytes(seed.raw, sizeof(seed.raw));
+  if(res != 0) {
+    return res;
+  }
+
+  if(posix_memalign(&ksqr_maps, ALIGN_BYTES, gf2x_ksqr_maps_size()) != 0) {
+    ksqr_maps = NULL;
+  }
+
+  bike_memcpy(&sk, sk_raw, sizeof(sk));
+  bike_memcpy(&ct, ct_raw, sizeof(ct));
+  decode_key_init(&key, &sk);
+
+  a.val  = sk.bin[0];
+  h.val  = sk.pk;
+  c0.val = ct.c0;
+
+  BENCH(b, "gf2x_mod_mul", gf2x_mod_mul(&c, &a, &h));
+  BENCH(b, "gf2x_mod_inv", gf2x_mod_inv(&c, &a));
+  BENCH(b, "decode", res |= decode(&e, &ct, &sk));
+  BENCH(b, "compute_syndrome",
+        res |= compute_syndrome(&s, &c0, &key.h0, &key.wlist[0], &ws.mul,
+                                key.ctx));
+  BENCH(b, "find_err1",
+        find_err1(&e, &black_e, &gray_e, &s, &key, THRESHOLD_MIN, DELTA, &ws,
+                  key.ctx));
+  BENCH(b, "generate_error_vector",
+        res |= generate_error_vector(&pad_e, &seed));
+
+  // Karatsuba is inlined in gf2x_mod_mul, so its base multiplication and the
+  // reduction are measured separately (gf2x_mod_mul minus gf2x_red is
+  // the Karatsuba multiplication).
+  bike_memcpy(base_a, a.val.raw, sizeof(base_a));
+  bike_memcpy(base_b, h.val.raw, sizeof(base_b));
+  bike_memcpy(dbl.raw, &ct, sizeof(ct));
+  BENCH(b, "gf2x_mul_base", ctx->gf2x.mul_base(base_c, base_a, base_b));
+  BENCH(b, "gf2x_red", ctx->gf2x.red(&c, &dbl));
+  BENCH(b, "gf2x_k_sqr", ctx->gf2x.k_sqr(&c, &a, R_BITS / 3, &ksqr_ws));
+  BENCH(b, "gf2x_mod_inv_exp",
+        gf2x_mod_inv_exp(&c, &a, NULL, &inv_ws, &ctx->gf2x));
+  if(ksqr_maps != NULL) {
+    gf2x_ksqr_maps_init(ksqr_maps);
+    BENCH(b, "gf2x_mod_inv_exp_maps",
+          gf2x_mod_inv_exp(&c, &a, ksqr_maps, &inv_ws, &ctx->gf2x));
+  }
+  BENCH(b, "gf2x_mod_inv_divstep",
+        gf2x_mod_inv_divstep(&c, &a, NULL, &inv_ws, &ctx->gf2x));
+  BENCH(b, "rotate_right", ctx->decode.rotate_right(&rotated_s, &s, R_BITS / 3));
+  BENCH(b, "bit_sliced_adder",
+        ctx->decode.bit_sliced_adder(&upc, &rotated_s, SLICES));
+#if defined(USE_SHA3_AND_SHAKE)
+  BENCH(b, "keccak_f1600_x4", keccak_f1600_x4(keccak_s));
+#endif
+
+  // The hash of the public key (function H), of one and of 4 messages
+  const uint8_t *sha_msg[SHA_X4_WAYS] = {pk_raw, pk_raw, pk_raw, pk_raw};
+  sha_dgst_x4_t  sha_dgst;
+  BENCH(b, "sha", res |= sha(&sha_dgst.val[0], sizeof(pk_raw), pk_raw));
+  BENCH(b, "sha_x4", res |= sha_x4(&sha_dgst, sizeof(pk_raw), sha_msg));
+
+  decode_key_cleanup(&key);
+  decode_ws_cleanup(&ws);
+  secure_clean((uint8_t *)&ksqr_ws, sizeof(ksqr_ws));
+  secure_clean((uint8_t *)&inv_ws, sizeof(inv_ws));
+  free(ksqr_maps);
+  secure_clean((uint8_t *)base_a, sizeof(base_a));
+  secure_clean((uint8_t *)&sk, sizeof(sk));
+  secure_clean(sk_raw, sizeof(sk_raw));
+
+  return res;
+}
+
+static void usage(IN const char *name)
+{
+  printf("Usage: %s [-n samples] [-f text|csv|json] [-i isa|all] [-p]\n",
+         name);
+  printf("  isa: one of portable, pclmul, avx2, avx512, vpclmul, native\n");
+  printf("  -p: also read the hardware performance counters\n");
+}
+
+int main(int argc, char *argv[])
+{
+  bench_t        b   = {0};
+  bench_format_t fmt = FORMAT_TEXT;
+  const char *   isa = "all";
+  int            opt;
+
+  b.num_samples = DEFAULT_SAMPLES;
+  for(size_t i = 0; i < PERF_NUM_COUNTERS; i++) {
+    b.perf_fd[i] = -1;
+  }
+
+  while((opt = getopt(argc, argv, "n:f:i:ph")) != -1) {
+    switch(opt) {
+      case 'n': b.num_samples = strtoull(optarg, NULL, 0); break;
+      case 'f':
+        if(strcmp(optarg, "csv") == 0) {
+          fmt = FORMAT_CSV;
+        } else if(strcmp(optarg, "json") == 0) {
+          fmt = FORMAT_JSON;
+        } else if(strcmp(optarg, "text") == 0) {
+          fmt = FORMAT_TEXT;
+        } else {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'i': isa = optarg; break;
+      case 'p': b.perf_enabled = 1; break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+
+  if(b.num_samples == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  b.samples = malloc(b.num_samples * sizeof(b.samples[0]));
+  if(b.samples == NULL) {
+    printf("Cannot allocate %zu samples\n", b.num_samples);
+    return 1;
+  }
+
+  // Report only the timings if no counter can be opened (e.g., on other
+  // systems, or when perf_event_paranoid does not allow it).
+  if(b.perf_enabled) {
+    perf_open(&b);
+    b.perf_enabled = 0;
+    for(size_t i = 0; i < PERF_NUM_COUNTERS; i++) {
+      b.perf_enabled |= (b.perf_fd[i] >= 0);
+    }
+    if(!b.perf_enabled) {
+      fprintf(stderr, "Warning: the hardware performance counters are not "
+                      "available\n");
+    }
+  }
+
+  // Run the benchmarks for the selected ISA, or for every available ISA
+  // (except for BIKE_ISA_NATIVE, which repeats the highest one).
+  size_t num_runs = 0;
+  for(int i = BIKE_ISA_PORTABLE; i <= BIKE_ISA_NATIVE; i++) {
+    const int all = (strcmp(isa, "all") == 0);
+    if((all && ((i == BIKE_ISA_NATIVE) || !bike_isa_available(i))) ||
+       (!all && (strcmp(isa, bike_isa_name(i)) != 0))) {
+      continue;
+    }
+
+    if(!bike_isa_available(i)) {
+      printf("The ISA %s is not supported by the CPU\n", isa);
+      perf_close(&b);
+      free(b.samples);
+      return 1;
+    }
+
+    bike_force_isa(i);
+    if((bench_kem(&b) != 0) || (bench_primitives(&b) != 0)) {
+      printf("Benchmark failed with error: %d\n", bike_errno);
+      perf_close(&b);
+      free(b.samples);
+      return 1;
+    }
+    num_runs++;
+  }
+
+  if(num_runs == 0) {
+    usage(argv[0]);
+    perf_close(&b);
+    free(b.samples);
+    return 1;
+  }
+
+  print_results(&b, fmt);
+
+  perf_close(&b);
+  free(b.samples);
+  return 0;
+}
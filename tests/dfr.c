@@ -0,0 +1,571 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ *
+ * Decoder-failure-rate (DFR) simulation.
+ * The work is split into chunks of decodes. Every chunk uses one key and
+ * chunk_size error vectors, all derived from the master seed, the chunk index
+ * and the decode index. Therefore, the results do not depend on the number of
+ * threads, and a run can be resumed from a checkpoint file.
+ * The decoder options (see usage) decode with decode_with_params instead of
+ * the decoder of the build, so that decoder variants can be simulated without
+ * rebuilding the library.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bike_arena.h"
+#include "bike_decode_trace.h"
+#include "decode.h"
+#include "gf2x.h"
+#include "sampling.h"
+#include "utilities.h"
+
+// The maximal number of iterations of the decoder options (-i)
+#define DFR_MAX_IT 64
+
+// iters[i] counts the decodes that converged after i iterations,
+// iters[max_it + 1] counts the decodes that did not converge.
+#define DFR_HIST_SIZE (DFR_MAX_IT + 2)
+
+// The number of chunks that are processed between two checkpoints
+#define DEFAULT_CHUNKS_PER_ROUND 64
+#define DEFAULT_CHUNK_SIZE       1000
+#define MAX_THREADS              1024
+
+// The constant-time decoder decodes DFR_GROUP error vectors at a time with
+// decode_wide_with_stats (all of them with the key of the chunk).
+#if defined(DECODE_VARTIME)
+#  define DFR_GROUP 1
+#else
+#  define DFR_GROUP DECODE_WIDE_LANES
+#endif
+
+// With DECODE_TRACE, the decoder iterations are aggregated from the trace of
+// decode_vartime, or of decode_with_params with the decoder options (the
+// multi-instance decoder is not traced). The sums are not
+// saved in the checkpoint file.
+#if defined(DECODE_TRACE) && defined(DECODE_VARTIME)
+#  define DFR_TRACE
+
+typedef struct dfr_trace_stats_s {
+  uint64_t iters;
+  uint64_t threshold;
+  uint64_t black_weight;
+  uint64_t gray_weight;
+  uint64_t syndrome_weight[BIKE_DECODE_TRACE_STEPS + 1];
+} dfr_trace_stats_t;
+#endif
+
+typedef struct dfr_stats_s {
+  uint64_t decodes;
+  uint64_t failures; // The decoder did not converge
+  uint64_t wrong;    // The decoder converged to a wrong error vector
+  uint64_t iters[DFR_HIST_SIZE];
+#if defined(DFR_TRACE)
+  dfr_trace_stats_t trace[DFR_MAX_IT]; // The sums of the records of iteration i
+#endif
+} dfr_stats_t;
+
+typedef struct dfr_run_s {
+  uint64_t        seed;
+  uint64_t        chunk_size;
+  uint64_t        num_chunks;
+  uint64_t        next_chunk; // Shared by the worker threads
+  uint64_t        end_chunk;  // The last chunk (exclusive) of the current round
+  decode_params_t params;     // The parameters of the decoder
+  int             use_params; // Decode with decode_with_params and params
+  dfr_stats_t     stats;      // Updated atomically by the worker threads
+} dfr_run_t;
+
+// The seeds of a chunk are (seed | chunk | 0) for the key and
+// (seed | chunk | i) for the i-th error vector, with i >= 1.
+static void derive_seed(OUT seed_t *seed,
+                        IN const uint64_t master,
+                        IN const uint64_t chunk,
+                        IN const uint64_t idx)
+{
+  bike_memset(seed, 0, sizeof(*seed));
+  bike_memcpy(&seed->raw[0], &master, sizeof(master));
+  bike_memcpy(&seed->raw[8], &chunk, sizeof(chunk));
+  bike_memcpy(&seed->raw[16], &idx, sizeof(idx));
+}
+
+static ret_t generate_key(OUT decode_key_t *key,
+                          OUT pad_r_t *pk,
+                          IN const seed_t *seed)
+{
+  DEFER_CLEANUP(aligned_sk_t sk = {0}, sk_cleanup);
+  DEFER_CLEANUP(pad_r_t h0 = {0}, pad_r_cleanup);
+  DEFER_CLEANUP(pad_r_t h1 = {0}, pad_r_cleanup);
+  DEFER_CLEANUP(pad_r_t h0inv = {0}, pad_r_cleanup);
+
+  GUARD(generate_secret_key(&h0, &h1, sk.wlist[0].val, sk.wlist[1].val, seed));
+
+  // pk = h1 * h0^-1
+  bike_memset(pk, 0, sizeof(*pk));
+  gf2x_mod_inv(&h0inv, &h0);
+  gf2x_mod_mul_sparse(pk, &h0inv, &h1, sk.wlist[1].val, D);
+
+  sk.bin[0] = h0.val;
+  sk.bin[1] = h1.val;
+  sk.pk     = pk->val;
+
+  decode_key_init(key, &sk);
+
+  return SUCCESS;
+}
+
+// Decode the n (up to DFR_GROUP) ciphertexts ct[j] with key, where iters[j]
+// is set as in decode_with_stats (max_it + 1 when the decoder did not
+// converge).
+static ret_t dfr_decode(OUT e_t dec_e[],
+                        OUT uint32_t iters[],
+                        IN const ct_t ct[],
+                        IN const decode_key_t *key,
+                        IN const dfr_run_t *   run,
+                        IN const size_t        n)
+{
+  if(run->use_params) {
+    for(size_t j = 0; j < n; j++) {
+      // iters[j] is already (max_it + 1) when the decoder did not converge
+      if((decode_with_params(&dec_e[j], &iters[j], &ct[j], key,
+                             &run->params) != SUCCESS) &&
+         (bike_errno == E_DECODER_INVALID_PARAMS)) {
+        return FAIL;
+      }
+    }
+
+    return SUCCESS;
+  }
+
+#if defined(DECODE_VARTIME)
+  for(size_t j = 0; j < n; j++) {
+    if(decode_vartime(&dec_e[j], &iters[j], &ct[j], key) != SUCCESS) {
+      iters[j] = MAX_IT + 1;
+    }
+  }
+
+  return SUCCESS;
+#else
+  const decode_key_t *keys[DFR_GROUP];
+  for(size_t j = 0; j < n; j++) {
+    keys[j] = key;
+  }
+
+  return decode_wide_with_stats(dec_e, iters, ct, keys, n);
+#endif
+}
+
+#if defined(DFR_TRACE)
+// Add the trace records of the calling thread to stats
+static void add_trace(IN OUT dfr_stats_t *stats)
+{
+  bike_decode_record_t recs[BIKE_DECODE_TRACE_SIZE];
+  size_t               num = 0;
+
+  bike_decode_trace_read(recs, BIKE_DECODE_TRACE_SIZE, &num);
+  for(size_t j = 0; j < num; j++) {
+    dfr_trace_stats_t *t = &stats->trace[recs[j].iter];
+
+    t->iters++;
+    t->threshold += recs[j].threshold;
+    t->black_weight += recs[j].black_weight;
+    t->gray_weight += recs[j].gray_weight;
+    for(size_t k = 0; k <= BIKE_DECODE_TRACE_STEPS; k++) {
+      t->syndrome_weight[k] += recs[j].syndrome_weight[k];
+    }
+  }
+}
+#endif
+
+// The buffers of a chunk, taken from the arena of the worker thread
+typedef struct dfr_bufs_s {
+  decode_key_t key;
+  pad_e_t      e[DFR_GROUP];
+  e_t          dec_e[DFR_GROUP];
+  ct_t         ct[DFR_GROUP];
+  pad_r_t      c0;
+  pad_r_t      pk;
+} dfr_bufs_t;
+
+// The buffers b are zero, and are wiped by the caller
+static ret_t run_chunk(OUT dfr_stats_t *stats,
+                       IN const dfr_run_t *run,
+                       IN const uint64_t   chunk,
+                       IN OUT dfr_bufs_t *b)
+{
+  uint32_t iters[DFR_GROUP];
+  seed_t   seed;
+
+  derive_seed(&seed, run->seed, chunk, 0);
+  GUARD(generate_key(&b->key, &b->pk, &seed));
+
+  for(uint64_t i = 1; i <= run->chunk_size; i += DFR_GROUP) {
+    const size_t n = ((run->chunk_size - i) < DFR_GROUP)
+                       ? (size_t)(run->chunk_size - i + 1)
+                       : DFR_GROUP;
+
+    for(size_t j = 0; j < n; j++) {
+      derive_seed(&seed, run->seed, chunk, i + j);
+      GUARD(generate_error_vector(&b->e[j], &seed));
+
+      // c0 = e0 + e1 * pk
+      gf2x_mod_mul(&b->c0, &b->e[j].val[1], &b->pk);
+      gf2x_mod_add(&b->c0, &b->c0, &b->e[j].val[0]);
+      b->ct[j].c0 = b->c0.val;
+    }
+
+    GUARD(dfr_decode(b->dec_e, iters, b->ct, &b->key, run, n));
+#if defined(DFR_TRACE)
+    add_trace(stats);
+#endif
+
+    for(size_t j = 0; j < n; j++) {
+      if(iters[j] == (run->params.max_it + 1)) {
+        stats->failures++;
+      } else if((0 != memcmp(&b->dec_e[j].val[0], &b->e[j].val[0].val,
+                             sizeof(r_t))) ||
+                (0 != memcmp(&b->dec_e[j].val[1], &b->e[j].val[1].val,
+                             sizeof(r_t)))) {
+        stats->wrong++;
+      }
+
+      stats->iters[iters[j]]++;
+      stats->decodes++;
+    }
+  }
+
+  return SUCCESS;
+}
+
+// Add the statistics of a chunk to the shared statistics (lock-free)
+static void merge_stats(OUT dfr_stats_t *shared, IN const dfr_stats_t *local)
+{
+  __atomic_fetch_add(&shared->decodes, local->decodes, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&shared->failures, local->failures, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&shared->wrong, local->wrong, __ATOMIC_RELAXED);
+  for(size_t i = 0; i < DFR_HIST_SIZE; i++) {
+    __atomic_fetch_add(&shared->iters[i], local->iters[i], __ATOMIC_RELAXED);
+  }
+#if defined(DFR_TRACE)
+  const uint64_t *src = (const uint64_t *)local->trace;
+  uint64_t *      dst = (uint64_t *)shared->trace;
+  const size_t    n =
+    DFR_MAX_IT * (sizeof(dfr_trace_stats_t) / sizeof(uint64_t));
+  for(size_t i = 0; i < n; i++) {
+    __atomic_fetch_add(&dst[i], src[i], __ATOMIC_RELAXED);
+  }
+#endif
+}
+
+static void *worker(void *arg)
+{
+  dfr_run_t *   run   = (dfr_run_t *)arg;
+  bike_arena_t *arena = NULL;
+
+  // The buffers of the thread are in an arena on the NUMA node of the thread
+  if(bike_arena_create(&arena, sizeof(dfr_bufs_t), BIKE_ARENA_LOCAL_NODE) !=
+     SUCCESS) {
+    printf("Failed to create the arena of a thread\n");
+    exit(1);
+  }
+
+  while(1) {
+    const uint64_t chunk =
+      __atomic_fetch_add(&run->next_chunk, 1, __ATOMIC_RELAXED);
+    if(chunk >= run->end_chunk) {
+      break;
+    }
+
+    dfr_stats_t local = {0};
+    dfr_bufs_t *bufs  = bike_arena_alloc(arena, sizeof(dfr_bufs_t));
+    if(run_chunk(&local, run, chunk, bufs) != SUCCESS) {
+      printf("Chunk %" PRIu64 " failed with error: %d\n", chunk, bike_errno);
+      exit(1);
+    }
+    bike_arena_reset(arena);
+    merge_stats(&run->stats, &local);
+  }
+
+  bike_arena_destroy(arena);
+  return NULL;
+}
+
+// The decoder parameters are saved in the checkpoint file (the coefficients
+// in hexadecimal, which is exact), and a run is resumed only with the same
+// parameters.
+static int load_checkpoint(OUT dfr_run_t *run, IN const char *path)
+{
+  FILE *f = fopen(path, "r");
+  if(f == NULL) {
+    return 0;
+  }
+
+  const decode_params_t *p     = &run->params;
+  decode_params_t        saved = {0};
+  uint32_t               level = 0;
+  uint32_t               hist  = 0;
+  int ok = (fscanf(f, "level %" SCNu32 "\n", &level) == 1) &&
+           (fscanf(f, "decoder %la %la %" SCNu32 " %" SCNu32 " %" SCNu32
+                      " %" SCNu32 " %" SCNu32 "\n",
+                   &saved.threshold_coeff0, &saved.threshold_coeff1,
+                   &saved.threshold_min, &saved.delta, &saved.err2_threshold,
+                   &saved.max_it, &saved.gray_iters) == 7) &&
+           (saved.threshold_coeff0 == p->threshold_coeff0) &&
+           (saved.threshold_coeff1 == p->threshold_coeff1) &&
+           (saved.threshold_min == p->threshold_min) &&
+           (saved.delta == p->delta) &&
+           (saved.err2_threshold == p->err2_threshold) &&
+           (saved.max_it == p->max_it) && (saved.gray_iters == p->gray_iters) &&
+           (fscanf(f, "seed %" SCNu64 "\n", &run->seed) == 1) &&
+           (fscanf(f, "chunk_size %" SCNu64 "\n", &run->chunk_size) == 1) &&
+           (fscanf(f, "next_chunk %" SCNu64 "\n", &run->next_chunk) == 1) &&
+           (fscanf(f, "decodes %" SCNu64 "\n", &run->stats.decodes) == 1) &&
+           (fscanf(f, "failures %" SCNu64 "\n", &run->stats.failures) == 1) &&
+           (fscanf(f, "wrong %" SCNu64 "\n", &run->stats.wrong) == 1) &&
+           (fscanf(f, "iters %" SCNu32, &hist) == 1) && (level == LEVEL) &&
+           (hist == (p->max_it + 2));
+
+  for(size_t i = 0; ok && (i < hist); i++) {
+    ok = (fscanf(f, " %" SCNu64, &run->stats.iters[i]) == 1);
+  }
+  fclose(f);
+
+  if(!ok) {
+    printf("Invalid checkpoint file %s (or a different level or decoder)\n",
+           path);
+    exit(1);
+  }
+
+  return 1;
+}
+
+// Write to a temporary file and rename it so that the checkpoint file
+// is never left partially written.
+static void save_checkpoint(IN const dfr_run_t *run, IN const char *path)
+{
+  char tmp_path[1024];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+  FILE *f = fopen(tmp_path, "w");
+  if(f == NULL) {
+    printf("Cannot write checkpoint file %s\n", tmp_path);
+    return;
+  }
+
+  fprintf(f, "level %d\n", LEVEL);
+  fprintf(f, "decoder %a %a %" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIu32
+             " %" PRIu32 "\n",
+          run->params.threshold_coeff0, run->params.threshold_coeff1,
+          run->params.threshold_min, run->params.delta,
+          run->params.err2_threshold, run->params.max_it,
+          run->params.gray_iters);
+  fprintf(f, "seed %" PRIu64 "\n", run->seed);
+  fprintf(f, "chunk_size %" PRIu64 "\n", run->chunk_size);
+  fprintf(f, "next_chunk %" PRIu64 "\n", run->end_chunk);
+  fprintf(f, "decodes %" PRIu64 "\n", run->stats.decodes);
+  fprintf(f, "failures %" PRIu64 "\n", run->stats.failures);
+  fprintf(f, "wrong %" PRIu64 "\n", run->stats.wrong);
+  fprintf(f, "iters %" PRIu32, run->params.max_it + 2);
+  for(size_t i = 0; i < (run->params.max_it + 2); i++) {
+    fprintf(f, " %" PRIu64, run->stats.iters[i]);
+  }
+  fprintf(f, "\n");
+  fclose(f);
+
+  if(rename(tmp_path, path) != 0) {
+    printf("Cannot rename checkpoint file %s\n", tmp_path);
+  }
+}
+
+static void print_stats(IN const dfr_stats_t *stats, IN const uint32_t max_it)
+{
+  printf("decodes: %" PRIu64 " failures: %" PRIu64 " wrong: %" PRIu64 "\n",
+         stats->decodes, stats->failures, stats->wrong);
+  printf("  converged after iteration:");
+  for(size_t i = 0; i <= max_it; i++) {
+    printf(" %zu:%" PRIu64, i, stats->iters[i]);
+  }
+  printf("  not converged: %" PRIu64 "\n", stats->iters[max_it + 1]);
+
+#if defined(DFR_TRACE)
+  // The averages of the records of every iteration
+  for(size_t i = 0; i < max_it; i++) {
+    const dfr_trace_stats_t *t = &stats->trace[i];
+    if(t->iters == 0) {
+      continue;
+    }
+
+    const double n = (double)t->iters;
+    printf("  iteration %zu (%" PRIu64 " decodes): threshold %.2f black %.2f "
+           "gray %.2f syndrome",
+           i, t->iters, t->threshold / n, t->black_weight / n,
+           t->gray_weight / n);
+    for(size_t k = 0; k <= BIKE_DECODE_TRACE_STEPS; k++) {
+      printf(" %.2f", t->syndrome_weight[k] / n);
+    }
+    printf("\n");
+  }
+#endif
+}
+
+static void usage(IN const char *name)
+{
+  printf("Usage: %s [-n decodes] [-t threads] [-c chunk_size] [-r chunks_per_round]\n"
+         "       [-s seed] [-f checkpoint_file]\n"
+         "       [-a bgf|bg|maj] [-x threshold_coeff0] [-y threshold_coeff1]\n"
+         "       [-m threshold_min] [-d delta] [-e err2_threshold] [-i max_it]\n"
+         "       [-g gray_iters]\n",
+         name);
+}
+
+static int parse_alg(OUT decode_params_t *params, IN const char *name)
+{
+  static const char *const names[DECODER_ALGS] = {
+    [DECODER_BGF] = "bgf", [DECODER_BG] = "bg", [DECODER_MAJ] = "maj"};
+
+  for(size_t i = 0; i < DECODER_ALGS; i++) {
+    if(strcmp(name, names[i]) == 0) {
+      return decode_alg_params(params, (decoder_alg_t)i) == SUCCESS;
+    }
+  }
+
+  return 0;
+}
+
+// Set the field of params of the decoder option opt
+static void set_param(IN OUT decode_params_t *params,
+                      IN const int            opt,
+                      IN const char *         arg)
+{
+  switch(opt) {
+    case 'x': params->threshold_coeff0 = strtod(arg, NULL); break;
+    case 'y': params->threshold_coeff1 = strtod(arg, NULL); break;
+    case 'm': params->threshold_min = (uint32_t)strtoul(arg, NULL, 0); break;
+    case 'd': params->delta = (uint32_t)strtoul(arg, NULL, 0); break;
+    case 'e': params->err2_threshold = (uint32_t)strtoul(arg, NULL, 0); break;
+    case 'i': params->max_it = (uint32_t)strtoul(arg, NULL, 0); break;
+    case 'g': params->gray_iters = (uint32_t)strtoul(arg, NULL, 0); break;
+    default: break;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  dfr_run_t   run          = {0};
+  uint64_t    decodes      = 1000000;
+  uint64_t    round_chunks = DEFAULT_CHUNKS_PER_ROUND;
+  long        num_threads  = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *checkpoint   = NULL;
+  const char *alg          = NULL;
+  int         opt;
+
+  // The field options are applied after -a, in the order of the command line
+  int         param_opts[argc];
+  const char *param_args[argc];
+  int         num_params = 0;
+
+  run.chunk_size = DEFAULT_CHUNK_SIZE;
+
+  while((opt = getopt(argc, argv, "n:t:c:r:s:f:a:x:y:m:d:e:i:g:h")) != -1) {
+    switch(opt) {
+      case 'n': decodes = strtoull(optarg, NULL, 0); break;
+      case 't': num_threads = strtol(optarg, NULL, 0); break;
+      case 'c': run.chunk_size = strtoull(optarg, NULL, 0); break;
+      case 'r': round_chunks = strtoull(optarg, NULL, 0); break;
+      case 's': run.seed = strtoull(optarg, NULL, 0); break;
+      case 'f': checkpoint = optarg; break;
+      case 'a': alg = optarg; break;
+      case 'x':
+      case 'y':
+      case 'm':
+      case 'd':
+      case 'e':
+      case 'i':
+      case 'g':
+        param_opts[num_params] = opt;
+        param_args[num_params] = optarg;
+        num_params++;
+        break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+
+  // Without decoder options, the decoder of the build is used
+  run.params     = decode_default_params;
+  run.use_params = (alg != NULL) || (num_params != 0);
+  if((alg != NULL) && !parse_alg(&run.params, alg)) {
+    usage(argv[0]);
+    return 1;
+  }
+  for(int i = 0; i < num_params; i++) {
+    set_param(&run.params, param_opts[i], param_args[i]);
+  }
+
+  // decode_with_params validates the other parameters
+  if((num_threads < 1) || (num_threads > MAX_THREADS) ||
+     (run.chunk_size == 0) || (round_chunks == 0) || (run.params.max_it == 0) ||
+     (run.params.max_it > DFR_MAX_IT)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if((checkpoint != NULL) && load_checkpoint(&run, checkpoint)) {
+    printf("Resuming from chunk %" PRIu64 " of %s\n", run.next_chunk,
+           checkpoint);
+  }
+
+  run.num_chunks = DIVIDE_AND_CEIL(decodes, run.chunk_size);
+
+  printf("DFR simulation: level %d, R_BITS %d, D %d, T %d\n", LEVEL, R_BITS, D,
+         T);
+  printf("Decoder%s: threshold max(%g + %g * |s|, %" PRIu32 "), delta %" PRIu32
+         ", err2_threshold %" PRIu32 ", max_it %" PRIu32 ", gray_iters %" PRIu32
+         "\n",
+         run.use_params ? " (decode_with_params)" : "",
+         run.params.threshold_coeff0, run.params.threshold_coeff1,
+         run.params.threshold_min, run.params.delta, run.params.err2_threshold,
+         run.params.max_it, run.params.gray_iters);
+  printf("%ld threads, %" PRIu64 " chunks of %" PRIu64 " decodes, seed %" PRIu64
+         "\n",
+         num_threads, run.num_chunks, run.chunk_size, run.seed);
+
+  pthread_t threads[MAX_THREADS];
+
+  while(run.next_chunk < run.num_chunks) {
+    run.end_chunk = run.next_chunk + round_chunks;
+    if(run.end_chunk > run.num_chunks) {
+      run.end_chunk = run.num_chunks;
+    }
+
+    for(long i = 0; i < num_threads; i++) {
+      if(pthread_create(&threads[i], NULL, worker, &run) != 0) {
+        printf("Cannot create thread %ld\n", i);
+        return 1;
+      }
+    }
+    for(long i = 0; i < num_threads; i++) {
+      pthread_join(threads[i], NULL);
+    }
+    run.next_chunk = run.end_chunk;
+
+    if(checkpoint != NULL) {
+      save_checkpoint(&run, checkpoint);
+    }
+
+    printf("Chunks: %" PRIu64 "/%" PRIu64 " ", run.next_chunk, run.num_chunks);
+    print_stats(&run.stats, run.params.max_it);
+  }
+
+  return 0;
+}
@@ -0,0 +1,326 @@
+/* Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0"
+ *
+ * Written by Nir Drucker, Shay Gueron and Dusan Kostic,
+ * AWS Cryptographic Algorithms Group.
+ *
+ * Parallel verification of KAT files.
+ * Every record of a KAT file holds the seed of the NIST DRBG, and the key
+ * pair, ciphertext and shared secret that are generated from it. Therefore,
+ * the records can be checked independently: the files are mapped into memory,
+ * the offsets of their records are collected, and the records are checked by
+ * several threads (each one with its own DRBG state), by running keypair, enc
+ * and dec with the seed of the record and comparing their outputs.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "api.h"
+#include "kem.h"
+#include "rng.h"
+#include "utilities.h"
+
+#define KAT_SEED_BYTES 48
+#define MAX_THREADS    1024
+#define MAX_FILES      64
+
+// A mapped KAT file and the offsets of its records ("count = " lines)
+typedef struct kat_file_s {
+  const char *name;
+  char *      data;
+  size_t      size;
+  size_t *    records;
+  size_t      num_records;
+} kat_file_t;
+
+// The records of all the files are numbered consecutively, and the threads
+// take them one at a time from next.
+typedef struct kat_run_s {
+  kat_file_t *files;
+  size_t      num_files;
+  size_t      num_records;
+  size_t      next;
+  size_t      failures;
+} kat_run_t;
+
+// The expected values of a record, decoded from hex without any allocation
+typedef struct kat_record_s {
+  unsigned char seed[KAT_SEED_BYTES];
+  unsigned char pk[CRYPTO_PUBLICKEYBYTES];
+  unsigned char sk[CRYPTO_SECRETKEYBYTES];
+  unsigned char ct[CRYPTO_CIPHERTEXTBYTES];
+  unsigned char ss[CRYPTO_BYTES];
+} kat_record_t;
+
+// Return the position of the first occurrence of s in [p, end), or NULL
+static const char *find_str(IN const char *p,
+                            IN const char *end,
+                            IN const char *s)
+{
+  const size_t len = strlen(s);
+
+  for(; (p + len) <= end; p++) {
+    if((*p == s[0]) && (memcmp(p, s, len) == 0)) {
+      return p;
+    }
+  }
+
+  return NULL;
+}
+
+static int hex_value(IN const char c)
+{
+  if((c >= '0') && (c <= '9')) {
+    return c - '0';
+  }
+  if((c >= 'A') && (c <= 'F')) {
+    return c - 'A' + 10;
+  }
+  if((c >= 'a') && (c <= 'f')) {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+// Decode the hex value of the field "name = " of the record [p, end) into
+// out. The value must be exactly len bytes long.
+static int read_field(OUT unsigned char *out,
+                      IN const size_t    len,
+                      IN const char *    p,
+                      IN const char *    end,
+                      IN const char *    name)
+{
+  p = find_str(p, end, name);
+  if((p == NULL) || ((size_t)(end - p) < (strlen(name) + (2 * len)))) {
+    return FAIL;
+  }
+  p += strlen(name);
+
+  for(size_t i = 0; i < len; i++) {
+    const int hi = hex_value(p[2 * i]);
+    const int lo = hex_value(p[(2 * i) + 1]);
+    if((hi < 0) || (lo < 0)) {
+      return FAIL;
+    }
+    out[i] = (unsigned char)((hi << 4) | lo);
+  }
+
+  // The value has no more digits (e.g., it is of another level)
+  p += 2 * len;
+  return ((p < end) && (hex_value(*p) >= 0)) ? FAIL : SUCCESS;
+}
+
+// Check the record i of f. Returns 0 if the record is reproduced.
+static int check_record(IN const kat_file_t *f, IN const size_t i)
+{
+  kat_record_t  exp;
+  unsigned char pk[CRYPTO_PUBLICKEYBYTES];
+  unsigned char sk[CRYPTO_SECRETKEYBYTES];
+  unsigned char ct[CRYPTO_CIPHERTEXTBYTES];
+  unsigned char ss[CRYPTO_BYTES];
+  unsigned char ss1[CRYPTO_BYTES];
+
+  const char *p   = &f->data[f->records[i]];
+  const char *end = (i + 1 < f->num_records) ? &f->data[f->records[i + 1]]
+                                             : &f->data[f->size];
+
+  if((read_field(exp.seed, sizeof(exp.seed), p, end, "seed = ") != SUCCESS) ||
+     (read_field(exp.pk, sizeof(exp.pk), p, end, "pk = ") != SUCCESS) ||
+     (read_field(exp.sk, sizeof(exp.sk), p, end, "sk = ") != SUCCESS) ||
+     (read_field(exp.ct, sizeof(exp.ct), p, end, "ct = ") != SUCCESS) ||
+     (read_field(exp.ss, sizeof(exp.ss), p, end, "ss = ") != SUCCESS)) {
+    printf("%s: record %zu cannot be parsed (or is not of this level)\n",
+           f->name, i);
+    return FAIL;
+  }
+
+  randombytes_init(exp.seed, NULL, 256);
+
+  if((crypto_kem_keypair(pk, sk) != 0) ||
+     (memcmp(pk, exp.pk, sizeof(pk)) != 0) ||
+     (memcmp(sk, exp.sk, sizeof(sk)) != 0)) {
+    printf("%s: record %zu: keypair mismatch\n", f->name, i);
+    return FAIL;
+  }
+
+  if((crypto_kem_enc(ct, ss, pk) != 0) ||
+     (memcmp(ct, exp.ct, sizeof(ct)) != 0) ||
+     (memcmp(ss, exp.ss, sizeof(ss)) != 0)) {
+    printf("%s: record %zu: enc mismatch\n", f->name, i);
+    return FAIL;
+  }
+
+  if((crypto_kem_dec(ss1, ct, sk) != 0) ||
+     (memcmp(ss1, exp.ss, sizeof(ss1)) != 0)) {
+    printf("%s: record %zu: dec mismatch\n", f->name, i);
+    return FAIL;
+  }
+
+  return SUCCESS;
+}
+
+static void *worker(void *arg)
+{
+  kat_run_t *run = (kat_run_t *)arg;
+
+  while(1) {
+    size_t i = __atomic_fetch_add(&run->next, 1, __ATOMIC_RELAXED);
+    if(i >= run->num_records) {
+      return NULL;
+    }
+
+    // Find the file of the record
+    size_t j = 0;
+    while(i >= run->files[j].num_records) {
+      i -= run->files[j].num_records;
+      j++;
+    }
+
+    if(check_record(&run->files[j], i) != SUCCESS) {
+      __atomic_add_fetch(&run->failures, 1, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+// Map the file f->name and collect the offsets of its records
+static int map_file(IN OUT kat_file_t *f)
+{
+  struct stat st;
+  const int   fd = open(f->name, O_RDONLY);
+
+  if((fd < 0) || (fstat(fd, &st) != 0) || (st.st_size == 0)) {
+    printf("Cannot read %s\n", f->name);
+    if(fd >= 0) {
+      close(fd);
+    }
+    return FAIL;
+  }
+
+  f->size = (size_t)st.st_size;
+  f->data = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(f->data == MAP_FAILED) {
+    printf("Cannot map %s\n", f->name);
+    f->data = NULL;
+    return FAIL;
+  }
+
+  // Count the records, and then collect their offsets
+  const char *end = &f->data[f->size];
+  for(int pass = 0; pass < 2; pass++) {
+    size_t n = 0;
+    for(const char *p = f->data; (p = find_str(p, end, "count = ")) != NULL;
+        p++) {
+      if(pass == 1) {
+        f->records[n] = (size_t)(p - f->data);
+      }
+      n++;
+    }
+
+    if(pass == 0) {
+      f->records = malloc((n == 0 ? 1 : n) * sizeof(f->records[0]));
+      if(f->records == NULL) {
+        printf("Cannot allocate the records of %s\n", f->name);
+        return FAIL;
+      }
+    }
+    f->num_records = n;
+  }
+
+  if(f->num_records == 0) {
+    printf("%s has no records\n", f->name);
+    return FAIL;
+  }
+
+  return SUCCESS;
+}
+
+static void unmap_file(IN OUT kat_file_t *f)
+{
+  if(f->data != NULL) {
+    munmap(f->data, f->size);
+  }
+  free(f->records);
+}
+
+static void usage(IN const char *name)
+{
+  printf("Usage: %s [-t threads] file.kat [file.kat ...]\n", name);
+  printf("  The files must be of the level and the variant (flags) of the "
+         "build.\n");
+}
+
+int main(int argc, char *argv[])
+{
+  kat_file_t files[MAX_FILES] = {0};
+  pthread_t  threads[MAX_THREADS];
+  kat_run_t  run         = {0};
+  long       num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int        opt;
+  int        res = 0;
+
+  while((opt = getopt(argc, argv, "t:h")) != -1) {
+    switch(opt) {
+      case 't': num_threads = strtol(optarg, NULL, 0); break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+
+  if((optind == argc) || ((argc - optind) > MAX_FILES) || (num_threads < 1)) {
+    usage(argv[0]);
+    return 1;
+  }
+  if(num_threads > MAX_THREADS) {
+    num_threads = MAX_THREADS;
+  }
+
+  run.files     = files;
+  run.num_files = (size_t)(argc - optind);
+  for(size_t i = 0; i < run.num_files; i++) {
+    files[i].name = argv[optind + i];
+    if(map_file(&files[i]) != SUCCESS) {
+      res = 1;
+      break;
+    }
+    run.num_records += files[i].num_records;
+  }
+
+  long started = 0;
+  for(; (res == 0) && (started < num_threads); started++) {
+    if(pthread_create(&threads[started], NULL, worker, &run) != 0) {
+      break;
+    }
+  }
+
+  // Check the records on this thread as well if no thread was started
+  if((res == 0) && (started == 0)) {
+    worker(&run);
+  }
+
+  for(long i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  if(res == 0) {
+    for(size_t i = 0; i < run.num_files; i++) {
+      printf("%s: %zu records\n", files[i].name, files[i].num_records);
+    }
+    printf("%zu records checked, %zu failed\n", run.num_records, run.failures);
+    res = (run.failures == 0) ? 0 : 1;
+  }
+
+  for(size_t i = 0; i < run.num_files; i++) {
+    unmap_file(&files[i]);
+  }
+
+  return res;
+}
@@ -5,21 +5,90 @@
  * AWS Cryptographic Algorithms Group.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include "bike_arena.h"
+#include "bike_bulk.h"
+#include "bike_decode_trace.h"
+#include "bike_isa.h"
+#include "bike_parallel.h"
+#include "bike_pipeline.h"
+#include "bike_profile.h"
+#include "bike_rng.h"
+#include "decode.h"
+#include "dispatch.h"
 #include "gf2x.h"
+#include "gf2x_internal.h"
 #include "kem.h"
+#include "kem_internal.h"
+#include "keycache.h"
+#include "keypool.h"
 #include "measurements.h"
+#include "sampling_internal.h"
+#include "sha.h"
 #include "utilities.h"
-#include "cpu_features.h"
+
+#if defined(MULTI_LEVEL)
+#  include "bike_multi_level.h"
+#endif
 
 #if !defined(NUM_OF_TESTS)
 #  define NUM_OF_TESTS 1
 #endif
 
+// The batched decapsulation processes groups of 4 ciphertexts
+#define BATCH_SIZE 5
+
+// The batched key generation processes batches of KEYPAIR_BATCH_SIZE keys
+#define KEYPAIR_TEST_SIZE (KEYPAIR_BATCH_SIZE + 1)
+
+// The key cache test decapsulates KEY_CACHE_TEST_SIZE times with
+// KEY_CACHE_TEST_KEYS keys
+#define KEY_CACHE_TEST_KEYS 3
+#define KEY_CACHE_TEST_SIZE 6
+
+// The number of jobs of every operation in the bulk test
+#define BULK_TEST_SIZE 5
+
+// The buffers of the jobs of the bulk test (pk[1] is a copy of pk[0])
+typedef struct bulk_test_s {
+  pk_t pk[2];
+  sk_t sk;
+  ct_t ct;
+  ss_t ss_enc;
+  ss_t ss_dec;
+} bulk_test_t;
+
+// The key pair, ciphertext and shared secrets of a key generation, an
+// encapsulation and a decapsulation
+typedef struct kem_out_s {
+  uint8_t pk[sizeof(pk_t)];
+  uint8_t sk[sizeof(sk_t)];
+  uint8_t ct[sizeof(ct_t)];
+  uint8_t k_enc[sizeof(ss_t)];
+  uint8_t k_dec[sizeof(ss_t)];
+} kem_out_t;
+
+// A variant of the KEM operations (e.g., with a workspace). arg is passed to
+// every operation.
+typedef struct kem_variant_s {
+  int (*keypair)(OUT uint8_t *pk, OUT uint8_t *sk, IN void *arg);
+  int (*enc)(OUT uint8_t *ct,
+             OUT uint8_t *ss,
+             IN const uint8_t *pk,
+             IN void *         arg);
+  int (*dec)(OUT uint8_t *ss,
+             IN const uint8_t *ct,
+             IN const uint8_t *sk,
+             IN void *         arg);
+} kem_variant_t;
+
 typedef struct magic_number_s {
   uint64_t val[4];
 } magic_number_t;
@@ -37,19 +106,1225 @@ typedef struct magic_number_s {
     printf("Magic is incorrect for param\n");                       \
   }
 
+// The tests use rand() as the randomness source, so that they can be
+// reproduced with FIXED_SEED, and repeated with srand.
+static int test_rng(OUT uint8_t *buf, IN size_t len)
+{
+  for(size_t i = 0; i < len; i++) {
+    buf[i] = rand();
+  }
+  return 0;
+}
+
+#if !defined(USE_NIST_RAND)
+// A randomness source that always fails
+static int failing_rng(OUT uint8_t *buf, IN size_t len)
+{
+  (void)buf;
+  (void)len;
+  return -1;
+}
+
+// A randomness source that fails after rng_budget calls
+static size_t rng_budget;
+static int    budget_rng(OUT uint8_t *buf, IN size_t len)
+{
+  if(rng_budget == 0) {
+    return -1;
+  }
+  rng_budget--;
+  return test_rng(buf, len);
+}
+#endif
+
+// A pointer into buf (of BIKE_WORKSPACE_ALIGN extra bytes) that is not
+// aligned to BIKE_WORKSPACE_ALIGN
+static void *misalign(IN uint8_t *buf)
+{
+  const size_t pad =
+    (BIKE_WORKSPACE_ALIGN - ((uintptr_t)buf % BIKE_WORKSPACE_ALIGN)) %
+    BIKE_WORKSPACE_ALIGN;
+  return &buf[pad + 1];
+}
+
+////////////////////////////////////////////////////////////////
+//                 The variants of the KEM operations
+////////////////////////////////////////////////////////////////
+static int kem_keypair(OUT uint8_t *pk, OUT uint8_t *sk, IN void *arg)
+{
+  (void)arg;
+  return crypto_kem_keypair(pk, sk);
+}
+
+static int kem_enc(OUT uint8_t *ct,
+                   OUT uint8_t *ss,
+                   IN const uint8_t *pk,
+                   IN void *         arg)
+{
+  (void)arg;
+  return crypto_kem_enc(ct, ss, pk);
+}
+
+static int kem_dec(OUT uint8_t *ss,
+                   IN const uint8_t *ct,
+                   IN const uint8_t *sk,
+                   IN void *         arg)
+{
+  (void)arg;
+  return crypto_kem_dec(ss, ct, sk);
+}
+
+static int kem_keypair_ws(OUT uint8_t *pk, OUT uint8_t *sk, IN void *arg)
+{
+  return crypto_kem_keypair_ws(pk, sk, arg);
+}
+
+static int kem_enc_ws(OUT uint8_t *ct,
+                      OUT uint8_t *ss,
+                      IN const uint8_t *pk,
+                      IN void *         arg)
+{
+  return crypto_kem_enc_ws(ct, ss, pk, arg);
+}
+
+static int kem_dec_ws(OUT uint8_t *ss,
+                      IN const uint8_t *ct,
+                      IN const uint8_t *sk,
+                      IN void *         arg)
+{
+  return crypto_kem_dec_ws(ss, ct, sk, arg);
+}
+
+static int kem_keypair_with_ctx(OUT uint8_t *pk, OUT uint8_t *sk, IN void *arg)
+{
+  return crypto_kem_keypair_with_ctx(pk, sk, arg);
+}
+
+static const kem_variant_t kem_default = {kem_keypair, kem_enc, kem_dec};
+static const kem_variant_t kem_ws = {kem_keypair_ws, kem_enc_ws, kem_dec_ws};
+static const kem_variant_t kem_with_ctx = {kem_keypair_with_ctx, kem_enc,
+                                           kem_dec};
+
+// Run a key generation, an encapsulation and a decapsulation of the variant
+// from the randomness of seed, and check that the shared secrets match.
+static int run_kem(OUT kem_out_t *out,
+                   IN const kem_variant_t *v,
+                   IN void *               arg,
+                   IN const unsigned int   seed)
+{
+  srand(seed);
+  int res = v->keypair(out->pk, out->sk, arg);
+  if(res == 0) {
+    res = v->enc(out->ct, out->k_enc, out->pk, arg);
+  }
+  if(res == 0) {
+    res = v->dec(out->k_dec, out->ct, out->sk, arg);
+  }
+  if((res == 0) && (0 != memcmp(out->k_enc, out->k_dec, sizeof(ss_t)))) {
+    res = 1;
+  }
+  return res;
+}
+
+// Check that the variant generates the key pair, ciphertext and shared
+// secret of ref from the same randomness (the seed of ref).
+static void check_kem_matches(IN const char *what,
+                              IN const kem_out_t *ref,
+                              IN const kem_variant_t *v,
+                              IN void *               arg,
+                              IN const unsigned int   seed)
+{
+  kem_out_t out;
+
+  if((run_kem(&out, v, arg, seed) != 0) ||
+     (0 != memcmp(ref->pk, out.pk, sizeof(out.pk))) ||
+     (0 != memcmp(ref->sk, out.sk, sizeof(out.sk))) ||
+     (0 != memcmp(ref->ct, out.ct, sizeof(out.ct))) ||
+     (0 != memcmp(ref->k_dec, out.k_dec, sizeof(out.k_dec)))) {
+    printf("Failure! %s does not match the reference KEM!\n", what);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+//                 The tests of the extensions
+////////////////////////////////////////////////////////////////
+
+// Run a key generation, encapsulation and decapsulation with the given source
+static int rng_round_trip(IN bike_rng_t rng)
+{
+  kem_out_t out;
+
+  bike_set_rng(rng);
+  const int res = run_kem(&out, &kem_default, NULL, rand());
+  bike_set_rng(test_rng);
+
+  return res;
+}
+
+// The randomness sources of the library (RDRAND and RDSEED are not available
+// on every CPU)
+static void test_rng_sources(void)
+{
+  uint8_t rd_buf[1];
+
+  if((rng_round_trip(NULL) != 0) || (rng_round_trip(bike_rng_getrandom) != 0) ||
+     ((bike_rng_rdrand(rd_buf, 1) == 0) &&
+      (rng_round_trip(bike_rng_rdrand) != 0)) ||
+     ((bike_rng_rdseed(rd_buf, 1) == 0) &&
+      (rng_round_trip(bike_rng_rdseed) != 0))) {
+    printf("Failure! a randomness source of the library does not work!\n");
+  }
+}
+
+// Encapsulate BATCH_SIZE ciphertexts to kem->pk and corrupt one of them.
+// k_ref are the shared secrets of crypto_kem_dec.
+static int make_ct_batch(OUT uint8_t ct[BATCH_SIZE][sizeof(ct_t)],
+                         OUT uint8_t k_ref[BATCH_SIZE][sizeof(ss_t)],
+                         IN const kem_out_t *kem)
+{
+  int res = 0;
+
+  for(size_t j = 0; (res == 0) && (j < BATCH_SIZE); j++) {
+    res = crypto_kem_enc(ct[j], k_ref[j], kem->pk);
+  }
+  ct[1][0] ^= 1;
+  if(res == 0) {
+    res = crypto_kem_dec(k_ref[1], ct[1], kem->sk);
+  }
+  return res;
+}
+
+// Decapsulate several ciphertexts with the batched API (one full group of 4
+// ciphertexts and a remainder). One of them is corrupted.
+static void test_dec_batch(IN const kem_out_t *kem)
+{
+  uint8_t              ct_val[BATCH_SIZE][sizeof(ct_t)];
+  uint8_t              k_batch[BATCH_SIZE][sizeof(ss_t)];
+  uint8_t              k_ref[BATCH_SIZE][sizeof(ss_t)];
+  unsigned char *      ss_batch[BATCH_SIZE];
+  const unsigned char *ct_batch[BATCH_SIZE];
+
+  int res = make_ct_batch(ct_val, k_ref, kem);
+  for(size_t j = 0; j < BATCH_SIZE; j++) {
+    ss_batch[j] = k_batch[j];
+    ct_batch[j] = ct_val[j];
+  }
+  if(res == 0) {
+    res = crypto_kem_dec_batch(ss_batch, ct_batch, BATCH_SIZE, kem->sk);
+  }
+  if((res != 0) || (0 != memcmp(k_batch, k_ref, sizeof(k_ref)))) {
+    printf("Failure! batched decapsulation does not match decapsulation!\n");
+  }
+}
+
+// Decapsulate with an expanded private key
+static void test_dec_key(IN const kem_out_t *kem)
+{
+  bike_dec_key_t dec_key;
+  uint8_t        k_dec[sizeof(ss_t)];
+
+  int res = crypto_kem_dec_key_init(&dec_key, kem->sk);
+  if(res == 0) {
+    res = crypto_kem_dec_with_key(k_dec, kem->ct, &dec_key);
+  }
+  crypto_kem_dec_key_clean(&dec_key);
+  if((res != 0) || (0 != memcmp(k_dec, kem->k_dec, sizeof(ss_t)))) {
+    printf("Failure! decapsulation with an expanded key does not match "
+           "decapsulation!\n");
+  }
+
+  // An expanded key that is not aligned is rejected
+  uint8_t *buf = malloc(crypto_kem_dec_key_size() + BIKE_WORKSPACE_ALIGN);
+  if((buf != NULL) &&
+     (crypto_kem_dec_key_init(misalign(buf), kem->sk) != FAIL)) {
+    printf("Failure! a misaligned expanded key is accepted!\n");
+  }
+  free(buf);
+}
+
+// The completion callback of the pipeline test
+static void pipeline_done(void *arg, int res) { *(int *)arg = res; }
+
+// Decapsulate a batch of ciphertexts (one of them corrupted) in a pipeline
+static void test_pipeline(IN const kem_out_t *kem)
+{
+  const bike_pipeline_params_t params   = {.max_in_flight = 3,
+                                         .num_threads   = {2, 1, 1},
+                                         .first_cpu     = {-1, -1, -1}};
+  bike_pipeline_t *            pipeline = NULL;
+  bike_dec_key_t               dec_key;
+  uint8_t                      ct_val[BATCH_SIZE][sizeof(ct_t)];
+  uint8_t                      k_ref[BATCH_SIZE][sizeof(ss_t)];
+  uint8_t                      k_pl[BATCH_SIZE][sizeof(ss_t)];
+  int                          pl_res[BATCH_SIZE];
+
+  int res = make_ct_batch(ct_val, k_ref, kem);
+  if(res == 0) {
+    res = crypto_kem_dec_key_init(&dec_key, kem->sk);
+  }
+  if(res == 0) {
+    res = bike_pipeline_create(&pipeline, &params);
+  }
+  for(size_t j = 0; (res == 0) && (j < BATCH_SIZE); j++) {
+    pl_res[j] = -1;
+    res       = bike_pipeline_submit(pipeline, k_pl[j], ct_val[j], &dec_key,
+                               pipeline_done, &pl_res[j]);
+  }
+  if(res == 0) {
+    bike_pipeline_flush(pipeline);
+  }
+  bike_pipeline_destroy(pipeline);
+  for(size_t j = 0; (res == 0) && (j < BATCH_SIZE); j++) {
+    res = pl_res[j];
+  }
+  crypto_kem_dec_key_clean(&dec_key);
+  if((res != 0) || (0 != memcmp(k_pl, k_ref, sizeof(k_ref)))) {
+    printf("Failure! pipelined decapsulation does not match "
+           "decapsulation!\n");
+  }
+}
+
+// Encapsulate with an expanded public key
+static void test_enc_key(IN const kem_out_t *kem)
+{
+  bike_enc_key_t enc_key;
+  kem_out_t      out;
+
+  int res = crypto_kem_enc_key_init(&enc_key, kem->pk);
+  if(res == 0) {
+    res = crypto_kem_enc_with_key(out.ct, out.k_enc, &enc_key);
+  }
+  if(res == 0) {
+    res = crypto_kem_dec(out.k_dec, out.ct, kem->sk);
+  }
+  if((res != 0) || (0 != memcmp(out.k_enc, out.k_dec, sizeof(ss_t)))) {
+    printf("Failure! encapsulation with an expanded key does not match "
+           "decapsulation!\n");
+  }
+
+  // An expanded key that is not aligned is rejected
+  uint8_t *buf = malloc(crypto_kem_enc_key_size() + BIKE_WORKSPACE_ALIGN);
+  if((buf != NULL) &&
+     (crypto_kem_enc_key_init(misalign(buf), kem->pk) != FAIL)) {
+    printf("Failure! a misaligned expanded key is accepted!\n");
+  }
+  free(buf);
+}
+
+// Expand a compact private key, which recovers the whole private key
+static void test_compact_key(IN const kem_out_t *kem)
+{
+  bike_dec_key_t dec_key;
+  uint8_t        csk[BIKE_COMPACT_SK_BYTES];
+  uint8_t        k_dec[sizeof(ss_t)];
+
+  int res = crypto_kem_sk_compact(csk, kem->sk);
+  if(res == 0) {
+    res = crypto_kem_dec_key_init_compact(&dec_key, csk);
+  }
+  if(res == 0) {
+    res = crypto_kem_dec_with_key(k_dec, kem->ct, &dec_key);
+  }
+  if((res != 0) || (0 != memcmp(&dec_key.sk, kem->sk, sizeof(sk_t))) ||
+     (0 != memcmp(k_dec, kem->k_dec, sizeof(ss_t)))) {
+    printf("Failure! decapsulation with a compact key does not match "
+           "decapsulation!\n");
+  }
+  crypto_kem_dec_key_clean(&dec_key);
+
+  // A compact key with an index out of range, or with a repeated index, is
+  // rejected
+  compact_sk_t bad;
+  for(size_t j = 0; (res == 0) && (j < 2); j++) {
+    bike_memcpy(&bad, csk, sizeof(bad));
+    bad.wlist[1][D - 1] = (j == 0) ? R_BITS : bad.wlist[1][0];
+    if(crypto_kem_dec_key_init_compact(&dec_key, (uint8_t *)&bad) != FAIL) {
+      printf("Failure! an invalid compact key is accepted!\n");
+    }
+  }
+  crypto_kem_dec_key_clean(&dec_key);
+}
+
+// Encapsulate and decapsulate in place on the aligned views
+static void test_views(IN const kem_out_t *kem)
+{
+  bike_pk_view_t pk_view;
+  bike_ct_view_t ct_view;
+  bike_dec_key_t dec_key;
+  kem_out_t      out;
+  uint8_t        k_view[sizeof(ss_t)];
+
+  int res = bike_pk_view_init(&pk_view, kem->pk);
+  if(res == 0) {
+    res = crypto_kem_enc_view(&ct_view, out.k_enc, &pk_view);
+  }
+  if(res == 0) {
+    bike_ct_view_export(out.ct, &ct_view);
+    res = crypto_kem_dec(out.k_dec, out.ct, kem->sk);
+  }
+  if(res == 0) {
+    res = crypto_kem_dec_key_init(&dec_key, kem->sk);
+  }
+  if(res == 0) {
+    res = bike_ct_view_init(&ct_view, out.ct);
+  }
+  if(res == 0) {
+    res = crypto_kem_dec_view(k_view, &ct_view, &dec_key);
+  }
+  crypto_kem_dec_key_clean(&dec_key);
+  if((res != 0) || (0 != memcmp(out.k_enc, out.k_dec, sizeof(ss_t))) ||
+     (0 != memcmp(k_view, out.k_dec, sizeof(ss_t)))) {
+    printf("Failure! the in-place view APIs do not match "
+           "decapsulation!\n");
+  }
+
+  // Views that are not aligned are rejected
+  uint8_t *buf = malloc(sizeof(bike_ct_view_t) + BIKE_WORKSPACE_ALIGN);
+  if((buf != NULL) &&
+     ((crypto_kem_enc_view(misalign(buf), out.k_enc, &pk_view) != FAIL) ||
+      (crypto_kem_dec_view(k_view, misalign(buf), &dec_key) != FAIL))) {
+    printf("Failure! a misaligned view is accepted!\n");
+  }
+  free(buf);
+}
+
+// The workspace APIs and the key generation with the precomputed maps of a
+// keygen context generate the same key pair, ciphertext and shared secret as
+// the APIs without them (from the same randomness).
+static void test_workspace(void)
+{
+  const unsigned int seed   = rand();
+  void *             ws     = NULL;
+  void *             kg_ctx = NULL;
+  kem_out_t          ref;
+
+  if(run_kem(&ref, &kem_default, NULL, seed) != 0) {
+    printf("Failure! the reference KEM does not work!\n");
+    return;
+  }
+
+  if(posix_memalign(&ws, BIKE_WORKSPACE_ALIGN, bike_workspace_size()) == 0) {
+    check_kem_matches("the workspace API", &ref, &kem_ws, ws, seed);
+  }
+  free(ws);
+
+  if((posix_memalign(&kg_ctx, BIKE_WORKSPACE_ALIGN, bike_keygen_ctx_size()) !=
+      0) ||
+     (bike_keygen_ctx_init(kg_ctx) != 0)) {
+    printf("Failure! the keygen context could not be initialized!\n");
+  } else {
+    check_kem_matches("the key generation with a keygen context", &ref,
+                      &kem_with_ctx, kg_ctx, seed);
+  }
+  free(kg_ctx);
+}
+
+// The online encapsulations of a pool (the precomputed ones in order,
+// followed by a full one when the pool is empty) generate the same
+// ciphertexts and shared secrets as crypto_kem_enc_with_key (from the same
+// randomness), and they are decapsulated correctly.
+static void test_enc_pool(IN const kem_out_t *kem)
+{
+  const unsigned int seed = rand();
+  bike_enc_key_t     ep_key;
+  void *             ep_pool = NULL;
+  uint8_t            ep_ref[3][sizeof(ct_t) + sizeof(ss_t)];
+  kem_out_t          out;
+
+  int res = crypto_kem_enc_key_init(&ep_key, kem->pk);
+  srand(seed);
+  for(size_t j = 0; (res == 0) && (j < 3); j++) {
+    res = crypto_kem_enc_with_key(ep_ref[j], &ep_ref[j][sizeof(ct_t)], &ep_key);
+  }
+  if(res == 0) {
+    res =
+      posix_memalign(&ep_pool, BIKE_WORKSPACE_ALIGN, bike_enc_pool_size(2));
+  }
+  if(res == 0) {
+    res = bike_enc_pool_init(ep_pool, 2, &ep_key);
+  }
+  if(res == 0) {
+    srand(seed);
+    res = bike_enc_precompute(ep_pool, 3);
+  }
+  if((res != 0) || (bike_enc_pool_count(ep_pool) != 2)) {
+    printf("Failure! the encapsulation pool is not filled!\n");
+  }
+  for(size_t j = 0; (res == 0) && (j < 3); j++) {
+    res = crypto_kem_enc_online(out.ct, out.k_enc, ep_pool);
+    if(res == 0) {
+      res = crypto_kem_dec(out.k_dec, out.ct, kem->sk);
+    }
+    if((res != 0) || (0 != memcmp(ep_ref[j], out.ct, sizeof(ct_t))) ||
+       (0 != memcmp(&ep_ref[j][sizeof(ct_t)], out.k_enc, sizeof(ss_t))) ||
+       (0 != memcmp(out.k_enc, out.k_dec, sizeof(ss_t)))) {
+      printf("Failure! the online encapsulation does not match "
+             "encapsulation!\n");
+    }
+  }
+  if(ep_pool != NULL) {
+    bike_enc_pool_clean(ep_pool);
+    if(bike_enc_pool_init(ep_pool, 0, &ep_key) != FAIL) {
+      printf("Failure! an empty encapsulation pool is accepted!\n");
+    }
+  }
+  free(ep_pool);
+}
+
+// Generate several key pairs with the batched API (one full batch and a
+// remainder), and the same key pairs with crypto_kem_keypair.
+static void test_keypair_batch(void)
+{
+  const unsigned int seed = rand();
+  unsigned char *    kp_pk = malloc(2 * KEYPAIR_TEST_SIZE * sizeof(pk_t));
+  unsigned char *    kp_sk = malloc(2 * KEYPAIR_TEST_SIZE * sizeof(sk_t));
+  unsigned char *    kp_pk_batch[KEYPAIR_TEST_SIZE];
+  unsigned char *    kp_sk_batch[KEYPAIR_TEST_SIZE];
+
+  int res = ((kp_pk == NULL) || (kp_sk == NULL)) ? 1 : 0;
+  for(size_t j = 0; (res == 0) && (j < KEYPAIR_TEST_SIZE); j++) {
+    kp_pk_batch[j] = &kp_pk[j * sizeof(pk_t)];
+    kp_sk_batch[j] = &kp_sk[j * sizeof(sk_t)];
+  }
+  if(res == 0) {
+    srand(seed);
+    res =
+      crypto_kem_keypair_batch(kp_pk_batch, kp_sk_batch, KEYPAIR_TEST_SIZE);
+  }
+  srand(seed);
+  for(size_t j = KEYPAIR_TEST_SIZE; (res == 0) && (j < 2 * KEYPAIR_TEST_SIZE);
+      j++) {
+    res = crypto_kem_keypair(&kp_pk[j * sizeof(pk_t)], &kp_sk[j * sizeof(sk_t)]);
+  }
+  if((res != 0) ||
+     (0 != memcmp(kp_pk, &kp_pk[KEYPAIR_TEST_SIZE * sizeof(pk_t)],
+                  KEYPAIR_TEST_SIZE * sizeof(pk_t))) ||
+     (0 != memcmp(kp_sk, &kp_sk[KEYPAIR_TEST_SIZE * sizeof(sk_t)],
+                  KEYPAIR_TEST_SIZE * sizeof(sk_t)))) {
+    printf("Failure! batched key generation does not match key "
+           "generation!\n");
+  }
+
+#if !defined(USE_NIST_RAND)
+  // When the randomness runs out in the middle of a batch, the private keys
+  // that were already generated are cleaned
+  bike_set_rng(budget_rng);
+  rng_budget = 2;
+  if((res == 0) &&
+     (crypto_kem_keypair_batch(kp_pk_batch, kp_sk_batch, KEYPAIR_TEST_SIZE) !=
+      FAIL)) {
+    printf("Failure! batched key generation does not fail!\n");
+  }
+  bike_set_rng(test_rng);
+  for(size_t j = 0; (res == 0) && (j < KEYPAIR_BATCH_SIZE * sizeof(sk_t)); j++) {
+    if(kp_sk[j] != 0) {
+      printf("Failure! batched key generation leaves private keys!\n");
+      break;
+    }
+  }
+#endif
+  free(kp_pk);
+  free(kp_sk);
+}
+
+// Take key pairs out of a pool (some of them may be misses)
+static void test_keypool(void)
+{
+  const bike_keypool_params_t params = {.capacity       = 4,
+                                        .low_watermark  = 1,
+                                        .high_watermark = 4,
+                                        .num_threads    = 1};
+  bike_keypool_t *            pool   = NULL;
+  bike_keypool_stats_t        stats  = {0};
+  kem_out_t                   out;
+
+  int res = bike_keypool_create(&pool, &params);
+  for(size_t j = 0; (res == 0) && (j < KEYPAIR_TEST_SIZE); j++) {
+    res = bike_keypool_pop(pool, out.pk, out.sk);
+    if(res == 0) {
+      res = crypto_kem_enc(out.ct, out.k_enc, out.pk);
+    }
+    if(res == 0) {
+      res = crypto_kem_dec(out.k_dec, out.ct, out.sk);
+    }
+    if((res == 0) && (0 != memcmp(out.k_enc, out.k_dec, sizeof(ss_t)))) {
+      res = 1;
+    }
+  }
+  if(res == 0) {
+    bike_keypool_get_stats(&stats, pool);
+  }
+  bike_keypool_destroy(pool);
+  if((res != 0) || ((stats.hits + stats.misses) != KEYPAIR_TEST_SIZE)) {
+    printf("Failure! key pairs of the key pool are incorrect!\n");
+  }
+
+#if !defined(USE_NIST_RAND)
+  // When the key generation keeps failing, the refill threads stop (after
+  // backing off), and the pool returns the errors of the key generation
+  const time_t deadline = time(NULL) + 10;
+  bike_set_rng(failing_rng);
+  stats.refill_stopped = 0;
+  res                  = bike_keypool_create(&pool, &params);
+  while((res == 0) && !stats.refill_stopped && (time(NULL) < deadline)) {
+    bike_keypool_get_stats(&stats, pool);
+  }
+  if((res != 0) || !stats.refill_stopped ||
+     (bike_keypool_pop(pool, out.pk, out.sk) == 0)) {
+    printf("Failure! the key pool does not stop on failures!\n");
+  }
+  bike_keypool_destroy(pool);
+  bike_set_rng(test_rng);
+#endif
+}
+
+// Decapsulate with the keys of a cache of two keys, in the order 0, 0, 1,
+// 2 (evicts 0), 1, 0 (evicts 2).
+static void test_key_cache(void)
+{
+  const size_t order[KEY_CACHE_TEST_SIZE] = {0, 0, 1, 2, 1, 0};
+  const bike_key_cache_params_t params    = {
+    .max_bytes = 2 * bike_key_cache_entry_size(), .num_shards = 1};
+  bike_key_cache_t *     cache = NULL;
+  bike_key_cache_stats_t stats = {0};
+  sk_t                   kc_sk[KEY_CACHE_TEST_KEYS];
+  ct_t                   kc_ct[KEY_CACHE_TEST_KEYS];
+  kem_out_t              out;
+
+  int res = bike_key_cache_create(&cache, &params);
+  for(size_t j = 0; (res == 0) && (j < KEY_CACHE_TEST_KEYS); j++) {
+    res = crypto_kem_keypair(out.pk, (unsigned char *)&kc_sk[j]);
+    if(res == 0) {
+      res = crypto_kem_enc((unsigned char *)&kc_ct[j], out.k_enc, out.pk);
+    }
+  }
+  for(size_t j = 0; (res == 0) && (j < KEY_CACHE_TEST_SIZE); j++) {
+    const unsigned char *key = (const unsigned char *)&kc_sk[order[j]];
+    const unsigned char *c   = (const unsigned char *)&kc_ct[order[j]];
+    res                      = crypto_kem_dec(out.k_enc, c, key);
+    if(res == 0) {
+      res = bike_key_cache_dec(cache, out.k_dec, c, key);
+    }
+    if((res == 0) && (0 != memcmp(out.k_enc, out.k_dec, sizeof(ss_t)))) {
+      res = 1;
+    }
+  }
+  if(res == 0) {
+    bike_key_cache_get_stats(&stats, cache);
+  }
+  bike_key_cache_destroy(cache);
+  if((res != 0) || (stats.hits != 2) || (stats.misses != 4) ||
+     (stats.evictions != 2)) {
+    printf("Failure! decapsulation with the key cache is incorrect!\n");
+  }
+
+  const bike_key_cache_params_t bad = {
+    .max_bytes = bike_key_cache_entry_size(), .num_shards = 2};
+  if(bike_key_cache_create(&cache, &bad) != FAIL) {
+    printf("Failure! a key cache without room for its shards is "
+           "accepted!\n");
+  }
+}
+
+// Run key generation, encapsulation and decapsulation jobs in bulk. With a
+// seed, the key pairs do not depend on the number of threads.
+static void test_bulk(void)
+{
+  const uint8_t   seed[BIKE_BULK_SEED_BYTES] = {1};
+  bike_bulk_job_t kp_jobs[BULK_TEST_SIZE];
+  bike_bulk_job_t enc_jobs[BULK_TEST_SIZE];
+  bike_bulk_job_t dec_jobs[BULK_TEST_SIZE];
+  bulk_test_t *   bulk = calloc(BULK_TEST_SIZE, sizeof(bulk_test_t));
+
+  int res = (bulk == NULL) ? 1 : 0;
+  for(size_t j = 0; (res == 0) && (j < BULK_TEST_SIZE); j++) {
+    kp_jobs[j]  = (bike_bulk_job_t){.op = BIKE_BULK_KEYPAIR,
+                                    .pk = (unsigned char *)&bulk[j].pk[0],
+                                    .sk = (unsigned char *)&bulk[j].sk};
+    enc_jobs[j] = (bike_bulk_job_t){.op = BIKE_BULK_ENC,
+                                    .pk = (unsigned char *)&bulk[j].pk[0],
+                                    .ct = (unsigned char *)&bulk[j].ct,
+                                    .ss = (unsigned char *)&bulk[j].ss_enc};
+    dec_jobs[j] = (bike_bulk_job_t){.op = BIKE_BULK_DEC,
+                                    .sk = (unsigned char *)&bulk[j].sk,
+                                    .ct = (unsigned char *)&bulk[j].ct,
+                                    .ss = (unsigned char *)&bulk[j].ss_dec};
+  }
+  if(res == 0) {
+    res = bike_bulk_run(kp_jobs, BULK_TEST_SIZE, 1, seed);
+  }
+  for(size_t j = 0; (res == 0) && (j < BULK_TEST_SIZE); j++) {
+    bulk[j].pk[1] = bulk[j].pk[0];
+  }
+  if(res == 0) {
+    res = bike_bulk_run(kp_jobs, BULK_TEST_SIZE, 3, seed);
+  }
+#if !defined(USE_NIST_RAND)
+  for(size_t j = 0; (res == 0) && (j < BULK_TEST_SIZE); j++) {
+    res = memcmp(&bulk[j].pk[0], &bulk[j].pk[1], sizeof(pk_t)) ? 1 : 0;
+  }
+#endif
+  if(res == 0) {
+    res = bike_bulk_run(enc_jobs, BULK_TEST_SIZE, 2, NULL);
+  }
+  if(res == 0) {
+    res = bike_bulk_run(dec_jobs, BULK_TEST_SIZE, 2, NULL);
+  }
+  for(size_t j = 0; (res == 0) && (j < BULK_TEST_SIZE); j++) {
+    res = memcmp(&bulk[j].ss_enc, &bulk[j].ss_dec, sizeof(ss_t)) ? 1 : 0;
+  }
+  if(res != 0) {
+    printf("Failure! the bulk jobs are incorrect!\n");
+  }
+  free(bulk);
+}
+
+// The buffers of an arena are aligned, and are wiped when they are released.
+static void test_arena(void)
+{
+  bike_arena_t *arena = NULL;
+  uint8_t *     buf[2];
+
+  int res = bike_arena_create(&arena, 4 * BIKE_ARENA_ALIGN, BIKE_ARENA_LOCAL_NODE);
+  if(res == 0) {
+    buf[0] = bike_arena_alloc(arena, 1);
+    buf[1] = bike_arena_alloc(arena, BIKE_ARENA_ALIGN);
+    res    = (buf[0] == NULL) || (buf[1] != &buf[0][BIKE_ARENA_ALIGN]) ||
+          (((uintptr_t)buf[0] % BIKE_ARENA_ALIGN) != 0) ||
+          (bike_arena_alloc(arena, SIZE_MAX) != NULL);
+  }
+  if(res == 0) {
+    bike_memset(buf[0], 0xff, 1);
+    bike_memset(buf[1], 0xff, BIKE_ARENA_ALIGN);
+    bike_arena_reset(arena);
+    res = (bike_arena_alloc(arena, 2 * BIKE_ARENA_ALIGN) != buf[0]) ||
+          (buf[0][0] != 0) || (buf[1][BIKE_ARENA_ALIGN - 1] != 0);
+  }
+  bike_arena_destroy(arena);
+  if(res != 0) {
+    printf("Failure! the arena is incorrect!\n");
+  }
+}
+
+// Every available ISA generates the same key pair, ciphertext and shared
+// secret as the portable implementation (from the same randomness).
+static void test_isa(void)
+{
+  const unsigned int seed = rand();
+  kem_out_t          ref;
+
+  bike_force_isa(BIKE_ISA_PORTABLE);
+  if(run_kem(&ref, &kem_default, NULL, seed) != 0) {
+    printf("Failure! the portable backend does not work!\n");
+  } else {
+    for(int isa = BIKE_ISA_PORTABLE + 1; isa < BIKE_ISA_NATIVE; isa++) {
+      if(bike_isa_available(isa)) {
+        bike_force_isa(isa);
+        check_kem_matches(bike_isa_name(isa), &ref, &kem_default, NULL, seed);
+      }
+    }
+  }
+  bike_force_isa(BIKE_ISA_NATIVE);
+}
+
+// The sorted secure_set_bits sets the same bits as the portable one (the
+// error vector indices fall in both halves, and may repeat).
+static void test_set_bits_sorted(void)
+{
+  idx_t   wlist[T];
+  pad_r_t set_ref;
+  pad_r_t set_out;
+
+  for(size_t j = 0; j < T; j++) {
+    wlist[j] = ((uint32_t)rand()) % (2 * R_BITS);
+  }
+  wlist[T - 1] = wlist[0];
+
+  for(size_t half = 0; half < N0; half++) {
+    secure_set_bits_port(&set_ref, half * R_BITS, wlist, T);
+    secure_set_bits_sorted(&set_out, half * R_BITS, wlist, T);
+    if(0 != memcmp(&set_ref, &set_out, sizeof(set_ref))) {
+      printf("Failure! the sorted secure_set_bits does not match the "
+             "portable one!\n");
+    }
+  }
+}
+
+// The k-squarings by the precomputed maps match the k-squarings that compute
+// the maps, for every kernel, and so does the inversion (inv_ref is the
+// inverse of a).
+static void test_ksqr_maps(IN const pad_r_t *a,
+                           IN const pad_r_t *inv_ref,
+                           IN OUT gf2x_inv_ws_t *ws,
+                           IN const gf2x_ctx *ctx)
+{
+  void *  ksqr_maps = NULL;
+  pad_r_t ksqr_ref;
+  pad_r_t ksqr_out;
+
+  if(posix_memalign(&ksqr_maps, ALIGN_BYTES, gf2x_ksqr_maps_size()) != 0) {
+    printf("Failure! the k-squaring maps could not be allocated!\n");
+    return;
+  }
+  gf2x_ksqr_maps_t *maps = ksqr_maps;
+  gf2x_ksqr_maps_init(maps);
+
+  gf2x_mod_inv_exp(&ksqr_out, a, maps, ws, ctx);
+  if(0 != memcmp(inv_ref, &ksqr_out, sizeof(*inv_ref))) {
+    printf("Failure! the inversion with the k-squaring maps does not "
+           "match the inversion without them!\n");
+  }
+
+  void (*k_sqr[3])(pad_r_t *, const pad_r_t *, size_t, gf2x_ksqr_ws_t *) = {
+    k_sqr_port, NULL, NULL};
+  void (*k_sqr_map[3])(pad_r_t *, const pad_r_t *, const uint16_t *,
+                       gf2x_ksqr_ws_t *) = {k_sqr_map_port, NULL, NULL};
+#if defined(X86_64)
+  if(is_avx2_enabled()) {
+    k_sqr[1]     = k_sqr_avx2;
+    k_sqr_map[1] = k_sqr_map_avx2;
+  }
+  if(is_avx512_enabled()) {
+    k_sqr[2]     = k_sqr_avx512;
+    k_sqr_map[2] = k_sqr_map_avx512;
+  }
+#endif
+  for(size_t j = 0; j < maps->num_maps; j++) {
+    // The parameter l of a map is its element 1 (map[i] = (i * l) % r)
+    const uint16_t *map = gf2x_ksqr_map(maps, j);
+    for(size_t m = 0; m < 3; m++) {
+      if(k_sqr[m] == NULL) {
+        continue;
+      }
+      k_sqr[m](&ksqr_ref, a, map[1], &ws->u.k_sqr);
+      k_sqr_map[m](&ksqr_out, a, map, &ws->u.k_sqr);
+      if(0 != memcmp(&ksqr_ref.val, &ksqr_out.val, sizeof(ksqr_ref.val))) {
+        printf("Failure! the k-squaring by the map of k=%u (kernel %zu) "
+               "does not match the k-squaring!\n",
+               maps->k[j], m);
+      }
+    }
+  }
+  free(ksqr_maps);
+}
+
+// The inversion computes an inverse, and the inversion by divsteps (with
+// every multiplication by the transition matrices) matches the inversion by
+// exponentiation, for an invertible polynomial of odd weight.
+static void test_inversion(void)
+{
+  DEFER_CLEANUP(gf2x_inv_ws_t inv_ws, gf2x_inv_ws_cleanup);
+  gf2x_ctx inv_ctx = get_dispatch_ctx()->gf2x;
+  pad_r_t  inv_a   = {0};
+  pad_r_t  inv_ref;
+  pad_r_t  inv_out;
+
+  for(size_t j = 0; j < R_BYTES; j++) {
+    inv_a.val.raw[j] = (uint8_t)rand();
+  }
+  inv_a.val.raw[R_BYTES - 1] &= LAST_R_BYTE_MASK;
+  inv_a.val.raw[0] ^= (r_bits_vector_weight(&inv_a.val) % 2) ^ 1;
+
+  gf2x_mod_inv_exp(&inv_ref, &inv_a, NULL, &inv_ws, &inv_ctx);
+  gf2x_mod_mul(&inv_out, &inv_ref, &inv_a);
+  if((inv_out.val.raw[0] != 1) || (r_bits_vector_weight(&inv_out.val) != 1)) {
+    printf("Failure! the inversion does not compute an inverse!\n");
+  }
+
+  test_ksqr_maps(&inv_a, &inv_ref, &inv_ws, &inv_ctx);
+
+  // The kernels that multiply by the transition matrices of the divsteps
+  void (*divstep_mul[3])(uint64_t *, uint64_t *, const uint64_t *,
+                         const uint64_t *, const uint64_t *, size_t) = {
+    gf2x_divstep_mul_port, NULL, NULL};
+#if defined(X86_64)
+  if(is_pclmul_enabled()) {
+    divstep_mul[1] = gf2x_divstep_mul_pclmul;
+  }
+  if(is_vpclmul_enabled()) {
+    divstep_mul[2] = gf2x_divstep_mul_vpclmul;
+  }
+#endif
+  for(size_t j = 0; j < 3; j++) {
+    if(divstep_mul[j] == NULL) {
+      continue;
+    }
+    inv_ctx.divstep_mul = divstep_mul[j];
+    gf2x_mod_inv_divstep(&inv_out, &inv_a, NULL, &inv_ws, &inv_ctx);
+    if(0 != memcmp(&inv_ref, &inv_out, sizeof(inv_ref))) {
+      printf("Failure! the inversion by divsteps (kernel %zu) does not "
+             "match the inversion by exponentiation!\n",
+             j);
+    }
+  }
+}
+
+// An error vector matches its (distinct) indices, and only them
+static void test_cmp_e_wlist(void)
+{
+  idx_t   wlist[T];
+  pad_e_t e_ref;
+
+  for(size_t j = 0; j < T; j++) {
+    wlist[j] = (j * (N_BITS / T)) + (((uint32_t)rand()) % (N_BITS / T));
+  }
+  wlist[T - 1] = IDX_INVALID_VAL;
+  secure_set_bits_port(&e_ref.val[0], 0, wlist, T);
+  secure_set_bits_port(&e_ref.val[1], R_BITS, wlist, T);
+  for(size_t half = 0; half < N0; half++) {
+    e_ref.val[half].val.raw[R_BYTES - 1] &= LAST_R_BYTE_MASK;
+    bike_memset(e_ref.val[half].pad, 0, sizeof(e_ref.val[half].pad));
+  }
+  if(secure_cmp_e_wlist(&e_ref, wlist, T) != 1) {
+    printf("Failure! an error vector does not match its indices!\n");
+  }
+  e_ref.val[1].val.raw[0] ^= 1;
+  if(secure_cmp_e_wlist(&e_ref, wlist, T) != 0) {
+    printf("Failure! an error vector matches other indices!\n");
+  }
+}
+
+#if defined(DELTA_ROTATION)
+// The indices of the key are sorted, and their delta rotations (with every
+// implementation) add the rotations of the syndrome by them to the UPC,
+// starting from the periodic syndrome
+static void test_delta_rotation(IN const aligned_sk_t *sk,
+                                IN const decode_key_t *key)
+{
+  syndrome_t rot_s, rot_win;
+  upc_t      upc_ref, upc_out;
+
+  for(size_t j = 0; j < R_QWORDS; j++) {
+    rot_s.qw[j] = ((uint64_t)rand() << 32) ^ (uint64_t)rand();
+  }
+  rot_s.qw[R_QWORDS - 1] &= LAST_R_QWORD_MASK;
+  dup_port(&rot_s);
+
+  void (*delta_add[3])(upc_t *, syndrome_t *, const rot_step_t *, size_t) = {
+    rotate_right_delta_add_port, NULL, NULL};
+#  if defined(X86_64)
+  if(is_avx2_enabled()) {
+    delta_add[1] = rotate_right_delta_add_avx2;
+  }
+  if(is_avx512_enabled()) {
+    delta_add[2] = rotate_right_delta_add_avx512;
+  }
+#  endif
+  for(size_t col = 0; col < N0; col++) {
+    bike_memset(&upc_ref, 0, sizeof(upc_ref));
+    for(size_t j = 0; j < D; j++) {
+      rotate_right_add_port(&upc_ref, &rot_win, &rot_s, sk->wlist[col].val[j],
+                            SLICES);
+      if((j > 0) && (key->wlist[col].val[j - 1] >= key->wlist[col].val[j])) {
+        printf("Failure! the indices of the decode key are not sorted!\n");
+      }
+    }
+
+    for(size_t k = 0; k < 3; k++) {
+      if(delta_add[k] == NULL) {
+        continue;
+      }
+      bike_memset(&rot_win, 0, sizeof(rot_win));
+      for(size_t x = 0; x < (64 * DELTA_ROT_READ_QWORDS); x++) {
+        const size_t y = x % R_BITS;
+        rot_win.qw[x / 64] |= ((rot_s.qw[y / 64] >> (y % 64)) & 1) << (x % 64);
+      }
+      bike_memset(&upc_out, 0, sizeof(upc_out));
+      for(size_t t = 0; t < DELTA_ROT_STEPS; t++) {
+        delta_add[k](&upc_out, &rot_win, &key->steps[col][t], SLICES);
+      }
+
+      for(size_t j = 0; j < SLICES; j++) {
+        upc_ref.slice[j].u.r.val.raw[R_BYTES - 1] &= LAST_R_BYTE_MASK;
+        upc_out.slice[j].u.r.val.raw[R_BYTES - 1] &= LAST_R_BYTE_MASK;
+        if(0 != memcmp(&upc_ref.slice[j].u.r.val, &upc_out.slice[j].u.r.val,
+                       R_BYTES)) {
+          printf("Failure! the delta rotations (kernel %zu) do not match "
+                 "the rotations!\n",
+                 k);
+          break;
+        }
+      }
+    }
+  }
+}
+#endif
+
+// The decoder with the parameters of the level is the default decoder, it
+// rejects parameters that do not fit the UPCs, and every decoding algorithm
+// decodes the ciphertext to the same errors.
+static void test_decoder_params(void)
+{
+  DEFER_CLEANUP(aligned_sk_t dec_sk, sk_cleanup);
+  DEFER_CLEANUP(decode_key_t key, decode_key_cleanup);
+  DEFER_CLEANUP(e_t e_out, e_cleanup);
+  e_t             e_stats;
+  uint32_t        iters_ref = 0;
+  uint32_t        iters_out = 0;
+  decode_params_t params    = decode_default_params;
+  kem_out_t       kem;
+
+  int res = crypto_kem_keypair(kem.pk, kem.sk);
+  if(res == 0) {
+    res = crypto_kem_enc(kem.ct, kem.k_enc, kem.pk);
+  }
+  bike_memcpy(&dec_sk, kem.sk, sizeof(dec_sk));
+  decode_key_init(&key, &dec_sk);
+  if(res == 0) {
+    res = decode_with_stats(&e_stats, &iters_ref, (ct_t *)kem.ct, &key);
+  }
+  if(res == 0) {
+    res = decode_with_params(&e_out, &iters_out, (ct_t *)kem.ct, &key, &params);
+  }
+  if((res != 0) || (iters_ref != iters_out) ||
+     (0 != memcmp(&e_stats, &e_out, sizeof(e_out)))) {
+    printf("Failure! the decoder with the default parameters does not "
+           "match the decoder!\n");
+  }
+  params.delta = D + 1;
+  if(decode_with_params(&e_out, &iters_out, (ct_t *)kem.ct, &key, &params) !=
+     FAIL) {
+    printf("Failure! the decoder accepts invalid parameters!\n");
+  }
+  const double bad_coeff[] = {-1, NAN, INFINITY};
+  for(size_t j = 0; j < sizeof(bad_coeff) / sizeof(bad_coeff[0]); j++) {
+    decode_params_t bad0 = decode_default_params;
+    decode_params_t bad1 = decode_default_params;
+    bad0.threshold_coeff0 = bad_coeff[j];
+    bad1.threshold_coeff1 = bad_coeff[j];
+    bike_errno            = 0;
+    BIKE_UNUSED_ATT const int rc0 =
+      decode_with_params(&e_out, &iters_out, (ct_t *)kem.ct, &key, &bad0);
+    const _bike_err_t err0 = bike_errno;
+    bike_errno             = 0;
+    BIKE_UNUSED_ATT const int rc1 =
+      decode_with_params(&e_out, &iters_out, (ct_t *)kem.ct, &key, &bad1);
+    if((err0 != E_DECODER_INVALID_PARAMS) ||
+       (bike_errno != E_DECODER_INVALID_PARAMS)) {
+      printf("Failure! the decoder accepts invalid coefficients!\n");
+    }
+  }
+
+  // A threshold above the UPCs flips no bit, so the decoder does not converge
+  params                  = decode_default_params;
+  params.threshold_coeff1 = 1e30;
+  BIKE_UNUSED_ATT const int huge_rc =
+    decode_with_params(&e_out, &iters_out, (ct_t *)kem.ct, &key, &params);
+  if(iters_out != (params.max_it + 1)) {
+    printf("Failure! the decoder converges with a threshold above D!\n");
+  }
+
+  for(uint32_t alg = 0; alg < DECODER_ALGS; alg++) {
+    if((decode_alg_params(&params, (decoder_alg_t)alg) != SUCCESS) ||
+       (decode_with_params(&e_out, &iters_out, (ct_t *)kem.ct, &key, &params) !=
+        SUCCESS) ||
+       (0 != memcmp(&e_stats, &e_out, sizeof(e_out)))) {
+      printf("Failure! decoder algorithm %u does not decode!\n", alg);
+    }
+  }
+  if(decode_alg_params(&params, (decoder_alg_t)DECODER_ALGS) != FAIL) {
+    printf("Failure! an invalid decoder algorithm is accepted!\n");
+  }
+
+#if defined(DELTA_ROTATION)
+  test_delta_rotation(&dec_sk, &key);
+#endif
+}
+
+// The incremental and the multi-buffer hashes match the one-shot hash
+static void test_sha(IN const kem_out_t *kem)
+{
+  sha_dgst_t dgst_ref, dgst_inc;
+  sha_ctx_t  sha_ctx;
+
+  // The incremental hash of a message that is absorbed in pieces of several
+  // lengths is the one-shot hash of the message
+  const size_t split[] = {0, 1, 7, 8, 100, 129, sizeof(pk_t)};
+  if(sha(&dgst_ref, sizeof(pk_t), kem->pk) != SUCCESS) {
+    printf("Failure! sha failed!\n");
+  }
+  for(size_t j = 0; j < sizeof(split) / sizeof(split[0]); j++) {
+    int sha_rc = sha_init(&sha_ctx);
+    for(size_t pos = 0; (sha_rc == SUCCESS) && (pos < sizeof(pk_t));) {
+      const size_t len = ((split[j] == 0) || (pos + split[j] > sizeof(pk_t)))
+                           ? (sizeof(pk_t) - pos)
+                           : split[j];
+      sha_rc           = sha_absorb(&sha_ctx, &kem->pk[pos], len);
+      pos += len;
+    }
+    if(sha_rc == SUCCESS) {
+      sha_rc = sha_final(&dgst_inc, &sha_ctx);
+    }
+    sha_ctx_cleanup(&sha_ctx);
+    if((sha_rc != SUCCESS) ||
+       (0 != memcmp(&dgst_ref, &dgst_inc, sizeof(dgst_ref)))) {
+      printf("Failure! the incremental hash does not match sha!\n");
+    }
+  }
+
+  // The multi-buffer hash of messages (with lengths around the padding
+  // boundaries of SHA-384) is the hash of every one of them. The messages
+  // overlap in x4_buf, which holds the longest message at every offset.
+  const uint32_t x4_len[] = {0, 111, 112, 128, 240, 1000};
+  uint8_t        x4_buf[1000 + SHA_X4_WAYS];
+  for(size_t i = 0; i < sizeof(x4_buf); i++) {
+    x4_buf[i] = (uint8_t)rand();
+  }
+  for(size_t j = 0; j < sizeof(x4_len) / sizeof(x4_len[0]); j++) {
+    const uint8_t *x4_msg[SHA_X4_WAYS];
+    sha_dgst_x4_t  x4_dgst;
+    int            x4_rc = SUCCESS;
+
+    for(size_t l = 0; l < SHA_X4_WAYS; l++) {
+      x4_msg[l] = &x4_buf[l];
+    }
+    x4_rc = sha_x4(&x4_dgst, x4_len[j], x4_msg);
+    for(size_t l = 0; (x4_rc == SUCCESS) && (l < SHA_X4_WAYS); l++) {
+      x4_rc = sha(&dgst_ref, x4_len[j], x4_msg[l]);
+      if(0 != memcmp(&dgst_ref, &x4_dgst.val[l], sizeof(dgst_ref))) {
+        x4_rc = FAIL;
+      }
+    }
+    if(x4_rc != SUCCESS) {
+      printf("Failure! the multi-buffer hash does not match sha!\n");
+    }
+  }
+
+#if defined(USE_SHA3_AND_SHAKE)
+  uint8_t  shake_ref[2 * SHAKE256_RATE], shake_inc[2 * SHAKE256_RATE];
+  uint64_t shake_s[26];
+  shake256(shake_ref, sizeof(shake_ref), kem->ct, sizeof(ct_t));
+  shake256_inc_init(shake_s);
+  shake256_inc_absorb(shake_s, kem->ct, 3);
+  shake256_inc_absorb(shake_s, &kem->ct[3], sizeof(ct_t) - 3);
+  shake256_inc_finalize(shake_s);
+  shake256_squeeze(shake_inc, 2, shake_s);
+  if(0 != memcmp(shake_ref, shake_inc, sizeof(shake_ref))) {
+    printf("Failure! the incremental SHAKE256 does not match shake256!\n");
+  }
+#endif
+}
+
+#if defined(INTRA_OP_PARALLEL)
+// The helper threads generate the same key pair, ciphertext and shared
+// secret as the calling thread alone (from the same randomness).
+static void test_parallel(void)
+{
+  const unsigned int seed = rand();
+  kem_out_t          ref;
+  char               what[64];
+
+  if(run_kem(&ref, &kem_default, NULL, seed) != 0) {
+    printf("Failure! the KEM does not work without helper threads!\n");
+    return;
+  }
+
+  for(size_t helpers = 1; helpers <= BIKE_PARALLEL_MAX_HELPERS; helpers++) {
+    if(bike_parallel_start(helpers) != 0) {
+      printf("Failure! the helper threads could not be started!\n");
+      continue;
+    }
+    snprintf(what, sizeof(what), "the KEM with %zu helper threads", helpers);
+    check_kem_matches(what, &ref, &kem_default, NULL, seed);
+    bike_parallel_stop();
+  }
+}
+#endif
+
+#if defined(BIKE_PROFILE)
+// The stages of the decapsulations of this thread were counted
+static void test_profile(void)
+{
+  bike_profile_t profile;
+
+  if((bike_profile_get(&profile) != 0) ||
+     (profile.calls[BIKE_PROFILE_COMPUTE_SYNDROME] == 0) ||
+     (profile.calls[BIKE_PROFILE_FIND_ERR1] == 0) ||
+     (profile.calls[BIKE_PROFILE_FUNCTION_H] == 0)) {
+    printf("Failure! the profile counters are incorrect!\n");
+  }
+  for(int stage = 0; stage < BIKE_PROFILE_NUM_STAGES; stage++) {
+    printf("Profile: %-16s %8lu calls %12lu cycles\n",
+           bike_profile_stage_name(stage), (unsigned long)profile.calls[stage],
+           (unsigned long)profile.cycles[stage]);
+  }
+  bike_profile_reset();
+}
+#endif
+
+#if defined(DECODE_TRACE)
+// Every iteration of a decapsulation is recorded, and the last one ends with
+// a zero syndrome
+static void test_decode_trace(void)
+{
+  bike_decode_record_t trace[BIKE_DECODE_TRACE_SIZE];
+  size_t               num_records = 0;
+  kem_out_t            out;
+
+  bike_decode_trace_reset();
+  if((crypto_kem_keypair(out.pk, out.sk) != 0) ||
+     (crypto_kem_enc(out.ct, out.k_enc, out.pk) != 0) ||
+     (crypto_kem_dec(out.k_dec, out.ct, out.sk) != 0) ||
+     (bike_decode_trace_read(trace, BIKE_DECODE_TRACE_SIZE, &num_records) !=
+      0) ||
+     (num_records == 0) ||
+     (trace[num_records - 1].syndrome_weight[BIKE_DECODE_TRACE_STEPS] != 0)) {
+    printf("Failure! the decoder trace is incorrect!\n");
+  }
+  for(size_t j = 0; j < num_records; j++) {
+    if((trace[j].decode != 0) || (trace[j].iter != j)) {
+      printf("Failure! the decoder trace records are out of order!\n");
+    }
+  }
+}
+#endif
+
+#if defined(MULTI_LEVEL)
+// Run every level of the multi-level build through the runtime dispatcher
+static void test_multi_level(void)
+{
+  for(size_t l = 0; l < bike_num_levels(); l++) {
+    const bike_level_params_t *params = bike_get_level_by_index(l);
+
+    unsigned char *l_sk    = malloc(params->sk_bytes);
+    unsigned char *l_pk    = malloc(params->pk_bytes);
+    unsigned char *l_ct    = malloc(params->ct_bytes);
+    unsigned char *l_k_enc = malloc(params->ss_bytes);
+    unsigned char *l_k_dec = malloc(params->ss_bytes);
+
+    if((l_sk == NULL) || (l_pk == NULL) || (l_ct == NULL) ||
+       (l_k_enc == NULL) || (l_k_dec == NULL) ||
+       (params->keypair(l_pk, l_sk) != 0) ||
+       (params->enc(l_ct, l_k_enc, l_pk) != 0) ||
+       (params->dec(l_k_dec, l_ct, l_sk) != 0) ||
+       (0 != memcmp(l_k_enc, l_k_dec, params->ss_bytes))) {
+      printf("Failure! level %u of the multi-level build\n", params->level);
+    } else {
+      printf("Success! level %u of the multi-level build\n", params->level);
+    }
+
+    free(l_sk);
+    free(l_pk);
+    free(l_ct);
+    free(l_k_enc);
+    free(l_k_dec);
+  }
+}
+#endif
+
 ////////////////////////////////////////////////////////////////
 //                 Main function for testing
 ////////////////////////////////////////////////////////////////
 int main()
 {
-  // Initialize the CPU features flags
-  cpu_features_init();
-
 #if defined(FIXED_SEED)
   srand(0);
 #else
   srand(time(NULL));
 #endif
+  bike_set_rng(test_rng);
+
+  test_rng_sources();
 
   magic_number_t magic = {0xa1234567b1234567, 0xc1234567d1234567,
                           0xe1234567f1234567, 0x0123456711234567};
@@ -98,7 +1373,7 @@ int main()
       }
     }
 
-    // Check magic numbers (memory overflow) 
+    // Check magic numbers (memory overflow)
     CHECK_MAGIC(sk);
     CHECK_MAGIC(pk);
     CHECK_MAGIC(ct);
@@ -109,7 +1384,53 @@ int main()
           SIZEOF_BITS(k_enc.val));
     print("Responder's computed key (K) of 256 bits  = ", (uint64_t *)k_dec.val,
           SIZEOF_BITS(k_enc.val));
+
+    // The extensions are checked against the key pair and ciphertext of this
+    // round trip
+    kem_out_t kem;
+    bike_memcpy(kem.pk, pk.val, sizeof(kem.pk));
+    bike_memcpy(kem.sk, sk.val, sizeof(kem.sk));
+    bike_memcpy(kem.ct, ct.val, sizeof(kem.ct));
+    bike_memcpy(kem.k_enc, k_enc.val, sizeof(kem.k_enc));
+    bike_memcpy(kem.k_dec, k_dec.val, sizeof(kem.k_dec));
+
+    test_dec_batch(&kem);
+    test_dec_key(&kem);
+    test_pipeline(&kem);
+    test_enc_key(&kem);
+    test_compact_key(&kem);
+    test_views(&kem);
+    test_enc_pool(&kem);
+    test_sha(&kem);
+    test_workspace();
+    test_keypair_batch();
+    test_keypool();
+    test_key_cache();
+    test_bulk();
+    test_arena();
+    test_set_bits_sorted();
+    test_inversion();
+    test_cmp_e_wlist();
+    test_decoder_params();
   }
 
+  test_isa();
+
+#if defined(INTRA_OP_PARALLEL)
+  test_parallel();
+#endif
+
+#if defined(BIKE_PROFILE)
+  test_profile();
+#endif
+
+#if defined(DECODE_TRACE)
+  test_decode_trace();
+#endif
+
+#if defined(MULTI_LEVEL)
+  test_multi_level();
+#endif
+
   return 0;
 }
@@ -39,11 +39,11 @@ function test_kats {
 
           cmake -DCMAKE_BUILD_TYPE=$build_type -DLEVEL=$level -DUSE_NIST_RAND=1 ${flag} ${extra_flag} ../../;
           make -j
-          ./bike-test
+          # Reproduce the records of the KAT file in parallel
           if [ "$level" = "1" ]; then
-            diff PQCkemKAT_BIKE_5223.rsp ../../tests/kats/${kat_l1} > /dev/null
+            ./bike-katcheck ../../tests/kats/${kat_l1}
           else
-            diff PQCkemKAT_BIKE_10105.rsp ../../tests/kats/${kat_l3} > /dev/null
+            ./bike-katcheck ../../tests/kats/${kat_l3}
           fi
           rm -rf *
         done